@@ -14,7 +14,7 @@ RUN set -x && \
     apt-get install -y apt-utils software-properties-common clang-format && \
     add-apt-repository ppa:ubuntu-toolchain-r/test && \
     apt-get update -y && \
-    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc-10 libmicrohttpd-dev doxygen graphviz && \
+    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc-10 libmicrohttpd-dev zlib1g-dev libzstd-dev doxygen graphviz && \
     rm -f /usr/bin/gcc && \
     ln -s /usr/bin/gcc-10 /usr/bin/gcc && \
     curl -sL https://github.com/Kitware/CMake/releases/download/v3.14.5/cmake-3.14.5-Linux-x86_64.tar.gz | tar xzf - -C /opt && \
@@ -46,7 +46,7 @@ ENV GCC_VERSION 10.1.0
 RUN set -x && \
     apt-get update && \
     apt-get install -y apt-utils clang-format && \
-    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc libmicrohttpd-dev doxygen graphviz && \
+    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc libmicrohttpd-dev zlib1g-dev libzstd-dev doxygen graphviz && \
     curl -sL https://github.com/Kitware/CMake/releases/download/v3.14.5/cmake-3.14.5-Linux-x86_64.tar.gz | tar xzf - -C /opt && \
     cp /opt/cmake-3.14.5-Linux-x86_64/bin/* /usr/local/bin/ && \
     cp -R /opt/cmake-3.14.5-Linux-x86_64/share/cmake-3.14 /usr/local/share/ && \
@@ -76,7 +76,7 @@ ENV GCC_VERSION 10.1.0
 RUN set -x && \
     apt-get update && \
     apt-get install -y apt-utils && \
-    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc libmicrohttpd-dev doxygen graphviz && \
+    apt-get install -y curl tar build-essential git pkg-config gdb valgrind gcc libmicrohttpd-dev zlib1g-dev libzstd-dev doxygen graphviz && \
     curl -sL https://github.com/Kitware/CMake/releases/download/v3.14.5/cmake-3.14.5-Linux-x86_64.tar.gz | tar xzf - -C /opt && \
     cp /opt/cmake-3.14.5-Linux-x86_64/bin/* /usr/local/bin/ && \
     cp -R /opt/cmake-3.14.5-Linux-x86_64/share/cmake-3.14 /usr/local/share/ && \
@@ -0,0 +1,129 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file prom_map_bench.c
+ * @brief Measures the heap footprint of a prom_map_t along with the time taken to set, get and iterate its keys. The
+ * slowest single set is reported as well since it bounds how long a writer may hold the map lock.
+ *
+ * Usage: prom_map_bench [keys...]
+ *
+ * Each size given is measured in turn, 1k, 100k and 1M keys by default. Keys are rendered up front so only the map is
+ * measured. Lookups visit the keys in a shuffled order so that consecutive lookups do not touch neighbouring entries.
+ */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Private
+#include "prom_map_i.h"
+#include "prom_map_t.h"
+
+static size_t prom_map_bench_heap_used(void) {
+#if defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+  return (size_t)info.uordblks + (size_t)info.hblkhd;
+}
+
+static double prom_map_bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int prom_map_bench_run(size_t count) {
+  char **keys = malloc(sizeof(char *) * count);
+  size_t *order = malloc(sizeof(size_t) * count);
+  if (keys == NULL || order == NULL) return 1;
+  for (size_t i = 0; i < count; i++) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "http_requests_total_%zu", i);
+    keys[i] = strdup(buf);
+    order[i] = i;
+  }
+
+  // Fisher-Yates with a fixed xorshift seed keeps runs comparable
+  uint64_t x = 88172645463325252ULL;
+  for (size_t i = count - 1; i > 0; i--) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    size_t j = x % (i + 1);
+    size_t tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+
+  size_t heap_start = prom_map_bench_heap_used();
+  prom_map_t *map = prom_map_new();
+  if (map == NULL) return 1;
+
+  double set_elapsed = 0.0;
+  double set_max = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    double start = prom_map_bench_now();
+    if (prom_map_set(map, keys[i], keys[i])) return 1;
+    double elapsed = prom_map_bench_now() - start;
+    set_elapsed += elapsed;
+    if (elapsed > set_max) set_max = elapsed;
+  }
+  size_t heap_end = prom_map_bench_heap_used();
+
+  double start = prom_map_bench_now();
+  for (size_t i = 0; i < count; i++) {
+    if (prom_map_get(map, keys[order[i]]) != keys[order[i]]) return 1;
+  }
+  double get_elapsed = prom_map_bench_now() - start;
+
+  size_t visited = 0;
+  size_t cursor = 0;
+  start = prom_map_bench_now();
+  while (prom_map_next(map, &cursor) != NULL) visited++;
+  double iterate_elapsed = prom_map_bench_now() - start;
+  if (visited != count) return 1;
+
+  printf("%10zu %14.1f %10.1f %14.1f %10.1f %12.1f\n", count, (double)(heap_end - heap_start) / (double)count,
+         set_elapsed / (double)count, set_max / 1e3, get_elapsed / (double)count, iterate_elapsed / (double)count);
+
+  if (prom_map_destroy(map)) return 1;
+  for (size_t i = 0; i < count; i++) free(keys[i]);
+  free(keys);
+  free(order);
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  printf("%10s %14s %10s %14s %10s %12s\n", "keys", "bytes/key", "ns/set", "max us/set", "ns/get", "ns/iterate");
+  if (argc == 1) {
+    return prom_map_bench_run(1000) || prom_map_bench_run(100000) || prom_map_bench_run(1000000);
+  }
+  for (int i = 1; i < argc; i++) {
+    size_t count = strtoul(argv[i], NULL, 10);
+    if (count == 0) {
+      fprintf(stderr, "usage: %s [keys...]\n", argv[0]);
+      return 1;
+    }
+    if (prom_map_bench_run(count)) return 1;
+  }
+  return 0;
+}
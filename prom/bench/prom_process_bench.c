@@ -0,0 +1,65 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file prom_process_bench.c
+ * @brief Measures the rate at which the process collector collects the metrics of the running process, reading its
+ * files under /proc on every call as a scrape would.
+ *
+ * Usage: prom_process_bench [calls]
+ *
+ * 100k calls are made by default, after a few warm up calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Public
+#include "prom.h"
+
+// Private
+#include "prom_collector_t.h"
+
+static double prom_process_bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(int argc, const char **argv) {
+  size_t calls = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+  if (calls == 0) return 1;
+
+  prom_collector_t *collector = prom_collector_process_new(NULL, NULL);
+  if (collector == NULL) return 1;
+
+  for (int i = 0; i < 100; i++) {
+    if (collector->collect_fn(collector) == NULL) return 1;
+  }
+
+  double start = prom_process_bench_now();
+  for (size_t i = 0; i < calls; i++) {
+    if (collector->collect_fn(collector) == NULL) return 1;
+  }
+  double elapsed = prom_process_bench_now() - start;
+
+  printf("%10s %14s %12s\n", "calls", "calls/s", "us/call");
+  printf("%10zu %14.0f %12.2f\n", calls, (double)calls / (elapsed / 1e9), elapsed / (double)calls / 1e3);
+
+  return prom_collector_destroy(collector);
+}
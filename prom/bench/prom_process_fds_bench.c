@@ -0,0 +1,106 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file prom_process_fds_bench.c
+ * @brief Compares the methods of counting the open file descriptors of the running process while it holds a given
+ * number of descriptors.
+ *
+ * Usage: prom_process_fds_bench [fds...]
+ *
+ * 1k and 100k descriptors are held by default. The soft RLIMIT_NOFILE is raised to the hard limit first, and counts
+ * beyond it are clamped.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+// Private
+#include "prom_process_fds_i.h"
+
+typedef int (*prom_process_fds_bench_fn)(const char *path);
+
+static double prom_process_fds_bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Calls fn for at least 200ms and prints the time per call
+static int prom_process_fds_bench_run(const char *name, prom_process_fds_bench_fn fn, size_t fds) {
+  int count = fn(NULL);
+  if (count < 0) {
+    printf("%10zu %10s %12s\n", fds, name, "unsupported");
+    return 0;
+  }
+
+  size_t calls = 0;
+  double start = prom_process_fds_bench_now();
+  double elapsed = 0.0;
+  do {
+    if (fn(NULL) != count) return 1;
+    calls++;
+    elapsed = prom_process_fds_bench_now() - start;
+  } while (elapsed < 2e8);
+
+  printf("%10zu %10s %12d %14.2f\n", fds, name, count, elapsed / (double)calls / 1e3);
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  size_t default_fds[] = {1000, 100000};
+  size_t runs = (argc > 1) ? (size_t)(argc - 1) : sizeof(default_fds) / sizeof(default_fds[0]);
+
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit)) return 1;
+  limit.rlim_cur = limit.rlim_max;
+  if (setrlimit(RLIMIT_NOFILE, &limit)) return 1;
+
+  int base = prom_process_fds_count(NULL);
+  if (base < 0) return 1;
+
+  printf("%10s %10s %12s %14s\n", "fds", "method", "count", "us/call");
+  for (size_t i = 0; i < runs; i++) {
+    size_t fds = (argc > 1) ? strtoul(argv[i + 1], NULL, 10) : default_fds[i];
+    if (limit.rlim_cur != RLIM_INFINITY && fds + (size_t)base + 16 > limit.rlim_cur) {
+      size_t clamped = (size_t)limit.rlim_cur - (size_t)base - 16;
+      fprintf(stderr, "%zu descriptors exceed RLIMIT_NOFILE %zu; holding %zu\n", fds, (size_t)limit.rlim_cur, clamped);
+      fds = clamped;
+    }
+
+    int *held = (int *)malloc(fds * sizeof(int));
+    if (held == NULL) return 1;
+    for (size_t j = 0; j < fds; j++) {
+      held[j] = open("/dev/null", O_RDONLY);
+      if (held[j] < 0) return 1;
+    }
+
+    int r = prom_process_fds_bench_run("stat", prom_process_fds_count_stat, fds);
+    if (r == 0) r = prom_process_fds_bench_run("getdents", prom_process_fds_count_getdents, fds);
+    if (r == 0) r = prom_process_fds_bench_run("readdir", prom_process_fds_count_readdir, fds);
+
+    for (size_t j = 0; j < fds; j++) close(held[j]);
+    free(held);
+    held = NULL;
+    if (r) return r;
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file prom_series_bench.c
+ * @brief Measures the heap footprint of a series for each metric type along with the time taken to create a series and
+ * to update an existing one.
+ *
+ * Usage: prom_series_bench [series]
+ *
+ * Each metric has two labels. Heap usage is read from the allocator before and after the series are created, so the
+ * figures include every allocation made on behalf of a series: the map entry, the key, the sample and its labels. The
+ * metrics share their label values, so the strings are interned while the first metric is being populated.
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Public
+#include "prom.h"
+
+#define PROM_SERIES_BENCH_DEFAULT_SERIES 100000
+
+static size_t prom_series_bench_heap_used(void) {
+#if defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+  return (size_t)info.uordblks + (size_t)info.hblkhd;
+}
+
+static double prom_series_bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+typedef enum prom_series_bench_type {
+  PROM_SERIES_BENCH_COUNTER,
+  PROM_SERIES_BENCH_GAUGE,
+  PROM_SERIES_BENCH_HISTOGRAM
+} prom_series_bench_type_t;
+
+static int prom_series_bench_update(prom_series_bench_type_t type, void *metric, size_t series, char *path,
+                                    size_t path_size, const char **label_values) {
+  for (size_t i = 0; i < series; i++) {
+    snprintf(path, path_size, "/api/v1/item/%zu", i);
+    int r = 0;
+    switch (type) {
+      case PROM_SERIES_BENCH_COUNTER:
+        r = prom_counter_inc(metric, label_values);
+        break;
+      case PROM_SERIES_BENCH_GAUGE:
+        r = prom_gauge_set(metric, 1.0, label_values);
+        break;
+      case PROM_SERIES_BENCH_HISTOGRAM:
+        r = prom_histogram_observe(metric, 0.1, label_values);
+        break;
+    }
+    if (r) return r;
+  }
+  return 0;
+}
+
+static int prom_series_bench_run(prom_series_bench_type_t type, const char *name, size_t series) {
+  const char *label_keys[] = {"path", "method"};
+  char path[64];
+  const char *label_values[] = {path, "GET"};
+
+  void *metric = NULL;
+  switch (type) {
+    case PROM_SERIES_BENCH_COUNTER:
+      metric = prom_counter_new(name, "benchmark", 2, label_keys);
+      break;
+    case PROM_SERIES_BENCH_GAUGE:
+      metric = prom_gauge_new(name, "benchmark", 2, label_keys);
+      break;
+    case PROM_SERIES_BENCH_HISTOGRAM:
+      metric = prom_histogram_new(name, "benchmark", prom_histogram_buckets_exponential(0.005, 2.0, 12), 2,
+                                  label_keys);
+      break;
+  }
+  if (metric == NULL) return 1;
+  size_t heap_start = prom_series_bench_heap_used();
+
+  double start = prom_series_bench_now();
+  if (prom_series_bench_update(type, metric, series, path, sizeof(path), label_values)) return 1;
+  double create_elapsed = prom_series_bench_now() - start;
+  size_t heap_end = prom_series_bench_heap_used();
+
+  // Updating the series again measures the lookup of an existing series
+  start = prom_series_bench_now();
+  if (prom_series_bench_update(type, metric, series, path, sizeof(path), label_values)) return 1;
+  double update_elapsed = prom_series_bench_now() - start;
+
+  printf("%-10s %10zu %16.1f %14.1f %14.1f\n", name, series, (double)(heap_end - heap_start) / (double)series,
+         create_elapsed / (double)series, update_elapsed / (double)series);
+
+  // The metric is destroyed through the counter destructor. Every metric type shares the same one.
+  return prom_counter_destroy(metric);
+}
+
+int main(int argc, const char **argv) {
+  size_t series = PROM_SERIES_BENCH_DEFAULT_SERIES;
+  if (argc > 1) series = strtoul(argv[1], NULL, 10);
+  if (series == 0) {
+    fprintf(stderr, "usage: %s [series]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%-10s %10s %16s %14s %14s\n", "metric", "series", "bytes/series", "ns/create", "ns/update");
+  if (prom_series_bench_run(PROM_SERIES_BENCH_COUNTER, "counter", series)) return 1;
+  if (prom_series_bench_run(PROM_SERIES_BENCH_GAUGE, "gauge", series)) return 1;
+  if (prom_series_bench_run(PROM_SERIES_BENCH_HISTOGRAM, "histogram", series)) return 1;
+  return 0;
+}
@@ -81,6 +81,21 @@ limitations under the License.
  * This function will increment the default metric sample for my_counter. Since we are not using metric labels, we pass
  * NULL as the second argument.
  *
+ * Each update resolves the metric sample from the given label values. If a code path updates the same label set
+ * repeatedly, resolve the sample once and update it through a child handle instead:
+ *
+ * @code{.c}
+ *
+ * prom_counter_child_t *get_requests = prom_counter_with_labels(requests_counter, (const char *[]){"GET"});
+ *
+ * void handle_get(void) {
+ *   prom_counter_child_inc(get_requests);
+ * }
+ * @endcode
+ *
+ * Child handles are available for counters, gauges and histograms and remain valid until the metric is destroyed or
+ * their series is removed by prom_metric_remove.
+ *
  * @section Program-Initialization Program Initialization
  *
  * At the start of the program's main function you need to do two things:
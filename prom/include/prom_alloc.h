@@ -30,6 +30,11 @@ limitations under the License.
  */
 #define prom_malloc malloc
 
+/**
+ * @brief Redefine this macro if you wish to override it. The default value is calloc.
+ */
+#define prom_calloc calloc
+
 /**
  * @brief Redefine this macro if you wish to override it. The default value is realloc.
  */
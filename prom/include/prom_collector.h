@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef PROM_COLLECTOR_H
 #define PROM_COLLECTOR_H
 
+#include <stdbool.h>
+
 #include "prom_map.h"
 #include "prom_metric.h"
 
@@ -51,14 +53,41 @@ prom_collector_t *prom_collector_new(const char *name);
 
 /**
  *@brief Construct a prom_collector_t* which includes the default process metrics
- * @param limits_path Pass NULL to discover the path to the /proc/[pid]/limits file associated with process ID assigned
- *                    by the host environment. Otherwise, pass a string to said path.
+ *
+ * The files are opened once by the constructor, so a process that forks must construct a new collector in the child to
+ * report on the child. The stat file is read again on every collection. Limits rarely change: those of the calling
+ * process are queried with getrlimit, and a limits file given by path is read again at most once a minute. Returns
+ * NULL if a file cannot be opened.
+ *
+ * The status and io files and the task directory are looked up next to the stat file. They add context switches, IO
+ * bytes and the CPU time of the threads of each name. Those metrics are left out if their file cannot be read, as
+ * /proc/[pid]/io cannot be in some containers. Only the first 64 thread names found get a series of their own; the
+ * threads of any further name are counted under the name __overflow__.
+ *
+ * @param limits_path Pass NULL to query the limits of the calling process with getrlimit. Otherwise, pass the path to a
+ *                    /proc/[pid]/limits file.
  * @param stat_path Pass NULL to discover the path to the /proc/[pid]/stat file associated with process ID assigned
  *                  by the host environment. Otherwise, pass a string to said path.
  * @return The constructed prom_collector_t*
  */
 prom_collector_t *prom_collector_process_new(const char *limits_path, const char *stat_path);
 
+/**
+ * @brief Construct a prom_collector_t* which reports the heap statistics of the allocator, so that the memory used by
+ * metrics can be told apart from heap growth of the application. The collector is not registered by default:
+ *
+ *     prom_collector_registry_register_collector(PROM_COLLECTOR_REGISTRY_DEFAULT, prom_collector_allocator_new(false));
+ *
+ * glibc malloc is queried with mallinfo2, and jemalloc with mallctl when libprom is built against it by setting
+ * JEMALLOC=1 while running cmake. Both lock the arenas of the allocator while they gather statistics, and glibc walks
+ * their free lists, so a collection costs more the more fragmented the heap is.
+ *
+ * @param arenas Pass true to report the statistics of each arena as well, labelled by arena number. glibc reads these
+ *               with malloc_info, which costs another walk of the arenas.
+ * @return The constructed prom_collector_t*, or NULL if the allocator does not report statistics
+ */
+prom_collector_t *prom_collector_allocator_new(bool arenas);
+
 /**
  * @brief Destroy a collector. You MUST set self to NULL after destruction.
  * @param self The target prom_collector_t*
@@ -30,6 +30,20 @@ limitations under the License.
  */
 typedef struct prom_collector_registry prom_collector_registry_t;
 
+/**
+ * @brief The formats in which a registry may expose its metrics
+ *
+ * References:
+ *   * Text: https://prometheus.io/docs/instrumenting/exposition_formats/
+ *   * OpenMetrics: https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md
+ *   * Protobuf: https://github.com/prometheus/client_model/blob/master/io/prometheus/client/metrics.proto
+ */
+typedef enum prom_exposition_format {
+  PROM_EXPOSITION_FORMAT_TEXT,        /**< The Prometheus text format, version 0.0.4 */
+  PROM_EXPOSITION_FORMAT_OPENMETRICS, /**< The OpenMetrics text format, version 1.0.0 */
+  PROM_EXPOSITION_FORMAT_PROTOBUF     /**< Varint length delimited io.prometheus.client.MetricFamily messages */
+} prom_exposition_format_t;
+
 /**
  * @brief Initialize the default registry by calling prom_collector_registry_init within your program. You MUST NOT
  * modify this value.
@@ -63,6 +77,32 @@ int prom_collector_registry_destroy(prom_collector_registry_t *self);
  */
 int prom_collector_registry_enable_process_metrics(prom_collector_registry_t *self);
 
+/**
+ * @brief Enable caching of the metric exposition on the given collector registry
+ *
+ * Once enabled, prom_collector_registry_bridge and prom_collector_registry_stream_t serve the most recently rendered
+ * exposition until it is older than max_age_ms. When it expires, the next scrape renders the registry again while
+ * concurrent scrapes wait for that rendering instead of repeating it. Caching is disabled by default.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param max_age_ms The maximum age of the cached exposition in milliseconds. 0 disables caching.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_enable_cache(prom_collector_registry_t *self, unsigned int max_age_ms);
+
+/**
+ * @brief Limits the total number of series of the metrics registered with the given collector registry. Returns a
+ * non-zero integer value upon failure.
+ *
+ * Once the limit is reached, updates to new series of any registered metric are handled according to the overflow
+ * policy of that metric, see prom_metric_set_series_limit. Series created before the limit was set count against it.
+ *
+ * @param self The target prom_collector_registry_t*
+ * @param max_series The maximum number of series. Pass 0 to lift the limit.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_set_series_limit(prom_collector_registry_t *self, size_t max_series);
+
 /**
  * @brief Registers a metric with the default collector on PROM_DEFAULT_COLLECTOR_REGISTRY
  *
@@ -106,6 +146,58 @@ int prom_collector_registry_register_collector(prom_collector_registry_t *self,
  */
 const char *prom_collector_registry_bridge(prom_collector_registry_t *self);
 
+/**
+ * @brief A prom_collector_registry_stream_t produces the metric exposition of a registry incrementally.
+ *
+ * Unlike prom_collector_registry_bridge, a stream never materializes the whole exposition. Metrics are rendered one at
+ * a time as the caller reads, so memory use is bounded by the largest single metric rather than the registry.
+ */
+typedef struct prom_collector_registry_stream prom_collector_registry_stream_t;
+
+/**
+ * @brief Constructs a prom_collector_registry_stream_t* positioned at the start of the exposition of the given
+ * registry. The stream MUST be destroyed before the registry.
+ * @param registry The prom_collector_registry_t* to expose
+ * @return The constructed prom_collector_registry_stream_t* or NULL upon failure
+ */
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *registry);
+
+/**
+ * @brief Constructs a prom_collector_registry_stream_t* positioned at the start of the exposition of the given
+ * registry in the given format. The stream MUST be destroyed before the registry.
+ *
+ * Every format is rendered metric by metric from the same traversal of the registry. OpenMetrics adds the _created
+ * series of counters and histograms, any exemplars and the closing # EOF line. The protobuf format is binary and MUST
+ * NOT be treated as a string.
+ *
+ * @param registry The prom_collector_registry_t* to expose
+ * @param format The exposition format
+ * @return The constructed prom_collector_registry_stream_t* or NULL upon failure
+ */
+prom_collector_registry_stream_t *prom_collector_registry_stream_new_format(prom_collector_registry_t *registry,
+                                                                            prom_exposition_format_t format);
+
+/**
+ * @brief Destroys a prom_collector_registry_stream_t*. You MUST set self to NULL after destruction.
+ * @param self The target prom_collector_registry_stream_t*
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self);
+
+/**
+ * @brief Copies the next chunk of the exposition into buf. Returns a non-zero integer value upon failure.
+ *
+ * Chunks are filled completely unless the end of the exposition is reached. In the text format, the concatenation of
+ * every chunk is identical to the output of prom_collector_registry_bridge.
+ *
+ * @param self The target prom_collector_registry_stream_t*
+ * @param buf The destination buffer
+ * @param size The size of buf in bytes
+ * @param len Set to the number of bytes copied into buf. Zero means the end of the exposition has been reached.
+ * @return A non-zero integer value upon failure
+ */
+int prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buf, size_t size, size_t *len);
+
 /**
  *@brief Validates that the given metric name complies with the specification:
  *
@@ -55,6 +55,19 @@ typedef prom_metric_t prom_counter_t;
  */
 prom_counter_t *prom_counter_new(const char *name, const char *help, size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief Construct a sharded prom_counter_t*
+ *
+ * A sharded counter spreads the updates to each of its samples across cache line padded slots, one slot per thread up
+ * to the number of CPUs, and sums the slots when the counter is scraped. Use a sharded counter when many threads update
+ * the same sample frequently. Each sample requires one cache line per slot.
+ *
+ * The parameters are the same as those of prom_counter_new.
+ * @return The constructed prom_counter_t*
+ */
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys);
+
 /**
  * @brief Destroys a prom_counter_t*. You must set self to NULL after destruction. A non-zero integer value will be
  *        returned on failure.
@@ -100,4 +113,72 @@ int prom_counter_inc(prom_counter_t *self, const char **label_values);
  */
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief Add the value to the prom_counter_t* and attach an exemplar to the sample. A non-zero integer value will be
+ *        returned on failure.
+ *
+ * The exemplar replaces any previous exemplar of the sample and is only exposed in the OpenMetrics and protobuf
+ * exposition formats. The combined length of the exemplar label names and values MUST NOT exceed 128 characters.
+ *
+ * @param self The target prom_counter_t*
+ * @param r_value The double to add to the prom_counter_t passed as self. The value MUST be greater than or equal to 0.
+ * @param label_values The label values associated with the metric sample being updated. See prom_counter_add.
+ * @param exemplar_label_count The number of exemplar labels
+ * @param exemplar_label_keys The exemplar label names, e.g. trace_id
+ * @param exemplar_label_values The exemplar label values
+ * @return A non-zero integer value upon failure.
+ *
+ * *Example*
+ *
+ *     prom_counter_add_with_exemplar(foo_counter, 1, NULL, 1, (const char*[]) { "trace_id" },
+ *                                    (const char*[]) { trace_id });
+ */
+int prom_counter_add_with_exemplar(prom_counter_t *self, double r_value, const char **label_values,
+                                   size_t exemplar_label_count, const char **exemplar_label_keys,
+                                   const char **exemplar_label_values);
+
+/**
+ * @brief A prom_counter_t sample bound to a fixed set of label values.
+ *
+ * A child is resolved once via prom_counter_with_labels and may then be updated directly, skipping the label lookup
+ * performed on every call to prom_counter_inc and prom_counter_add. Children are owned by the counter from which they
+ * were retrieved and remain valid until said counter is destroyed or their series is removed by prom_metric_remove. A
+ * child MUST NOT be destroyed by the caller. The series of a child is never expired by prom_metric_set_series_ttl.
+ */
+typedef prom_metric_sample_t prom_counter_child_t;
+
+/**
+ * @brief Returns the prom_counter_child_t* for the given label values, creating the sample if necessary. Returns NULL
+ *        upon failure.
+ * @param self The target prom_counter_t*
+ * @param label_values The label values associated with the metric sample to bind. The number of labels must match the
+ *                     value passed to label_key_count in the counter's constructor. If no label values are necessary,
+ *                     pass NULL. Otherwise, It may be convenient to pass this value as a literal.
+ * @return The prom_counter_child_t* or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_counter_child_t *requests = prom_counter_with_labels(foo_counter, (const char*[]) { "GET", "200" });
+ *     for (;;) {
+ *       prom_counter_child_inc(requests);
+ *     }
+ */
+prom_counter_child_t *prom_counter_with_labels(prom_counter_t *self, const char **label_values);
+
+/**
+ * @brief Increment the prom_counter_child_t by 1. A non-zero integer value will be returned on failure.
+ * @param self The target prom_counter_child_t*
+ * @return A non-zero integer value upon failure.
+ */
+int prom_counter_child_inc(prom_counter_child_t *self);
+
+/**
+ * @brief Add the value to the prom_counter_child_t*. A non-zero integer value will be returned on failure.
+ * @param self The target prom_counter_child_t*
+ * @param r_value The double to add to the prom_counter_child_t passed as self. The value MUST be greater than or equal
+ *                to 0.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_counter_child_add(prom_counter_child_t *self, double r_value);
+
 #endif  // PROM_COUNTER_H
@@ -152,4 +152,70 @@ int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values
  */
 int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values);
 
+/**
+ * @brief A prom_gauge_t sample bound to a fixed set of label values.
+ *
+ * A child is resolved once via prom_gauge_with_labels and may then be updated directly, skipping the label lookup
+ * performed on every call to the prom_gauge_t update functions. Children are owned by the gauge from which they were
+ * retrieved and remain valid until said gauge is destroyed or their series is removed by prom_metric_remove. A child
+ * MUST NOT be destroyed by the caller. The series of a child is never expired by prom_metric_set_series_ttl.
+ */
+typedef prom_metric_sample_t prom_gauge_child_t;
+
+/**
+ * @brief Returns the prom_gauge_child_t* for the given label values, creating the sample if necessary. Returns NULL
+ *        upon failure.
+ * @param self The target prom_gauge_t*
+ * @param label_values The label values associated with the metric sample to bind. The number of labels must match the
+ *                     value passed to label_key_count in the gauge's constructor. If no label values are necessary,
+ *                     pass NULL. Otherwise, It may be convenient to pass this value as a literal.
+ * @return The prom_gauge_child_t* or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_gauge_child_t *in_flight = prom_gauge_with_labels(foo_gauge, (const char*[]) { "GET" });
+ *     prom_gauge_child_inc(in_flight);
+ *     do_work();
+ *     prom_gauge_child_dec(in_flight);
+ */
+prom_gauge_child_t *prom_gauge_with_labels(prom_gauge_t *self, const char **label_values);
+
+/**
+ * @brief Increment the prom_gauge_child_t* by 1.
+ * @param self The target prom_gauge_child_t*
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_child_inc(prom_gauge_child_t *self);
+
+/**
+ * @brief Decrement the prom_gauge_child_t* by 1.
+ * @param self The target prom_gauge_child_t*
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_child_dec(prom_gauge_child_t *self);
+
+/**
+ * @brief Add the value to the prom_gauge_child_t*.
+ * @param self The target prom_gauge_child_t*
+ * @param r_value The double to add to the prom_gauge_child_t passed as self.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_child_add(prom_gauge_child_t *self, double r_value);
+
+/**
+ * @brief Subtract the value from the prom_gauge_child_t*.
+ * @param self The target prom_gauge_child_t*
+ * @param r_value The double to subtract from the prom_gauge_child_t passed as self.
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_child_sub(prom_gauge_child_t *self, double r_value);
+
+/**
+ * @brief Set the value for the prom_gauge_child_t*
+ * @param self The target prom_gauge_child_t*
+ * @param r_value The double to which the prom_gauge_child_t* passed as self will be set
+ * @return A non-zero integer value upon failure.
+ */
+int prom_gauge_child_set(prom_gauge_child_t *self, double r_value);
+
 #endif  // PROM_GAUGE_H
@@ -60,6 +60,45 @@ typedef prom_metric_t prom_histogram_t;
 prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_histogram_buckets_t *buckets,
                                      size_t label_key_count, const char **label_keys);
 
+/**
+ * @brief The lowest native histogram schema. Each bucket is 2^16 times wider than the previous one.
+ */
+#define PROM_HISTOGRAM_NATIVE_SCHEMA_MIN -4
+
+/**
+ * @brief The highest native histogram schema. Each bucket is 2^(1/256) times wider than the previous one.
+ */
+#define PROM_HISTOGRAM_NATIVE_SCHEMA_MAX 8
+
+/**
+ * @brief Construct a native prom_histogram_t*, whose buckets are sparse and exponential rather than fixed.
+ *
+ * The upper bound of bucket i is 2^(2^-schema)^i, so schema 3 yields eight buckets per power of two with boundaries
+ * roughly 9% apart. Only buckets that received observations are kept. When an observation populates more than
+ * max_bucket_count buckets, the schema is decremented, halving the resolution by merging adjacent buckets, until the
+ * buckets fit again. Observations within 2^-128 of zero are counted in a dedicated zero bucket.
+ *
+ * The buckets of a native histogram are only exposed in the protobuf exposition format. The text formats expose the
+ * +Inf bucket, the count and the sum of a native histogram.
+ *
+ * @param name The name of the metric
+ * @param help The metric description
+ * @param schema The initial resolution, from PROM_HISTOGRAM_NATIVE_SCHEMA_MIN to PROM_HISTOGRAM_NATIVE_SCHEMA_MAX
+ * @param max_bucket_count The number of populated buckets per sample beyond which the resolution is reduced. Pass 0 to
+ *                         never reduce the resolution.
+ * @param label_key_count The number of labels associated with the given metric. Pass 0 if the metric does not require
+ *                        labels.
+ * @param label_keys A collection of label keys. The number of keys MUST match the value passed as label_key_count. If
+ *                   no labels are required, pass NULL.
+ * @return The constructed prom_histogram_t* or NULL if the schema is out of range
+ *
+ * *Example*
+ *
+ *     prom_histogram_new_native("request_duration_seconds", "Request latency", 3, 160, 1, (const char *[]){"method"});
+ */
+prom_histogram_t *prom_histogram_new_native(const char *name, const char *help, int schema, size_t max_bucket_count,
+                                            size_t label_key_count, const char **label_keys);
+
 /**
  * @brief Destroy a prom_histogram_t*. self MUSTS be set to NULL after destruction. Returns a non-zero integer value
  *        upon failure.
@@ -78,4 +117,56 @@ int prom_histogram_destroy(prom_histogram_t *self);
  */
 int prom_histogram_observe(prom_histogram_t *self, double value, const char **label_values);
 
+/**
+ * @brief Observe the value and attach an exemplar to the bucket it falls into
+ *
+ * The exemplar replaces any previous exemplar of the bucket and is only exposed in the OpenMetrics and protobuf
+ * exposition formats. The combined length of the exemplar label names and values MUST NOT exceed 128 characters.
+ *
+ * @param self The target prom_histogram_t*
+ * @param value The value to observe
+ * @param label_values The label values associated with the metric sample being updated. See prom_histogram_observe.
+ * @param exemplar_label_count The number of exemplar labels
+ * @param exemplar_label_keys The exemplar label names, e.g. trace_id
+ * @param exemplar_label_values The exemplar label values
+ * @return Non-zero value upon failure
+ */
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values);
+
+/**
+ * @brief A prom_histogram_t sample bound to a fixed set of label values.
+ *
+ * A child is resolved once via prom_histogram_with_labels and may then be observed directly, skipping the label lookup
+ * performed on every call to prom_histogram_observe. Children are owned by the histogram from which they were
+ * retrieved and remain valid until said histogram is destroyed or their series is removed by prom_metric_remove. A
+ * child MUST NOT be destroyed by the caller. The series of a child is never expired by prom_metric_set_series_ttl.
+ */
+typedef prom_metric_sample_histogram_t prom_histogram_child_t;
+
+/**
+ * @brief Returns the prom_histogram_child_t* for the given label values, creating the sample if necessary. Returns
+ *        NULL upon failure.
+ * @param self The target prom_histogram_t*
+ * @param label_values The label values associated with the metric sample to bind. The number of labels must match the
+ *                     value passed to label_key_count in the histogram's constructor. If no label values are
+ *                     necessary, pass NULL. Otherwise, It may be convenient to pass this value as a literal.
+ * @return The prom_histogram_child_t* or NULL upon failure
+ *
+ * *Example*
+ *
+ *     prom_histogram_child_t *latency = prom_histogram_with_labels(foo_histogram, (const char*[]) { "GET" });
+ *     prom_histogram_child_observe(latency, 0.042);
+ */
+prom_histogram_child_t *prom_histogram_with_labels(prom_histogram_t *self, const char **label_values);
+
+/**
+ * @brief Observe the value for the prom_histogram_child_t*
+ * @param self The target prom_histogram_child_t*
+ * @param value The value to observe
+ * @return Non-zero value upon failure
+ */
+int prom_histogram_child_observe(prom_histogram_child_t *self, double value);
+
 #endif  // PROM_HISTOGRAM_INCLUDED
@@ -22,6 +22,9 @@ limitations under the License.
 #ifndef PROM_METRIC_H
 #define PROM_METRIC_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "prom_metric_sample.h"
 #include "prom_metric_sample_histogram.h"
 
@@ -33,12 +36,23 @@ struct prom_metric;
  */
 typedef struct prom_metric prom_metric_t;
 
+/**
+ * @brief Determines what becomes of an update to a new series once a metric or its registry reached its series limit
+ */
+typedef enum prom_series_overflow {
+  PROM_SERIES_OVERFLOW_DROP, /**< The update fails and the series is not created. This is the default. */
+  PROM_SERIES_OVERFLOW_FOLD  /**< The update applies to a single series whose label values are all __overflow__ */
+} prom_series_overflow_t;
+
 /**
  * @brief Returns a prom_metric_sample_t*. The order of label_values is significant.
  *
  * You may use this function to cache metric samples to avoid sample lookup. Metric samples are stored in a hash map
  * with O(1) lookups in average case; nonethless, caching metric samples and updating them directly might be
- * preferrable in performance-sensitive situations.
+ * preferrable in performance-sensitive situations. If the metric expires idle series, see prom_metric_set_series_ttl,
+ * cache the child returned by the with_labels function of the metric type instead, which is never expired. Unlike the
+ * update functions of each metric type, a sample returned here is not protected from prom_metric_remove and MUST NOT
+ * be used after its series was removed.
  *
  * @param self The target prom_metric_t*
  * @param label_values The label values associated with the metric sample being updated. The number of labels must
@@ -53,7 +67,10 @@ prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const
  *
  * You may use this function to cache metric samples to avoid sample lookup. Metric samples are stored in a hash map
  * with O(1) lookups in average case; nonethless, caching metric samples and updating them directly might be
- * preferrable in performance-sensitive situations.
+ * preferrable in performance-sensitive situations. If the metric expires idle series, see prom_metric_set_series_ttl,
+ * cache the child returned by the with_labels function of the metric type instead, which is never expired. Unlike the
+ * update functions of each metric type, a sample returned here is not protected from prom_metric_remove and MUST NOT
+ * be used after its series was removed.
  *
  * @param self The target prom_histogram_metric_t*
  * @param label_values The label values associated with the metric sample being updated. The number of labels must
@@ -64,4 +81,65 @@ prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const
 prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
                                                                          const char **label_values);
 
+/**
+ * @brief Limits the number of series of a metric. Returns a non-zero integer value upon failure.
+ *
+ * Once a metric holds max_series series, updates to further label sets are handled according to overflow. The same
+ * applies when the registry the metric is registered with reaches its own limit, see
+ * prom_collector_registry_set_series_limit. Either way, each rejected update is counted, see
+ * prom_metric_series_rejected. The limit SHOULD be set right after the metric is constructed, before it is updated.
+ *
+ * @param self The target prom_metric_t*
+ * @param max_series The maximum number of series. Pass 0 to lift the limit.
+ * @param overflow The prom_series_overflow_t policy applied to updates beyond the limit
+ * @return A non-zero integer value upon failure
+ *
+ * *Example*
+ *
+ *     prom_counter_t *requests = prom_counter_new("requests", "requests by path", 1, (const char *[]){"path"});
+ *     prom_metric_set_series_limit(requests, 1000, PROM_SERIES_OVERFLOW_FOLD);
+ */
+int prom_metric_set_series_limit(prom_metric_t *self, size_t max_series, prom_series_overflow_t overflow);
+
+/**
+ * @brief Returns the number of updates rejected because the metric or its registry had reached its series limit.
+ * @param self The target prom_metric_t*
+ * @return The number of rejected updates
+ */
+uint64_t prom_metric_series_rejected(prom_metric_t *self);
+
+/**
+ * @brief Removes the series with the given label values from a metric. Returns a non-zero integer value upon failure.
+ * Removing a series that does not exist is not a failure.
+ *
+ * The series is no longer exposed and no longer counts against any series limit. A later update with the same label
+ * values starts a new series from scratch. The memory of the series is reused as soon as updates in flight can no
+ * longer refer to it. Children and samples retrieved for the series MUST NOT be used after it was removed.
+ *
+ * @param self The target prom_metric_t*
+ * @param label_values The label values of the series to remove. Pass NULL if the metric has no labels.
+ * @return A non-zero integer value upon failure
+ *
+ * *Example*
+ *
+ *     // The connection is gone, so are its metrics
+ *     prom_metric_remove(bytes_received, (const char *[]){peer_address});
+ */
+int prom_metric_remove(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief Removes the series of a metric that have not been updated for ttl_ms milliseconds. Returns a non-zero integer
+ * value upon failure.
+ *
+ * Idle series are looked for whenever the metric is scraped, so a series may outlive its TTL by up to two scrape
+ * intervals. Series whose child was retrieved through the with_labels function of the metric type are never expired,
+ * since updates through a child are not tracked. An update racing with the expiry of its series may be lost.
+ *
+ * @param self The target prom_metric_t*
+ * @param ttl_ms The time in milliseconds after which an idle series is removed. Pass 0 to keep series forever, which is
+ *               the default.
+ * @return A non-zero integer value upon failure
+ */
+int prom_metric_set_series_ttl(prom_metric_t *self, unsigned int ttl_ms);
+
 #endif  // PROM_METRIC_H
@@ -0,0 +1,341 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PROM_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Public
+#include "prom_collector.h"
+#include "prom_gauge.h"
+
+// Private
+#include "prom_allocator_i.h"
+#include "prom_allocator_t.h"
+#include "prom_log.h"
+
+prom_gauge_t *prom_allocator_allocated_bytes;
+
+#if defined(PROM_ALLOCATOR_JEMALLOC)
+prom_gauge_t *prom_allocator_active_bytes;
+prom_gauge_t *prom_allocator_resident_bytes;
+prom_gauge_t *prom_allocator_mapped_bytes;
+prom_gauge_t *prom_allocator_metadata_bytes;
+prom_gauge_t *prom_allocator_retained_bytes;
+prom_gauge_t *prom_allocator_arena_allocated_bytes;
+prom_gauge_t *prom_allocator_arena_active_bytes;
+#elif defined(PROM_ALLOCATOR_GLIBC)
+prom_gauge_t *prom_allocator_heap_bytes;
+prom_gauge_t *prom_allocator_mmapped_bytes;
+prom_gauge_t *prom_allocator_free_bytes;
+prom_gauge_t *prom_allocator_releasable_bytes;
+prom_gauge_t *prom_allocator_arena_system_bytes;
+prom_gauge_t *prom_allocator_arena_free_bytes;
+#endif
+
+/**
+ * @brief Creates a gauge with no labels, or with the arena label if arena is true, and adds it to collector
+ */
+static int prom_allocator_gauge_new(prom_collector_t *collector, prom_gauge_t **gauge, const char *name,
+                                    const char *help, bool arena) {
+  *gauge = prom_gauge_new(name, help, arena ? 1 : 0, arena ? (const char *[]){"arena"} : NULL);
+  if (*gauge == NULL) return 1;
+  return prom_collector_add_metric(collector, *gauge);
+}
+
+/**
+ * @brief Sets the series of gauge for the arena with the given number
+ */
+static int prom_allocator_arena_set(prom_gauge_t *gauge, unsigned int nr, double value) {
+  char arena[16];
+  snprintf(arena, sizeof(arena), "%u", nr);
+  return prom_gauge_set(gauge, value, (const char *[]){arena});
+}
+
+#if defined(PROM_ALLOCATOR_JEMALLOC)
+
+int prom_allocator_init(prom_collector_t *collector, bool arenas) {
+  int r = 0;
+  r = prom_allocator_gauge_new(collector, &prom_allocator_allocated_bytes, "allocator_allocated_bytes",
+                               "Bytes allocated by the application.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_active_bytes, "allocator_active_bytes",
+                               "Bytes in the active pages of the allocator.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_resident_bytes, "allocator_resident_bytes",
+                               "Bytes in the physically resident pages mapped by the allocator.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_mapped_bytes, "allocator_mapped_bytes",
+                               "Bytes in the active extents mapped by the allocator.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_metadata_bytes, "allocator_metadata_bytes",
+                               "Bytes dedicated to the metadata of the allocator.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_retained_bytes, "allocator_retained_bytes",
+                               "Bytes in virtual memory mappings retained by the allocator for later reuse.", false);
+  if (r) return r;
+
+  if (!arenas) return 0;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_arena_allocated_bytes, "allocator_arena_allocated_bytes",
+                               "Bytes allocated by the application from an arena.", true);
+  if (r) return r;
+
+  return prom_allocator_gauge_new(collector, &prom_allocator_arena_active_bytes, "allocator_arena_active_bytes",
+                                  "Bytes in the active pages of an arena.", true);
+}
+
+/**
+ * @brief Reads the size_t statistic name and sets gauge to it
+ */
+static int prom_allocator_mallctl_set(prom_gauge_t *gauge, const char *name) {
+  size_t value = 0;
+  size_t len = sizeof(value);
+  if (mallctl(name, &value, &len, NULL, 0)) {
+    PROM_LOG("failed to read a jemalloc statistic");
+    return 1;
+  }
+  return prom_gauge_set(gauge, (double)value, NULL);
+}
+
+static int prom_allocator_update_arenas(void) {
+  unsigned int narenas = 0;
+  size_t len = sizeof(narenas);
+  if (mallctl("arenas.narenas", &narenas, &len, NULL, 0)) return 1;
+  size_t page = 0;
+  len = sizeof(page);
+  if (mallctl("arenas.page", &page, &len, NULL, 0)) return 1;
+
+  // The names are translated once and the arena index of each is replaced for every arena
+  size_t initialized_mib[3];
+  size_t initialized_miblen = 3;
+  size_t small_mib[5];
+  size_t small_miblen = 5;
+  size_t large_mib[5];
+  size_t large_miblen = 5;
+  size_t pactive_mib[4];
+  size_t pactive_miblen = 4;
+  if (mallctlnametomib("arena.0.initialized", initialized_mib, &initialized_miblen) ||
+      mallctlnametomib("stats.arenas.0.small.allocated", small_mib, &small_miblen) ||
+      mallctlnametomib("stats.arenas.0.large.allocated", large_mib, &large_miblen) ||
+      mallctlnametomib("stats.arenas.0.pactive", pactive_mib, &pactive_miblen)) {
+    return 1;
+  }
+
+  int r = 0;
+  for (unsigned int i = 0; i < narenas; i++) {
+    bool initialized = false;
+    len = sizeof(initialized);
+    initialized_mib[1] = i;
+    if (mallctlbymib(initialized_mib, initialized_miblen, &initialized, &len, NULL, 0) || !initialized) continue;
+
+    size_t small = 0;
+    size_t large = 0;
+    size_t pactive = 0;
+    small_mib[2] = i;
+    large_mib[2] = i;
+    pactive_mib[2] = i;
+    len = sizeof(size_t);
+    if (mallctlbymib(small_mib, small_miblen, &small, &len, NULL, 0) ||
+        mallctlbymib(large_mib, large_miblen, &large, &len, NULL, 0) ||
+        mallctlbymib(pactive_mib, pactive_miblen, &pactive, &len, NULL, 0)) {
+      return 1;
+    }
+
+    r = prom_allocator_arena_set(prom_allocator_arena_allocated_bytes, i, (double)(small + large));
+    if (r) return r;
+
+    r = prom_allocator_arena_set(prom_allocator_arena_active_bytes, i, (double)(pactive * page));
+    if (r) return r;
+  }
+  return 0;
+}
+
+int prom_allocator_update(bool arenas) {
+  // The statistics are a snapshot that is only refreshed when the epoch is advanced
+  uint64_t epoch = 1;
+  size_t len = sizeof(epoch);
+  if (mallctl("epoch", &epoch, &len, &epoch, len)) {
+    PROM_LOG("failed to refresh the jemalloc statistics");
+    return 1;
+  }
+
+  int r = 0;
+  r = prom_allocator_mallctl_set(prom_allocator_allocated_bytes, "stats.allocated");
+  if (r) return r;
+
+  r = prom_allocator_mallctl_set(prom_allocator_active_bytes, "stats.active");
+  if (r) return r;
+
+  r = prom_allocator_mallctl_set(prom_allocator_resident_bytes, "stats.resident");
+  if (r) return r;
+
+  r = prom_allocator_mallctl_set(prom_allocator_mapped_bytes, "stats.mapped");
+  if (r) return r;
+
+  r = prom_allocator_mallctl_set(prom_allocator_metadata_bytes, "stats.metadata");
+  if (r) return r;
+
+  r = prom_allocator_mallctl_set(prom_allocator_retained_bytes, "stats.retained");
+  if (r) return r;
+
+  if (!arenas) return 0;
+  r = prom_allocator_update_arenas();
+  if (r) PROM_LOG("failed to read the jemalloc arena statistics");
+  return r;
+}
+
+#elif defined(PROM_ALLOCATOR_GLIBC)
+
+int prom_allocator_init(prom_collector_t *collector, bool arenas) {
+  int r = 0;
+  r = prom_allocator_gauge_new(collector, &prom_allocator_allocated_bytes, "allocator_allocated_bytes",
+                               "Bytes allocated by the application.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_heap_bytes, "allocator_heap_bytes",
+                               "Bytes of the heaps the allocator obtained from the system, excluding mmapped chunks.",
+                               false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_mmapped_bytes, "allocator_mmapped_bytes",
+                               "Bytes of the chunks the allocator mapped individually.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_free_bytes, "allocator_free_bytes",
+                               "Bytes of the free chunks of the heaps of the allocator.", false);
+  if (r) return r;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_releasable_bytes, "allocator_releasable_bytes",
+                               "Bytes at the top of the main heap that malloc_trim could release.", false);
+  if (r) return r;
+
+  if (!arenas) return 0;
+
+  r = prom_allocator_gauge_new(collector, &prom_allocator_arena_system_bytes, "allocator_arena_system_bytes",
+                               "Bytes an arena currently holds from the system.", true);
+  if (r) return r;
+
+  return prom_allocator_gauge_new(collector, &prom_allocator_arena_free_bytes, "allocator_arena_free_bytes",
+                                  "Bytes of the free chunks of an arena.", true);
+}
+
+/**
+ * @brief Returns the size attribute of the first element that starts with tag between begin and end, or 0 if there is
+ * none
+ */
+static size_t prom_allocator_xml_size(const char *begin, const char *end, const char *tag) {
+  const char *c = strstr(begin, tag);
+  if (c == NULL || c >= end) return 0;
+  c = strstr(c, "size=\"");
+  if (c == NULL || c >= end) return 0;
+  return (size_t)strtoull(c + strlen("size=\""), NULL, 10);
+}
+
+int prom_allocator_malloc_info_next(const char **xml, prom_allocator_arena_t *arena) {
+  const char *heap = strstr(*xml, "<heap nr=\"");
+  if (heap == NULL) return 1;
+  heap += strlen("<heap nr=\"");
+  const char *end = strstr(heap, "</heap>");
+  if (end == NULL) return 1;
+
+  arena->nr = (unsigned int)strtoul(heap, NULL, 10);
+  arena->system_bytes = prom_allocator_xml_size(heap, end, "<system type=\"current\"");
+  arena->free_bytes = prom_allocator_xml_size(heap, end, "<total type=\"fast\"") +
+                      prom_allocator_xml_size(heap, end, "<total type=\"rest\"");
+  *xml = end + strlen("</heap>");
+  return 0;
+}
+
+static int prom_allocator_update_arenas(void) {
+  // malloc_info only writes to a stream. The memory of the stream is allocated by stdio and released with free.
+  char *xml = NULL;
+  size_t len = 0;
+  FILE *stream = open_memstream(&xml, &len);
+  if (stream == NULL) return 1;
+  int r = malloc_info(0, stream);
+  if (fclose(stream)) r = 1;
+  if (r) {
+    free(xml);
+    return r;
+  }
+
+  const char *c = xml;
+  prom_allocator_arena_t arena;
+  while (prom_allocator_malloc_info_next(&c, &arena) == 0) {
+    r = prom_allocator_arena_set(prom_allocator_arena_system_bytes, arena.nr, (double)arena.system_bytes);
+    if (r) break;
+
+    r = prom_allocator_arena_set(prom_allocator_arena_free_bytes, arena.nr, (double)arena.free_bytes);
+    if (r) break;
+  }
+  free(xml);
+  return r;
+}
+
+int prom_allocator_update(bool arenas) {
+  // mallinfo2 replaced mallinfo, whose int fields overflow past 2 GiB, in glibc 2.33
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+
+  int r = 0;
+  r = prom_gauge_set(prom_allocator_allocated_bytes, (double)info.uordblks + (double)info.hblkhd, NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_allocator_heap_bytes, (double)info.arena, NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_allocator_mmapped_bytes, (double)info.hblkhd, NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_allocator_free_bytes, (double)info.fordblks, NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_allocator_releasable_bytes, (double)info.keepcost, NULL);
+  if (r) return r;
+
+  if (!arenas) return 0;
+  r = prom_allocator_update_arenas();
+  if (r) PROM_LOG("failed to read the malloc arena statistics");
+  return r;
+}
+
+#else
+
+int prom_allocator_init(prom_collector_t *collector, bool arenas) {
+  PROM_LOG("the allocator does not report statistics");
+  return 1;
+}
+
+int prom_allocator_update(bool arenas) { return 1; }
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_ALLOCATOR_I_H
+#define PROM_ALLOCATOR_I_H
+
+#include <stdbool.h>
+
+#include "prom_allocator_t.h"
+#include "prom_collector.h"
+
+/**
+ * @brief API PRIVATE Creates the gauges of the statistics of the allocator and adds them to collector. The per-arena
+ * gauges are only created if arenas is true. Returns non-zero if the allocator does not report statistics.
+ */
+int prom_allocator_init(prom_collector_t *collector, bool arenas);
+
+/**
+ * @brief API PRIVATE Queries the allocator and sets the gauges created by prom_allocator_init
+ */
+int prom_allocator_update(bool arenas);
+
+#if defined(PROM_ALLOCATOR_GLIBC)
+/**
+ * @brief API PRIVATE Scans the XML written by malloc_info for the next heap element at or after *xml, fills in arena
+ * and advances *xml past the element. Returns non-zero if there is no further heap element.
+ */
+int prom_allocator_malloc_info_next(const char **xml, prom_allocator_arena_t *arena);
+#endif
+
+#endif  // PROM_ALLOCATOR_I_H
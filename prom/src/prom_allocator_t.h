@@ -0,0 +1,63 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_ALLOCATOR_T_H
+#define PROM_ALLOCATOR_T_H
+
+// Included first for __GLIBC__
+#include <stdlib.h>
+
+#include "prom_gauge.h"
+
+/**
+ * @brief API PRIVATE The allocator whose statistics are reported. jemalloc is used when libprom is built against it by
+ * setting JEMALLOC=1 while running cmake, and glibc malloc otherwise.
+ */
+#if defined(PROM_JEMALLOC)
+#define PROM_ALLOCATOR_JEMALLOC
+#elif defined(__GLIBC__)
+#define PROM_ALLOCATOR_GLIBC
+#endif
+
+extern prom_gauge_t *prom_allocator_allocated_bytes;
+
+#if defined(PROM_ALLOCATOR_JEMALLOC)
+extern prom_gauge_t *prom_allocator_active_bytes;
+extern prom_gauge_t *prom_allocator_resident_bytes;
+extern prom_gauge_t *prom_allocator_mapped_bytes;
+extern prom_gauge_t *prom_allocator_metadata_bytes;
+extern prom_gauge_t *prom_allocator_retained_bytes;
+extern prom_gauge_t *prom_allocator_arena_allocated_bytes;
+extern prom_gauge_t *prom_allocator_arena_active_bytes;
+#elif defined(PROM_ALLOCATOR_GLIBC)
+extern prom_gauge_t *prom_allocator_heap_bytes;
+extern prom_gauge_t *prom_allocator_mmapped_bytes;
+extern prom_gauge_t *prom_allocator_free_bytes;
+extern prom_gauge_t *prom_allocator_releasable_bytes;
+extern prom_gauge_t *prom_allocator_arena_system_bytes;
+extern prom_gauge_t *prom_allocator_arena_free_bytes;
+
+/**
+ * @brief API PRIVATE The statistics of a glibc malloc arena, as reported by malloc_info
+ */
+typedef struct prom_allocator_arena {
+  unsigned int nr;     /**< nr     The number of the arena */
+  size_t system_bytes; /**< system The bytes the arena currently holds from the system */
+  size_t free_bytes;   /**< free   The bytes of the free chunks of the arena */
+} prom_allocator_arena_t;
+#endif
+
+#endif  // PROM_ALLOCATOR_T_H
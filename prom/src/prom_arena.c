@@ -0,0 +1,145 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_arena_i.h"
+#include "prom_arena_t.h"
+#include "prom_assert.h"
+
+// The first chunk is small so that metrics with few series stay small. Chunks double up to the maximum size.
+#define PROM_ARENA_MIN_CHUNK_SIZE 1024
+#define PROM_ARENA_MAX_CHUNK_SIZE 65536
+
+prom_arena_t *prom_arena_new(void) {
+  prom_arena_t *self = (prom_arena_t *)prom_malloc(sizeof(prom_arena_t));
+  if (self == NULL) return NULL;
+  self->chunks = NULL;
+  self->chunk_size = PROM_ARENA_MIN_CHUNK_SIZE;
+  self->allocated = 0;
+  self->bins = NULL;
+  return self;
+}
+
+int prom_arena_destroy(prom_arena_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+  prom_arena_chunk_t *chunk = self->chunks;
+  while (chunk != NULL) {
+    prom_arena_chunk_t *next = chunk->next;
+    prom_free(chunk);
+    chunk = next;
+  }
+  self->chunks = NULL;
+  prom_free(self);
+  self = NULL;
+  return 0;
+}
+
+static prom_arena_chunk_t *prom_arena_chunk_new(prom_arena_t *self, size_t size) {
+  prom_arena_chunk_t *chunk = (prom_arena_chunk_t *)prom_malloc(sizeof(prom_arena_chunk_t) + size);
+  if (chunk == NULL) return NULL;
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+  self->allocated += sizeof(prom_arena_chunk_t) + size;
+  return chunk;
+}
+
+/**
+ * @brief API PRIVATE Returns the bin of the given aligned size or NULL if there is none
+ */
+static prom_arena_bin_t *prom_arena_bin(prom_arena_t *self, size_t size) {
+  for (prom_arena_bin_t *bin = self->bins; bin != NULL; bin = bin->next) {
+    if (bin->size == size) return bin;
+  }
+  return NULL;
+}
+
+void *prom_arena_alloc(prom_arena_t *self, size_t size) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  size = (size + PROM_ARENA_ALIGNMENT - 1) & ~(PROM_ARENA_ALIGNMENT - 1);
+
+  if (self->bins != NULL) {
+    prom_arena_bin_t *bin = prom_arena_bin(self, size);
+    if (bin != NULL && bin->blocks != NULL) {
+      prom_arena_block_t *block = bin->blocks;
+      bin->blocks = block->next;
+      return block;
+    }
+  }
+
+  prom_arena_chunk_t *chunk = self->chunks;
+  if (chunk != NULL && chunk->size - chunk->used >= size) {
+    void *ptr = (char *)chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+  }
+
+  // Large allocations get a chunk of their own, placed behind the current chunk so that its free space is not lost
+  if (size > self->chunk_size / 2) {
+    prom_arena_chunk_t *large = prom_arena_chunk_new(self, size);
+    if (large == NULL) return NULL;
+    large->used = size;
+    if (chunk == NULL) {
+      self->chunks = large;
+    } else {
+      large->next = chunk->next;
+      chunk->next = large;
+    }
+    return large->data;
+  }
+
+  chunk = prom_arena_chunk_new(self, self->chunk_size);
+  if (chunk == NULL) return NULL;
+  chunk->next = self->chunks;
+  self->chunks = chunk;
+  if (self->chunk_size < PROM_ARENA_MAX_CHUNK_SIZE) self->chunk_size *= 2;
+
+  chunk->used = size;
+  return chunk->data;
+}
+
+int prom_arena_free(prom_arena_t *self, void *ptr, size_t size) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (ptr == NULL) return 0;
+
+  size = (size + PROM_ARENA_ALIGNMENT - 1) & ~(PROM_ARENA_ALIGNMENT - 1);
+  prom_arena_bin_t *bin = prom_arena_bin(self, size);
+  if (bin == NULL) {
+    bin = (prom_arena_bin_t *)prom_arena_alloc(self, sizeof(prom_arena_bin_t));
+    if (bin == NULL) return 1;
+    bin->size = size;
+    bin->blocks = NULL;
+    bin->next = self->bins;
+    self->bins = bin;
+  }
+
+  prom_arena_block_t *block = (prom_arena_block_t *)ptr;
+  block->next = bin->blocks;
+  bin->blocks = block;
+  return 0;
+}
+
+size_t prom_arena_allocated(prom_arena_t *self) {
+  PROM_ASSERT(self != NULL);
+  return self->allocated;
+}
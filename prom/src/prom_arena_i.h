@@ -0,0 +1,53 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_ARENA_I_H
+#define PROM_ARENA_I_H
+
+#include <stddef.h>
+
+// Private
+#include "prom_arena_t.h"
+
+/**
+ * @brief API PRIVATE Constructs a prom_arena_t*. No chunk is allocated until the first allocation.
+ */
+prom_arena_t *prom_arena_new(void);
+
+/**
+ * @brief API PRIVATE Destroys a prom_arena_t* and every allocation made from it
+ */
+int prom_arena_destroy(prom_arena_t *self);
+
+/**
+ * @brief API PRIVATE Returns size bytes aligned to PROM_ARENA_ALIGNMENT or NULL on failure. The memory is not
+ * initialized.
+ */
+void *prom_arena_alloc(prom_arena_t *self, size_t size);
+
+/**
+ * @brief API PRIVATE Returns a block of size bytes obtained from prom_arena_alloc to the arena, which hands it out
+ * again to a later allocation of the same size. Returns a non-zero integer value upon failure, in which case the block
+ * is simply not reused.
+ */
+int prom_arena_free(prom_arena_t *self, void *ptr, size_t size);
+
+/**
+ * @brief API PRIVATE Returns the number of bytes obtained from prom_malloc by the arena
+ */
+size_t prom_arena_allocated(prom_arena_t *self);
+
+#endif  // PROM_ARENA_I_H
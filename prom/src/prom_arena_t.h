@@ -0,0 +1,72 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_ARENA_T_H
+#define PROM_ARENA_T_H
+
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE The alignment of every allocation made from a prom_arena_t. It suits the pointers, sizes, doubles
+ * and 64 bit counters stored in an arena. Cache line aligned data must align itself within its allocation.
+ */
+#define PROM_ARENA_ALIGNMENT 8
+
+/**
+ * @brief API PRIVATE A chunk of memory carved up by a prom_arena_t. The usable bytes follow the header.
+ */
+typedef struct prom_arena_chunk {
+  struct prom_arena_chunk *next;              /**< next The previously filled chunk */
+  size_t size;                                /**< size The number of usable bytes */
+  size_t used;                                /**< used The number of bytes handed out */
+  _Alignas(PROM_ARENA_ALIGNMENT) char data[]; /**< data The usable bytes */
+} prom_arena_chunk_t;
+
+/**
+ * @brief API PRIVATE A block returned to a prom_arena_t. Its first bytes link it to the next free block of its size.
+ */
+typedef struct prom_arena_block {
+  struct prom_arena_block *next; /**< next The next free block of the same size */
+} prom_arena_block_t;
+
+/**
+ * @brief API PRIVATE The free blocks of one size. Bins are allocated from the arena itself and kept until it is
+ * destroyed.
+ */
+typedef struct prom_arena_bin {
+  struct prom_arena_bin *next; /**< next   The bin of another size */
+  size_t size;                 /**< size   The aligned size of the blocks */
+  prom_arena_block_t *blocks;  /**< blocks The free blocks or NULL */
+} prom_arena_bin_t;
+
+/**
+ * @brief API PRIVATE A bump allocator. Memory is handed out from chunks that grow geometrically and is only released,
+ * all at once, when the arena is destroyed.
+ *
+ * Blocks returned by prom_arena_free are kept in a bin per size and handed out again by allocations of the same size.
+ * Series of a metric are freed and recreated with the same handful of sizes, so exact sizes suffice.
+ *
+ * A prom_arena_t is not safe for concurrent use. Each metric owns an arena backing its series, and allocations from it
+ * are serialized by the metric's write lock.
+ */
+typedef struct prom_arena {
+  prom_arena_chunk_t *chunks; /**< chunks     The chunk being filled followed by those filled before it */
+  size_t chunk_size;          /**< chunk_size The usable size of the next chunk */
+  size_t allocated;           /**< allocated  The number of bytes obtained from prom_malloc */
+  prom_arena_bin_t *bins;     /**< bins       The free blocks by size or NULL if none was ever freed */
+} prom_arena_t;
+
+#endif  // PROM_ARENA_T_H
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 // Public
@@ -23,17 +26,29 @@
 #include "prom_collector_registry.h"
 
 // Private
+#include "prom_allocator_i.h"
 #include "prom_assert.h"
+#include "prom_collector_i.h"
 #include "prom_collector_t.h"
+#include "prom_counter_i.h"
+#include "prom_errors.h"
+#include "prom_linked_list_t.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_i.h"
 #include "prom_process_fds_i.h"
 #include "prom_process_fds_t.h"
+#include "prom_process_io_i.h"
+#include "prom_process_io_t.h"
 #include "prom_process_limits_i.h"
 #include "prom_process_limits_t.h"
 #include "prom_process_stat_i.h"
 #include "prom_process_stat_t.h"
+#include "prom_process_status_i.h"
+#include "prom_process_status_t.h"
+#include "prom_process_threads_i.h"
+#include "prom_process_threads_t.h"
+#include "prom_procfs_i.h"
 #include "prom_string_builder_i.h"
 
 prom_map_t *prom_collector_default_collect(prom_collector_t *self) { return self->metrics; }
@@ -60,6 +75,15 @@ prom_collector_t *prom_collector_new(const char *name) {
   }
   self->proc_limits_file_path = NULL;
   self->proc_stat_file_path = NULL;
+  self->proc_limits_file = NULL;
+  self->proc_limits = (prom_process_limits_values_t){0.0, 0.0, 0};
+  self->proc_stat_file = NULL;
+  self->proc_status_file = NULL;
+  self->proc_io_file = NULL;
+  self->proc_threads = NULL;
+  self->alloc_arenas = false;
+  self->proc_lock = NULL;
+  self->budget = NULL;
   return self;
 }
 
@@ -78,6 +102,46 @@ int prom_collector_destroy(prom_collector_t *self) {
   if (r) ret = r;
   self->string_builder = NULL;
 
+  if (self->proc_limits_file != NULL) {
+    r = prom_process_limits_file_destroy(self->proc_limits_file);
+    if (r) ret = r;
+    self->proc_limits_file = NULL;
+  }
+
+  if (self->proc_stat_file != NULL) {
+    r = prom_process_stat_file_destroy(self->proc_stat_file);
+    if (r) ret = r;
+    self->proc_stat_file = NULL;
+  }
+
+  if (self->proc_status_file != NULL) {
+    r = prom_procfs_buf_destroy(self->proc_status_file);
+    if (r) ret = r;
+    self->proc_status_file = NULL;
+  }
+
+  if (self->proc_io_file != NULL) {
+    r = prom_procfs_buf_destroy(self->proc_io_file);
+    if (r) ret = r;
+    self->proc_io_file = NULL;
+  }
+
+  if (self->proc_threads != NULL) {
+    r = prom_process_threads_destroy(self->proc_threads);
+    if (r) ret = r;
+    self->proc_threads = NULL;
+  }
+
+  if (self->proc_lock != NULL) {
+    r = pthread_mutex_destroy(self->proc_lock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_MUTEX_DESTROY_ERROR);
+      ret = r;
+    }
+    prom_free(self->proc_lock);
+    self->proc_lock = NULL;
+  }
+
   prom_free((char *)self->name);
   self->name = NULL;
   prom_free(self);
@@ -113,14 +177,59 @@ int prom_collector_add_metric(prom_collector_t *self, prom_metric_t *metric) {
     PROM_LOG("metric already found in collector");
     return 1;
   }
+  if (self->budget != NULL) {
+    int r = prom_metric_set_series_budget(metric, self->budget);
+    if (r) return r;
+  }
   return prom_map_set(self->metrics, metric->name, metric);
 }
 
+int prom_collector_set_series_budget(prom_collector_t *self, prom_series_budget_t *budget) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  self->budget = budget;
+  for (prom_linked_list_node_t *current_node = self->metrics->keys->head; current_node != NULL;
+       current_node = current_node->next) {
+    prom_metric_t *metric = (prom_metric_t *)prom_map_get(self->metrics, (const char *)current_node->item);
+    if (metric == NULL) continue;
+    r = prom_metric_set_series_budget(metric, budget);
+    if (r) return r;
+  }
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Process Collector
 
 prom_map_t *prom_collector_process_collect(prom_collector_t *self);
 
+/**
+ * @brief API PRIVATE Writes the path of the file name of the process to path. The files of a process are found next
+ * to its stat file, so the process of stat_path is the one reported on. A NULL stat_path is the calling process.
+ */
+static void prom_collector_process_path(char *path, size_t size, const char *stat_path, const char *name) {
+  if (stat_path == NULL) {
+    snprintf(path, size, "/proc/%d/%s", (int)getpid(), name);
+    return;
+  }
+  const char *slash = strrchr(stat_path, '/');
+  int dir_len = (slash == NULL) ? 0 : (int)(slash - stat_path + 1);
+  snprintf(path, size, "%.*s%s", dir_len, stat_path, name);
+}
+
+/**
+ * @brief API PRIVATE Opens and reads the optional file name of the process. Returns NULL if the file is not readable,
+ * as /proc/[pid]/io is in some containers, in which case its metrics are left out.
+ */
+static prom_procfs_buf_t *prom_collector_process_optional_file_new(const char *stat_path, const char *name) {
+  char path[PATH_MAX];
+  prom_collector_process_path(path, sizeof(path), stat_path, name);
+  if (access(path, R_OK)) return NULL;
+  return prom_procfs_buf_new(path);
+}
+
 prom_collector_t *prom_collector_process_new(const char *limits_path, const char *stat_path) {
   prom_collector_t *self = prom_collector_new("process");
   PROM_ASSERT(self != NULL);
@@ -132,6 +241,32 @@ prom_collector_t *prom_collector_process_new(const char *limits_path, const char
   self->proc_stat_file_path = stat_path;
   self->collect_fn = &prom_collector_process_collect;
 
+  // The files are opened once and read again by collections. The limits of the calling process are queried with
+  // getrlimit rather than read from a file.
+  if (limits_path != NULL) {
+    self->proc_limits_file = prom_process_limits_file_new(limits_path);
+    if (self->proc_limits_file == NULL) {
+      prom_collector_destroy(self);
+      return NULL;
+    }
+  }
+  self->proc_stat_file = prom_process_stat_file_new(stat_path);
+  self->proc_lock = (pthread_mutex_t *)prom_malloc(sizeof(pthread_mutex_t));
+  if (self->proc_stat_file == NULL || self->proc_lock == NULL || pthread_mutex_init(self->proc_lock, NULL)) {
+    prom_free(self->proc_lock);
+    self->proc_lock = NULL;
+    prom_collector_destroy(self);
+    return NULL;
+  }
+
+  // The status and io files and the task directory only add metrics, so the collector goes without them if they
+  // cannot be read
+  self->proc_status_file = prom_collector_process_optional_file_new(stat_path, "status");
+  self->proc_io_file = prom_collector_process_optional_file_new(stat_path, "io");
+  char task_path[PATH_MAX];
+  prom_collector_process_path(task_path, sizeof(task_path), stat_path, "task");
+  if (access(task_path, R_OK | X_OK) == 0) self->proc_threads = prom_process_threads_new(task_path);
+
   r = prom_process_limits_init();
   if (r) return NULL;
 
@@ -141,6 +276,39 @@ prom_collector_t *prom_collector_process_new(const char *limits_path, const char
   r = prom_process_fds_init();
   if (r) return NULL;
 
+  if (self->proc_status_file != NULL) {
+    r = prom_process_status_init();
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_context_switches_total);
+    if (r) return NULL;
+  }
+
+  if (self->proc_io_file != NULL) {
+    r = prom_process_io_init();
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_io_read_bytes_total);
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_io_write_bytes_total);
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_io_storage_read_bytes_total);
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_io_storage_write_bytes_total);
+    if (r) return NULL;
+  }
+
+  if (self->proc_threads != NULL) {
+    r = prom_process_threads_init();
+    if (r) return NULL;
+
+    r = prom_collector_add_metric(self, prom_process_thread_cpu_seconds_total);
+    if (r) return NULL;
+  }
+
   r = prom_collector_add_metric(self, prom_process_max_fds);
   if (r) return NULL;
 
@@ -162,116 +330,150 @@ prom_collector_t *prom_collector_process_new(const char *limits_path, const char
   r = prom_collector_add_metric(self, prom_process_open_fds);
   if (r) return NULL;
 
+  r = prom_collector_add_metric(self, prom_process_threads);
+  if (r) return NULL;
+
+  r = prom_collector_add_metric(self, prom_process_minor_page_faults_total);
+  if (r) return NULL;
+
+  r = prom_collector_add_metric(self, prom_process_major_page_faults_total);
+  if (r) return NULL;
+
   return self;
 }
 
-prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return NULL;
-
+/**
+ * @brief API PRIVATE Reads the process files into the buffers of the collector and sets the process metrics. The
+ * caller must hold the process lock.
+ */
+static int prom_collector_process_collect_locked(prom_collector_t *self) {
   int r = 0;
 
-  // Allocate and create a *prom_process_limits_file_t
-  prom_process_limits_file_t *limits_f = prom_process_limits_file_new(self->proc_limits_file_path);
-  if (limits_f == NULL) {
-    prom_process_limits_file_destroy(limits_f);
-    return NULL;
-  }
+  r = prom_process_limits_load(&self->proc_limits, self->proc_limits_file);
+  if (r) return r;
 
-  // Allocate and create a *prom_map_t from prom_process_limits_file_t. This is the main storage container for the
-  // limits metric data
-  prom_map_t *limits_map = prom_process_limits(limits_f);
-  if (limits_map == NULL) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    return NULL;
-  }
+  r = prom_procfs_buf_read(self->proc_stat_file);
+  if (r) return r;
 
-  // Retrieve the *prom_process_limits_row_t for Max open files
-  prom_process_limits_row_t *max_fds = (prom_process_limits_row_t *)prom_map_get(limits_map, "Max open files");
-  if (max_fds == NULL) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    return NULL;
-  }
+  prom_process_stat_t stat;
+  r = prom_process_stat_parse(&stat, self->proc_stat_file);
+  if (r) return r;
 
-  // Retrieve the *prom_process_limits_row_t for Max address space
-  prom_process_limits_row_t *virtual_memory_max_bytes =
-      (prom_process_limits_row_t *)prom_map_get(limits_map, "Max address space");
-  if (virtual_memory_max_bytes == NULL) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    return NULL;
-  }
+  r = prom_gauge_set(prom_process_max_fds, self->proc_limits.max_fds, NULL);
+  if (r) return r;
 
-  // Set the metric values for max_fds and virtual_memory_max_bytes
-  r = prom_gauge_set(prom_process_max_fds, max_fds->soft, NULL);
-  if (r) return NULL;
-  r = prom_gauge_set(prom_process_virtual_memory_max_bytes, virtual_memory_max_bytes->soft, NULL);
-  if (r) return NULL;
+  r = prom_gauge_set(prom_process_virtual_memory_max_bytes, self->proc_limits.virtual_memory_max_bytes, NULL);
+  if (r) return r;
 
-  // Aloocate and create a *prom_process_stat_file_t
-  prom_process_stat_file_t *stat_f = prom_process_stat_file_new(self->proc_stat_file_path);
-  if (stat_f == NULL) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    return self->metrics;
-  }
+  r = prom_gauge_set(prom_process_cpu_seconds_total, (double)(stat.utime + stat.stime) / sysconf(_SC_CLK_TCK), NULL);
+  if (r) return r;
 
-  // Allocate and create a *prom_process_stat_t from *prom_process_stat_file_t
-  prom_process_stat_t *stat = prom_process_stat_new(stat_f);
+  r = prom_gauge_set(prom_process_virtual_memory_bytes, stat.vsize, NULL);
+  if (r) return r;
 
-  // Set the metrics related to the stat file
-  r = prom_gauge_set(prom_process_cpu_seconds_total, ((stat->utime + stat->stime) / sysconf(_SC_CLK_TCK)), NULL);
-  if (r) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    prom_process_stat_file_destroy(stat_f);
-    prom_process_stat_destroy(stat);
-    return NULL;
-  }
-  r = prom_gauge_set(prom_process_virtual_memory_bytes, stat->vsize, NULL);
-  if (r) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    prom_process_stat_file_destroy(stat_f);
-    prom_process_stat_destroy(stat);
-    return NULL;
+  r = prom_gauge_set(prom_process_resident_memory_bytes, stat.rss * sysconf(_SC_PAGE_SIZE), NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_process_start_time_seconds, stat.starttime, NULL);
+  if (r) return r;
+
+  r = prom_gauge_set(prom_process_threads, stat.num_threads, NULL);
+  if (r) return r;
+
+  r = prom_counter_set_total(prom_process_minor_page_faults_total, stat.minflt, NULL);
+  if (r) return r;
+
+  r = prom_counter_set_total(prom_process_major_page_faults_total, stat.majflt, NULL);
+  if (r) return r;
+
+  if (self->proc_status_file != NULL) {
+    r = prom_procfs_buf_read(self->proc_status_file);
+    if (r) return r;
+
+    prom_process_status_t status;
+    r = prom_process_status_parse(&status, self->proc_status_file);
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_context_switches_total, status.voluntary_ctxt_switches,
+                               (const char *[]){"voluntary"});
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_context_switches_total, status.nonvoluntary_ctxt_switches,
+                               (const char *[]){"involuntary"});
+    if (r) return r;
   }
-  r = prom_gauge_set(prom_process_resident_memory_bytes, stat->rss*sysconf(_SC_PAGE_SIZE), NULL);
-  if (r) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    prom_process_stat_file_destroy(stat_f);
-    prom_process_stat_destroy(stat);
-    return NULL;
+
+  if (self->proc_io_file != NULL) {
+    r = prom_procfs_buf_read(self->proc_io_file);
+    if (r) return r;
+
+    prom_process_io_t io;
+    r = prom_process_io_parse(&io, self->proc_io_file);
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_io_read_bytes_total, io.rchar, NULL);
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_io_write_bytes_total, io.wchar, NULL);
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_io_storage_read_bytes_total, io.read_bytes, NULL);
+    if (r) return r;
+
+    r = prom_counter_set_total(prom_process_io_storage_write_bytes_total, io.write_bytes, NULL);
+    if (r) return r;
   }
-  r = prom_gauge_set(prom_process_start_time_seconds, stat->starttime, NULL);
-  if (r) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    prom_process_stat_file_destroy(stat_f);
-    prom_process_stat_destroy(stat);
-    return NULL;
+
+  if (self->proc_threads != NULL) {
+    r = prom_process_threads_update(self->proc_threads);
+    if (r) return r;
   }
-  r = prom_gauge_set(prom_process_open_fds, prom_process_fds_count(NULL), NULL);
+
+  return prom_gauge_set(prom_process_open_fds, prom_process_fds_count(NULL), NULL);
+}
+
+prom_map_t *prom_collector_process_collect(prom_collector_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  int r = pthread_mutex_lock(self->proc_lock);
   if (r) {
-    prom_process_limits_file_destroy(limits_f);
-    prom_map_destroy(limits_map);
-    prom_process_stat_file_destroy(stat_f);
-    prom_process_stat_destroy(stat);
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
     return NULL;
   }
 
-  // If there is any issue deallocating the following structures, return NULL to indicate failure
-  r = prom_process_limits_file_destroy(limits_f);
-  if (r) return NULL;
-  r = prom_map_destroy(limits_map);
-  if (r) return NULL;
-  r = prom_process_stat_file_destroy(stat_f);
-  if (r) return NULL;
-  r = prom_process_stat_destroy(stat);
+  r = prom_collector_process_collect_locked(self);
+
+  int rr = pthread_mutex_unlock(self->proc_lock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_UNLOCK_ERROR);
+    if (r == 0) r = rr;
+  }
   if (r) return NULL;
+  return self->metrics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocator Collector
+
+static prom_map_t *prom_collector_allocator_collect(prom_collector_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
 
+  if (prom_allocator_update(self->alloc_arenas)) return NULL;
   return self->metrics;
 }
+
+prom_collector_t *prom_collector_allocator_new(bool arenas) {
+  prom_collector_t *self = prom_collector_new("allocator");
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  self->alloc_arenas = arenas;
+  self->collect_fn = &prom_collector_allocator_collect;
+  if (prom_allocator_init(self, arenas)) {
+    prom_collector_destroy(self);
+    return NULL;
+  }
+  return self;
+}
@@ -0,0 +1,30 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Private
+#include "prom_collector_t.h"
+#include "prom_metric_t.h"
+
+#ifndef PROM_COLLECTOR_I_INCLUDED
+#define PROM_COLLECTOR_I_INCLUDED
+
+/**
+ * @brief API PRIVATE Counts the series of every metric of the collector, present and future, against the given budget
+ * of the registry the collector is registered with
+ */
+int prom_collector_set_series_budget(prom_collector_t *self, prom_series_budget_t *budget);
+
+#endif  // PROM_COLLECTOR_I_INCLUDED
@@ -16,7 +16,9 @@
 
 #include <pthread.h>
 #include <regex.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <time.h>
 
 // Public
 #include "prom_alloc.h"
@@ -25,12 +27,15 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_collector_i.h"
 #include "prom_collector_registry_t.h"
 #include "prom_collector_t.h"
+#include "prom_linked_list_t.h"
 #include "prom_errors.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
+#include "prom_metric_formatter_t.h"
 #include "prom_metric_i.h"
 #include "prom_metric_t.h"
 #include "prom_process_limits_i.h"
@@ -38,6 +43,8 @@
 
 prom_collector_registry_t *PROM_COLLECTOR_REGISTRY_DEFAULT;
 
+static void prom_collector_registry_snapshot_release(prom_collector_registry_snapshot_t *snapshot);
+
 prom_collector_registry_t *prom_collector_registry_new(const char *name) {
   int r = 0;
 
@@ -46,18 +53,42 @@ prom_collector_registry_t *prom_collector_registry_new(const char *name) {
   self->disable_process_metrics = false;
 
   self->name = prom_strdup(name);
+  atomic_init(&self->series_budget.max_series, 0);
+  atomic_init(&self->series_budget.series, 0);
   self->collectors = prom_map_new();
   prom_map_set_free_value_fn(self->collectors, &prom_collector_free_generic);
-  prom_map_set(self->collectors, "default", prom_collector_new("default"));
+  prom_collector_t *default_collector = prom_collector_new("default");
+  prom_collector_set_series_budget(default_collector, &self->series_budget);
+  prom_map_set(self->collectors, "default", default_collector);
 
-  self->metric_formatter = prom_metric_formatter_new();
-  self->string_builder = prom_string_builder_new();
+  self->formatter_pool_size = 0;
   self->lock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
   r = pthread_rwlock_init(self->lock, NULL);
   if (r) {
     PROM_LOG("failed to initialize rwlock");
     return NULL;
   }
+  self->formatter_pool_lock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
+  r = pthread_rwlock_init(self->formatter_pool_lock, NULL);
+  if (r) {
+    PROM_LOG("failed to initialize rwlock");
+    return NULL;
+  }
+
+  atomic_init(&self->cache_max_age, 0);
+  for (size_t i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) self->cache[i] = NULL;
+  self->cache_lock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
+  r = pthread_rwlock_init(self->cache_lock, NULL);
+  if (r) {
+    PROM_LOG("failed to initialize rwlock");
+    return NULL;
+  }
+  self->render_lock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
+  r = pthread_rwlock_init(self->render_lock, NULL);
+  if (r) {
+    PROM_LOG("failed to initialize rwlock");
+    return NULL;
+  }
   return self;
 }
 
@@ -72,6 +103,40 @@ int prom_collector_registry_enable_process_metrics(prom_collector_registry_t *se
   return 1;
 }
 
+int prom_collector_registry_enable_cache(prom_collector_registry_t *self, unsigned int max_age_ms) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  atomic_store(&self->cache_max_age, (uint64_t)max_age_ms * 1000000);
+  if (max_age_ms > 0) return 0;
+
+  // Drop the cached expositions so that they do not outlive the cache. Scrapes still reading them hold a reference.
+  prom_collector_registry_snapshot_t *snapshots[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT];
+  int r = pthread_rwlock_wrlock(self->cache_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  for (size_t i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    snapshots[i] = self->cache[i];
+    self->cache[i] = NULL;
+  }
+  r = pthread_rwlock_unlock(self->cache_lock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  for (size_t i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    prom_collector_registry_snapshot_release(snapshots[i]);
+  }
+  return r;
+}
+
+int prom_collector_registry_set_series_limit(prom_collector_registry_t *self, size_t max_series) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  atomic_store(&self->series_budget.max_series, max_series);
+  return 0;
+}
+
 int prom_collector_registry_enable_custom_process_metrics(prom_collector_registry_t *self,
                                                           const char *process_limits_path,
                                                           const char *process_stats_path) {
@@ -108,19 +173,38 @@ int prom_collector_registry_destroy(prom_collector_registry_t *self) {
   self->collectors = NULL;
   if (r) ret = r;
 
-  r = prom_metric_formatter_destroy(self->metric_formatter);
-  self->metric_formatter = NULL;
-  if (r) ret = r;
-
-  r = prom_string_builder_destroy(self->string_builder);
-  self->string_builder = NULL;
-  if (r) ret = r;
+  for (size_t i = 0; i < self->formatter_pool_size; i++) {
+    r = prom_metric_formatter_destroy(self->formatter_pool[i]);
+    self->formatter_pool[i] = NULL;
+    if (r) ret = r;
+  }
+  self->formatter_pool_size = 0;
 
   r = pthread_rwlock_destroy(self->lock);
   prom_free(self->lock);
   self->lock = NULL;
   if (r) ret = r;
 
+  r = pthread_rwlock_destroy(self->formatter_pool_lock);
+  prom_free(self->formatter_pool_lock);
+  self->formatter_pool_lock = NULL;
+  if (r) ret = r;
+
+  for (size_t i = 0; i < PROM_COLLECTOR_REGISTRY_FORMAT_COUNT; i++) {
+    prom_collector_registry_snapshot_release(self->cache[i]);
+    self->cache[i] = NULL;
+  }
+
+  r = pthread_rwlock_destroy(self->cache_lock);
+  prom_free(self->cache_lock);
+  self->cache_lock = NULL;
+  if (r) ret = r;
+
+  r = pthread_rwlock_destroy(self->render_lock);
+  prom_free(self->render_lock);
+  self->render_lock = NULL;
+  if (r) ret = r;
+
   prom_free((char *)self->name);
   self->name = NULL;
 
@@ -172,7 +256,8 @@ int prom_collector_registry_register_collector(prom_collector_registry_t *self,
       return 1;
     }
   }
-  r = prom_map_set(self->collectors, collector->name, collector);
+  r = prom_collector_set_series_budget(collector, &self->series_budget);
+  if (r == 0) r = prom_map_set(self->collectors, collector->name, collector);
   if (r) {
     int rr = pthread_rwlock_unlock(self->lock);
     if (rr) {
@@ -210,8 +295,325 @@ int prom_collector_registry_validate_metric_name(prom_collector_registry_t *self
   return 0;
 }
 
+/**
+ * @brief API PRIVATE Returns an idle metric formatter from the registry's pool, or a new one if the pool is empty,
+ * set to load metrics in the given format.
+ *
+ * Each scrape renders into a formatter of its own, so concurrent scrapes neither race nor wait on one another. The
+ * pool lock is only held to take or return a formatter.
+ */
+static prom_metric_formatter_t *prom_collector_registry_acquire_formatter(prom_collector_registry_t *self,
+                                                                          prom_exposition_format_t format) {
+  prom_metric_formatter_t *formatter = NULL;
+
+  int r = pthread_rwlock_wrlock(self->formatter_pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
+  }
+  if (self->formatter_pool_size > 0) {
+    formatter = self->formatter_pool[--self->formatter_pool_size];
+    self->formatter_pool[self->formatter_pool_size] = NULL;
+  }
+  r = pthread_rwlock_unlock(self->formatter_pool_lock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  if (formatter == NULL) formatter = prom_metric_formatter_new();
+  if (formatter != NULL) formatter->format = format;
+  return formatter;
+}
+
+/**
+ * @brief API PRIVATE Returns a metric formatter to the registry's pool. The formatter is destroyed if the pool is full.
+ */
+static int prom_collector_registry_release_formatter(prom_collector_registry_t *self,
+                                                     prom_metric_formatter_t *formatter) {
+  int r = 0;
+
+  // Keep the buffer for the next scrape unless it grew unreasonably large
+  if (prom_string_builder_allocated(formatter->string_builder) > PROM_COLLECTOR_REGISTRY_FORMATTER_RETAIN_SIZE) {
+    r = prom_metric_formatter_clear(formatter);
+  } else {
+    r = prom_string_builder_truncate(formatter->string_builder, 0);
+  }
+  if (r) return prom_metric_formatter_destroy(formatter);
+
+  r = pthread_rwlock_wrlock(self->formatter_pool_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return prom_metric_formatter_destroy(formatter);
+  }
+  if (self->formatter_pool_size < PROM_COLLECTOR_REGISTRY_FORMATTER_POOL_SIZE) {
+    self->formatter_pool[self->formatter_pool_size++] = formatter;
+    formatter = NULL;
+  }
+  r = pthread_rwlock_unlock(self->formatter_pool_lock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  if (formatter != NULL) return prom_metric_formatter_destroy(formatter);
+  return r;
+}
+
+static uint64_t prom_collector_registry_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void prom_collector_registry_snapshot_release(prom_collector_registry_snapshot_t *snapshot) {
+  if (snapshot == NULL) return;
+  if (atomic_fetch_sub(&snapshot->refs, 1) > 1) return;
+  prom_free(snapshot->data);
+  snapshot->data = NULL;
+  prom_free(snapshot);
+}
+
+/**
+ * @brief API PRIVATE Returns a new reference to the cached exposition in the given format if it is younger than
+ * max_age, otherwise NULL
+ */
+static prom_collector_registry_snapshot_t *prom_collector_registry_cache_get(prom_collector_registry_t *self,
+                                                                             prom_exposition_format_t format,
+                                                                             uint64_t max_age) {
+  prom_collector_registry_snapshot_t *snapshot = NULL;
+
+  int r = pthread_rwlock_rdlock(self->cache_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
+  }
+  if (self->cache[format] != NULL && prom_collector_registry_now() - self->cache[format]->rendered_at < max_age) {
+    snapshot = self->cache[format];
+    atomic_fetch_add(&snapshot->refs, 1);
+  }
+  r = pthread_rwlock_unlock(self->cache_lock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return snapshot;
+}
+
+/**
+ * @brief API PRIVATE Renders the exposition of the registry in the given format into a new snapshot. Returns NULL upon
+ * failure.
+ * @param r Set to the return code of the rendering. The snapshot is returned even if some metrics failed to render.
+ */
+static prom_collector_registry_snapshot_t *prom_collector_registry_render(prom_collector_registry_t *self,
+                                                                          prom_exposition_format_t format, int *r) {
+  prom_metric_formatter_t *formatter = prom_collector_registry_acquire_formatter(self, format);
+  if (formatter == NULL) return NULL;
+
+  uint64_t rendered_at = prom_collector_registry_now();
+  *r = prom_metric_formatter_load_metrics(formatter, self->collectors);
+
+  prom_collector_registry_snapshot_t *snapshot =
+      (prom_collector_registry_snapshot_t *)prom_malloc(sizeof(prom_collector_registry_snapshot_t));
+  snapshot->len = prom_string_builder_len(formatter->string_builder);
+  snapshot->data = prom_string_builder_dump(formatter->string_builder);
+  snapshot->rendered_at = rendered_at;
+  atomic_init(&snapshot->refs, 1);
+
+  prom_collector_registry_release_formatter(self, formatter);
+  if (snapshot->data == NULL) {
+    prom_free(snapshot);
+    return NULL;
+  }
+  return snapshot;
+}
+
+/**
+ * @brief API PRIVATE Returns a reference to an exposition of the registry in the given format that is at most max_age
+ * old.
+ *
+ * When the cached exposition has expired, a single scrape renders a new one while concurrent scrapes wait for it
+ * rather than rendering the registry themselves. Renderings that fail are returned to the caller but not cached.
+ */
+static prom_collector_registry_snapshot_t *prom_collector_registry_cache_acquire(prom_collector_registry_t *self,
+                                                                                 prom_exposition_format_t format,
+                                                                                 uint64_t max_age) {
+  prom_collector_registry_snapshot_t *snapshot = prom_collector_registry_cache_get(self, format, max_age);
+  if (snapshot != NULL) return snapshot;
+
+  int r = pthread_rwlock_wrlock(self->render_lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
+  }
+
+  // Another scrape may have refreshed the cache while this one waited
+  snapshot = prom_collector_registry_cache_get(self, format, max_age);
+  if (snapshot == NULL) {
+    int render_r = 0;
+    snapshot = prom_collector_registry_render(self, format, &render_r);
+    if (snapshot != NULL && render_r == 0) {
+      atomic_fetch_add(&snapshot->refs, 1);
+      r = pthread_rwlock_wrlock(self->cache_lock);
+      if (r) {
+        PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+        atomic_fetch_sub(&snapshot->refs, 1);
+      } else {
+        prom_collector_registry_snapshot_t *expired = self->cache[format];
+        self->cache[format] = snapshot;
+        r = pthread_rwlock_unlock(self->cache_lock);
+        if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+        prom_collector_registry_snapshot_release(expired);
+      }
+    }
+  }
+
+  r = pthread_rwlock_unlock(self->render_lock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return snapshot;
+}
+
 const char *prom_collector_registry_bridge(prom_collector_registry_t *self) {
-  prom_metric_formatter_clear(self->metric_formatter);
-  prom_metric_formatter_load_metrics(self->metric_formatter, self->collectors);
-  return (const char *)prom_metric_formatter_dump(self->metric_formatter);
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  uint64_t max_age = atomic_load(&self->cache_max_age);
+  if (max_age > 0) {
+    prom_collector_registry_snapshot_t *snapshot =
+        prom_collector_registry_cache_acquire(self, PROM_EXPOSITION_FORMAT_TEXT, max_age);
+    if (snapshot == NULL) return NULL;
+    char *out = (char *)prom_malloc(snapshot->len + 1);
+    memcpy(out, snapshot->data, snapshot->len + 1);
+    prom_collector_registry_snapshot_release(snapshot);
+    return (const char *)out;
+  }
+
+  prom_metric_formatter_t *formatter = prom_collector_registry_acquire_formatter(self, PROM_EXPOSITION_FORMAT_TEXT);
+  if (formatter == NULL) return NULL;
+
+  prom_metric_formatter_load_metrics(formatter, self->collectors);
+  char *out = prom_string_builder_dump(formatter->string_builder);
+
+  prom_collector_registry_release_formatter(self, formatter);
+  return (const char *)out;
+}
+
+prom_collector_registry_stream_t *prom_collector_registry_stream_new(prom_collector_registry_t *registry) {
+  return prom_collector_registry_stream_new_format(registry, PROM_EXPOSITION_FORMAT_TEXT);
+}
+
+prom_collector_registry_stream_t *prom_collector_registry_stream_new_format(prom_collector_registry_t *registry,
+                                                                            prom_exposition_format_t format) {
+  PROM_ASSERT(registry != NULL);
+  if (registry == NULL) return NULL;
+
+  prom_collector_registry_stream_t *self =
+      (prom_collector_registry_stream_t *)prom_malloc(sizeof(prom_collector_registry_stream_t));
+  self->registry = registry;
+  self->format = format;
+  self->offset = 0;
+  self->collector_node = registry->collectors->keys->head;
+  self->metrics = NULL;
+  self->metric_node = NULL;
+  self->done = false;
+  self->metric_formatter = NULL;
+  self->snapshot = NULL;
+
+  // A cached exposition is read as is rather than rendered metric by metric
+  uint64_t max_age = atomic_load(&registry->cache_max_age);
+  if (max_age > 0) {
+    self->snapshot = prom_collector_registry_cache_acquire(registry, format, max_age);
+    if (self->snapshot == NULL) {
+      prom_collector_registry_stream_destroy(self);
+      return NULL;
+    }
+    self->done = true;
+    return self;
+  }
+
+  self->metric_formatter = prom_collector_registry_acquire_formatter(registry, format);
+  if (self->metric_formatter == NULL) {
+    prom_collector_registry_stream_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_collector_registry_stream_destroy(prom_collector_registry_stream_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  int r = 0;
+  if (self->metric_formatter != NULL) {
+    r = prom_collector_registry_release_formatter(self->registry, self->metric_formatter);
+    self->metric_formatter = NULL;
+  }
+  prom_collector_registry_snapshot_release(self->snapshot);
+  self->snapshot = NULL;
+
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+/**
+ * @brief API PRIVATE Renders the next metric of the registry into the stream's formatter, moving on to the next
+ * collector as each one is exhausted. Renders the end of the exposition and sets done once there are no metrics left.
+ */
+static int prom_collector_registry_stream_load_next(prom_collector_registry_stream_t *self) {
+  for (;;) {
+    if (self->metric_node != NULL) {
+      const char *metric_name = (const char *)self->metric_node->item;
+      self->metric_node = self->metric_node->next;
+      prom_metric_t *metric = (prom_metric_t *)prom_map_get(self->metrics, metric_name);
+      if (metric == NULL) return 1;
+      return prom_metric_formatter_load_metric(self->metric_formatter, metric);
+    }
+
+    if (self->collector_node == NULL) {
+      self->done = true;
+      return prom_metric_formatter_load_end(self->metric_formatter);
+    }
+
+    const char *collector_name = (const char *)self->collector_node->item;
+    self->collector_node = self->collector_node->next;
+    prom_collector_t *collector = (prom_collector_t *)prom_map_get(self->registry->collectors, collector_name);
+    if (collector == NULL) return 1;
+
+    self->metrics = collector->collect_fn(collector);
+    if (self->metrics == NULL) return 1;
+    self->metric_node = self->metrics->keys->head;
+  }
+}
+
+int prom_collector_registry_stream_read(prom_collector_registry_stream_t *self, char *buf, size_t size, size_t *len) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  *len = 0;
+
+  if (self->snapshot != NULL) {
+    size_t n = self->snapshot->len - self->offset;
+    if (n > size) n = size;
+    memcpy(buf, self->snapshot->data + self->offset, n);
+    self->offset += n;
+    *len = n;
+    return 0;
+  }
+
+  prom_string_builder_t *string_builder = self->metric_formatter->string_builder;
+
+  while (*len < size) {
+    size_t rendered = prom_string_builder_len(string_builder);
+    if (self->offset < rendered) {
+      size_t n = rendered - self->offset;
+      if (n > size - *len) n = size - *len;
+      memcpy(buf + *len, prom_string_builder_str(string_builder) + self->offset, n);
+      self->offset += n;
+      *len += n;
+      continue;
+    }
+    if (self->done) break;
+
+    // The current metric has been read in full. Reuse the buffer for the next one.
+    r = prom_string_builder_truncate(string_builder, 0);
+    if (r) return r;
+    self->offset = 0;
+
+    r = prom_collector_registry_stream_load_next(self);
+    if (r) return r;
+  }
+  return 0;
 }
@@ -18,23 +18,70 @@
 #define PROM_REGISTRY_T_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_collector_registry.h"
 
 // Private
+#include "prom_linked_list_t.h"
 #include "prom_map_t.h"
 #include "prom_metric_formatter_t.h"
-#include "prom_string_builder_t.h"
+#include "prom_metric_t.h"
+
+/**
+ * @brief API PRIVATE The number of idle metric formatters retained by a registry for reuse by later scrapes
+ */
+#define PROM_COLLECTOR_REGISTRY_FORMATTER_POOL_SIZE 4
+
+/**
+ * @brief API PRIVATE Formatters whose buffer grew beyond this many bytes are shrunk before being returned to the pool
+ */
+#define PROM_COLLECTOR_REGISTRY_FORMATTER_RETAIN_SIZE (1024 * 1024)
+
+/**
+ * @brief API PRIVATE The number of exposition formats, each of which is cached separately
+ */
+#define PROM_COLLECTOR_REGISTRY_FORMAT_COUNT 3
+
+/**
+ * @brief API PRIVATE A rendered exposition shared by every scrape served from the cache. Snapshots are immutable and
+ * reference counted. The cache holds one reference and each scrape reading the snapshot holds another.
+ */
+typedef struct prom_collector_registry_snapshot {
+  char *data;           /**< The rendered exposition */
+  size_t len;           /**< The length of data */
+  uint64_t rendered_at; /**< The monotonic time at which data was rendered in nanoseconds */
+  atomic_size_t refs;   /**< The number of references held */
+} prom_collector_registry_snapshot_t;
 
 struct prom_collector_registry {
   const char *name;
-  bool disable_process_metrics;              /**< Disables the collection of process metrics */
-  prom_map_t *collectors;                    /**< Map of collectors keyed by name */
-  prom_string_builder_t *string_builder;     /**< Enables string building */
-  prom_metric_formatter_t *metric_formatter; /**< metric formatter for metric exposition on bridge call */
-  pthread_rwlock_t *lock;                    /**< mutex for safety against concurrent registration */
+  bool disable_process_metrics; /**< Disables the collection of process metrics */
+  prom_map_t *collectors;       /**< Map of collectors keyed by name */
+  pthread_rwlock_t *lock;       /**< mutex for safety against concurrent registration */
+  prom_metric_formatter_t *formatter_pool[PROM_COLLECTOR_REGISTRY_FORMATTER_POOL_SIZE]; /**< Idle formatters */
+  size_t formatter_pool_size;                /**< The number of idle formatters in formatter_pool */
+  pthread_rwlock_t *formatter_pool_lock;     /**< Guards formatter_pool */
+  _Atomic uint64_t cache_max_age;            /**< The maximum age of cache in nanoseconds. 0 disables caching */
+  prom_collector_registry_snapshot_t *cache[PROM_COLLECTOR_REGISTRY_FORMAT_COUNT]; /**< Latest exposition by format */
+  pthread_rwlock_t *cache_lock;              /**< Guards cache */
+  pthread_rwlock_t *render_lock;             /**< Held while refreshing cache so that only one scrape renders */
+  prom_series_budget_t series_budget;        /**< Counts the series of every registered metric */
+};
+
+struct prom_collector_registry_stream {
+  prom_collector_registry_t *registry;          /**< The registry being exposed */
+  prom_exposition_format_t format;              /**< The exposition format */
+  prom_metric_formatter_t *metric_formatter;    /**< Holds the rendered text of the current metric. Pooled */
+  prom_collector_registry_snapshot_t *snapshot; /**< The cached exposition being read or NULL if rendering live */
+  size_t offset;                                /**< The number of bytes of the current metric already read */
+  prom_linked_list_node_t *collector_node;      /**< The next collector to collect from */
+  prom_map_t *metrics;                          /**< The metrics returned by the current collector */
+  prom_linked_list_node_t *metric_node;         /**< The next metric of the current collector to render */
+  bool done;                                    /**< Set once every metric has been rendered */
 };
 
 #endif  // PROM_REGISTRY_T_H
@@ -17,8 +17,17 @@
 #ifndef PROM_COLLECTOR_T_H
 #define PROM_COLLECTOR_T_H
 
+#include <pthread.h>
+#include <stdbool.h>
+
 #include "prom_collector.h"
 #include "prom_map_t.h"
+#include "prom_metric_t.h"
+#include "prom_process_io_t.h"
+#include "prom_process_limits_t.h"
+#include "prom_process_status_t.h"
+#include "prom_process_threads_t.h"
+#include "prom_procfs_t.h"
 #include "prom_string_builder_t.h"
 
 struct prom_collector {
@@ -28,6 +37,15 @@ struct prom_collector {
   prom_string_builder_t *string_builder;
   const char *proc_limits_file_path;
   const char *proc_stat_file_path;
+  prom_procfs_buf_t *proc_limits_file;          /**< The open limits file of a process collector or NULL */
+  prom_process_limits_values_t proc_limits;     /**< The limits last loaded by a process collector */
+  prom_procfs_buf_t *proc_stat_file;            /**< The open stat file of a process collector or NULL */
+  prom_process_status_file_t *proc_status_file; /**< The open status file of a process collector or NULL */
+  prom_process_io_file_t *proc_io_file;         /**< The open io file of a process collector or NULL */
+  prom_process_threads_t *proc_threads;         /**< The open task directory of a process collector or NULL */
+  pthread_mutex_t *proc_lock;                   /**< Serializes process collections, which share the file buffers */
+  bool alloc_arenas;                            /**< Whether an allocator collector reports per-arena statistics */
+  prom_series_budget_t *budget;                 /**< The series budget of the registry or NULL if unregistered */
 };
 
 #endif  // PROM_COLLECTOR_T_H
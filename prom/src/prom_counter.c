@@ -21,7 +21,10 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_counter_i.h"
+#include "prom_epoch_i.h"
 #include "prom_errors.h"
+#include "prom_exemplar_i.h"
 #include "prom_log.h"
 #include "prom_metric_i.h"
 #include "prom_metric_sample_i.h"
@@ -32,6 +35,14 @@ prom_counter_t *prom_counter_new(const char *name, const char *help, size_t labe
   return (prom_counter_t *)prom_metric_new(PROM_COUNTER, name, help, label_key_count, label_keys);
 }
 
+prom_counter_t *prom_counter_new_sharded(const char *name, const char *help, size_t label_key_count,
+                                         const char **label_keys) {
+  prom_counter_t *self = prom_counter_new(name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+  self->shard_count = prom_metric_sample_default_shard_count();
+  return self;
+}
+
 int prom_counter_destroy(prom_counter_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
@@ -48,9 +59,11 @@ int prom_counter_inc(prom_counter_t *self, const char **label_values) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, 1.0);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_add(sample, 1.0);
+  prom_epoch_exit();
+  return r;
 }
 
 int prom_counter_add(prom_counter_t *self, double r_value, const char **label_values) {
@@ -60,7 +73,79 @@ int prom_counter_add(prom_counter_t *self, double r_value, const char **label_va
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_add(sample, r_value);
+  prom_epoch_exit();
+  return r;
+}
+
+int prom_counter_set_total(prom_counter_t *self, double r_value, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  prom_epoch_enter();
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_set_total(sample, r_value);
+  prom_epoch_exit();
+  return r;
+}
+
+int prom_counter_add_with_exemplar(prom_counter_t *self, double r_value, const char **label_values,
+                                   size_t exemplar_label_count, const char **exemplar_label_keys,
+                                   const char **exemplar_label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  // Build the exemplar first so that an invalid one leaves the counter untouched
+  prom_exemplar_t *exemplar =
+      prom_exemplar_new(exemplar_label_count, exemplar_label_keys, exemplar_label_values, r_value);
+  if (exemplar == NULL) return 1;
+
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, r_value);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_add(sample, r_value);
+  if (r) {
+    prom_exemplar_destroy(exemplar);
+  } else {
+    r = prom_metric_sample_set_exemplar(self, sample, exemplar);
+  }
+  prom_epoch_exit();
+  return r;
+}
+
+prom_counter_child_t *prom_counter_with_labels(prom_counter_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return (prom_counter_child_t *)prom_metric_series_pin(self, label_values);
+}
+
+int prom_counter_child_inc(prom_counter_child_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_add(self, 1.0);
+}
+
+int prom_counter_child_add(prom_counter_child_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_COUNTER) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_add(self, r_value);
 }
@@ -0,0 +1,30 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_COUNTER_I_H
+#define PROM_COUNTER_I_H
+
+// Public
+#include "prom_counter.h"
+
+/**
+ * @brief API PRIVATE Sets the sample of the counter with the given label values to an absolute value. Lets collectors
+ * expose totals kept elsewhere, such as by the kernel, as counters. The counter must not be sharded.
+ */
+int prom_counter_set_total(prom_counter_t *self, double r_value, const char **label_values);
+
+#endif  // PROM_COUNTER_I_H
@@ -0,0 +1,360 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Shortest round-trip double formatting based on Grisu2 as described in "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers" by Florian Loitsch.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Private
+#include "prom_dtoa_i.h"
+
+#define PROM_DTOA_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFull
+#define PROM_DTOA_EXPONENT_MASK 0x7FF0000000000000ull
+#define PROM_DTOA_HIDDEN_BIT 0x0010000000000000ull
+#define PROM_DTOA_SIGNIFICAND_SIZE 52
+#define PROM_DTOA_EXPONENT_BIAS (0x3FF + PROM_DTOA_SIGNIFICAND_SIZE)
+#define PROM_DTOA_MIN_EXPONENT (-PROM_DTOA_EXPONENT_BIAS + 1)
+
+// Values with a larger magnitude are not necessarily integers that fit the fast path
+#define PROM_DTOA_MAX_EXACT_INTEGER 9007199254740992.0
+
+// Like "%.17g", switch to exponent notation when the decimal exponent falls outside [-4, 17)
+#define PROM_DTOA_MIN_FIXED_EXPONENT (-4)
+#define PROM_DTOA_MAX_FIXED_EXPONENT 17
+
+// A floating point number f * 2^e with a 64 bit significand
+typedef struct prom_dtoa_fp {
+  uint64_t f;
+  int e;
+} prom_dtoa_fp_t;
+
+// Normalized powers of ten 10^-348, 10^-340, ..., 10^340
+static const prom_dtoa_fp_t prom_dtoa_cached_powers[] = {
+    {0xfa8fd5a0081c0288ull, -1220},
+    {0xbaaee17fa23ebf76ull, -1193},
+    {0x8b16fb203055ac76ull, -1166},
+    {0xcf42894a5dce35eaull, -1140},
+    {0x9a6bb0aa55653b2dull, -1113},
+    {0xe61acf033d1a45dfull, -1087},
+    {0xab70fe17c79ac6caull, -1060},
+    {0xff77b1fcbebcdc4full, -1034},
+    {0xbe5691ef416bd60cull, -1007},
+    {0x8dd01fad907ffc3cull, -980},
+    {0xd3515c2831559a83ull, -954},
+    {0x9d71ac8fada6c9b5ull, -927},
+    {0xea9c227723ee8bcbull, -901},
+    {0xaecc49914078536dull, -874},
+    {0x823c12795db6ce57ull, -847},
+    {0xc21094364dfb5637ull, -821},
+    {0x9096ea6f3848984full, -794},
+    {0xd77485cb25823ac7ull, -768},
+    {0xa086cfcd97bf97f4ull, -741},
+    {0xef340a98172aace5ull, -715},
+    {0xb23867fb2a35b28eull, -688},
+    {0x84c8d4dfd2c63f3bull, -661},
+    {0xc5dd44271ad3cdbaull, -635},
+    {0x936b9fcebb25c996ull, -608},
+    {0xdbac6c247d62a584ull, -582},
+    {0xa3ab66580d5fdaf6ull, -555},
+    {0xf3e2f893dec3f126ull, -529},
+    {0xb5b5ada8aaff80b8ull, -502},
+    {0x87625f056c7c4a8bull, -475},
+    {0xc9bcff6034c13053ull, -449},
+    {0x964e858c91ba2655ull, -422},
+    {0xdff9772470297ebdull, -396},
+    {0xa6dfbd9fb8e5b88full, -369},
+    {0xf8a95fcf88747d94ull, -343},
+    {0xb94470938fa89bcfull, -316},
+    {0x8a08f0f8bf0f156bull, -289},
+    {0xcdb02555653131b6ull, -263},
+    {0x993fe2c6d07b7facull, -236},
+    {0xe45c10c42a2b3b06ull, -210},
+    {0xaa242499697392d3ull, -183},
+    {0xfd87b5f28300ca0eull, -157},
+    {0xbce5086492111aebull, -130},
+    {0x8cbccc096f5088ccull, -103},
+    {0xd1b71758e219652cull, -77},
+    {0x9c40000000000000ull, -50},
+    {0xe8d4a51000000000ull, -24},
+    {0xad78ebc5ac620000ull, 3},
+    {0x813f3978f8940984ull, 30},
+    {0xc097ce7bc90715b3ull, 56},
+    {0x8f7e32ce7bea5c70ull, 83},
+    {0xd5d238a4abe98068ull, 109},
+    {0x9f4f2726179a2245ull, 136},
+    {0xed63a231d4c4fb27ull, 162},
+    {0xb0de65388cc8ada8ull, 189},
+    {0x83c7088e1aab65dbull, 216},
+    {0xc45d1df942711d9aull, 242},
+    {0x924d692ca61be758ull, 269},
+    {0xda01ee641a708deaull, 295},
+    {0xa26da3999aef774aull, 322},
+    {0xf209787bb47d6b85ull, 348},
+    {0xb454e4a179dd1877ull, 375},
+    {0x865b86925b9bc5c2ull, 402},
+    {0xc83553c5c8965d3dull, 428},
+    {0x952ab45cfa97a0b3ull, 455},
+    {0xde469fbd99a05fe3ull, 481},
+    {0xa59bc234db398c25ull, 508},
+    {0xf6c69a72a3989f5cull, 534},
+    {0xb7dcbf5354e9beceull, 561},
+    {0x88fcf317f22241e2ull, 588},
+    {0xcc20ce9bd35c78a5ull, 614},
+    {0x98165af37b2153dfull, 641},
+    {0xe2a0b5dc971f303aull, 667},
+    {0xa8d9d1535ce3b396ull, 694},
+    {0xfb9b7cd9a4a7443cull, 720},
+    {0xbb764c4ca7a44410ull, 747},
+    {0x8bab8eefb6409c1aull, 774},
+    {0xd01fef10a657842cull, 800},
+    {0x9b10a4e5e9913129ull, 827},
+    {0xe7109bfba19c0c9dull, 853},
+    {0xac2820d9623bf429ull, 880},
+    {0x80444b5e7aa7cf85ull, 907},
+    {0xbf21e44003acdd2dull, 933},
+    {0x8e679c2f5e44ff8full, 960},
+    {0xd433179d9c8cb841ull, 986},
+    {0x9e19db92b4e31ba9ull, 1013},
+    {0xeb96bf6ebadf77d9ull, 1039},
+    {0xaf87023b9bf0ee6bull, 1066},
+};
+
+static const uint64_t prom_dtoa_pow10[] = {1ull,
+                                           10ull,
+                                           100ull,
+                                           1000ull,
+                                           10000ull,
+                                           100000ull,
+                                           1000000ull,
+                                           10000000ull,
+                                           100000000ull,
+                                           1000000000ull,
+                                           10000000000ull,
+                                           100000000000ull,
+                                           1000000000000ull,
+                                           10000000000000ull,
+                                           100000000000000ull,
+                                           1000000000000000ull,
+                                           10000000000000000ull,
+                                           100000000000000000ull,
+                                           1000000000000000000ull,
+                                           10000000000000000000ull};
+
+static prom_dtoa_fp_t prom_dtoa_fp_from_double(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased_e = (int)((bits & PROM_DTOA_EXPONENT_MASK) >> PROM_DTOA_SIGNIFICAND_SIZE);
+  uint64_t significand = bits & PROM_DTOA_SIGNIFICAND_MASK;
+  if (biased_e != 0) return (prom_dtoa_fp_t){significand + PROM_DTOA_HIDDEN_BIT, biased_e - PROM_DTOA_EXPONENT_BIAS};
+  return (prom_dtoa_fp_t){significand, PROM_DTOA_MIN_EXPONENT};
+}
+
+static prom_dtoa_fp_t prom_dtoa_fp_multiply(prom_dtoa_fp_t x, prom_dtoa_fp_t y) {
+  const uint64_t mask = 0xFFFFFFFFull;
+  uint64_t a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+  uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+  tmp += 1ull << 31;  // round
+  return (prom_dtoa_fp_t){ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+}
+
+static prom_dtoa_fp_t prom_dtoa_fp_normalize(prom_dtoa_fp_t x) {
+  int shift = __builtin_clzll(x.f);
+  return (prom_dtoa_fp_t){x.f << shift, x.e - shift};
+}
+
+// Computes the boundaries m- and m+ halfway between value and its neighbours, sharing the exponent of m+
+static void prom_dtoa_boundaries(prom_dtoa_fp_t v, prom_dtoa_fp_t *minus, prom_dtoa_fp_t *plus) {
+  *plus = prom_dtoa_fp_normalize((prom_dtoa_fp_t){(v.f << 1) + 1, v.e - 1});
+  // The lower neighbour is closer when the significand is a power of two
+  if (v.f == PROM_DTOA_HIDDEN_BIT) {
+    *minus = (prom_dtoa_fp_t){(v.f << 2) - 1, v.e - 2};
+  } else {
+    *minus = (prom_dtoa_fp_t){(v.f << 1) - 1, v.e - 1};
+  }
+  minus->f <<= minus->e - plus->e;
+  minus->e = plus->e;
+}
+
+// Returns a cached power c = 10^-k such that the binary exponent of e * c lands in [-60, -32]
+static prom_dtoa_fp_t prom_dtoa_cached_power(int e, int *k) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;  // 1 / log2(10)
+  int ik = (int)dk;
+  if (dk - ik > 0.0) ik++;
+  unsigned index = (unsigned)((ik >> 3) + 1);
+  *k = -(-348 + (int)index * 8);
+  return prom_dtoa_cached_powers[index];
+}
+
+static void prom_dtoa_round(char *digits, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    digits[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static int prom_dtoa_count_digits(uint32_t n) {
+  int count = 1;
+  while (count < 10 && n >= prom_dtoa_pow10[count]) count++;
+  return count;
+}
+
+// Generates the shortest digits of w within the unsafe interval (mp - delta, mp], adjusting the decimal exponent k
+static int prom_dtoa_generate_digits(prom_dtoa_fp_t w, prom_dtoa_fp_t mp, uint64_t delta, char *digits, int *k) {
+  const prom_dtoa_fp_t one = {1ull << -mp.e, mp.e};
+  const uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = prom_dtoa_count_digits(p1);
+  int len = 0;
+
+  while (kappa > 0) {
+    uint32_t divisor = (uint32_t)prom_dtoa_pow10[kappa - 1];
+    uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || len) digits[len++] = (char)('0' + d);
+    kappa--;
+    uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+    if (rest <= delta) {
+      *k += kappa;
+      prom_dtoa_round(digits, len, delta, rest, prom_dtoa_pow10[kappa] << -one.e, wp_w);
+      return len;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d || len) digits[len++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k += kappa;
+      int index = -kappa;
+      prom_dtoa_round(digits, len, delta, p2, one.f, wp_w * (index < 20 ? prom_dtoa_pow10[index] : 0));
+      return len;
+    }
+  }
+}
+
+// Writes the shortest digits of a positive, finite value and returns their count. The value equals digits * 10^k.
+static int prom_dtoa_grisu2(double value, char *digits, int *k) {
+  prom_dtoa_fp_t v = prom_dtoa_fp_from_double(value);
+  prom_dtoa_fp_t minus, plus;
+  prom_dtoa_boundaries(v, &minus, &plus);
+
+  prom_dtoa_fp_t c_mk = prom_dtoa_cached_power(plus.e, k);
+  prom_dtoa_fp_t w = prom_dtoa_fp_multiply(prom_dtoa_fp_normalize(v), c_mk);
+  prom_dtoa_fp_t wp = prom_dtoa_fp_multiply(plus, c_mk);
+  prom_dtoa_fp_t wm = prom_dtoa_fp_multiply(minus, c_mk);
+  // Stay conservative regarding the rounding error of the multiplications
+  wm.f++;
+  wp.f--;
+  return prom_dtoa_generate_digits(w, wp, wp.f - wm.f, digits, k);
+}
+
+static size_t prom_dtoa_uint64(uint64_t n, char *buf) {
+  char tmp[20];
+  size_t len = 0;
+  do {
+    tmp[len++] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n);
+  for (size_t i = 0; i < len; i++) buf[i] = tmp[len - 1 - i];
+  return len;
+}
+
+size_t prom_dtoa(double value, char *buf) {
+  char *p = buf;
+
+  if (isnan(value)) {
+    memcpy(buf, "NaN", 4);
+    return 3;
+  }
+  if (isinf(value)) {
+    memcpy(buf, value > 0 ? "+Inf" : "-Inf", 5);
+    return 4;
+  }
+  if (signbit(value)) {
+    *p++ = '-';
+    value = -value;
+  }
+
+  // Fast path for integral values such as counters
+  if (value < PROM_DTOA_MAX_EXACT_INTEGER) {
+    uint64_t n = (uint64_t)value;
+    if ((double)n == value) {
+      p += prom_dtoa_uint64(n, p);
+      *p = '\0';
+      return (size_t)(p - buf);
+    }
+  }
+
+  char digits[18];
+  int k = 0;
+  int len = prom_dtoa_grisu2(value, digits, &k);
+  // The position of the decimal point relative to the first digit
+  int point = len + k;
+  int exponent = point - 1;
+
+  if (exponent < PROM_DTOA_MIN_FIXED_EXPONENT || exponent >= PROM_DTOA_MAX_FIXED_EXPONENT) {
+    // d.ddde[+-]XX
+    *p++ = digits[0];
+    if (len > 1) {
+      *p++ = '.';
+      memcpy(p, digits + 1, (size_t)(len - 1));
+      p += len - 1;
+    }
+    *p++ = 'e';
+    if (exponent < 0) {
+      *p++ = '-';
+      exponent = -exponent;
+    } else {
+      *p++ = '+';
+    }
+    if (exponent < 10) *p++ = '0';
+    p += prom_dtoa_uint64((uint64_t)exponent, p);
+  } else if (point <= 0) {
+    // 0.000ddd
+    *p++ = '0';
+    *p++ = '.';
+    memset(p, '0', (size_t)-point);
+    p += -point;
+    memcpy(p, digits, (size_t)len);
+    p += len;
+  } else if (point >= len) {
+    // ddd000
+    memcpy(p, digits, (size_t)len);
+    p += len;
+    memset(p, '0', (size_t)(point - len));
+    p += point - len;
+  } else {
+    // ddd.ddd
+    memcpy(p, digits, (size_t)point);
+    p += point;
+    *p++ = '.';
+    memcpy(p, digits + point, (size_t)(len - point));
+    p += len - point;
+  }
+
+  *p = '\0';
+  return (size_t)(p - buf);
+}
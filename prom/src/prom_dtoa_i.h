@@ -0,0 +1,42 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_DTOA_I_H
+#define PROM_DTOA_I_H
+
+#include <stddef.h>
+
+/**
+ * @brief Size of a buffer large enough to hold any value rendered by prom_dtoa, including the terminating null byte
+ */
+#define PROM_DTOA_BUFFER_SIZE 32
+
+/**
+ * API PRIVATE
+ * @brief Renders a double as the sample value of the Prometheus text exposition format
+ *
+ * Integral values below 2^53 are printed as plain integers. All other finite values are printed with a digit sequence
+ * that parses back to the same double, laid out like "%.17g". The digits come from Grisu2 and are the shortest possible
+ * for all but a tiny fraction of inputs. Infinities and NaN are printed as +Inf, -Inf and NaN. The output does not
+ * depend on the current locale.
+ *
+ * @param value The value to render
+ * @param buf Destination of at least PROM_DTOA_BUFFER_SIZE bytes
+ * @return The length of the rendered value, excluding the terminating null byte
+ */
+size_t prom_dtoa(double value, char *buf);
+
+#endif  // PROM_DTOA_I_H
@@ -0,0 +1,118 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_epoch_i.h"
+#include "prom_epoch_t.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+
+// Epoch 0 marks a thread outside any critical section, so counting starts at 1
+static _Atomic(uint64_t) prom_epoch_global = 1;
+static _Atomic(prom_epoch_record_t *) prom_epoch_records = NULL;
+static pthread_key_t prom_epoch_key;
+static pthread_once_t prom_epoch_key_once = PTHREAD_ONCE_INIT;
+static bool prom_epoch_key_ok = false;
+
+static __thread prom_epoch_record_t *prom_epoch_self = NULL;
+static __thread unsigned prom_epoch_depth = 0;
+
+static void prom_epoch_release(void *value) {
+  prom_epoch_record_t *record = (prom_epoch_record_t *)value;
+  atomic_store_explicit(&record->active, 0, memory_order_release);
+  atomic_store_explicit(&record->in_use, false, memory_order_release);
+}
+
+static void prom_epoch_key_init(void) {
+  int r = pthread_key_create(&prom_epoch_key, prom_epoch_release);
+  if (r) {
+    PROM_LOG("failed to create the epoch thread key");
+    return;
+  }
+  prom_epoch_key_ok = true;
+}
+
+/**
+ * @brief API PRIVATE Returns the record of the calling thread, taking over one handed back by an exited thread or
+ * publishing a new one. Returns NULL upon failure.
+ */
+static prom_epoch_record_t *prom_epoch_record_acquire(void) {
+  prom_epoch_record_t *record = NULL;
+  for (record = atomic_load_explicit(&prom_epoch_records, memory_order_acquire); record != NULL;
+       record = record->next) {
+    bool in_use = false;
+    if (!atomic_load_explicit(&record->in_use, memory_order_relaxed) &&
+        atomic_compare_exchange_strong(&record->in_use, &in_use, true)) {
+      break;
+    }
+  }
+
+  if (record == NULL) {
+    record = (prom_epoch_record_t *)prom_malloc(sizeof(prom_epoch_record_t));
+    if (record == NULL) return NULL;
+    atomic_init(&record->active, 0);
+    atomic_init(&record->in_use, true);
+    record->next = atomic_load_explicit(&prom_epoch_records, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&prom_epoch_records, &record->next, record, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+  }
+
+  // Without the key the record is never handed back, which only costs a record per thread
+  pthread_once(&prom_epoch_key_once, prom_epoch_key_init);
+  if (prom_epoch_key_ok && pthread_setspecific(prom_epoch_key, record)) {
+    PROM_LOG("failed to register the epoch record of a thread");
+  }
+  return record;
+}
+
+void prom_epoch_enter(void) {
+  if (prom_epoch_depth++ > 0) return;
+  if (prom_epoch_self == NULL) prom_epoch_self = prom_epoch_record_acquire();
+  if (prom_epoch_self == NULL) return;
+
+  // The fence orders the store of active before every load of the critical section. A retirer that advances the
+  // epoch after this thread loaded it either sees the store or has unlinked the object before any load below.
+  atomic_store_explicit(&prom_epoch_self->active, atomic_load(&prom_epoch_global), memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+void prom_epoch_exit(void) {
+  if (--prom_epoch_depth > 0 || prom_epoch_self == NULL) return;
+  atomic_store_explicit(&prom_epoch_self->active, 0, memory_order_release);
+}
+
+uint64_t prom_epoch_retire(void) { return atomic_fetch_add(&prom_epoch_global, 1); }
+
+uint64_t prom_epoch_safe(void) {
+  uint64_t safe = UINT64_MAX;
+  atomic_thread_fence(memory_order_seq_cst);
+  for (prom_epoch_record_t *record = atomic_load_explicit(&prom_epoch_records, memory_order_acquire); record != NULL;
+       record = record->next) {
+    uint64_t active = atomic_load_explicit(&record->active, memory_order_acquire);
+    if (active != 0 && active < safe) safe = active;
+  }
+  return safe;
+}
@@ -0,0 +1,49 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_EPOCH_I_H
+#define PROM_EPOCH_I_H
+
+#include <stdint.h>
+
+// Private
+#include "prom_epoch_t.h"
+
+/**
+ * @brief API PRIVATE Begins a critical section in which the calling thread may dereference memory reached without a
+ * lock. Memory retired after the section begins is not reclaimed before it ends. Sections may nest.
+ */
+void prom_epoch_enter(void);
+
+/**
+ * @brief API PRIVATE Ends the critical section begun by the matching prom_epoch_enter.
+ */
+void prom_epoch_exit(void);
+
+/**
+ * @brief API PRIVATE Advances the global epoch and returns the epoch an object unlinked beforehand is retired in. Once
+ * prom_epoch_safe returns a greater epoch, no thread can still hold a reference to the object.
+ */
+uint64_t prom_epoch_retire(void);
+
+/**
+ * @brief API PRIVATE Returns the epoch the oldest critical section in progress began in, or UINT64_MAX if there is
+ * none. Objects retired in a lower epoch may be reclaimed.
+ */
+uint64_t prom_epoch_safe(void);
+
+#endif  // PROM_EPOCH_I_H
@@ -0,0 +1,37 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PROM_EPOCH_T_H
+#define PROM_EPOCH_T_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief API PRIVATE The state of a thread that reads shared structures without taking a lock.
+ *
+ * Records are never freed. One is taken over by each thread on its first critical section and handed back when the
+ * thread exits, so their number is bounded by the peak number of threads.
+ */
+typedef struct prom_epoch_record {
+  _Atomic(uint64_t) active;        /**< active The epoch observed when the critical section began or 0 outside one */
+  _Atomic(bool) in_use;            /**< in_use Whether a live thread owns the record */
+  struct prom_epoch_record *next;  /**< next   The next record. Never changes once the record is published */
+} prom_epoch_record_t;
+
+#endif  // PROM_EPOCH_T_H
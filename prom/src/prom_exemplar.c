@@ -0,0 +1,67 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_exemplar_i.h"
+#include "prom_exemplar_t.h"
+#include "prom_log.h"
+#include "prom_metric_sample_i.h"
+
+prom_exemplar_t *prom_exemplar_new(size_t label_count, const char **label_keys, const char **label_values,
+                                   double value) {
+  size_t label_len = 0;
+  for (size_t i = 0; i < label_count; i++) {
+    label_len += strlen(label_keys[i]) + strlen(label_values[i]);
+  }
+  if (label_len > PROM_EXEMPLAR_MAX_LABEL_LEN) {
+    PROM_LOG("exemplar labels exceed the maximum length");
+    return NULL;
+  }
+
+  // The label arrays and strings follow the struct in the same allocation
+  size_t size = sizeof(prom_exemplar_t) + sizeof(const char *) * label_count * 2 + label_len + label_count * 2;
+  prom_exemplar_t *self = (prom_exemplar_t *)prom_malloc(size);
+  if (self == NULL) return NULL;
+  self->label_count = label_count;
+  self->label_keys = (const char **)(self + 1);
+  self->label_values = self->label_keys + label_count;
+  char *str = (char *)(self->label_values + label_count);
+  for (size_t i = 0; i < label_count; i++) {
+    size_t len = strlen(label_keys[i]) + 1;
+    memcpy(str, label_keys[i], len);
+    self->label_keys[i] = str;
+    str += len;
+
+    len = strlen(label_values[i]) + 1;
+    memcpy(str, label_values[i], len);
+    self->label_values[i] = str;
+    str += len;
+  }
+  self->value = value;
+  self->timestamp = prom_metric_sample_now();
+  return self;
+}
+
+int prom_exemplar_destroy(prom_exemplar_t *self) {
+  prom_free(self);
+  return 0;
+}
@@ -0,0 +1,35 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_EXEMPLAR_I_H
+#define PROM_EXEMPLAR_I_H
+
+// Private
+#include "prom_exemplar_t.h"
+
+/**
+ * @brief API PRIVATE Constructs a prom_exemplar_t* timestamped with the current time. Returns NULL if the labels
+ * exceed PROM_EXEMPLAR_MAX_LABEL_LEN.
+ */
+prom_exemplar_t *prom_exemplar_new(size_t label_count, const char **label_keys, const char **label_values,
+                                   double value);
+
+/**
+ * @brief API PRIVATE Destroys a prom_exemplar_t*
+ */
+int prom_exemplar_destroy(prom_exemplar_t *self);
+
+#endif  // PROM_EXEMPLAR_I_H
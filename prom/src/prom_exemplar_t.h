@@ -0,0 +1,39 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_EXEMPLAR_T_H
+#define PROM_EXEMPLAR_T_H
+
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE The maximum combined length of the label names and values of an exemplar, as set by OpenMetrics
+ */
+#define PROM_EXEMPLAR_MAX_LABEL_LEN 128
+
+/**
+ * @brief API PRIVATE An exemplar attached to a counter sample or histogram bucket. Exemplars are immutable and stored
+ * in a single allocation together with their labels.
+ */
+typedef struct prom_exemplar {
+  size_t label_count;        /**< label_count  The number of labels */
+  const char **label_keys;   /**< label_keys   The label names */
+  const char **label_values; /**< label_values The label values */
+  double value;              /**< value        The observed value */
+  double timestamp;          /**< timestamp    The Unix time at which the value was observed in seconds */
+} prom_exemplar_t;
+
+#endif  // PROM_EXEMPLAR_T_H
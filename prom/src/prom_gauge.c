@@ -21,6 +21,7 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_epoch_i.h"
 #include "prom_errors.h"
 #include "prom_log.h"
 #include "prom_metric_i.h"
@@ -47,9 +48,11 @@ int prom_gauge_inc(prom_gauge_t *self, const char **label_values) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, 1.0);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_add(sample, 1.0);
+  prom_epoch_exit();
+  return r;
 }
 
 int prom_gauge_dec(prom_gauge_t *self, const char **label_values) {
@@ -59,9 +62,11 @@ int prom_gauge_dec(prom_gauge_t *self, const char **label_values) {
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_sub(sample, 1.0);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_sub(sample, 1.0);
+  prom_epoch_exit();
+  return r;
 }
 
 int prom_gauge_add(prom_gauge_t *self, double r_value, const char **label_values) {
@@ -71,9 +76,11 @@ int prom_gauge_add(prom_gauge_t *self, double r_value, const char **label_values
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_add(sample, r_value);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_add(sample, r_value);
+  prom_epoch_exit();
+  return r;
 }
 
 int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values) {
@@ -83,9 +90,11 @@ int prom_gauge_sub(prom_gauge_t *self, double r_value, const char **label_values
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_sub(sample, r_value);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_sub(sample, r_value);
+  prom_epoch_exit();
+  return r;
 }
 
 int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values) {
@@ -95,7 +104,69 @@ int prom_gauge_set(prom_gauge_t *self, double r_value, const char **label_values
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(self, label_values);
-  if (sample == NULL) return 1;
-  return prom_metric_sample_set(sample, r_value);
+  int r = (sample == NULL) ? 1 : prom_metric_sample_set(sample, r_value);
+  prom_epoch_exit();
+  return r;
+}
+
+prom_gauge_child_t *prom_gauge_with_labels(prom_gauge_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return (prom_gauge_child_t *)prom_metric_series_pin(self, label_values);
+}
+
+int prom_gauge_child_inc(prom_gauge_child_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_add(self, 1.0);
+}
+
+int prom_gauge_child_dec(prom_gauge_child_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_sub(self, 1.0);
+}
+
+int prom_gauge_child_add(prom_gauge_child_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_add(self, r_value);
+}
+
+int prom_gauge_child_sub(prom_gauge_child_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_sub(self, r_value);
+}
+
+int prom_gauge_child_set(prom_gauge_child_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_GAUGE) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  return prom_metric_sample_set(self, r_value);
 }
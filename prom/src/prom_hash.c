@@ -0,0 +1,102 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A fast non-cryptographic hash following the construction of wyhash by Wang Yi, which is released into the public
+// domain. Each 16 byte block is folded into the state with a single 64x64 to 128 bit multiplication.
+
+#include <stdint.h>
+#include <string.h>
+
+// Private
+#include "prom_hash_i.h"
+
+#define PROM_HASH_SECRET_0 0xa0761d6478bd642full
+#define PROM_HASH_SECRET_1 0xe7037ed1a0b428dbull
+
+// Multiplies a and b and stores the low and high halves of the 128 bit product in a and b
+static inline void prom_hash_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  *a = lo;
+  *b = hi;
+#endif
+}
+
+static inline uint64_t prom_hash_mix(uint64_t a, uint64_t b) {
+  prom_hash_mum(&a, &b);
+  return a ^ b;
+}
+
+// Unaligned little endian loads. memcpy compiles down to a single load.
+static inline uint64_t prom_hash_read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline uint64_t prom_hash_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+uint64_t prom_hash(const void *data, size_t len, uint64_t seed) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint64_t a = 0;
+  uint64_t b = 0;
+
+  seed ^= prom_hash_mix(seed ^ PROM_HASH_SECRET_0, PROM_HASH_SECRET_1);
+  if (len <= 16) {
+    if (len >= 4) {
+      // Two possibly overlapping 4 byte reads from each end cover up to 16 bytes
+      size_t offset = (len >> 3) << 2;
+      a = (prom_hash_read32(p) << 32) | prom_hash_read32(p + offset);
+      b = (prom_hash_read32(p + len - 4) << 32) | prom_hash_read32(p + len - 4 - offset);
+    } else if (len > 0) {
+      a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+    }
+  } else {
+    size_t i = len;
+    while (i > 16) {
+      seed = prom_hash_mix(prom_hash_read64(p) ^ PROM_HASH_SECRET_1, prom_hash_read64(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    a = prom_hash_read64(p + i - 16);
+    b = prom_hash_read64(p + i - 8);
+  }
+
+  a ^= PROM_HASH_SECRET_1;
+  b ^= seed;
+  prom_hash_mum(&a, &b);
+  return prom_hash_mix(a ^ PROM_HASH_SECRET_0 ^ len, b ^ PROM_HASH_SECRET_1);
+}
@@ -0,0 +1,37 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_HASH_I_H
+#define PROM_HASH_I_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * API PRIVATE
+ * @brief Returns a 64 bit hash of len bytes starting at data
+ *
+ * The hash is not cryptographic. Hashes may be chained by passing the hash of the previous piece of data as the seed of
+ * the next one.
+ *
+ * @param data The bytes to hash
+ * @param len The number of bytes
+ * @param seed The seed of the hash
+ * @return The hash
+ */
+uint64_t prom_hash(const void *data, size_t len, uint64_t seed);
+
+#endif  // PROM_HASH_I_H
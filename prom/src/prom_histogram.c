@@ -22,7 +22,9 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_epoch_i.h"
 #include "prom_errors.h"
+#include "prom_exemplar_i.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_i.h"
@@ -54,6 +56,29 @@ prom_histogram_t *prom_histogram_new(const char *name, const char *help, prom_hi
   return self;
 }
 
+prom_histogram_t *prom_histogram_new_native(const char *name, const char *help, int schema, size_t max_bucket_count,
+                                            size_t label_key_count, const char **label_keys) {
+  if (schema < PROM_HISTOGRAM_NATIVE_SCHEMA_MIN || schema > PROM_HISTOGRAM_NATIVE_SCHEMA_MAX) {
+    PROM_LOG("native histogram schema out of range");
+    return NULL;
+  }
+  prom_histogram_t *self = (prom_histogram_t *)prom_metric_new(PROM_HISTOGRAM, name, help, label_key_count, label_keys);
+  if (self == NULL) return NULL;
+
+  // Native histograms have no classic buckets besides +Inf
+  self->buckets = (prom_histogram_buckets_t *)prom_malloc(sizeof(prom_histogram_buckets_t));
+  if (self->buckets == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  self->buckets->count = 0;
+  self->buckets->upper_bounds = NULL;
+  self->native = true;
+  self->native_schema = schema;
+  self->native_max_buckets = max_bucket_count;
+  return self;
+}
+
 int prom_histogram_destroy(prom_histogram_t *self) {
   PROM_ASSERT(self != NULL);
 
@@ -73,7 +98,52 @@ int prom_histogram_observe(prom_histogram_t *self, double value, const char **la
     PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
     return 1;
   }
+  prom_epoch_enter();
   prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_from_labels(self, label_values);
-  if (h_sample == NULL) return 1;
-  return prom_metric_sample_histogram_observe(h_sample, value);
+  int r = (h_sample == NULL) ? 1 : prom_metric_sample_histogram_observe(h_sample, value);
+  prom_epoch_exit();
+  return r;
+}
+
+int prom_histogram_observe_with_exemplar(prom_histogram_t *self, double value, const char **label_values,
+                                         size_t exemplar_label_count, const char **exemplar_label_keys,
+                                         const char **exemplar_label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->type != PROM_HISTOGRAM) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  // Build the exemplar first so that an invalid one leaves the histogram untouched
+  prom_exemplar_t *exemplar =
+      prom_exemplar_new(exemplar_label_count, exemplar_label_keys, exemplar_label_values, value);
+  if (exemplar == NULL) return 1;
+
+  prom_epoch_enter();
+  prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_from_labels(self, label_values);
+  int r = (h_sample == NULL) ? 1 : prom_metric_sample_histogram_observe(h_sample, value);
+  if (r) {
+    prom_exemplar_destroy(exemplar);
+  } else {
+    size_t index = prom_metric_sample_histogram_bucket_index(h_sample, value);
+    r = prom_metric_sample_histogram_set_exemplar(self, h_sample, index, exemplar);
+  }
+  prom_epoch_exit();
+  return r;
+}
+
+prom_histogram_child_t *prom_histogram_with_labels(prom_histogram_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  if (self->type != PROM_HISTOGRAM) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return NULL;
+  }
+  return (prom_histogram_child_t *)prom_metric_series_pin(self, label_values);
+}
+
+int prom_histogram_child_observe(prom_histogram_child_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_metric_sample_histogram_observe(self, value);
 }
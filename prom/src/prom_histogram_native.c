@@ -0,0 +1,218 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://prometheus.io/docs/specs/native_histograms/
+
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_histogram.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_histogram_native_i.h"
+#include "prom_histogram_native_t.h"
+#include "prom_log.h"
+
+// The bucket boundaries within one power of two for each positive schema, as fractions in [0.5, 1). Schema s has 2^s
+// boundaries; prom_histogram_native_bounds[s] points at those of schema s.
+static double prom_histogram_native_bound_storage[(2 << PROM_HISTOGRAM_NATIVE_SCHEMA_MAX) - 2];
+static const double *prom_histogram_native_bounds[PROM_HISTOGRAM_NATIVE_SCHEMA_MAX + 1];
+static pthread_once_t prom_histogram_native_bounds_once = PTHREAD_ONCE_INIT;
+
+static void prom_histogram_native_init_bounds(void) {
+  double *bounds = prom_histogram_native_bound_storage;
+  for (int32_t schema = 1; schema <= PROM_HISTOGRAM_NATIVE_SCHEMA_MAX; schema++) {
+    size_t bound_count = (size_t)1 << schema;
+    for (size_t i = 0; i < bound_count; i++) {
+      bounds[i] = exp2((double)i / (double)bound_count) / 2.0;
+    }
+    prom_histogram_native_bounds[schema] = bounds;
+    bounds += bound_count;
+  }
+}
+
+prom_histogram_native_t *prom_histogram_native_new(int32_t schema, size_t max_bucket_count) {
+  if (schema < PROM_HISTOGRAM_NATIVE_SCHEMA_MIN || schema > PROM_HISTOGRAM_NATIVE_SCHEMA_MAX) {
+    PROM_LOG("native histogram schema out of range");
+    return NULL;
+  }
+
+  prom_histogram_native_t *self = (prom_histogram_native_t *)prom_malloc(sizeof(prom_histogram_native_t));
+  if (self == NULL) return NULL;
+  if (pthread_mutex_init(&self->lock, NULL)) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_INIT_ERROR);
+    prom_free(self);
+    return NULL;
+  }
+  self->schema = schema;
+  self->max_bucket_count = max_bucket_count;
+  self->zero_threshold = PROM_HISTOGRAM_NATIVE_ZERO_THRESHOLD;
+  self->count = 0;
+  self->zero_count = 0;
+  self->positive = (prom_histogram_native_buckets_t){NULL, 0, 0};
+  self->negative = (prom_histogram_native_buckets_t){NULL, 0, 0};
+  return self;
+}
+
+int prom_histogram_native_destroy(prom_histogram_native_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  int r = pthread_mutex_destroy(&self->lock);
+  if (r) PROM_LOG(PROM_PTHREAD_MUTEX_DESTROY_ERROR);
+
+  prom_free(self->positive.buckets);
+  self->positive.buckets = NULL;
+  prom_free(self->negative.buckets);
+  self->negative.buckets = NULL;
+
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+int32_t prom_histogram_native_bucket_index(int32_t schema, double value) {
+  // Infinity shares the index computation of the largest double and is then moved to the following bucket
+  bool inf = isinf(value);
+  if (inf) value = DBL_MAX;
+
+  int exp = 0;
+  double frac = frexp(fabs(value), &exp);
+  int32_t index = 0;
+  if (schema > 0) {
+    // Find the first boundary greater than or equal to the fraction
+    pthread_once(&prom_histogram_native_bounds_once, prom_histogram_native_init_bounds);
+    const double *bounds = prom_histogram_native_bounds[schema];
+    size_t low = 0;
+    size_t high = (size_t)1 << schema;
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (bounds[mid] < frac) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    index = (int32_t)low + (exp - 1) * (1 << schema);
+  } else {
+    // Powers of two are the upper bound of their bucket. Lower schemas merge 2^-schema buckets of schema 0 into one.
+    index = exp;
+    if (frac == 0.5) index--;
+    int32_t offset = (1 << -schema) - 1;
+    index = (index + offset) >> -schema;
+  }
+  if (inf) index++;
+  return index;
+}
+
+/**
+ * @brief API PRIVATE Increments the bucket at index, inserting it if it is not populated yet. Returns 0 if the bucket
+ * existed, 1 if it was inserted and -1 upon failure.
+ */
+static int prom_histogram_native_buckets_add(prom_histogram_native_buckets_t *self, int32_t index) {
+  size_t low = 0;
+  size_t high = self->count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (self->buckets[mid].index < index) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < self->count && self->buckets[low].index == index) {
+    self->buckets[low].count++;
+    return 0;
+  }
+
+  if (self->count == self->capacity) {
+    size_t capacity = (self->capacity == 0) ? 8 : self->capacity * 2;
+    prom_histogram_native_bucket_t *buckets = (prom_histogram_native_bucket_t *)prom_realloc(
+        self->buckets, sizeof(prom_histogram_native_bucket_t) * capacity);
+    if (buckets == NULL) return -1;
+    self->buckets = buckets;
+    self->capacity = capacity;
+  }
+  memmove(self->buckets + low + 1, self->buckets + low, sizeof(prom_histogram_native_bucket_t) * (self->count - low));
+  self->buckets[low] = (prom_histogram_native_bucket_t){index, 1};
+  self->count++;
+  return 1;
+}
+
+/**
+ * @brief API PRIVATE Merges buckets 2i-1 and 2i into bucket i, as they are at the next lower schema. The mapping keeps
+ * the buckets ordered, so merging is done in place.
+ */
+static void prom_histogram_native_buckets_halve(prom_histogram_native_buckets_t *self) {
+  size_t count = 0;
+  for (size_t i = 0; i < self->count; i++) {
+    int32_t index = self->buckets[i].index;
+    index = (index > 0) ? (index + 1) / 2 : index / 2;
+    if (count > 0 && self->buckets[count - 1].index == index) {
+      self->buckets[count - 1].count += self->buckets[i].count;
+    } else {
+      self->buckets[count++] = (prom_histogram_native_bucket_t){index, self->buckets[i].count};
+    }
+  }
+  self->count = count;
+}
+
+int prom_histogram_native_observe(prom_histogram_native_t *self, double value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_mutex_lock(&self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+
+  int ret = 0;
+  self->count++;
+  if (isnan(value)) {
+    // NaN has no bucket and is only reflected in the count and sum
+  } else if (value > self->zero_threshold || value < -self->zero_threshold) {
+    prom_histogram_native_buckets_t *buckets = (value > 0) ? &self->positive : &self->negative;
+    int inserted = prom_histogram_native_buckets_add(buckets, prom_histogram_native_bucket_index(self->schema, value));
+    if (inserted < 0) {
+      self->count--;
+      ret = 1;
+    }
+    while (inserted > 0 && self->max_bucket_count > 0 &&
+           self->positive.count + self->negative.count > self->max_bucket_count &&
+           self->schema > PROM_HISTOGRAM_NATIVE_SCHEMA_MIN) {
+      prom_histogram_native_buckets_halve(&self->positive);
+      prom_histogram_native_buckets_halve(&self->negative);
+      self->schema--;
+    }
+  } else {
+    self->zero_count++;
+  }
+
+  r = pthread_mutex_unlock(&self->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_UNLOCK_ERROR);
+    return r;
+  }
+  return ret;
+}
@@ -0,0 +1,48 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_HISTOGRAM_NATIVE_I_H
+#define PROM_HISTOGRAM_NATIVE_I_H
+
+#include <stdint.h>
+
+// Private
+#include "prom_histogram_native_t.h"
+
+/**
+ * @brief API PRIVATE Constructs a prom_histogram_native_t* without observations. Returns NULL if the schema is out of
+ * range.
+ */
+prom_histogram_native_t *prom_histogram_native_new(int32_t schema, size_t max_bucket_count);
+
+/**
+ * @brief API PRIVATE Destroys a prom_histogram_native_t*
+ */
+int prom_histogram_native_destroy(prom_histogram_native_t *self);
+
+/**
+ * @brief API PRIVATE Counts the value in its bucket, reducing the schema if the bucket count exceeds the maximum. NaN
+ * is only counted in the total count.
+ */
+int prom_histogram_native_observe(prom_histogram_native_t *self, double value);
+
+/**
+ * @brief API PRIVATE Returns the index of the bucket of the given schema containing the absolute value, which must be
+ * greater than 0. Infinity is placed in the bucket following the one containing the largest double.
+ */
+int32_t prom_histogram_native_bucket_index(int32_t schema, double value);
+
+#endif  // PROM_HISTOGRAM_NATIVE_I_H
@@ -0,0 +1,65 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_HISTOGRAM_NATIVE_T_H
+#define PROM_HISTOGRAM_NATIVE_T_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief API PRIVATE Observations whose absolute value does not exceed this threshold are counted in the zero bucket.
+ * Matches the default of the reference client, 2^-128.
+ */
+#define PROM_HISTOGRAM_NATIVE_ZERO_THRESHOLD 2.938735877055719e-39
+
+/**
+ * @brief API PRIVATE A populated bucket of a native histogram
+ */
+typedef struct prom_histogram_native_bucket {
+  int32_t index;  /**< index The bucket index. Bucket i spans (base^(i-1), base^i] */
+  uint64_t count; /**< count The number of observations in the bucket */
+} prom_histogram_native_bucket_t;
+
+/**
+ * @brief API PRIVATE The populated buckets of one sign, ordered by index
+ */
+typedef struct prom_histogram_native_buckets {
+  prom_histogram_native_bucket_t *buckets; /**< buckets  The populated buckets */
+  size_t count;                            /**< count    The number of populated buckets */
+  size_t capacity;                         /**< capacity The number of buckets allocated */
+} prom_histogram_native_buckets_t;
+
+/**
+ * @brief API PRIVATE The sparse exponential buckets of a native histogram sample.
+ *
+ * The base of the buckets is 2^(2^-schema). Only populated buckets are stored. When an observation populates more than
+ * max_bucket_count buckets, the schema is decremented, merging every pair of adjacent buckets, until the buckets fit
+ * again or the minimum schema is reached. Every field is guarded by lock.
+ */
+typedef struct prom_histogram_native {
+  pthread_mutex_t lock;                     /**< lock             Guards the fields below */
+  int32_t schema;                           /**< schema           The current resolution */
+  size_t max_bucket_count;                  /**< max_bucket_count The bucket count that triggers a reduction or 0 */
+  double zero_threshold;                    /**< zero_threshold   The upper bound of the zero bucket */
+  uint64_t count;                           /**< count            The number of observations including NaN */
+  uint64_t zero_count;                      /**< zero_count       The number of observations in the zero bucket */
+  prom_histogram_native_buckets_t positive; /**< positive         The buckets of positive observations */
+  prom_histogram_native_buckets_t negative; /**< negative         The buckets of negative observations */
+} prom_histogram_native_t;
+
+#endif  // PROM_HISTOGRAM_NATIVE_T_H
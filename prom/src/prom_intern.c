@@ -0,0 +1,146 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_arena_i.h"
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_intern_i.h"
+#include "prom_intern_t.h"
+#include "prom_log.h"
+#include "prom_map_i.h"
+
+static prom_intern_t *prom_intern_default_table = NULL;
+static pthread_once_t prom_intern_default_once = PTHREAD_ONCE_INIT;
+
+prom_intern_t *prom_intern_new(void) {
+  int r = 0;
+
+  prom_intern_t *self = (prom_intern_t *)prom_malloc(sizeof(prom_intern_t));
+  if (self == NULL) return NULL;
+  self->entries = NULL;
+  self->rwlock = NULL;
+
+  self->arena = prom_arena_new();
+  if (self->arena == NULL) {
+    prom_intern_destroy(self);
+    return NULL;
+  }
+
+  // Entries live in the arena, so the map is left with its no-op free function
+  self->entries = prom_map_new_from_arena(self->arena);
+  if (self->entries == NULL) {
+    prom_intern_destroy(self);
+    return NULL;
+  }
+
+  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
+  if (self->rwlock == NULL) {
+    prom_intern_destroy(self);
+    return NULL;
+  }
+  r = pthread_rwlock_init(self->rwlock, NULL);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
+    prom_intern_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_intern_destroy(prom_intern_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  int r = 0;
+  int ret = 0;
+
+  if (self->entries != NULL) {
+    r = prom_map_destroy(self->entries);
+    self->entries = NULL;
+    if (r) ret = r;
+  }
+
+  if (self->arena != NULL) {
+    r = prom_arena_destroy(self->arena);
+    self->arena = NULL;
+    if (r) ret = r;
+  }
+
+  if (self->rwlock != NULL) {
+    r = pthread_rwlock_destroy(self->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR);
+      ret = r;
+    }
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
+  }
+
+  prom_free(self);
+  self = NULL;
+  return ret;
+}
+
+static void prom_intern_default_init(void) { prom_intern_default_table = prom_intern_new(); }
+
+prom_intern_t *prom_intern_default(void) {
+  pthread_once(&prom_intern_default_once, prom_intern_default_init);
+  return prom_intern_default_table;
+}
+
+const char *prom_intern_find(prom_intern_t *self, const char *str) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  return (const char *)prom_map_get(self->entries, str);
+}
+
+const char *prom_intern_add(prom_intern_t *self, const char *str) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  // Fast path. Most strings are interned by the first series using them
+  const char *interned = prom_intern_find(self, str);
+  if (interned != NULL) return interned;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
+  }
+
+  interned = prom_intern_find(self, str);
+  if (interned == NULL) {
+    size_t size = strlen(str) + 1;
+    char *copy = (char *)prom_arena_alloc(self->arena, size);
+    if (copy != NULL) {
+      memcpy(copy, str, size);
+      r = prom_map_set(self->entries, str, copy);
+      if (r == 0) interned = copy;
+    }
+  }
+
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return interned;
+}
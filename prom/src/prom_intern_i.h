@@ -0,0 +1,49 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_INTERN_I_H
+#define PROM_INTERN_I_H
+
+// Private
+#include "prom_intern_t.h"
+
+/**
+ * @brief API PRIVATE Constructs a prom_intern_t*
+ */
+prom_intern_t *prom_intern_new(void);
+
+/**
+ * @brief API PRIVATE Destroys a prom_intern_t* along with every string interned in it
+ */
+int prom_intern_destroy(prom_intern_t *self);
+
+/**
+ * @brief API PRIVATE Returns the process-wide intern table shared by all metrics. The table is created on first use
+ * and lives as long as the process.
+ */
+prom_intern_t *prom_intern_default(void);
+
+/**
+ * @brief API PRIVATE Returns the interned copy of str or NULL if it has not been interned. Takes no lock.
+ */
+const char *prom_intern_find(prom_intern_t *self, const char *str);
+
+/**
+ * @brief API PRIVATE Returns the interned copy of str, interning it first if required. Returns NULL on failure.
+ */
+const char *prom_intern_add(prom_intern_t *self, const char *str);
+
+#endif  // PROM_INTERN_I_H
@@ -0,0 +1,38 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_INTERN_T_H
+#define PROM_INTERN_T_H
+
+#include <pthread.h>
+
+// Private
+#include "prom_arena_t.h"
+#include "prom_map_t.h"
+
+/**
+ * @brief API PRIVATE A table of interned label keys. Each distinct string is stored once, and entries are
+ * never freed or moved while the table is alive, so their addresses are stable.
+ *
+ * Lookups take no lock. Interning a new string is serialized by rwlock, which also guards the arena.
+ */
+typedef struct prom_intern {
+  prom_map_t *entries;      /**< entries Maps each interned string to its stored copy */
+  prom_arena_t *arena;      /**< arena   Backs the stored strings and the nodes of the map */
+  pthread_rwlock_t *rwlock; /**< rwlock  Serializes interning */
+} prom_intern_t;
+
+#endif  // PROM_INTERN_T_H
@@ -92,13 +92,13 @@ int prom_linked_list_append(prom_linked_list_t *self, void *item) {
   prom_linked_list_node_t *node = (prom_linked_list_node_t *)prom_malloc(sizeof(prom_linked_list_node_t));
 
   node->item = item;
+  node->next = NULL;
   if (self->tail) {
     self->tail->next = node;
   } else {
     self->head = node;
   }
   self->tail = node;
-  node->next = NULL;
   self->size++;
   return 0;
 }
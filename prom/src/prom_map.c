@@ -15,13 +15,18 @@
  */
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 // Public
 #include "prom_alloc.h"
 
 // Private
+#include "prom_arena_i.h"
 #include "prom_assert.h"
+#include "prom_epoch_i.h"
 #include "prom_errors.h"
 #include "prom_linked_list_i.h"
 #include "prom_linked_list_t.h"
@@ -30,6 +35,21 @@
 #include "prom_map_t.h"
 
 #define PROM_MAP_INITIAL_SIZE 32
+#define PROM_MAP_SEGMENT_BASE_SIZE 16
+
+// The number of slots copied from a replaced slot array per insertion. A copy must complete before the new array is
+// half full. At least a quarter of its slots remain free when it is published and the old array is at most as large,
+// so a step of 4 suffices. Twice that leaves a margin and halves the number of insertions during which lookups probe
+// both arrays.
+#define PROM_MAP_MIGRATION_STEP 8
+
+#define PROM_MAP_FNV_OFFSET_BASIS 14695981039346656037ULL
+#define PROM_MAP_FNV_PRIME 1099511628211ULL
+
+// The lower half of a slot holds the index of its node plus one. These values are reserved.
+#define PROM_MAP_SLOT_EMPTY 0
+#define PROM_MAP_SLOT_DELETED UINT32_MAX
+#define PROM_MAP_MAX_NODES (UINT32_MAX - 1)
 
 static void destroy_map_node_value_no_op(void *value) {}
 
@@ -37,81 +57,294 @@ static void destroy_map_node_value_no_op(void *value) {}
 // prom_map_node
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-prom_map_node_t *prom_map_node_new(const char *key, void *value, prom_map_node_free_value_fn free_value_fn) {
-  prom_map_node_t *self = prom_malloc(sizeof(prom_map_node_t));
-  self->key = prom_strdup(key);
-  self->value = value;
-  self->free_value_fn = free_value_fn;
+/**
+ * @brief API PRIVATE Returns the node at the given index. Safe to call without holding the lock for any index below
+ * node_count.
+ */
+static prom_map_node_t *prom_map_node_at(prom_map_t *self, size_t index) {
+  size_t segment = 63 - __builtin_clzll(index / PROM_MAP_SEGMENT_BASE_SIZE + 1);
+  size_t offset = index - PROM_MAP_SEGMENT_BASE_SIZE * (((size_t)1 << segment) - 1);
+  prom_map_node_t *nodes = atomic_load_explicit(&self->segments[segment], memory_order_acquire);
+  return &nodes[offset];
+}
+
+/**
+ * @brief API PRIVATE Appends a node holding a copy of key and value and sets index to its position. The node is not
+ * reachable by readers until a slot referencing it is published. The caller must hold the write lock.
+ */
+static prom_map_node_t *prom_map_node_append(prom_map_t *self, const char *key, void *value, size_t *index) {
+  // Hashed values take over the node of a removed one first. Readers still holding its index compare the new value in
+  // full, so they cannot mistake it for the old one.
+  if (key == NULL && self->free_node_count > 0) {
+    size_t free_index = self->free_nodes[--self->free_node_count];
+    prom_map_node_t *node = prom_map_node_at(self, free_index);
+    atomic_store_explicit(&node->value, value, memory_order_release);
+    *index = free_index;
+    return node;
+  }
+
+  size_t i = atomic_load_explicit(&self->node_count, memory_order_relaxed);
+  if (i >= PROM_MAP_MAX_NODES) return NULL;
+
+  size_t segment = 63 - __builtin_clzll(i / PROM_MAP_SEGMENT_BASE_SIZE + 1);
+  if (atomic_load_explicit(&self->segments[segment], memory_order_relaxed) == NULL) {
+    prom_map_node_t *nodes =
+        (prom_map_node_t *)prom_malloc(sizeof(prom_map_node_t) * (PROM_MAP_SEGMENT_BASE_SIZE << segment));
+    if (nodes == NULL) return NULL;
+    atomic_store_explicit(&self->segments[segment], nodes, memory_order_release);
+  }
+
+  char *key_copy = NULL;
+  if (key != NULL) {
+    size_t key_size = strlen(key) + 1;
+    key_copy = (self->arena == NULL) ? prom_malloc(key_size) : prom_arena_alloc(self->arena, key_size);
+    if (key_copy == NULL) return NULL;
+    memcpy(key_copy, key, key_size);
+  }
+
+  prom_map_node_t *node = prom_map_node_at(self, i);
+  node->key = key_copy;
+  atomic_init(&node->value, value);
+  atomic_store_explicit(&self->node_count, i + 1, memory_order_release);
+  *index = i;
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// prom_map_table
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static prom_map_table_t *prom_map_table_new(size_t max_size) {
+  // Zeroed memory leaves every slot empty. Large arrays come straight from fresh pages, so a resize does not pay for
+  // clearing them.
+  prom_map_table_t *self = prom_calloc(1, sizeof(prom_map_table_t) + sizeof(uint64_t) * max_size);
+  if (self == NULL) return NULL;
+  self->max_size = max_size;
+  atomic_init(&self->prev, NULL);
+  self->retired_next = NULL;
+  self->retired_epoch = 0;
   return self;
 }
 
-int prom_map_node_destroy(prom_map_node_t *self) {
-  PROM_ASSERT(self != NULL);
-  if (self == NULL) return 0;
-  prom_free((void *)self->key);
-  self->key = NULL;
-  if (self->value != NULL) (*self->free_value_fn)(self->value);
-  self->value = NULL;
-  prom_free(self);
-  self = NULL;
-  return 0;
+/**
+ * @brief API PRIVATE hash function that returns a 64 bit hash of the given key.
+ *
+ * The algorithm is 64 bit FNV-1a.
+ *
+ * Reference:
+ *   * http://www.isthe.com/chongo/tech/comp/fnv/index.html
+ */
+static uint64_t prom_map_hash(const char *key) {
+  uint64_t hash = PROM_MAP_FNV_OFFSET_BASIS;
+  for (const unsigned char *c = (const unsigned char *)key; *c != '\0'; c++) {
+    hash ^= *c;
+    hash *= PROM_MAP_FNV_PRIME;
+  }
+  return hash;
 }
 
-void prom_map_node_free(void *item) {
-  prom_map_node_t *map_node = (prom_map_node_t *)item;
-  prom_map_node_destroy(map_node);
+/**
+ * @brief API PRIVATE Returns the tag stored in the slots of a hash. The tag also selects the slot a probe starts from.
+ */
+static uint32_t prom_map_tag(uint64_t hash) { return (uint32_t)(hash >> 32); }
+
+static uint64_t prom_map_slot(uint32_t tag, size_t index) { return ((uint64_t)tag << 32) | (uint64_t)(index + 1); }
+
+/**
+ * @brief API PRIVATE Returns the index of the node referenced by slot, or -1 if the slot does not hold the given tag.
+ */
+static ssize_t prom_map_slot_index(uint64_t slot, uint32_t tag) {
+  uint32_t low = (uint32_t)slot;
+  if (low == PROM_MAP_SLOT_DELETED || (uint32_t)(slot >> 32) != tag) return -1;
+  return (ssize_t)low - 1;
 }
 
-prom_linked_list_compare_t prom_map_node_compare(void *item_a, void *item_b) {
-  prom_map_node_t *map_node_a = (prom_map_node_t *)item_a;
-  prom_map_node_t *map_node_b = (prom_map_node_t *)item_b;
+/**
+ * @brief API PRIVATE Publishes slot in the first empty or deleted slot of its probe sequence in table, which must be
+ * the current slot array. The caller must hold the write lock.
+ */
+static void prom_map_table_insert(prom_map_t *self, prom_map_table_t *table, uint64_t slot) {
+  // A deleted slot may be reused; readers probing past it simply see another key
+  size_t mask = table->max_size - 1;
+  size_t i = (size_t)(slot >> 32) & mask;
+  for (;; i = (i + 1) & mask) {
+    uint64_t current = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+    if (current == PROM_MAP_SLOT_EMPTY) break;
+    if ((uint32_t)current == PROM_MAP_SLOT_DELETED) {
+      self->deleted--;
+      break;
+    }
+  }
+  atomic_store_explicit(&table->slots[i], slot, memory_order_release);
+}
 
-  return strcmp(map_node_a->key, map_node_b->key);
+/**
+ * @brief API PRIVATE Probes table for key and returns its node, or NULL if it is not present. Sets position to the
+ * slot of the node. Safe to call without holding the lock.
+ */
+static prom_map_node_t *prom_map_find(prom_map_t *self, prom_map_table_t *table, uint64_t hash, const char *key,
+                                      size_t *position) {
+  uint32_t tag = prom_map_tag(hash);
+  size_t mask = table->max_size - 1;
+  for (size_t i = tag & mask;; i = (i + 1) & mask) {
+    uint64_t slot = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+    if (slot == PROM_MAP_SLOT_EMPTY) return NULL;
+    ssize_t index = prom_map_slot_index(slot, tag);
+    if (index < 0) continue;
+    prom_map_node_t *node = prom_map_node_at(self, index);
+    if (node->key != NULL && strcmp(node->key, key) == 0) {
+      *position = i;
+      return node;
+    }
+  }
+}
+
+/**
+ * @brief API PRIVATE Probes table for a value stored under hash for which match returns true and sets position to its
+ * slot. Safe to call without holding the lock.
+ */
+static void *prom_map_find_hashed(prom_map_t *self, prom_map_table_t *table, uint64_t hash, prom_map_match_fn match,
+                                  const void *arg, size_t *position) {
+  uint32_t tag = prom_map_tag(hash);
+  size_t mask = table->max_size - 1;
+  for (size_t i = tag & mask;; i = (i + 1) & mask) {
+    uint64_t slot = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+    if (slot == PROM_MAP_SLOT_EMPTY) return NULL;
+    ssize_t index = prom_map_slot_index(slot, tag);
+    if (index < 0) continue;
+    void *value = atomic_load_explicit(&prom_map_node_at(self, index)->value, memory_order_acquire);
+    if (value != NULL && (*match)(value, arg)) {
+      *position = i;
+      return value;
+    }
+  }
+}
+
+/**
+ * @brief API PRIVATE Returns the node holding key or NULL, along with the slot array and position of its slot. The
+ * caller must hold the write lock.
+ */
+static prom_map_node_t *prom_map_locate(prom_map_t *self, uint64_t hash, const char *key, prom_map_table_t **table,
+                                        size_t *position) {
+  *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  prom_map_node_t *node = prom_map_find(self, *table, hash, key, position);
+  if (node != NULL) return node;
+
+  prom_map_table_t *prev = atomic_load_explicit(&(*table)->prev, memory_order_relaxed);
+  if (prev == NULL) return NULL;
+
+  // Slots before migrated have been copied already, so a key found there has since been deleted
+  node = prom_map_find(self, prev, hash, key, position);
+  if (node == NULL || *position < self->migrated) return NULL;
+  *table = prev;
+  return node;
+}
+
+/**
+ * @brief API PRIVATE Queues a slot array that readers can no longer reach for reclamation. The caller must hold the
+ * write lock.
+ */
+static void prom_map_table_retire(prom_map_t *self, prom_map_table_t *table) {
+  table->retired_epoch = prom_epoch_retire();
+  if (self->retired_tail == NULL) {
+    self->retired = table;
+  } else {
+    self->retired_tail->retired_next = table;
+  }
+  self->retired_tail = table;
+  self->retired_count++;
+}
+
+/**
+ * @brief API PRIVATE Frees the retired slot arrays no lookup can still be probing. The caller must hold the write lock.
+ */
+static void prom_map_table_reclaim(prom_map_t *self) {
+  if (self->retired == NULL) return;
+  uint64_t safe = prom_epoch_safe();
+  while (self->retired != NULL && self->retired->retired_epoch < safe) {
+    prom_map_table_t *table = self->retired;
+    self->retired = table->retired_next;
+    self->retired_count--;
+    prom_free(table);
+  }
+  if (self->retired == NULL) self->retired_tail = NULL;
+}
+
+/**
+ * @brief API PRIVATE Copies up to count slots of the array being migrated from into the current one. Once every slot
+ * has been copied, the array is detached and retired. The caller must hold the write lock.
+ */
+static void prom_map_migrate(prom_map_t *self, size_t count) {
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  prom_map_table_t *prev = atomic_load_explicit(&table->prev, memory_order_relaxed);
+  if (prev == NULL) return;
+
+  for (; count > 0 && self->migrated < prev->max_size; count--) {
+    uint64_t slot = atomic_load_explicit(&prev->slots[self->migrated++], memory_order_relaxed);
+    if (slot == PROM_MAP_SLOT_EMPTY || (uint32_t)slot == PROM_MAP_SLOT_DELETED) continue;
+    prom_map_table_insert(self, table, slot);
+  }
+  if (self->migrated == prev->max_size) {
+    atomic_store_explicit(&table->prev, NULL, memory_order_release);
+    prom_map_table_retire(self, prev);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // prom_map
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-prom_map_t *prom_map_new() {
+prom_map_t *prom_map_new() { return prom_map_new_from_arena(NULL); }
+
+prom_map_t *prom_map_new_from_arena(prom_arena_t *arena) {
   int r = 0;
 
   prom_map_t *self = (prom_map_t *)prom_malloc(sizeof(prom_map_t));
+  if (self == NULL) return NULL;
+  self->arena = arena;
   self->size = 0;
   self->max_size = PROM_MAP_INITIAL_SIZE;
+  self->deleted = 0;
+  self->migrated = 0;
+  self->free_value_fn = destroy_map_node_value_no_op;
+  self->keys = NULL;
+  self->retired = NULL;
+  self->retired_tail = NULL;
+  self->retired_count = 0;
+  self->free_nodes = NULL;
+  self->free_node_count = 0;
+  self->free_node_capacity = 0;
+  self->rwlock = NULL;
+  atomic_init(&self->node_count, 0);
+  for (size_t i = 0; i < PROM_MAP_SEGMENT_COUNT; i++) {
+    atomic_init(&self->segments[i], NULL);
+  }
+  atomic_init(&self->table, prom_map_table_new(self->max_size));
+  if (atomic_load_explicit(&self->table, memory_order_relaxed) == NULL) {
+    prom_map_destroy(self);
+    return NULL;
+  }
 
   self->keys = prom_linked_list_new();
-  if (self->keys == NULL) return NULL;
+  if (self->keys == NULL) {
+    prom_map_destroy(self);
+    return NULL;
+  }
 
-  // These each key will be allocated once by prom_map_node_new and used here as well to save memory. With that said
-  // we will only have to deallocate each key once. That will happen on prom_map_node_destroy.
+  // Each key is allocated once by prom_map_node_append and used here as well to save memory. With that said we will
+  // only have to deallocate each key once. That will happen on prom_map_destroy.
   r = prom_linked_list_set_free_fn(self->keys, prom_linked_list_no_op_free);
   if (r) {
     prom_map_destroy(self);
     return NULL;
   }
 
-  self->addrs = prom_malloc(sizeof(prom_linked_list_t) * self->max_size);
-  self->free_value_fn = destroy_map_node_value_no_op;
-
-  for (int i = 0; i < self->max_size; i++) {
-    self->addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(self->addrs[i], prom_map_node_free);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
-    r = prom_linked_list_set_compare_fn(self->addrs[i], prom_map_node_compare);
-    if (r) {
-      prom_map_destroy(self);
-      return NULL;
-    }
-  }
-
   self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
   r = pthread_rwlock_init(self->rwlock, NULL);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_INIT_ERROR);
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
     prom_map_destroy(self);
     return NULL;
   }
@@ -124,202 +357,184 @@ int prom_map_destroy(prom_map_t *self) {
   int r = 0;
   int ret = 0;
 
-  r = prom_linked_list_destroy(self->keys);
-  if (r) ret = r;
-  self->keys = NULL;
-
-  for (size_t i = 0; i < self->max_size; i++) {
-    r = prom_linked_list_destroy(self->addrs[i]);
+  if (self->keys != NULL) {
+    r = prom_linked_list_destroy(self->keys);
     if (r) ret = r;
-    self->addrs[i] = NULL;
+    self->keys = NULL;
   }
-  prom_free(self->addrs);
-  self->addrs = NULL;
 
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
-    ret = r;
+  // Deleted nodes have already released their value but still own their key
+  size_t node_count = atomic_load_explicit(&self->node_count, memory_order_relaxed);
+  for (size_t i = 0; i < node_count; i++) {
+    prom_map_node_t *node = prom_map_node_at(self, i);
+    void *value = atomic_load_explicit(&node->value, memory_order_relaxed);
+    if (value != NULL) (*self->free_value_fn)(value);
+    if (self->arena == NULL) prom_free((void *)node->key);
+    node->key = NULL;
+  }
+  for (size_t i = 0; i < PROM_MAP_SEGMENT_COUNT; i++) {
+    prom_free(atomic_load_explicit(&self->segments[i], memory_order_relaxed));
+    atomic_store_explicit(&self->segments[i], NULL, memory_order_relaxed);
+  }
+
+  // No reader may use a map being destroyed, so slot arrays still awaiting reclamation are freed right away
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  if (table != NULL) prom_free(atomic_load_explicit(&table->prev, memory_order_relaxed));
+  prom_free(table);
+  atomic_store_explicit(&self->table, NULL, memory_order_relaxed);
+  while (self->retired != NULL) {
+    table = self->retired;
+    self->retired = table->retired_next;
+    prom_free(table);
+  }
+  self->retired_tail = NULL;
+  self->retired_count = 0;
+  prom_free(self->free_nodes);
+  self->free_nodes = NULL;
+
+  if (self->rwlock != NULL) {
+    r = pthread_rwlock_destroy(self->rwlock);
+    if (r) {
+      PROM_LOG(PROM_PTHREAD_RWLOCK_DESTROY_ERROR)
+      ret = r;
+    }
+    prom_free(self->rwlock);
+    self->rwlock = NULL;
   }
 
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
   prom_free(self);
   self = NULL;
 
   return ret;
 }
 
-static size_t prom_map_get_index_internal(const char *key, size_t *size, size_t *max_size) {
-  size_t index;
-  size_t a = 31415, b = 27183;
-  for (index = 0; *key != '\0'; key++, a = a * b % (*max_size - 1)) {
-    index = (a * index + *key) % *max_size;
-  }
-  return index;
+void *prom_map_get(prom_map_t *self, const char *key) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  // No lock is taken. Nodes never move once published and the critical section keeps replaced slot arrays from being
+  // freed while they are probed. prev is loaded before probing table: once it reads NULL, every slot it held has been
+  // copied into table.
+  uint64_t hash = prom_map_hash(key);
+  size_t position = 0;
+  prom_epoch_enter();
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_acquire);
+  prom_map_table_t *prev = atomic_load_explicit(&table->prev, memory_order_acquire);
+  prom_map_node_t *node = prom_map_find(self, table, hash, key, &position);
+  if (node == NULL && prev != NULL) node = prom_map_find(self, prev, hash, key, &position);
+  void *value = (node == NULL) ? NULL : atomic_load_explicit(&node->value, memory_order_acquire);
+  prom_epoch_exit();
+  return value;
 }
 
-/**
- * @brief API PRIVATE hash function that returns an array index from the given key and prom_map.
- *
- * The algorithm is based off of Horner's method. In a simpler version, you set the return value to 0. Next, for each
- * character in the string, you add the integer value of the current character to the product of the prime number and
- * the current return value, set the result to the return value, then finally return the return value.
- *
- * In this version of the algorithm, we attempt to achieve a probabily of key to index conversion collisions to
- * 1/M (with M being the max_size of the map). This optimizes dispersion and consequently, evens out the performance
- * for gets and sets for each item. Instead of using a fixed prime number, we generate a coefficient for each iteration
- * through the loop.
- *
- * Reference:
- *   * Algorithms in C: Third Edition by Robert Sedgewick, p579
- */
-size_t prom_map_get_index(prom_map_t *self, const char *key) {
-  return prom_map_get_index_internal(key, &self->size, &self->max_size);
+void *prom_map_get_hashed(prom_map_t *self, uint64_t hash, prom_map_match_fn match, const void *arg) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  // Like prom_map_get, no lock is taken
+  size_t position = 0;
+  prom_epoch_enter();
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_acquire);
+  prom_map_table_t *prev = atomic_load_explicit(&table->prev, memory_order_acquire);
+  void *value = prom_map_find_hashed(self, table, hash, match, arg, &position);
+  if (value == NULL && prev != NULL) value = prom_map_find_hashed(self, prev, hash, match, arg, &position);
+  prom_epoch_exit();
+  return value;
 }
 
-static void *prom_map_get_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                   prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
-
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      prom_map_node_destroy(temp_map_node);
-      temp_map_node = NULL;
-      return current_map_node->value;
-    }
+void *prom_map_next(prom_map_t *self, size_t *cursor) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+
+  size_t node_count = atomic_load_explicit(&self->node_count, memory_order_acquire);
+  while (*cursor < node_count) {
+    prom_map_node_t *node = prom_map_node_at(self, (*cursor)++);
+    void *value = atomic_load_explicit(&node->value, memory_order_acquire);
+    if (value != NULL) return value;
   }
-  prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
   return NULL;
 }
 
-void *prom_map_get(prom_map_t *self, const char *key) {
+/**
+ * @brief API PRIVATE Ensures a free slot remains after the next insertion by keeping at most half of the slots in use.
+ *
+ * Every call first copies a few slots of the array being migrated from, if any. Once the current array is half full,
+ * it is replaced by one twice its size, or by one of the same size if deleted slots make up most of the load. The new
+ * array starts out empty and the slots of the old one are copied over by subsequent calls, which bounds the work done
+ * by any single insertion. Once copied, the old array is retired because concurrent readers may still hold it, and
+ * freed by a later call after they have returned.
+ */
+static int prom_map_ensure_space(prom_map_t *self) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    NULL;
-  }
-  void *payload =
-      prom_map_get_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
-  r = pthread_rwlock_unlock(self->rwlock);
-  if (r) {
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-    return NULL;
+
+  prom_map_table_reclaim(self);
+  prom_map_migrate(self, PROM_MAP_MIGRATION_STEP);
+  if (self->size + self->deleted <= self->max_size / 2) {
+    return 0;
   }
-  return payload;
-}
 
-static int prom_map_set_internal(const char *key, void *value, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                 prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn,
-                                 bool destroy_current_value) {
-  prom_map_node_t *map_node = prom_map_node_new(key, value, free_value_fn);
-  if (map_node == NULL) return 1;
+  // The migration step is large enough for a migration to complete before the next resize. Finish it otherwise.
+  prom_map_migrate(self, SIZE_MAX);
 
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, map_node);
-    if (result == PROM_EQUAL) {
-      if (destroy_current_value) {
-        free_value_fn(current_map_node->value);
-        current_map_node->value = NULL;
-      }
-      prom_free((char *)current_map_node->key);
-      current_map_node->key = NULL;
-      prom_free(current_map_node);
-      current_map_node = NULL;
-      current_node->item = map_node;
-      return 0;
-    }
-  }
-  prom_linked_list_append(list, map_node);
-  prom_linked_list_append(keys, (char *)map_node->key);
-  (*size)++;
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  size_t max_size = (self->size <= self->max_size / 4) ? table->max_size : table->max_size * 2;
+  prom_map_table_t *new_table = prom_map_table_new(max_size);
+  if (new_table == NULL) return 1;
+
+  atomic_store_explicit(&new_table->prev, table, memory_order_relaxed);
+  atomic_store_explicit(&self->table, new_table, memory_order_release);
+  self->max_size = new_table->max_size;
+  self->deleted = 0;
+  self->migrated = 0;
   return 0;
 }
 
-int prom_map_ensure_space(prom_map_t *self) {
-  PROM_ASSERT(self != NULL);
+/**
+ * @brief API PRIVATE Appends a node for key and value and publishes it in the current slot array. The caller must have
+ * ensured the key is absent and that there is space.
+ */
+static prom_map_node_t *prom_map_insert(prom_map_t *self, uint64_t hash, const char *key, void *value) {
+  size_t index = 0;
+  prom_map_node_t *node = prom_map_node_append(self, key, value, &index);
+  if (node == NULL) return NULL;
+
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  prom_map_table_insert(self, table, prom_map_slot(prom_map_tag(hash), index));
+  self->size++;
+  return node;
+}
+
+static int prom_map_set_internal(prom_map_t *self, const char *key, void *value) {
   int r = 0;
 
-  if (self->size <= self->max_size / 2) {
+  uint64_t hash = prom_map_hash(key);
+  prom_map_table_t *table = NULL;
+  size_t position = 0;
+  prom_map_node_t *map_node = prom_map_locate(self, hash, key, &table, &position);
+  if (map_node != NULL) {
+    void *current_value = atomic_exchange_explicit(&map_node->value, value, memory_order_acq_rel);
+    if (current_value != NULL && current_value != value) self->free_value_fn(current_value);
     return 0;
   }
 
-  // Increase the max size
-  size_t new_max = self->max_size * 2;
-  size_t new_size = 0;
-
-  // Create a new list of keys
-  prom_linked_list_t *new_keys = prom_linked_list_new();
-  if (new_keys == NULL) return 1;
-
-  r = prom_linked_list_set_free_fn(new_keys, prom_linked_list_no_op_free);
+  r = prom_map_ensure_space(self);
   if (r) return r;
 
-  // Create a new array of addrs
-  prom_linked_list_t **new_addrs = prom_malloc(sizeof(prom_linked_list_t) * new_max);
-
-  // Initialize the new array
-  for (int i = 0; i < new_max; i++) {
-    new_addrs[i] = prom_linked_list_new();
-    r = prom_linked_list_set_free_fn(new_addrs[i], prom_map_node_free);
-    if (r) return r;
-    r = prom_linked_list_set_compare_fn(new_addrs[i], prom_map_node_compare);
-    if (r) return r;
-  }
-
-  // Iterate through each linked-list at each memory region in the map's backbone
-  for (int i = 0; i < self->max_size; i++) {
-    // Create a new map node for each node in the linked list and insert it into the new map. Afterwards, deallocate
-    // the old map node
-    prom_linked_list_t *list = self->addrs[i];
-    prom_linked_list_node_t *current_node = list->head;
-    while (current_node != NULL) {
-      prom_map_node_t *map_node = (prom_map_node_t *)current_node->item;
-      r = prom_map_set_internal(map_node->key, map_node->value, &new_size, &new_max, new_keys, new_addrs,
-                                self->free_value_fn, false);
-      if (r) return r;
-
-      prom_linked_list_node_t *next = current_node->next;
-      prom_free(current_node);
-      current_node = NULL;
-      prom_free((void *)map_node->key);
-      map_node->key = NULL;
-      prom_free(map_node);
-      map_node = NULL;
-      current_node = next;
-    }
-    // We're done deallocating each map node in the linked list, so deallocate the linked-list object
-    prom_free(self->addrs[i]);
-    self->addrs[i] = NULL;
-  }
-  // Destroy the collection of keys in the map
-  prom_linked_list_destroy(self->keys);
-  self->keys = NULL;
+  map_node = prom_map_insert(self, hash, key, value);
+  if (map_node == NULL) return 1;
+  return prom_linked_list_append(self->keys, (char *)map_node->key);
+}
 
-  // Deallocate the backbone of the map
-  prom_free(self->addrs);
-  self->addrs = NULL;
+static int prom_map_set_hashed_internal(prom_map_t *self, uint64_t hash, void *value) {
+  int r = 0;
 
-  // Update the members of the current map
-  self->size = new_size;
-  self->max_size = new_max;
-  self->keys = new_keys;
-  self->addrs = new_addrs;
+  r = prom_map_ensure_space(self);
+  if (r) return r;
 
-  return 0;
+  return (prom_map_insert(self, hash, NULL, value) == NULL) ? 1 : 0;
 }
 
-int prom_map_set(prom_map_t *self, const char *key, void *value) {
+int prom_map_set_hashed(prom_map_t *self, uint64_t hash, void *value) {
   PROM_ASSERT(self != NULL);
   int r = 0;
   r = pthread_rwlock_wrlock(self->rwlock);
@@ -327,20 +542,25 @@ int prom_map_set(prom_map_t *self, const char *key, void *value) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
     return r;
   }
+  int ret = prom_map_set_hashed_internal(self, hash, value);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    return r;
+  }
+  return ret;
+}
 
-  r = prom_map_ensure_space(self);
+int prom_map_set(prom_map_t *self, const char *key, void *value) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+  r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
-    int rr = 0;
-    rr = pthread_rwlock_unlock(self->rwlock);
-    if (rr) {
-      PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
-      return rr;
-    } else {
-      return r;
-    }
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
   }
-  r = prom_map_set_internal(key, value, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn,
-                            true);
+
+  r = prom_map_set_internal(self, key, value);
   if (r) {
     int rr = 0;
     rr = pthread_rwlock_unlock(self->rwlock);
@@ -358,30 +578,28 @@ int prom_map_set(prom_map_t *self, const char *key, void *value) {
   return r;
 }
 
-static int prom_map_delete_internal(const char *key, size_t *size, size_t *max_size, prom_linked_list_t *keys,
-                                    prom_linked_list_t **addrs, prom_map_node_free_value_fn free_value_fn) {
+static int prom_map_delete_internal(prom_map_t *self, const char *key) {
   int r = 0;
-  size_t index = prom_map_get_index_internal(key, size, max_size);
-  prom_linked_list_t *list = addrs[index];
-  prom_map_node_t *temp_map_node = prom_map_node_new(key, NULL, free_value_fn);
 
-  for (prom_linked_list_node_t *current_node = list->head; current_node != NULL; current_node = current_node->next) {
-    prom_map_node_t *current_map_node = (prom_map_node_t *)current_node->item;
-    prom_linked_list_compare_t result = prom_linked_list_compare(list, current_map_node, temp_map_node);
-    if (result == PROM_EQUAL) {
-      r = prom_linked_list_remove(list, current_node);
-      if (r) return r;
+  prom_map_table_t *table = NULL;
+  size_t position = 0;
+  prom_map_node_t *node = prom_map_locate(self, prom_map_hash(key), key, &table, &position);
+  if (node == NULL) return 0;
 
-      r = prom_linked_list_remove(keys, (char *)current_map_node->key);
-      if (r) return r;
+  // The slot is marked deleted rather than emptied so probes for keys stored past it still reach them. The node keeps
+  // its key until the map is destroyed, since readers may be comparing against it. A slot deleted from the array being
+  // migrated from is simply not copied.
+  atomic_store_explicit(&table->slots[position], PROM_MAP_SLOT_DELETED, memory_order_release);
+  if (table == atomic_load_explicit(&self->table, memory_order_relaxed)) self->deleted++;
 
-      (*size)--;
-      break;
-    }
-  }
-  r = prom_map_node_destroy(temp_map_node);
-  temp_map_node = NULL;
-  return r;
+  r = prom_linked_list_remove(self->keys, (char *)node->key);
+  if (r) return r;
+
+  void *value = atomic_exchange_explicit(&node->value, NULL, memory_order_acq_rel);
+  if (value != NULL) (*self->free_value_fn)(value);
+
+  self->size--;
+  return 0;
 }
 
 int prom_map_delete(prom_map_t *self, const char *key) {
@@ -391,9 +609,9 @@ int prom_map_delete(prom_map_t *self, const char *key) {
   r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    ret = r;
+    return r;
   }
-  r = prom_map_delete_internal(key, &self->size, &self->max_size, self->keys, self->addrs, self->free_value_fn);
+  r = prom_map_delete_internal(self, key);
   if (r) ret = r;
   r = pthread_rwlock_unlock(self->rwlock);
   if (r) {
@@ -403,6 +621,53 @@ int prom_map_delete(prom_map_t *self, const char *key) {
   return ret;
 }
 
+static void *prom_map_remove_hashed_internal(prom_map_t *self, uint64_t hash, prom_map_match_fn match,
+                                             const void *arg) {
+  // As in prom_map_locate, a value found in the array being migrated from before migrated has since been removed
+  size_t position = 0;
+  prom_map_table_t *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  void *value = prom_map_find_hashed(self, table, hash, match, arg, &position);
+  if (value == NULL) {
+    table = atomic_load_explicit(&table->prev, memory_order_relaxed);
+    if (table == NULL) return NULL;
+    value = prom_map_find_hashed(self, table, hash, match, arg, &position);
+    if (value == NULL || position < self->migrated) return NULL;
+  }
+
+  uint64_t slot = atomic_load_explicit(&table->slots[position], memory_order_relaxed);
+  size_t index = (size_t)(uint32_t)slot - 1;
+  atomic_store_explicit(&table->slots[position], PROM_MAP_SLOT_DELETED, memory_order_release);
+  if (table == atomic_load_explicit(&self->table, memory_order_relaxed)) self->deleted++;
+  atomic_store_explicit(&prom_map_node_at(self, index)->value, NULL, memory_order_release);
+  self->size--;
+
+  // If the index cannot be recorded, the node is simply not reused
+  if (self->free_node_count == self->free_node_capacity) {
+    size_t capacity = (self->free_node_capacity == 0) ? PROM_MAP_SEGMENT_BASE_SIZE : self->free_node_capacity * 2;
+    size_t *free_nodes = (size_t *)prom_realloc(self->free_nodes, sizeof(size_t) * capacity);
+    if (free_nodes == NULL) return value;
+    self->free_nodes = free_nodes;
+    self->free_node_capacity = capacity;
+  }
+  self->free_nodes[self->free_node_count++] = index;
+  return value;
+}
+
+void *prom_map_remove_hashed(prom_map_t *self, uint64_t hash, prom_map_match_fn match, const void *arg) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  int r = 0;
+  r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
+  }
+  void *value = prom_map_remove_hashed_internal(self, hash, match, arg);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return value;
+}
+
 int prom_map_set_free_value_fn(prom_map_t *self, prom_map_node_free_value_fn free_value_fn) {
   PROM_ASSERT(self != NULL);
   self->free_value_fn = free_value_fn;
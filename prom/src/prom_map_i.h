@@ -17,22 +17,55 @@
 #ifndef PROM_MAP_I_INCLUDED
 #define PROM_MAP_I_INCLUDED
 
+#include <stdint.h>
+
+#include "prom_arena_t.h"
 #include "prom_map_t.h"
 
 prom_map_t *prom_map_new(void);
 
+prom_map_t *prom_map_new_from_arena(prom_arena_t *arena);
+
 int prom_map_set_free_value_fn(prom_map_t *self, prom_map_node_free_value_fn free_value_fn);
 
 void *prom_map_get(prom_map_t *self, const char *key);
 
 int prom_map_set(prom_map_t *self, const char *key, void *value);
 
+/**
+ * @brief API PRIVATE Returns the first value stored under hash for which match returns true, or NULL. Takes no lock.
+ *
+ * Only part of the hash is kept, so match may also be called with values stored under a different hash. It must
+ * compare values in full.
+ */
+void *prom_map_get_hashed(prom_map_t *self, uint64_t hash, prom_map_match_fn match, const void *arg);
+
+/**
+ * @brief API PRIVATE Stores value under the given hash without a key. The caller must ensure that no value it considers
+ * equal is present already. Such values are not part of the key list and can only be found by prom_map_get_hashed or
+ * prom_map_next, so a map should hold either keyed or hashed values.
+ */
+int prom_map_set_hashed(prom_map_t *self, uint64_t hash, void *value);
+
+/**
+ * @brief API PRIVATE Removes the first value stored under hash for which match returns true and returns it, or NULL if
+ * there is none. Unlike prom_map_delete, the value is not freed: readers that found it without a lock may still be
+ * using it, so the caller decides when to release it.
+ */
+void *prom_map_remove_hashed(prom_map_t *self, uint64_t hash, prom_map_match_fn match, const void *arg);
+
+/**
+ * @brief API PRIVATE Returns the next value present at or after cursor in insertion order and moves cursor past it, or
+ * NULL once every value has been visited. A cursor starts at 0. Takes no lock; values inserted concurrently may or may
+ * not be visited. A value inserted after another was removed by prom_map_remove_hashed may take its place in the
+ * order.
+ */
+void *prom_map_next(prom_map_t *self, size_t *cursor);
+
 int prom_map_delete(prom_map_t *self, const char *key);
 
 int prom_map_destroy(prom_map_t *self);
 
 size_t prom_map_size(prom_map_t *self);
 
-prom_map_node_t *prom_map_node_new(const char *key, void *value, prom_map_node_free_value_fn free_value_fn);
-
 #endif  // PROM_MAP_I_INCLUDED
@@ -18,28 +18,92 @@
 #define PROM_MAP_T_H
 
 #include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_map.h"
 
 // Private
+#include "prom_arena_t.h"
 #include "prom_linked_list_t.h"
 
 typedef void (*prom_map_node_free_value_fn)(void *);
 
+/**
+ * @brief API PRIVATE Returns true if value is the one looked up by prom_map_get_hashed, which passes arg through
+ */
+typedef bool (*prom_map_match_fn)(const void *value, const void *arg);
+
+/**
+ * @brief API PRIVATE The number of segments holding the nodes of a prom_map_t. Each segment is twice the size of the
+ * previous one, which is enough for any map addressable by a 32 bit index.
+ */
+#define PROM_MAP_SEGMENT_COUNT 28
+
+/**
+ * @brief API PRIVATE An entry of a prom_map_t.
+ *
+ * Nodes are stored contiguously in insertion order and never move, so a node found without holding the lock stays
+ * valid for the lifetime of the map. Nodes stored by prom_map_set_hashed carry no key. A deleted node keeps its key but
+ * its value is cleared. A node emptied by prom_map_remove_hashed is reused by a later hashed insertion.
+ */
 struct prom_map_node {
-  const char *key;
-  void *value;
-  prom_map_node_free_value_fn free_value_fn;
+  const char *key;       /**< key   The key or NULL for hashed nodes */
+  _Atomic(void *) value; /**< value The value associated with the key or NULL once deleted */
 };
 
+/**
+ * @brief API PRIVATE The open-addressing slot array of a prom_map_t.
+ *
+ * Each slot is either empty (0), deleted or holds the upper 32 bits of the hash of a key in its upper half and the
+ * index of the node plus one in its lower half. Collisions are resolved by linear probing.
+ *
+ * While a slot array replaced by a resize still holds slots that have not been copied over, prev points at it and
+ * lookups missing this array continue in prev.
+ */
+typedef struct prom_map_table {
+  size_t max_size;                       /**< max_size      The number of slots. Always a power of two */
+  _Atomic(struct prom_map_table *) prev; /**< prev          The array being migrated into this one or NULL */
+  struct prom_map_table *retired_next;   /**< retired_next  The array retired after this one */
+  uint64_t retired_epoch;                /**< retired_epoch The epoch this array was retired in */
+  _Atomic(uint64_t) slots[];             /**< slots         The hash and node index of each slot */
+} prom_map_table_t;
+
+/**
+ * @brief API PRIVATE A hash map safe for concurrent use.
+ *
+ * prom_map_get takes no lock. Writers serialize on rwlock. Slots are only ever filled or marked deleted in place, so a
+ * reader probing concurrently with a writer never misses a key that was present when it started.
+ *
+ * When the map grows, a larger slot array is published atomically and the slots of the replaced one are copied over a
+ * few at a time by subsequent insertions, so no single insertion pays for the whole resize. Until the copy completes,
+ * lookups probe both arrays. Once its copy completes, a replaced array is retired and freed by a later insertion as
+ * soon as every lookup that may still be probing it has returned.
+ *
+ * A map may be backed by an arena, in which case its keys are allocated from the arena and released along with it. The
+ * arena must outlive the map.
+ */
 struct prom_map {
-  size_t size;                /**< contains the size of the map */
-  size_t max_size;            /**< stores the current max_size */
-  prom_linked_list_t *keys;   /**< linked list containing containing all keys present */
-  prom_linked_list_t **addrs; /**< Sequence of linked lists. Each list contains nodes with the same index */
-  pthread_rwlock_t *rwlock;
+  size_t size;                        /**< contains the size of the map */
+  size_t max_size;                    /**< stores the current max_size */
+  size_t deleted;                     /**< the number of slots marked deleted */
+  size_t migrated;                    /**< the number of slots of the previous array copied so far */
+  prom_linked_list_t *keys;           /**< linked list containing containing all keys present */
+  _Atomic(prom_map_table_t *) table;  /**< the current slot array */
+  _Atomic(size_t) node_count;         /**< the number of nodes published, including deleted ones */
+  prom_map_table_t *retired;          /**< slot arrays detached by a migration, oldest first */
+  prom_map_table_t *retired_tail;     /**< the last retired slot array */
+  size_t retired_count;               /**< the number of retired slot arrays not yet freed */
+  pthread_rwlock_t *rwlock;           /**< serializes writers */
+  prom_arena_t *arena;                /**< backs the keys or NULL if they are allocated individually */
+  size_t *free_nodes;                 /**< the indexes of nodes emptied by prom_map_remove_hashed */
+  size_t free_node_count;             /**< the number of indexes in free_nodes */
+  size_t free_node_capacity;          /**< the capacity of free_nodes */
   prom_map_node_free_value_fn free_value_fn;
+
+  /** the nodes in insertion order. Segment i holds 16 << i nodes and is allocated once the previous one is full */
+  _Atomic(prom_map_node_t *) segments[PROM_MAP_SEGMENT_COUNT];
 };
 
 #endif  // PROM_MAP_T_H
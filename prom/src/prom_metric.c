@@ -15,14 +15,24 @@
  */
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
 // Public
 #include "prom_alloc.h"
 #include "prom_histogram_buckets.h"
 
 // Private
+#include "prom_arena_i.h"
 #include "prom_assert.h"
+#include "prom_epoch_i.h"
 #include "prom_errors.h"
+#include "prom_exemplar_i.h"
+#include "prom_hash_i.h"
+#include "prom_histogram_native_i.h"
+#include "prom_intern_i.h"
 #include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
@@ -30,6 +40,9 @@
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
 
+#define PROM_METRIC_L_VALUE_BUF_SIZE 256
+#define PROM_METRIC_OVERFLOW_LABEL_VALUE "__overflow__"
+
 char *prom_metric_type_map[4] = {"counter", "gauge", "histogram", "summary"};
 
 prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name, const char *help,
@@ -40,6 +53,29 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
   self->name = name;
   self->help = help;
   self->buckets = NULL;
+  self->native = false;
+  self->native_schema = 0;
+  self->native_max_buckets = 0;
+  self->shard_count = 0;
+  self->arena = NULL;
+  self->samples = NULL;
+  self->max_series = 0;
+  self->overflow = PROM_SERIES_OVERFLOW_DROP;
+  atomic_init(&self->series_count, 0);
+  atomic_init(&self->series_rejected, 0);
+  atomic_init(&self->overflow_sample, NULL);
+  atomic_init(&self->budget, NULL);
+  atomic_init(&self->series_ttl, 0);
+  self->retired = NULL;
+  self->retired_tail = NULL;
+  atomic_init(&self->retired_count, 0);
+
+  // Label keys are interned in the table shared by every metric
+  self->intern = prom_intern_default();
+  if (self->intern == NULL) {
+    prom_free(self);
+    return NULL;
+  }
 
   const char **k = (const char **)prom_malloc(sizeof(const char *) * label_key_count);
 
@@ -54,11 +90,23 @@ prom_metric_t *prom_metric_new(prom_metric_type_t metric_type, const char *name,
       prom_metric_destroy(self);
       return NULL;
     }
-    k[i] = prom_strdup(label_keys[i]);
+    k[i] = prom_intern_add(self->intern, label_keys[i]);
+    if (k[i] == NULL) {
+      prom_free(k);
+      prom_free(self);
+      return NULL;
+    }
   }
   self->label_keys = k;
   self->label_key_count = label_key_count;
-  self->samples = prom_map_new();
+
+  // The arena backs the samples, their labels and the map nodes holding them. It is destroyed after the map.
+  self->arena = prom_arena_new();
+  if (self->arena == NULL) {
+    prom_metric_destroy(self);
+    return NULL;
+  }
+  self->samples = prom_map_new_from_arena(self->arena);
 
   if (metric_type == PROM_HISTOGRAM) {
     r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_histogram_free_generic);
@@ -101,9 +149,29 @@ int prom_metric_destroy(prom_metric_t *self) {
     if (r) ret = r;
   }
 
-  r = prom_map_destroy(self->samples);
-  self->samples = NULL;
-  if (r) ret = r;
+  if (self->samples != NULL) {
+    r = prom_map_destroy(self->samples);
+    self->samples = NULL;
+    if (r) ret = r;
+  }
+
+  // Retired series, like their records, live in the arena. Only what they hold outside of it is released here.
+  for (prom_metric_retired_t *retired = self->retired; retired != NULL; retired = retired->next) {
+    if (self->type == PROM_HISTOGRAM) {
+      r = prom_metric_sample_histogram_destroy((prom_metric_sample_histogram_t *)retired->sample);
+    } else {
+      r = prom_metric_sample_destroy((prom_metric_sample_t *)retired->sample);
+    }
+    if (r) ret = r;
+  }
+  self->retired = NULL;
+  self->retired_tail = NULL;
+
+  if (self->arena != NULL) {
+    r = prom_arena_destroy(self->arena);
+    self->arena = NULL;
+    if (r) ret = r;
+  }
 
   r = prom_metric_formatter_destroy(self->formatter);
   self->formatter = NULL;
@@ -118,10 +186,7 @@ int prom_metric_destroy(prom_metric_t *self) {
   prom_free(self->rwlock);
   self->rwlock = NULL;
 
-  for (int i = 0; i < self->label_key_count; i++) {
-    prom_free((void *)self->label_keys[i]);
-    self->label_keys[i] = NULL;
-  }
+  // The label keys themselves are interned
   prom_free(self->label_keys);
   self->label_keys = NULL;
 
@@ -144,95 +209,592 @@ void prom_metric_free_generic(void *item) {
   prom_metric_destroy(self);
 }
 
-prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
-  PROM_ASSERT(self != NULL);
+/**
+ * @brief API PRIVATE Renders the l_value for the given label values into buf. If it does not fit, the l_value is
+ * rendered into a newly allocated string instead which the caller must free. Returns NULL on failure.
+ */
+static char *prom_metric_render_l_value(prom_metric_t *self, const char **label_values, char *buf, size_t size) {
+  size_t len = prom_metric_formatter_render_l_value(buf, size, self->name, NULL, self->label_key_count,
+                                                    self->label_keys, label_values);
+  if (len < size) return buf;
+
+  char *l_value = (char *)prom_malloc(len + 1);
+  if (l_value == NULL) return NULL;
+  prom_metric_formatter_render_l_value(l_value, len + 1, self->name, NULL, self->label_key_count, self->label_keys,
+                                       label_values);
+  return l_value;
+}
+
+/**
+ * @brief API PRIVATE Returns the hash of the given label values. Only the values are hashed, one after the other. They
+ * are never rendered for a lookup.
+ */
+static uint64_t prom_metric_series_hash(prom_metric_t *self, const char **label_values) {
+  uint64_t hash = 0;
+  for (size_t i = 0; i < self->label_key_count; i++) {
+    hash = prom_hash(label_values[i], strlen(label_values[i]), hash);
+  }
+  return hash;
+}
+
+/**
+ * @brief API PRIVATE The label values looked up by prom_metric_series_match
+ */
+typedef struct prom_metric_series_query {
+  prom_metric_t *metric;     /**< metric       The metric owning the series */
+  const char **label_values; /**< label_values The label values of the series */
+} prom_metric_series_query_t;
+
+/**
+ * @brief API PRIVATE Returns the label values of a sample of the metric
+ */
+static const char **prom_metric_series_label_values(prom_metric_t *self, const void *sample) {
+  if (self->type == PROM_HISTOGRAM) return ((const prom_metric_sample_histogram_t *)sample)->label_values;
+  return ((const prom_metric_sample_t *)sample)->label_values;
+}
+
+/**
+ * @brief API PRIVATE Returns the flag of a sample of the metric marking it as updated since the last sweep
+ */
+static _Atomic bool *prom_metric_series_touched(prom_metric_t *self, void *sample) {
+  if (self->type == PROM_HISTOGRAM) return &((prom_metric_sample_histogram_t *)sample)->touched;
+  return &((prom_metric_sample_t *)sample)->touched;
+}
+
+/**
+ * @brief API PRIVATE Returns the flag of a sample of the metric marking it as handed out as a child
+ */
+static bool *prom_metric_series_pinned(prom_metric_t *self, void *sample) {
+  if (self->type == PROM_HISTOGRAM) return &((prom_metric_sample_histogram_t *)sample)->pinned;
+  return &((prom_metric_sample_t *)sample)->pinned;
+}
+
+/**
+ * @brief API PRIVATE Returns the time of the last sweep that found a sample of the metric touched
+ */
+static uint64_t *prom_metric_series_idle_since(prom_metric_t *self, void *sample) {
+  if (self->type == PROM_HISTOGRAM) return &((prom_metric_sample_histogram_t *)sample)->idle_since;
+  return &((prom_metric_sample_t *)sample)->idle_since;
+}
+
+/**
+ * @brief API PRIVATE A prom_map_match_fn comparing the label values of a sample with those of the query, one by one
+ */
+static bool prom_metric_series_match(const void *value, const void *arg) {
+  const prom_metric_series_query_t *query = (const prom_metric_series_query_t *)arg;
+  const char **label_values = prom_metric_series_label_values(query->metric, value);
+  for (size_t i = 0; i < query->metric->label_key_count; i++) {
+    if (label_values[i] != query->label_values[i] && strcmp(label_values[i], query->label_values[i]) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief API PRIVATE Returns the size of the block holding the given copied label values
+ */
+static size_t prom_metric_label_values_size(prom_metric_t *self, const char **label_values) {
+  size_t size = sizeof(const char *) * self->label_key_count;
+  for (size_t i = 0; i < self->label_key_count; i++) size += strlen(label_values[i]) + 1;
+  return size;
+}
+
+/**
+ * @brief API PRIVATE Returns a copy of the given label values allocated from the metric arena as a single block, the
+ * array followed by the strings, or NULL if the metric has no labels. The copy identifies the series and is kept by
+ * the sample for encoders that need each label value on its own. Values are not interned so that their memory is
+ * returned to the arena with the series. The caller must hold the write lock.
+ */
+static const char **prom_metric_copy_label_values(prom_metric_t *self, const char **label_values) {
+  if (self->label_key_count == 0) return NULL;
+
+  const char **copy = (const char **)prom_arena_alloc(self->arena, prom_metric_label_values_size(self, label_values));
+  if (copy == NULL) return NULL;
+  char *str = (char *)(copy + self->label_key_count);
+  for (size_t i = 0; i < self->label_key_count; i++) {
+    size_t size = strlen(label_values[i]) + 1;
+    memcpy(str, label_values[i], size);
+    copy[i] = str;
+    str += size;
+  }
+  return copy;
+}
+
+/**
+ * @brief API PRIVATE Returns a copy made by prom_metric_copy_label_values to the metric arena
+ */
+static int prom_metric_free_label_values(prom_metric_t *self, const char **label_values) {
+  if (label_values == NULL) return 0;
+  return prom_arena_free(self->arena, label_values, prom_metric_label_values_size(self, label_values));
+}
+
+/**
+ * @brief API PRIVATE Constructs the sample of a new series, a prom_metric_sample_histogram_t* for histograms and a
+ * prom_metric_sample_t* otherwise. The series text is only rendered here, once per series. The caller must hold the
+ * write lock.
+ */
+static void *prom_metric_series_new(prom_metric_t *self, const char **label_values) {
+  const char **copy = prom_metric_copy_label_values(self, label_values);
+  if (copy == NULL && self->label_key_count > 0) return NULL;
+
+  if (self->type == PROM_HISTOGRAM) {
+    prom_metric_sample_histogram_t *sample = prom_metric_sample_histogram_new(
+        self->arena, self->name, self->buckets, self->label_key_count, self->label_keys, label_values);
+    if (sample == NULL) {
+      prom_metric_free_label_values(self, copy);
+      return NULL;
+    }
+    sample->label_values = copy;
+    if (self->native) {
+      sample->native = prom_histogram_native_new(self->native_schema, self->native_max_buckets);
+      if (sample->native == NULL) {
+        prom_metric_sample_histogram_recycle(sample, self->arena);
+        prom_metric_free_label_values(self, copy);
+        return NULL;
+      }
+    }
+    return sample;
+  }
+
+  char buf[PROM_METRIC_L_VALUE_BUF_SIZE];
+  prom_metric_sample_t *sample = NULL;
+  char *l_value = prom_metric_render_l_value(self, label_values, buf, sizeof(buf));
+  if (l_value != NULL) {
+    sample = prom_metric_sample_new_from_arena(self->arena, self->type, l_value, self->shard_count);
+    if (l_value != buf) prom_free(l_value);
+  }
+  if (sample == NULL) {
+    prom_metric_free_label_values(self, copy);
+    return NULL;
+  }
+  sample->label_values = copy;
+  return sample;
+}
+
+/**
+ * @brief API PRIVATE Returns true if the metric or its registry has reached its series limit. Safe to call without
+ * holding the lock.
+ */
+static bool prom_metric_series_full(prom_metric_t *self) {
+  if (self->max_series > 0 && atomic_load_explicit(&self->series_count, memory_order_relaxed) >= self->max_series) {
+    return true;
+  }
+  prom_series_budget_t *budget = atomic_load_explicit(&self->budget, memory_order_acquire);
+  if (budget == NULL) return false;
+  size_t max_series = atomic_load_explicit(&budget->max_series, memory_order_relaxed);
+  return max_series > 0 && atomic_load_explicit(&budget->series, memory_order_relaxed) >= max_series;
+}
+
+/**
+ * @brief API PRIVATE Reserves a series within the limits of the metric and its registry. Returns false if either limit
+ * has been reached. The caller must hold the write lock.
+ */
+static bool prom_metric_series_reserve(prom_metric_t *self) {
+  if (self->max_series > 0 && atomic_load_explicit(&self->series_count, memory_order_relaxed) >= self->max_series) {
+    return false;
+  }
+  prom_series_budget_t *budget = atomic_load_explicit(&self->budget, memory_order_relaxed);
+  if (budget != NULL) {
+    size_t max_series = atomic_load_explicit(&budget->max_series, memory_order_relaxed);
+    size_t series = atomic_fetch_add_explicit(&budget->series, 1, memory_order_relaxed);
+    if (max_series > 0 && series >= max_series) {
+      atomic_fetch_sub_explicit(&budget->series, 1, memory_order_relaxed);
+      return false;
+    }
+  }
+  atomic_fetch_add_explicit(&self->series_count, 1, memory_order_relaxed);
+  return true;
+}
+
+/**
+ * @brief API PRIVATE Returns a series reserved by prom_metric_series_reserve which could not be created. The caller
+ * must hold the write lock.
+ */
+static void prom_metric_series_unreserve(prom_metric_t *self) {
+  atomic_fetch_sub_explicit(&self->series_count, 1, memory_order_relaxed);
+  prom_series_budget_t *budget = atomic_load_explicit(&self->budget, memory_order_relaxed);
+  if (budget != NULL) atomic_fetch_sub_explicit(&budget->series, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief API PRIVATE Creates the sample of the series with the given label values and indexes it. The caller must hold
+ * the write lock.
+ */
+static void *prom_metric_series_add(prom_metric_t *self, uint64_t hash, const char **label_values) {
+  void *sample = prom_metric_series_new(self, label_values);
+  if (sample == NULL) return NULL;
+  // On failure, the sample is left in the arena. It holds nothing else yet.
+  if (prom_map_set_hashed(self->samples, hash, sample)) return NULL;
+  return sample;
+}
+
+/**
+ * @brief API PRIVATE Returns the sample of the overflow series, creating it if required. The overflow series is not
+ * counted against any limit. The caller must hold the write lock.
+ */
+static void *prom_metric_series_overflow(prom_metric_t *self) {
+  void *sample = atomic_load_explicit(&self->overflow_sample, memory_order_relaxed);
+  if (sample != NULL) return sample;
+
+  const char **label_values = (const char **)prom_malloc(sizeof(const char *) * (self->label_key_count + 1));
+  if (label_values == NULL) return NULL;
+  for (size_t i = 0; i < self->label_key_count; i++) label_values[i] = PROM_METRIC_OVERFLOW_LABEL_VALUE;
+
+  // The label set may have been used explicitly before the limit was reached
+  uint64_t hash = prom_metric_series_hash(self, label_values);
+  prom_metric_series_query_t query = {self, label_values};
+  sample = prom_map_get_hashed(self->samples, hash, &prom_metric_series_match, &query);
+  if (sample == NULL) {
+    sample = prom_metric_series_add(self, hash, label_values);
+  } else {
+    prom_metric_series_unreserve(self);
+  }
+  prom_free(label_values);
+
+  if (sample != NULL) atomic_store_explicit(&self->overflow_sample, sample, memory_order_release);
+  return sample;
+}
+
+/**
+ * @brief API PRIVATE Marks a sample as updated if the series of the metric expire. Safe to call without holding the
+ * lock.
+ */
+static void prom_metric_series_touch(prom_metric_t *self, void *sample) {
+  if (atomic_load_explicit(&self->series_ttl, memory_order_relaxed) == 0) return;
+  // The flag is written once per sweep at most, so busy series do not keep writing it
+  _Atomic bool *touched = prom_metric_series_touched(self, sample);
+  if (!atomic_load_explicit(touched, memory_order_relaxed)) atomic_store_explicit(touched, true, memory_order_relaxed);
+}
+
+/**
+ * @brief API PRIVATE Returns the sample of the series with the given label values, creating it if required. The caller
+ * must hold the write lock.
+ */
+static void *prom_metric_series_from_labels_locked(prom_metric_t *self, uint64_t hash, const char **label_values) {
+  prom_metric_series_query_t query = {self, label_values};
+  void *sample = prom_map_get_hashed(self->samples, hash, &prom_metric_series_match, &query);
+  if (sample != NULL) return sample;
+
+  if (prom_metric_series_reserve(self)) {
+    sample = prom_metric_series_add(self, hash, label_values);
+    if (sample == NULL) prom_metric_series_unreserve(self);
+    return sample;
+  }
+  atomic_fetch_add_explicit(&self->series_rejected, 1, memory_order_relaxed);
+  if (self->overflow == PROM_SERIES_OVERFLOW_DROP) return NULL;
+  return prom_metric_series_overflow(self);
+}
+
+/**
+ * @brief API PRIVATE Returns the sample of the series with the given label values, creating it if required
+ */
+static void *prom_metric_series_from_labels(prom_metric_t *self, const char **label_values) {
   int r = 0;
+  uint64_t hash = prom_metric_series_hash(self, label_values);
+  prom_metric_series_query_t query = {self, label_values};
+
+  // Fast path. Looking up an existing sample takes no lock
+  void *sample = prom_map_get_hashed(self->samples, hash, &prom_metric_series_match, &query);
+  if (sample != NULL) {
+    prom_metric_series_touch(self, sample);
+    return sample;
+  }
+
+  // Once a limit has been reached, updates to new series are rejected without contending for the lock
+  if (prom_metric_series_full(self)) {
+    if (self->overflow == PROM_SERIES_OVERFLOW_DROP) {
+      atomic_fetch_add_explicit(&self->series_rejected, 1, memory_order_relaxed);
+      return NULL;
+    }
+    sample = atomic_load_explicit(&self->overflow_sample, memory_order_acquire);
+    if (sample != NULL) {
+      atomic_fetch_add_explicit(&self->series_rejected, 1, memory_order_relaxed);
+      prom_metric_series_touch(self, sample);
+      return sample;
+    }
+  }
+
+  // Slow path. Serialize creation so that concurrent callers agree on a single sample
   r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
     return NULL;
   }
 
-#define PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);             \
-  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);   \
-  return NULL;
+  sample = prom_metric_series_from_labels_locked(self, hash, label_values);
+  if (sample != NULL) prom_metric_series_touch(self, sample);
 
-  // Get l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
-                                         label_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
-  }
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return sample;
+}
 
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
-  }
+void *prom_metric_series_pin(prom_metric_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
 
-  // Get sample
-  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(self->samples, l_value);
-  if (sample == NULL) {
-    sample = prom_metric_sample_new(self->type, l_value, 0.0);
-    r = prom_map_set(self->samples, l_value, sample);
-    if (r) {
-      PROM_METRIC_SAMPLE_FROM_LABELS_HANDLE_UNLOCK();
-    }
+  // The lookup and the pin happen under the write lock so that a sweep cannot expire the series in between
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return NULL;
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
+  void *sample = prom_metric_series_from_labels_locked(self, prom_metric_series_hash(self, label_values), label_values);
+  if (sample != NULL) *prom_metric_series_pinned(self, sample) = true;
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
   return sample;
 }
 
+prom_metric_sample_t *prom_metric_sample_from_labels(prom_metric_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  PROM_ASSERT(self->type != PROM_HISTOGRAM);
+  return (prom_metric_sample_t *)prom_metric_series_from_labels(self, label_values);
+}
+
 prom_metric_sample_histogram_t *prom_metric_sample_histogram_from_labels(prom_metric_t *self,
                                                                          const char **label_values) {
   PROM_ASSERT(self != NULL);
+  if (self == NULL) return NULL;
+  PROM_ASSERT(self->type == PROM_HISTOGRAM);
+  return (prom_metric_sample_histogram_t *)prom_metric_series_from_labels(self, label_values);
+}
 
-  int r = 0;
-  r = pthread_rwlock_wrlock(self->rwlock);
+int prom_metric_sample_set_exemplar(prom_metric_t *self, prom_metric_sample_t *sample, prom_exemplar_t *exemplar) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // Scrapes read the exemplar under the read lock, so the write lock ensures none is reading the one being replaced
+  int r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
     PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    return NULL;
+    prom_exemplar_destroy(exemplar);
+    return r;
+  }
+  prom_exemplar_t *replaced = sample->exemplar;
+  sample->exemplar = exemplar;
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  if (replaced != NULL) prom_exemplar_destroy(replaced);
+  return r;
+}
+
+int prom_metric_sample_histogram_set_exemplar(prom_metric_t *self, prom_metric_sample_histogram_t *sample,
+                                              size_t index, prom_exemplar_t *exemplar) {
+  PROM_ASSERT(self != NULL);
+  PROM_ASSERT(index <= sample->bucket_count);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    prom_exemplar_destroy(exemplar);
+    return r;
   }
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK() \
-  r = pthread_rwlock_unlock(self->rwlock);                       \
-  if (r) {                                                       \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);                  \
-    return NULL;                                                 \
+  // Most histograms never see an exemplar, so the slots are only allocated along with the first one
+  prom_exemplar_t *replaced = NULL;
+  if (sample->exemplars == NULL) {
+    sample->exemplars = (prom_exemplar_t **)prom_malloc(sizeof(prom_exemplar_t *) * (sample->bucket_count + 1));
+    for (size_t i = 0; i <= sample->bucket_count; i++) sample->exemplars[i] = NULL;
   }
+  replaced = sample->exemplars[index];
+  sample->exemplars[index] = exemplar;
+
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+
+  if (replaced != NULL) prom_exemplar_destroy(replaced);
+  return r;
+}
+
+int prom_metric_set_series_limit(prom_metric_t *self, size_t max_series, prom_series_overflow_t overflow) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
 
-  // Load the l_value
-  r = prom_metric_formatter_load_l_value(self->formatter, self->name, NULL, self->label_key_count, self->label_keys,
-                                         label_values);
+  int r = pthread_rwlock_wrlock(self->rwlock);
   if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
   }
+  self->max_series = max_series;
+  self->overflow = overflow;
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r;
+}
+
+uint64_t prom_metric_series_rejected(prom_metric_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+  return atomic_load_explicit(&self->series_rejected, memory_order_relaxed);
+}
 
-  // This must be freed before returning
-  const char *l_value = prom_metric_formatter_dump(self->formatter);
-  if (l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+int prom_metric_set_series_budget(prom_metric_t *self, prom_series_budget_t *budget) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
   }
+  // Series created before the metric was registered count against the budget as well
+  size_t series = atomic_load_explicit(&self->series_count, memory_order_relaxed);
+  prom_series_budget_t *current = atomic_load_explicit(&self->budget, memory_order_relaxed);
+  if (current != NULL) atomic_fetch_sub_explicit(&current->series, series, memory_order_relaxed);
+  if (budget != NULL) atomic_fetch_add_explicit(&budget->series, series, memory_order_relaxed);
+  atomic_store_explicit(&self->budget, budget, memory_order_release);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+  return r;
+}
 
-  // Get sample
-  prom_metric_sample_histogram_t *sample = (prom_metric_sample_histogram_t *)prom_map_get(self->samples, l_value);
-  if (sample == NULL) {
-    sample = prom_metric_sample_histogram_new(self->name, self->buckets, self->label_key_count, self->label_keys,
-                                              label_values);
-    if (sample == NULL) {
-      prom_free((void *)l_value);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+/**
+ * @brief API PRIVATE Returns the current monotonic time in nanoseconds
+ */
+static uint64_t prom_metric_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief API PRIVATE Removes the series with the given label values and retires its sample until no update can still
+ * be using it. Does nothing if the series is not present. The caller must hold the write lock.
+ */
+static int prom_metric_series_remove(prom_metric_t *self, const char **label_values) {
+  // The record is allocated first so that a series is never removed without being retired
+  prom_metric_retired_t *retired =
+      (prom_metric_retired_t *)prom_arena_alloc(self->arena, sizeof(prom_metric_retired_t));
+  if (retired == NULL) return 1;
+
+  prom_metric_series_query_t query = {self, label_values};
+  void *sample = prom_map_remove_hashed(self->samples, prom_metric_series_hash(self, label_values),
+                                        &prom_metric_series_match, &query);
+  if (sample == NULL) return prom_arena_free(self->arena, retired, sizeof(prom_metric_retired_t));
+
+  // The overflow series is not counted against any limit
+  if (sample == atomic_load_explicit(&self->overflow_sample, memory_order_relaxed)) {
+    atomic_store_explicit(&self->overflow_sample, NULL, memory_order_relaxed);
+  } else {
+    prom_metric_series_unreserve(self);
+  }
+
+  retired->next = NULL;
+  retired->sample = sample;
+  retired->retired_epoch = prom_epoch_retire();
+  if (self->retired_tail == NULL) {
+    self->retired = retired;
+  } else {
+    self->retired_tail->next = retired;
+  }
+  self->retired_tail = retired;
+  atomic_fetch_add_explicit(&self->retired_count, 1, memory_order_relaxed);
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Returns the memory of the retired series no update can still be using to the arena. The caller
+ * must hold the write lock.
+ */
+static int prom_metric_series_recycle(prom_metric_t *self) {
+  int r = 0;
+  if (self->retired == NULL) return 0;
+  uint64_t safe = prom_epoch_safe();
+  while (self->retired != NULL && self->retired->retired_epoch < safe) {
+    prom_metric_retired_t *retired = self->retired;
+    self->retired = retired->next;
+    if (self->retired == NULL) self->retired_tail = NULL;
+    atomic_fetch_sub_explicit(&self->retired_count, 1, memory_order_relaxed);
+
+    const char **label_values = prom_metric_series_label_values(self, retired->sample);
+    if (self->type == PROM_HISTOGRAM) {
+      r = prom_metric_sample_histogram_recycle((prom_metric_sample_histogram_t *)retired->sample, self->arena);
+    } else {
+      r = prom_metric_sample_recycle((prom_metric_sample_t *)retired->sample, self->arena);
     }
-    r = prom_map_set(self->samples, l_value, sample);
-    if (r) {
-      prom_free((void *)l_value);
-      pthread_rwlock_unlock(self->rwlock);
-      PROM_METRIC_SAMPLE_HISTOGRAM_FROM_LABELS_HANDLE_UNLOCK();
+    if (r) return r;
+    r = prom_metric_free_label_values(self, label_values);
+    if (r) return r;
+    r = prom_arena_free(self->arena, retired, sizeof(prom_metric_retired_t));
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief API PRIVATE Removes the series that have not been updated through their label values for the TTL of the
+ * metric, sparing those handed out as a child. The caller must hold the write lock.
+ */
+static int prom_metric_series_expire(prom_metric_t *self, uint64_t ttl, uint64_t now) {
+  int r = 0;
+  size_t cursor = 0;
+  for (void *sample = prom_map_next(self->samples, &cursor); sample != NULL;
+       sample = prom_map_next(self->samples, &cursor)) {
+    if (*prom_metric_series_pinned(self, sample)) continue;
+    uint64_t *idle_since = prom_metric_series_idle_since(self, sample);
+    if (atomic_exchange_explicit(prom_metric_series_touched(self, sample), false, memory_order_relaxed)) {
+      *idle_since = now;
+    } else if (now - *idle_since >= ttl) {
+      r = prom_metric_series_remove(self, prom_metric_series_label_values(self, sample));
+      if (r) return r;
     }
   }
-  pthread_rwlock_unlock(self->rwlock);
-  prom_free((void *)l_value);
-  return sample;
+  return 0;
+}
+
+int prom_metric_sweep(prom_metric_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // Most metrics neither expire series nor ever remove one, and are left alone without taking the lock
+  uint64_t ttl = atomic_load_explicit(&self->series_ttl, memory_order_relaxed);
+  if (ttl == 0 && atomic_load_explicit(&self->retired_count, memory_order_relaxed) == 0) return 0;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  uint64_t now = prom_metric_now();
+  int ret = 0;
+  if (ttl > 0) ret = prom_metric_series_expire(self, ttl, now);
+  if (ret == 0) ret = prom_metric_series_recycle(self);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    ret = r;
+  }
+  return ret;
+}
+
+int prom_metric_remove(prom_metric_t *self, const char **label_values) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = pthread_rwlock_wrlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+  // Recycling here too bounds the memory of metrics that remove series but are never scraped
+  int ret = prom_metric_series_remove(self, label_values);
+  if (ret == 0) ret = prom_metric_series_recycle(self);
+  r = pthread_rwlock_unlock(self->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    ret = r;
+  }
+  return ret;
+}
+
+int prom_metric_set_series_ttl(prom_metric_t *self, unsigned int ttl_ms) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  atomic_store_explicit(&self->series_ttl, (uint64_t)ttl_ms * 1000000ULL, memory_order_relaxed);
+  return 0;
 }
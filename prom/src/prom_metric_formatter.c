@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
 // Public
@@ -22,10 +24,16 @@
 // Private
 #include "prom_assert.h"
 #include "prom_collector_t.h"
+#include "prom_dtoa_i.h"
+#include "prom_errors.h"
 #include "prom_linked_list_t.h"
+#include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_metric_formatter_i.h"
+#include "prom_metric_i.h"
+#include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
 #include "prom_metric_sample_t.h"
 #include "prom_metric_t.h"
 #include "prom_string_builder_i.h"
@@ -42,6 +50,9 @@ prom_metric_formatter_t *prom_metric_formatter_new() {
     prom_metric_formatter_destroy(self);
     return NULL;
   }
+  self->format = PROM_EXPOSITION_FORMAT_TEXT;
+  self->family_start = 0;
+  self->family_metrics_start = 0;
   return self;
 }
 
@@ -158,24 +169,93 @@ int prom_metric_formatter_load_l_value(prom_metric_formatter_t *self, const char
   return 0;
 }
 
+static size_t prom_metric_formatter_render_str(char *buf, size_t size, size_t len, const char *str) {
+  for (; *str != '\0'; str++, len++) {
+    if (len < size) buf[len] = *str;
+  }
+  return len;
+}
+
+static size_t prom_metric_formatter_render_char(char *buf, size_t size, size_t len, char c) {
+  if (len < size) buf[len] = c;
+  return len + 1;
+}
+
+size_t prom_metric_formatter_render_l_value(char *buf, size_t size, const char *name, const char *suffix,
+                                            size_t label_count, const char **label_keys, const char **label_values) {
+  size_t len = 0;
+
+  len = prom_metric_formatter_render_str(buf, size, len, name);
+  if (suffix != NULL) {
+    len = prom_metric_formatter_render_char(buf, size, len, '_');
+    len = prom_metric_formatter_render_str(buf, size, len, suffix);
+  }
+
+  for (size_t i = 0; i < label_count; i++) {
+    len = prom_metric_formatter_render_char(buf, size, len, (i == 0) ? '{' : ',');
+    len = prom_metric_formatter_render_str(buf, size, len, label_keys[i]);
+    len = prom_metric_formatter_render_char(buf, size, len, '=');
+    len = prom_metric_formatter_render_char(buf, size, len, '"');
+    len = prom_metric_formatter_render_str(buf, size, len, label_values[i]);
+    len = prom_metric_formatter_render_char(buf, size, len, '"');
+  }
+  if (label_count > 0) len = prom_metric_formatter_render_char(buf, size, len, '}');
+
+  if (size > 0) buf[(len < size) ? len : size - 1] = '\0';
+  return len;
+}
+
+static int prom_metric_formatter_load_r_value(prom_metric_formatter_t *self, const char *prefix, size_t prefix_len,
+                                              double r_value) {
+  int r = 0;
+
+  r = prom_string_builder_add_strn(self->string_builder, prefix, prefix_len);
+  if (r) return r;
+
+  char buffer[PROM_DTOA_BUFFER_SIZE + 1];
+  size_t len = prom_dtoa(r_value, buffer);
+  buffer[len++] = '\n';
+  return prom_string_builder_add_strn(self->string_builder, buffer, len);
+}
+
 int prom_metric_formatter_load_sample(prom_metric_formatter_t *self, prom_metric_sample_t *sample) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
 
-  int r = 0;
+  return prom_metric_formatter_load_r_value(self, sample->prefix, sample->prefix_len, prom_metric_sample_value(sample));
+}
 
-  r = prom_string_builder_add_str(self->string_builder, sample->l_value);
-  if (r) return r;
+int prom_metric_formatter_load_histogram_sample(prom_metric_formatter_t *self,
+                                                prom_metric_sample_histogram_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
 
-  r = prom_string_builder_add_char(self->string_builder, ' ');
-  if (r) return r;
+  int r = 0;
+  size_t label_block_len = 0;
+  const char *label_block = prom_metric_sample_histogram_label_block(sample, &label_block_len);
+  const char *prefix = NULL;
+  size_t prefix_len = 0;
+
+  // Buckets are stored non-cumulatively. Accumulate them here so each le sample counts every observation less than
+  // or equal to its upper bound. The +Inf bucket then holds the total, which is also exported as the count.
+  uint64_t cumulative_count = 0;
+  for (size_t i = 0; i <= sample->bucket_count; i++) {
+    cumulative_count += atomic_load_explicit(&sample->bucket_counts[i], memory_order_relaxed);
+    r = prom_string_builder_add_strn(self->string_builder, label_block, label_block_len);
+    if (r) return r;
 
-  char buffer[50];
-  sprintf(buffer, "%.17g", sample->r_value);
-  r = prom_string_builder_add_str(self->string_builder, buffer);
+    prefix = prom_metric_sample_histogram_prefix(sample, i, &prefix_len);
+    r = prom_metric_formatter_load_r_value(self, prefix, prefix_len, (double)cumulative_count);
+    if (r) return r;
+  }
+
+  prefix = prom_metric_sample_histogram_prefix(sample, sample->bucket_count + 1, &prefix_len);
+  r = prom_metric_formatter_load_r_value(self, prefix, prefix_len, (double)cumulative_count);
   if (r) return r;
 
-  return prom_string_builder_add_char(self->string_builder, '\n');
+  prefix = prom_metric_sample_histogram_prefix(sample, sample->bucket_count + 2, &prefix_len);
+  return prom_metric_formatter_load_r_value(self, prefix, prefix_len,
+                                            atomic_load_explicit(&sample->sum, memory_order_relaxed));
 }
 
 int prom_metric_formatter_clear(prom_metric_formatter_t *self) {
@@ -197,43 +277,93 @@ char *prom_metric_formatter_dump(prom_metric_formatter_t *self) {
   return data;
 }
 
+static int prom_metric_formatter_load_text_header(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  int r = prom_metric_formatter_load_help(self, metric->name, metric->help);
+  if (r) return r;
+  return prom_metric_formatter_load_type(self, metric->name, metric->type);
+}
+
+static int prom_metric_formatter_load_text_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                  prom_metric_sample_t *sample) {
+  return prom_metric_formatter_load_sample(self, sample);
+}
+
+static int prom_metric_formatter_load_text_histogram_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                            prom_metric_sample_histogram_t *sample) {
+  return prom_metric_formatter_load_histogram_sample(self, sample);
+}
+
+static int prom_metric_formatter_load_text_footer(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  return prom_string_builder_add_char(self->string_builder, '\n');
+}
+
+/**
+ * @brief API PRIVATE The functions loading each part of a metric in a given exposition format
+ */
+typedef struct prom_metric_formatter_encoder {
+  int (*load_header)(prom_metric_formatter_t *self, prom_metric_t *metric);
+  int (*load_sample)(prom_metric_formatter_t *self, prom_metric_t *metric, prom_metric_sample_t *sample);
+  int (*load_histogram_sample)(prom_metric_formatter_t *self, prom_metric_t *metric,
+                               prom_metric_sample_histogram_t *sample);
+  int (*load_footer)(prom_metric_formatter_t *self, prom_metric_t *metric);
+} prom_metric_formatter_encoder_t;
+
+// Indexed by prom_exposition_format_t
+static const prom_metric_formatter_encoder_t prom_metric_formatter_encoders[] = {
+    {&prom_metric_formatter_load_text_header, &prom_metric_formatter_load_text_sample,
+     &prom_metric_formatter_load_text_histogram_sample, &prom_metric_formatter_load_text_footer},
+    {&prom_metric_formatter_load_openmetrics_header, &prom_metric_formatter_load_openmetrics_sample,
+     &prom_metric_formatter_load_openmetrics_histogram_sample, NULL},
+    {&prom_metric_formatter_load_protobuf_header, &prom_metric_formatter_load_protobuf_sample,
+     &prom_metric_formatter_load_protobuf_histogram_sample, &prom_metric_formatter_load_protobuf_footer}};
+
 int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric_t *metric) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 1;
 
   int r = 0;
+  const prom_metric_formatter_encoder_t *encoder = &prom_metric_formatter_encoders[self->format];
 
-  r = prom_metric_formatter_load_help(self, metric->name, metric->help);
+  r = prom_metric_sweep(metric);
   if (r) return r;
 
-  r = prom_metric_formatter_load_type(self, metric->name, metric->type);
+  r = encoder->load_header(self, metric);
   if (r) return r;
 
-  for (prom_linked_list_node_t *current_node = metric->samples->keys->head; current_node != NULL;
-       current_node = current_node->next) {
-    const char *key = (const char *)current_node->item;
+  // Samples are visited in creation order without a lock. The read lock keeps exemplars from being replaced while they
+  // are loaded.
+  r = pthread_rwlock_rdlock(metric->rwlock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
+    return r;
+  }
+
+  size_t cursor = 0;
+  for (void *sample = prom_map_next(metric->samples, &cursor); sample != NULL && r == 0;
+       sample = prom_map_next(metric->samples, &cursor)) {
     if (metric->type == PROM_HISTOGRAM) {
-      prom_metric_sample_histogram_t *hist_sample =
-          (prom_metric_sample_histogram_t *)prom_map_get(metric->samples, key);
-
-      if (hist_sample == NULL) return 1;
-
-      for (prom_linked_list_node_t *current_hist_node = hist_sample->l_value_list->head; current_hist_node != NULL;
-           current_hist_node = current_hist_node->next) {
-        const char *hist_key = (const char *)current_hist_node->item;
-        prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(hist_sample->samples, hist_key);
-        if (sample == NULL) return 1;
-        r = prom_metric_formatter_load_sample(self, sample);
-        if (r) return r;
-      }
+      r = encoder->load_histogram_sample(self, metric, (prom_metric_sample_histogram_t *)sample);
     } else {
-      prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(metric->samples, key);
-      if (sample == NULL) return 1;
-      r = prom_metric_formatter_load_sample(self, sample);
-      if (r) return r;
+      r = encoder->load_sample(self, metric, (prom_metric_sample_t *)sample);
     }
   }
-  return prom_string_builder_add_char(self->string_builder, '\n');
+
+  int rr = pthread_rwlock_unlock(metric->rwlock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);
+    if (r == 0) r = rr;
+  }
+  if (r) return r;
+
+  if (encoder->load_footer == NULL) return 0;
+  return encoder->load_footer(self, metric);
+}
+
+int prom_metric_formatter_load_end(prom_metric_formatter_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  if (self->format != PROM_EXPOSITION_FORMAT_OPENMETRICS) return 0;
+  return prom_string_builder_add_str(self->string_builder, "# EOF\n");
 }
 
 int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t *collectors) {
@@ -257,5 +387,5 @@ int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t
       if (r) return r;
     }
   }
-  return r;
+  return prom_metric_formatter_load_end(self);
 }
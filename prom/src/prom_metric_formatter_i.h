@@ -21,6 +21,7 @@
 
 // Private
 #include "prom_metric_formatter_t.h"
+#include "prom_metric_sample_histogram_t.h"
 #include "prom_metric_t.h"
 
 /**
@@ -56,18 +57,85 @@ int prom_metric_formatter_load_type(prom_metric_formatter_t *self, const char *n
 int prom_metric_formatter_load_l_value(prom_metric_formatter_t *metric_formatter, const char *name, const char *suffix,
                                        size_t label_count, const char **label_keys, const char **label_values);
 
+/**
+ * @brief API PRIVATE Renders a metric sample L-value into buf without allocating
+ * @param buf The destination buffer. May be NULL if size is 0.
+ * @param size The size of buf in bytes.
+ *
+ * The remaining parameters match prom_metric_formatter_load_l_value. Like snprintf, at most size - 1 characters are
+ * written followed by a terminating null byte, and the return value is the length of the full L-value. A return value
+ * of size or more means the output was truncated.
+ */
+size_t prom_metric_formatter_render_l_value(char *buf, size_t size, const char *name, const char *suffix,
+                                            size_t label_count, const char **label_keys, const char **label_values);
+
 /**
  * @brief API PRIVATE Loads the formatter with a metric sample
  */
 int prom_metric_formatter_load_sample(prom_metric_formatter_t *metric_formatter, prom_metric_sample_t *sample);
 
 /**
- * @brief API PRIVATE Loads a metric in the string exposition format
+ * @brief API PRIVATE Loads the formatter with each bucket, the count and the sum of a histogram sample
+ */
+int prom_metric_formatter_load_histogram_sample(prom_metric_formatter_t *metric_formatter,
+                                                prom_metric_sample_histogram_t *sample);
+
+/**
+ * @brief API PRIVATE Loads the OpenMetrics HELP and TYPE lines of a metric. The family name of a counter omits the
+ * _total suffix.
+ */
+int prom_metric_formatter_load_openmetrics_header(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads a counter or gauge sample in the OpenMetrics format. Counters are loaded with their _total
+ * suffix, exemplar and _created series.
+ */
+int prom_metric_formatter_load_openmetrics_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                  prom_metric_sample_t *sample);
+
+/**
+ * @brief API PRIVATE Loads the _bucket series with their exemplars, the _count, _sum and _created series of a
+ * histogram sample in the OpenMetrics format
+ */
+int prom_metric_formatter_load_openmetrics_histogram_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                            prom_metric_sample_histogram_t *sample);
+
+/**
+ * @brief API PRIVATE Opens the protobuf MetricFamily message of a metric and loads its name, help and type
+ */
+int prom_metric_formatter_load_protobuf_header(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads a counter or gauge sample as a protobuf Metric message
+ */
+int prom_metric_formatter_load_protobuf_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                               prom_metric_sample_t *sample);
+
+/**
+ * @brief API PRIVATE Loads a histogram sample as a protobuf Metric message
+ */
+int prom_metric_formatter_load_protobuf_histogram_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                         prom_metric_sample_histogram_t *sample);
+
+/**
+ * @brief API PRIVATE Closes the protobuf MetricFamily message opened by prom_metric_formatter_load_protobuf_header,
+ * prefixing it with its length. Families without samples are dropped.
+ */
+int prom_metric_formatter_load_protobuf_footer(prom_metric_formatter_t *self, prom_metric_t *metric);
+
+/**
+ * @brief API PRIVATE Loads a metric in the exposition format of the formatter
  */
 int prom_metric_formatter_load_metric(prom_metric_formatter_t *self, prom_metric_t *metric);
 
 /**
- * @brief API PRIVATE Loads the given metrics
+ * @brief API PRIVATE Loads whatever terminates the exposition in the format of the formatter, i.e. the # EOF line of
+ * OpenMetrics
+ */
+int prom_metric_formatter_load_end(prom_metric_formatter_t *self);
+
+/**
+ * @brief API PRIVATE Loads the given metrics followed by the end of the exposition
  */
 int prom_metric_formatter_load_metrics(prom_metric_formatter_t *self, prom_map_t *collectors);
 
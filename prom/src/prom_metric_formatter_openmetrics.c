@@ -0,0 +1,242 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md
+
+#include <stdatomic.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_dtoa_i.h"
+#include "prom_exemplar_t.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_t.h"
+#include "prom_string_builder_i.h"
+
+#define PROM_METRIC_FORMATTER_OPENMETRICS_TOTAL_SUFFIX "_total"
+
+/**
+ * @brief API PRIVATE Returns the length of the family name of a metric. OpenMetrics names counter families without
+ * the _total suffix carried by their samples.
+ */
+static size_t prom_metric_formatter_openmetrics_family_len(prom_metric_t *metric) {
+  size_t len = strlen(metric->name);
+  size_t suffix_len = strlen(PROM_METRIC_FORMATTER_OPENMETRICS_TOTAL_SUFFIX);
+  if (metric->type == PROM_COUNTER && len > suffix_len &&
+      strcmp(metric->name + len - suffix_len, PROM_METRIC_FORMATTER_OPENMETRICS_TOTAL_SUFFIX) == 0) {
+    return len - suffix_len;
+  }
+  return len;
+}
+
+static int prom_metric_formatter_openmetrics_load_value(prom_metric_formatter_t *self, double value) {
+  char buffer[PROM_DTOA_BUFFER_SIZE];
+  size_t len = prom_dtoa(value, buffer);
+  return prom_string_builder_add_strn(self->string_builder, buffer, len);
+}
+
+/**
+ * @brief API PRIVATE Loads the exemplar, if any, and terminates the line of a sample
+ */
+static int prom_metric_formatter_openmetrics_load_exemplar(prom_metric_formatter_t *self, prom_exemplar_t *exemplar) {
+  int r = 0;
+
+  if (exemplar != NULL) {
+    r = prom_string_builder_add_str(self->string_builder, " # {");
+    if (r) return r;
+
+    for (size_t i = 0; i < exemplar->label_count; i++) {
+      if (i > 0) {
+        r = prom_string_builder_add_char(self->string_builder, ',');
+        if (r) return r;
+      }
+      r = prom_string_builder_add_str(self->string_builder, exemplar->label_keys[i]);
+      if (r) return r;
+
+      r = prom_string_builder_add_strn(self->string_builder, "=\"", 2);
+      if (r) return r;
+
+      r = prom_string_builder_add_str(self->string_builder, exemplar->label_values[i]);
+      if (r) return r;
+
+      r = prom_string_builder_add_char(self->string_builder, '"');
+      if (r) return r;
+    }
+
+    r = prom_string_builder_add_strn(self->string_builder, "} ", 2);
+    if (r) return r;
+
+    r = prom_metric_formatter_openmetrics_load_value(self, exemplar->value);
+    if (r) return r;
+
+    r = prom_string_builder_add_char(self->string_builder, ' ');
+    if (r) return r;
+
+    r = prom_metric_formatter_openmetrics_load_value(self, exemplar->timestamp);
+    if (r) return r;
+  }
+  return prom_string_builder_add_char(self->string_builder, '\n');
+}
+
+/**
+ * @brief API PRIVATE Loads a series whose name is the first name_len characters of name followed by suffix. The
+ * labels are taken from a rendered prefix, skipping the skip_len characters of the name it begins with.
+ */
+static int prom_metric_formatter_openmetrics_load_series(prom_metric_formatter_t *self, const char *name,
+                                                         size_t name_len, const char *suffix, const char *prefix,
+                                                         size_t prefix_len, size_t skip_len) {
+  int r = 0;
+
+  r = prom_string_builder_add_strn(self->string_builder, name, name_len);
+  if (r) return r;
+
+  r = prom_string_builder_add_str(self->string_builder, suffix);
+  if (r) return r;
+
+  return prom_string_builder_add_strn(self->string_builder, prefix + skip_len, prefix_len - skip_len);
+}
+
+/**
+ * @brief API PRIVATE Loads a prefix followed by the value, the exemplar if any, and the end of the line
+ */
+static int prom_metric_formatter_openmetrics_load_line(prom_metric_formatter_t *self, const char *prefix,
+                                                       size_t prefix_len, double value, prom_exemplar_t *exemplar) {
+  int r = 0;
+
+  r = prom_string_builder_add_strn(self->string_builder, prefix, prefix_len);
+  if (r) return r;
+
+  r = prom_metric_formatter_openmetrics_load_value(self, value);
+  if (r) return r;
+
+  return prom_metric_formatter_openmetrics_load_exemplar(self, exemplar);
+}
+
+int prom_metric_formatter_load_openmetrics_header(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t family_len = prom_metric_formatter_openmetrics_family_len(metric);
+
+  r = prom_string_builder_add_str(self->string_builder, "# HELP ");
+  if (r) return r;
+
+  r = prom_string_builder_add_strn(self->string_builder, metric->name, family_len);
+  if (r) return r;
+
+  r = prom_string_builder_add_char(self->string_builder, ' ');
+  if (r) return r;
+
+  r = prom_string_builder_add_str(self->string_builder, metric->help);
+  if (r) return r;
+
+  r = prom_string_builder_add_str(self->string_builder, "\n# TYPE ");
+  if (r) return r;
+
+  r = prom_string_builder_add_strn(self->string_builder, metric->name, family_len);
+  if (r) return r;
+
+  r = prom_string_builder_add_char(self->string_builder, ' ');
+  if (r) return r;
+
+  r = prom_string_builder_add_str(self->string_builder, prom_metric_type_map[metric->type]);
+  if (r) return r;
+
+  return prom_string_builder_add_char(self->string_builder, '\n');
+}
+
+int prom_metric_formatter_load_openmetrics_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                  prom_metric_sample_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  double value = prom_metric_sample_value(sample);
+
+  if (metric->type != PROM_COUNTER) {
+    return prom_metric_formatter_openmetrics_load_line(self, sample->prefix, sample->prefix_len, value, NULL);
+  }
+
+  // The sample prefix begins with the metric name. Counter series are named after the family instead.
+  size_t name_len = strlen(metric->name);
+  size_t family_len = prom_metric_formatter_openmetrics_family_len(metric);
+  r = prom_metric_formatter_openmetrics_load_series(self, metric->name, family_len,
+                                                    PROM_METRIC_FORMATTER_OPENMETRICS_TOTAL_SUFFIX, sample->prefix,
+                                                    sample->prefix_len, name_len);
+  if (r) return r;
+
+  r = prom_metric_formatter_openmetrics_load_line(self, NULL, 0, value, sample->exemplar);
+  if (r) return r;
+
+  r = prom_metric_formatter_openmetrics_load_series(self, metric->name, family_len, "_created", sample->prefix,
+                                                    sample->prefix_len, name_len);
+  if (r) return r;
+
+  return prom_metric_formatter_openmetrics_load_line(self, NULL, 0, sample->created, NULL);
+}
+
+int prom_metric_formatter_load_openmetrics_histogram_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                            prom_metric_sample_histogram_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t name_len = strlen(metric->name);
+  size_t label_block_len = 0;
+  const char *label_block = prom_metric_sample_histogram_label_block(sample, &label_block_len);
+  const char *prefix = NULL;
+  size_t prefix_len = 0;
+
+  // The pieces rendered for the text format are reused. Only the series names of the buckets and of _created differ.
+  uint64_t cumulative_count = 0;
+  for (size_t i = 0; i <= sample->bucket_count; i++) {
+    cumulative_count += atomic_load_explicit(&sample->bucket_counts[i], memory_order_relaxed);
+    r = prom_metric_formatter_openmetrics_load_series(self, metric->name, name_len, "_bucket", label_block,
+                                                      label_block_len, name_len);
+    if (r) return r;
+
+    prefix = prom_metric_sample_histogram_prefix(sample, i, &prefix_len);
+    r = prom_metric_formatter_openmetrics_load_line(self, prefix, prefix_len, (double)cumulative_count,
+                                                    (sample->exemplars != NULL) ? sample->exemplars[i] : NULL);
+    if (r) return r;
+  }
+
+  const char *count_prefix = prom_metric_sample_histogram_prefix(sample, sample->bucket_count + 1, &prefix_len);
+  size_t count_prefix_len = prefix_len;
+  r = prom_metric_formatter_openmetrics_load_line(self, count_prefix, count_prefix_len, (double)cumulative_count,
+                                                  NULL);
+  if (r) return r;
+
+  prefix = prom_metric_sample_histogram_prefix(sample, sample->bucket_count + 2, &prefix_len);
+  r = prom_metric_formatter_openmetrics_load_line(self, prefix, prefix_len,
+                                                  atomic_load_explicit(&sample->sum, memory_order_relaxed), NULL);
+  if (r) return r;
+
+  // The count prefix begins with name_count, which is replaced by name_created
+  r = prom_metric_formatter_openmetrics_load_series(self, metric->name, name_len, "_created", count_prefix,
+                                                    count_prefix_len, name_len + strlen("_count"));
+  if (r) return r;
+
+  return prom_metric_formatter_openmetrics_load_line(self, NULL, 0, sample->created, NULL);
+}
@@ -0,0 +1,458 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reference: https://github.com/prometheus/client_model/blob/master/io/prometheus/client/metrics.proto
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Public
+#include "prom_alloc.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_errors.h"
+#include "prom_exemplar_t.h"
+#include "prom_histogram_native_t.h"
+#include "prom_log.h"
+#include "prom_metric_formatter_i.h"
+#include "prom_metric_sample_histogram_t.h"
+#include "prom_metric_sample_i.h"
+#include "prom_metric_sample_t.h"
+#include "prom_metric_t.h"
+#include "prom_string_builder_i.h"
+
+// Wire types
+#define PROM_PROTOBUF_VARINT 0
+#define PROM_PROTOBUF_FIXED64 1
+#define PROM_PROTOBUF_LEN 2
+
+// The longest encoding of a 64 bit varint
+#define PROM_PROTOBUF_VARINT_MAX_LEN 10
+
+// MetricFamily fields
+#define PROM_PROTOBUF_METRIC_FAMILY_NAME 1
+#define PROM_PROTOBUF_METRIC_FAMILY_HELP 2
+#define PROM_PROTOBUF_METRIC_FAMILY_TYPE 3
+#define PROM_PROTOBUF_METRIC_FAMILY_METRIC 4
+
+// Metric fields
+#define PROM_PROTOBUF_METRIC_LABEL 1
+#define PROM_PROTOBUF_METRIC_GAUGE 2
+#define PROM_PROTOBUF_METRIC_COUNTER 3
+#define PROM_PROTOBUF_METRIC_HISTOGRAM 7
+
+// LabelPair fields
+#define PROM_PROTOBUF_LABEL_PAIR_NAME 1
+#define PROM_PROTOBUF_LABEL_PAIR_VALUE 2
+
+// Gauge and Counter fields
+#define PROM_PROTOBUF_VALUE 1
+#define PROM_PROTOBUF_COUNTER_EXEMPLAR 2
+#define PROM_PROTOBUF_COUNTER_CREATED_TIMESTAMP 3
+
+// Histogram fields
+#define PROM_PROTOBUF_HISTOGRAM_SAMPLE_COUNT 1
+#define PROM_PROTOBUF_HISTOGRAM_SAMPLE_SUM 2
+#define PROM_PROTOBUF_HISTOGRAM_BUCKET 3
+#define PROM_PROTOBUF_HISTOGRAM_SCHEMA 5
+#define PROM_PROTOBUF_HISTOGRAM_ZERO_THRESHOLD 6
+#define PROM_PROTOBUF_HISTOGRAM_ZERO_COUNT 7
+#define PROM_PROTOBUF_HISTOGRAM_NEGATIVE_SPAN 9
+#define PROM_PROTOBUF_HISTOGRAM_NEGATIVE_DELTA 10
+#define PROM_PROTOBUF_HISTOGRAM_POSITIVE_SPAN 12
+#define PROM_PROTOBUF_HISTOGRAM_POSITIVE_DELTA 13
+#define PROM_PROTOBUF_HISTOGRAM_CREATED_TIMESTAMP 15
+#define PROM_PROTOBUF_HISTOGRAM_EXEMPLARS 16
+
+// BucketSpan fields
+#define PROM_PROTOBUF_BUCKET_SPAN_OFFSET 1
+#define PROM_PROTOBUF_BUCKET_SPAN_LENGTH 2
+
+// Bucket fields
+#define PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT 1
+#define PROM_PROTOBUF_BUCKET_UPPER_BOUND 2
+#define PROM_PROTOBUF_BUCKET_EXEMPLAR 3
+
+// Exemplar fields
+#define PROM_PROTOBUF_EXEMPLAR_LABEL 1
+#define PROM_PROTOBUF_EXEMPLAR_VALUE 2
+#define PROM_PROTOBUF_EXEMPLAR_TIMESTAMP 3
+
+// Timestamp fields
+#define PROM_PROTOBUF_TIMESTAMP_SECONDS 1
+#define PROM_PROTOBUF_TIMESTAMP_NANOS 2
+
+// MetricType values indexed by prom_metric_type_t
+static const uint64_t prom_metric_formatter_protobuf_types[] = {0 /* COUNTER */, 1 /* GAUGE */, 4 /* HISTOGRAM */,
+                                                                 2 /* SUMMARY */};
+
+static size_t prom_metric_formatter_protobuf_encode_varint(char *buf, uint64_t value) {
+  size_t len = 0;
+  while (value >= 0x80) {
+    buf[len++] = (char)((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = (char)value;
+  return len;
+}
+
+// Maps signed integers to unsigned ones of similar magnitude, as used by the sint32 and sint64 types
+static uint64_t prom_metric_formatter_protobuf_zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int prom_metric_formatter_protobuf_load_tag(prom_metric_formatter_t *self, uint64_t field, uint64_t wire_type) {
+  char buf[PROM_PROTOBUF_VARINT_MAX_LEN];
+  size_t len = prom_metric_formatter_protobuf_encode_varint(buf, (field << 3) | wire_type);
+  return prom_string_builder_add_strn(self->string_builder, buf, len);
+}
+
+static int prom_metric_formatter_protobuf_load_varint(prom_metric_formatter_t *self, uint64_t field, uint64_t value) {
+  char buf[PROM_PROTOBUF_VARINT_MAX_LEN * 2];
+  size_t len = prom_metric_formatter_protobuf_encode_varint(buf, (field << 3) | PROM_PROTOBUF_VARINT);
+  len += prom_metric_formatter_protobuf_encode_varint(buf + len, value);
+  return prom_string_builder_add_strn(self->string_builder, buf, len);
+}
+
+static int prom_metric_formatter_protobuf_load_double(prom_metric_formatter_t *self, uint64_t field, double value) {
+  int r = prom_metric_formatter_protobuf_load_tag(self, field, PROM_PROTOBUF_FIXED64);
+  if (r) return r;
+
+  // Doubles are encoded in little endian byte order regardless of the host
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  char buf[sizeof(bits)];
+  for (size_t i = 0; i < sizeof(bits); i++) {
+    buf[i] = (char)(bits >> (i * 8));
+  }
+  return prom_string_builder_add_strn(self->string_builder, buf, sizeof(buf));
+}
+
+static int prom_metric_formatter_protobuf_load_string(prom_metric_formatter_t *self, uint64_t field, const char *str) {
+  size_t str_len = strlen(str);
+  char buf[PROM_PROTOBUF_VARINT_MAX_LEN * 2];
+  size_t len = prom_metric_formatter_protobuf_encode_varint(buf, (field << 3) | PROM_PROTOBUF_LEN);
+  len += prom_metric_formatter_protobuf_encode_varint(buf + len, str_len);
+  int r = prom_string_builder_add_strn(self->string_builder, buf, len);
+  if (r) return r;
+  return prom_string_builder_add_strn(self->string_builder, str, str_len);
+}
+
+/**
+ * @brief API PRIVATE Closes the embedded message loaded since offset start by inserting its tag and length in front of
+ * it. Messages are loaded before their length is known, so the length is only inserted once they are complete. A field
+ * of 0 inserts the length alone, as used to delimit top level messages.
+ */
+static int prom_metric_formatter_protobuf_close_message(prom_metric_formatter_t *self, uint64_t field, size_t start) {
+  char buf[PROM_PROTOBUF_VARINT_MAX_LEN * 2];
+  size_t len = 0;
+  if (field != 0) len = prom_metric_formatter_protobuf_encode_varint(buf, (field << 3) | PROM_PROTOBUF_LEN);
+  len += prom_metric_formatter_protobuf_encode_varint(buf + len,
+                                                      prom_string_builder_len(self->string_builder) - start);
+  return prom_string_builder_insert(self->string_builder, start, buf, len);
+}
+
+static int prom_metric_formatter_protobuf_load_timestamp(prom_metric_formatter_t *self, uint64_t field,
+                                                         double timestamp) {
+  int r = 0;
+  size_t start = prom_string_builder_len(self->string_builder);
+  // Timestamps are taken from the realtime clock and are never negative
+  uint64_t seconds = (uint64_t)timestamp;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_TIMESTAMP_SECONDS, seconds);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_TIMESTAMP_NANOS,
+                                                 (uint64_t)((timestamp - (double)seconds) * 1e9));
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_close_message(self, field, start);
+}
+
+static int prom_metric_formatter_protobuf_load_label_pair(prom_metric_formatter_t *self, uint64_t field,
+                                                          const char *name, const char *value) {
+  int r = 0;
+  size_t start = prom_string_builder_len(self->string_builder);
+
+  r = prom_metric_formatter_protobuf_load_string(self, PROM_PROTOBUF_LABEL_PAIR_NAME, name);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_string(self, PROM_PROTOBUF_LABEL_PAIR_VALUE, value);
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_close_message(self, field, start);
+}
+
+static int prom_metric_formatter_protobuf_load_labels(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                      const char **label_values) {
+  int r = 0;
+  for (size_t i = 0; i < metric->label_key_count; i++) {
+    r = prom_metric_formatter_protobuf_load_label_pair(self, PROM_PROTOBUF_METRIC_LABEL, metric->label_keys[i],
+                                                       label_values[i]);
+    if (r) return r;
+  }
+  return 0;
+}
+
+static int prom_metric_formatter_protobuf_load_exemplar(prom_metric_formatter_t *self, uint64_t field,
+                                                        prom_exemplar_t *exemplar) {
+  if (exemplar == NULL) return 0;
+
+  int r = 0;
+  size_t start = prom_string_builder_len(self->string_builder);
+
+  for (size_t i = 0; i < exemplar->label_count; i++) {
+    r = prom_metric_formatter_protobuf_load_label_pair(self, PROM_PROTOBUF_EXEMPLAR_LABEL, exemplar->label_keys[i],
+                                                       exemplar->label_values[i]);
+    if (r) return r;
+  }
+
+  r = prom_metric_formatter_protobuf_load_double(self, PROM_PROTOBUF_EXEMPLAR_VALUE, exemplar->value);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_timestamp(self, PROM_PROTOBUF_EXEMPLAR_TIMESTAMP, exemplar->timestamp);
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_close_message(self, field, start);
+}
+
+/**
+ * @brief API PRIVATE Loads the populated native buckets of one sign. Runs of adjacent buckets form a span, whose offset
+ * is the distance from the end of the previous span, and the bucket counts are delta encoded in a packed field.
+ */
+static int prom_metric_formatter_protobuf_load_native_buckets(prom_metric_formatter_t *self,
+                                                              prom_histogram_native_buckets_t *buckets,
+                                                              uint64_t span_field, uint64_t delta_field) {
+  if (buckets->count == 0) return 0;
+
+  int r = 0;
+  size_t i = 0;
+  int32_t next_index = 0;
+  while (i < buckets->count) {
+    size_t length = 1;
+    while (i + length < buckets->count && buckets->buckets[i + length].index == buckets->buckets[i].index + length) {
+      length++;
+    }
+    size_t span_start = prom_string_builder_len(self->string_builder);
+
+    r = prom_metric_formatter_protobuf_load_varint(
+        self, PROM_PROTOBUF_BUCKET_SPAN_OFFSET,
+        prom_metric_formatter_protobuf_zigzag((int64_t)buckets->buckets[i].index - next_index));
+    if (r) return r;
+
+    r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_BUCKET_SPAN_LENGTH, length);
+    if (r) return r;
+
+    r = prom_metric_formatter_protobuf_close_message(self, span_field, span_start);
+    if (r) return r;
+
+    next_index = buckets->buckets[i].index + (int32_t)length;
+    i += length;
+  }
+
+  size_t delta_start = prom_string_builder_len(self->string_builder);
+  int64_t previous = 0;
+  for (i = 0; i < buckets->count; i++) {
+    char buf[PROM_PROTOBUF_VARINT_MAX_LEN];
+    int64_t count = (int64_t)buckets->buckets[i].count;
+    uint64_t delta = prom_metric_formatter_protobuf_zigzag(count - previous);
+    size_t len = prom_metric_formatter_protobuf_encode_varint(buf, delta);
+    r = prom_string_builder_add_strn(self->string_builder, buf, len);
+    if (r) return r;
+    previous = count;
+  }
+  return prom_metric_formatter_protobuf_close_message(self, delta_field, delta_start);
+}
+
+/**
+ * @brief API PRIVATE Loads the count, the zero bucket and the sparse buckets of a native histogram. The caller must
+ * hold the lock of the native histogram.
+ */
+static int prom_metric_formatter_protobuf_load_native_locked(prom_metric_formatter_t *self,
+                                                             prom_histogram_native_t *native) {
+  int r = 0;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_HISTOGRAM_SAMPLE_COUNT, native->count);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_HISTOGRAM_SCHEMA,
+                                                 prom_metric_formatter_protobuf_zigzag(native->schema));
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_double(self, PROM_PROTOBUF_HISTOGRAM_ZERO_THRESHOLD, native->zero_threshold);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_HISTOGRAM_ZERO_COUNT, native->zero_count);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_native_buckets(self, &native->negative, PROM_PROTOBUF_HISTOGRAM_NEGATIVE_SPAN,
+                                                         PROM_PROTOBUF_HISTOGRAM_NEGATIVE_DELTA);
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_load_native_buckets(self, &native->positive,
+                                                            PROM_PROTOBUF_HISTOGRAM_POSITIVE_SPAN,
+                                                            PROM_PROTOBUF_HISTOGRAM_POSITIVE_DELTA);
+}
+
+/**
+ * @brief API PRIVATE Loads a native histogram under its lock, so the count is never less than the observations in the
+ * buckets.
+ */
+static int prom_metric_formatter_protobuf_load_native(prom_metric_formatter_t *self, prom_histogram_native_t *native) {
+  int r = pthread_mutex_lock(&native->lock);
+  if (r) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_LOCK_ERROR);
+    return r;
+  }
+
+  r = prom_metric_formatter_protobuf_load_native_locked(self, native);
+
+  int rr = pthread_mutex_unlock(&native->lock);
+  if (rr) {
+    PROM_LOG(PROM_PTHREAD_MUTEX_UNLOCK_ERROR);
+    if (r == 0) r = rr;
+  }
+  return r;
+}
+
+int prom_metric_formatter_load_protobuf_header(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  self->family_start = prom_string_builder_len(self->string_builder);
+
+  r = prom_metric_formatter_protobuf_load_string(self, PROM_PROTOBUF_METRIC_FAMILY_NAME, metric->name);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_string(self, PROM_PROTOBUF_METRIC_FAMILY_HELP, metric->help);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_METRIC_FAMILY_TYPE,
+                                                 prom_metric_formatter_protobuf_types[metric->type]);
+  if (r) return r;
+
+  self->family_metrics_start = prom_string_builder_len(self->string_builder);
+  return 0;
+}
+
+int prom_metric_formatter_load_protobuf_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                               prom_metric_sample_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t start = prom_string_builder_len(self->string_builder);
+
+  r = prom_metric_formatter_protobuf_load_labels(self, metric, sample->label_values);
+  if (r) return r;
+
+  size_t value_start = prom_string_builder_len(self->string_builder);
+  r = prom_metric_formatter_protobuf_load_double(self, PROM_PROTOBUF_VALUE, prom_metric_sample_value(sample));
+  if (r) return r;
+
+  if (metric->type == PROM_COUNTER) {
+    r = prom_metric_formatter_protobuf_load_exemplar(self, PROM_PROTOBUF_COUNTER_EXEMPLAR, sample->exemplar);
+    if (r) return r;
+
+    r = prom_metric_formatter_protobuf_load_timestamp(self, PROM_PROTOBUF_COUNTER_CREATED_TIMESTAMP, sample->created);
+    if (r) return r;
+
+    r = prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_METRIC_COUNTER, value_start);
+  } else {
+    r = prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_METRIC_GAUGE, value_start);
+  }
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_METRIC_FAMILY_METRIC, start);
+}
+
+int prom_metric_formatter_load_protobuf_histogram_sample(prom_metric_formatter_t *self, prom_metric_t *metric,
+                                                         prom_metric_sample_histogram_t *sample) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  size_t start = prom_string_builder_len(self->string_builder);
+
+  r = prom_metric_formatter_protobuf_load_labels(self, metric, sample->label_values);
+  if (r) return r;
+
+  size_t histogram_start = prom_string_builder_len(self->string_builder);
+
+  // The +Inf bucket is included so that its exemplar has a place
+  uint64_t cumulative_count = 0;
+  for (size_t i = 0; sample->native == NULL && i <= sample->bucket_count; i++) {
+    cumulative_count += atomic_load_explicit(&sample->bucket_counts[i], memory_order_relaxed);
+    size_t bucket_start = prom_string_builder_len(self->string_builder);
+
+    r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_BUCKET_CUMULATIVE_COUNT, cumulative_count);
+    if (r) return r;
+
+    double upper_bound = (i < sample->bucket_count) ? sample->buckets->upper_bounds[i] : INFINITY;
+    r = prom_metric_formatter_protobuf_load_double(self, PROM_PROTOBUF_BUCKET_UPPER_BOUND, upper_bound);
+    if (r) return r;
+
+    if (sample->exemplars != NULL) {
+      r = prom_metric_formatter_protobuf_load_exemplar(self, PROM_PROTOBUF_BUCKET_EXEMPLAR, sample->exemplars[i]);
+      if (r) return r;
+    }
+
+    r = prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_HISTOGRAM_BUCKET, bucket_start);
+    if (r) return r;
+  }
+
+  if (sample->native == NULL) {
+    r = prom_metric_formatter_protobuf_load_varint(self, PROM_PROTOBUF_HISTOGRAM_SAMPLE_COUNT, cumulative_count);
+  } else {
+    r = prom_metric_formatter_protobuf_load_native(self, sample->native);
+    if (r) return r;
+
+    // Native histograms have no classic buckets to carry exemplars, so the exemplar of +Inf is attached to the
+    // histogram itself
+    if (sample->exemplars != NULL) {
+      r = prom_metric_formatter_protobuf_load_exemplar(self, PROM_PROTOBUF_HISTOGRAM_EXEMPLARS,
+                                                       sample->exemplars[sample->bucket_count]);
+    }
+  }
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_double(self, PROM_PROTOBUF_HISTOGRAM_SAMPLE_SUM,
+                                                 atomic_load_explicit(&sample->sum, memory_order_relaxed));
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_load_timestamp(self, PROM_PROTOBUF_HISTOGRAM_CREATED_TIMESTAMP, sample->created);
+  if (r) return r;
+
+  r = prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_METRIC_HISTOGRAM, histogram_start);
+  if (r) return r;
+
+  return prom_metric_formatter_protobuf_close_message(self, PROM_PROTOBUF_METRIC_FAMILY_METRIC, start);
+}
+
+int prom_metric_formatter_load_protobuf_footer(prom_metric_formatter_t *self, prom_metric_t *metric) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // A family without metrics carries no data. Drop it rather than expose an empty family.
+  if (prom_string_builder_len(self->string_builder) == self->family_metrics_start) {
+    return prom_string_builder_truncate(self->string_builder, self->family_start);
+  }
+  return prom_metric_formatter_protobuf_close_message(self, 0, self->family_start);
+}
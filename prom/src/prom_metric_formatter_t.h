@@ -17,11 +17,18 @@
 #ifndef PROM_METRIC_FORMATTER_T_H
 #define PROM_METRIC_FORMATTER_T_H
 
+// Public
+#include "prom_collector_registry.h"
+
+// Private
 #include "prom_string_builder_t.h"
 
 typedef struct prom_metric_formatter {
   prom_string_builder_t *string_builder;
   prom_string_builder_t *err_builder;
+  prom_exposition_format_t format; /**< The format in which metrics are loaded */
+  size_t family_start;             /**< The offset of the protobuf MetricFamily being loaded */
+  size_t family_metrics_start;     /**< The offset of the first Metric of the protobuf MetricFamily being loaded */
 } prom_metric_formatter_t;
 
 #endif  // PROM_METRIC_FORMATTER_T_H
@@ -15,6 +15,7 @@
  */
 
 // Private
+#include "prom_exemplar_t.h"
 #include "prom_metric_sample_histogram_t.h"
 #include "prom_metric_t.h"
 
@@ -42,4 +43,36 @@ int prom_metric_destroy_generic(void *item);
  */
 void prom_metric_free_generic(void *item);
 
+/**
+ * @brief API PRIVATE Replaces the exemplar of a sample of the metric, destroying the previous one. Takes ownership of
+ * exemplar, which is destroyed upon failure.
+ */
+int prom_metric_sample_set_exemplar(prom_metric_t *self, prom_metric_sample_t *sample, prom_exemplar_t *exemplar);
+
+/**
+ * @brief API PRIVATE Replaces the exemplar of the bucket at the given index of a histogram sample of the metric,
+ * destroying the previous one. Takes ownership of exemplar, which is destroyed upon failure.
+ */
+int prom_metric_sample_histogram_set_exemplar(prom_metric_t *self, prom_metric_sample_histogram_t *sample,
+                                              size_t index, prom_exemplar_t *exemplar);
+
+/**
+ * @brief API PRIVATE Counts the series of the metric against the given budget of its registry, or against none if
+ * budget is NULL
+ */
+int prom_metric_set_series_budget(prom_metric_t *self, prom_series_budget_t *budget);
+
+/**
+ * @brief API PRIVATE Returns the sample of the series with the given label values like prom_metric_sample_from_labels
+ * or prom_metric_sample_histogram_from_labels, and pins it. A pinned series is never expired by its TTL since it may be
+ * updated through a child handle without a lookup.
+ */
+void *prom_metric_series_pin(prom_metric_t *self, const char **label_values);
+
+/**
+ * @brief API PRIVATE Expires the series idle for longer than the TTL of the metric, if any, and reuses the memory of
+ * series removed long enough ago. Called before each scrape of the metric.
+ */
+int prom_metric_sweep(prom_metric_t *self);
+
 #endif  // PROM_METRIC_I_INCLUDED
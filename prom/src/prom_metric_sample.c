@@ -15,35 +15,165 @@
  */
 
 #include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
 
 // Public
 #include "prom_alloc.h"
 
 // Private
+#include "prom_arena_i.h"
 #include "prom_assert.h"
 #include "prom_errors.h"
+#include "prom_exemplar_i.h"
 #include "prom_log.h"
 #include "prom_metric_sample_i.h"
 #include "prom_metric_sample_t.h"
 
-prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value) {
-  prom_metric_sample_t *self = (prom_metric_sample_t *)prom_malloc(sizeof(prom_metric_sample_t));
+// Each thread is assigned a shard index the first time it updates a sharded sample. Threads are assigned indexes
+// round-robin so that, up to the shard count, concurrently running threads update distinct shards.
+static atomic_size_t prom_metric_sample_next_shard_index = ATOMIC_VAR_INIT(0);
+static _Thread_local size_t prom_metric_sample_shard_index = SIZE_MAX;
+
+/**
+ * @brief API PRIVATE Initializes a sample whose prefix storage directly follows the struct
+ */
+static void prom_metric_sample_init(prom_metric_sample_t *self, prom_metric_type_t type, const char *l_value,
+                                    size_t len, double r_value) {
   self->type = type;
-  self->l_value = prom_strdup(l_value);
+  self->from_arena = false;
+  self->prefix = (char *)(self + 1);
+  memcpy(self->prefix, l_value, len);
+  self->prefix[len] = ' ';
+  self->prefix[len + 1] = '\0';
+  self->prefix_len = len + 1;
   self->r_value = ATOMIC_VAR_INIT(r_value);
+  self->shard_count = 0;
+  self->shards = NULL;
+  self->shards_alloc = NULL;
+  self->label_values = NULL;
+  self->created = prom_metric_sample_now();
+  self->exemplar = NULL;
+  atomic_init(&self->touched, true);
+  self->pinned = false;
+  self->idle_since = 0;
+}
+
+/**
+ * @brief API PRIVATE Aligns the shards of a sample within shards_alloc, which must hold shard_count + 1 shards.
+ */
+static void prom_metric_sample_init_shards(prom_metric_sample_t *self, size_t shard_count) {
+  // Neither prom_malloc nor the arena guarantee cache line alignment, so the allocation holds one slot more than needed
+  // and the shards are aligned within it.
+  uintptr_t addr = (uintptr_t)self->shards_alloc;
+  addr = (addr + PROM_METRIC_SAMPLE_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(PROM_METRIC_SAMPLE_CACHE_LINE_SIZE - 1);
+  self->shards = (prom_metric_sample_shard_t *)addr;
+  for (size_t i = 0; i < shard_count; i++) {
+    atomic_init(&self->shards[i].r_value, 0.0);
+  }
+  self->shard_count = shard_count;
+}
+
+prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value) {
+  size_t len = strlen(l_value);
+  prom_metric_sample_t *self = (prom_metric_sample_t *)prom_malloc(sizeof(prom_metric_sample_t) + len + 2);
+  if (self == NULL) return NULL;
+  prom_metric_sample_init(self, type, l_value, len, r_value);
   return self;
 }
 
+prom_metric_sample_t *prom_metric_sample_new_sharded(prom_metric_type_t type, const char *l_value,
+                                                     size_t shard_count) {
+  PROM_ASSERT(shard_count > 0 && shard_count <= PROM_METRIC_SAMPLE_MAX_SHARDS);
+  PROM_ASSERT((shard_count & (shard_count - 1)) == 0);
+  prom_metric_sample_t *self = prom_metric_sample_new(type, l_value, 0.0);
+  if (self == NULL) return NULL;
+  self->shards_alloc = prom_malloc(sizeof(prom_metric_sample_shard_t) * (shard_count + 1));
+  if (self->shards_alloc == NULL) {
+    prom_metric_sample_destroy(self);
+    return NULL;
+  }
+  prom_metric_sample_init_shards(self, shard_count);
+  return self;
+}
+
+prom_metric_sample_t *prom_metric_sample_new_from_arena(prom_arena_t *arena, prom_metric_type_t type,
+                                                        const char *l_value, size_t shard_count) {
+  PROM_ASSERT(arena != NULL);
+  PROM_ASSERT(shard_count <= PROM_METRIC_SAMPLE_MAX_SHARDS);
+  PROM_ASSERT((shard_count & (shard_count - 1)) == 0);
+  size_t len = strlen(l_value);
+  prom_metric_sample_t *self = (prom_metric_sample_t *)prom_arena_alloc(arena, sizeof(prom_metric_sample_t) + len + 2);
+  if (self == NULL) return NULL;
+  prom_metric_sample_init(self, type, l_value, len, 0.0);
+  self->from_arena = true;
+  if (shard_count > 0) {
+    self->shards_alloc = prom_arena_alloc(arena, sizeof(prom_metric_sample_shard_t) * (shard_count + 1));
+    if (self->shards_alloc == NULL) return NULL;
+    prom_metric_sample_init_shards(self, shard_count);
+  }
+  return self;
+}
+
+size_t prom_metric_sample_default_shard_count(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  size_t shard_count = 1;
+  while (shard_count < PROM_METRIC_SAMPLE_MAX_SHARDS && (long)shard_count < cpus) {
+    shard_count <<= 1;
+  }
+  return shard_count;
+}
+
+double prom_metric_sample_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+double prom_metric_sample_value(prom_metric_sample_t *self) {
+  PROM_ASSERT(self != NULL);
+  double r_value = atomic_load(&self->r_value);
+  for (size_t i = 0; i < self->shard_count; i++) {
+    r_value += atomic_load_explicit(&self->shards[i].r_value, memory_order_relaxed);
+  }
+  return r_value;
+}
+
 int prom_metric_sample_destroy(prom_metric_sample_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
-  prom_free((void *)self->l_value);
-  self->l_value = NULL;
+  if (self->exemplar != NULL) prom_exemplar_destroy(self->exemplar);
+  self->exemplar = NULL;
+
+  // Everything else held by a sample allocated from an arena is released along with the arena
+  if (self->from_arena) return 0;
+
+  self->prefix = NULL;
+  prom_free(self->shards_alloc);
+  self->shards_alloc = NULL;
+  self->shards = NULL;
+  prom_free((void *)self->label_values);
+  self->label_values = NULL;
   prom_free((void *)self);
   self = NULL;
   return 0;
 }
 
+int prom_metric_sample_recycle(prom_metric_sample_t *self, prom_arena_t *arena) {
+  PROM_ASSERT(self != NULL);
+  PROM_ASSERT(self->from_arena);
+  if (self == NULL) return 0;
+  int r = prom_metric_sample_destroy(self);
+  if (r) return r;
+  if (self->shards_alloc != NULL) {
+    r = prom_arena_free(arena, self->shards_alloc, sizeof(prom_metric_sample_shard_t) * (self->shard_count + 1));
+    if (r) return r;
+  }
+  return prom_arena_free(arena, self, sizeof(prom_metric_sample_t) + self->prefix_len + 1);
+}
+
 int prom_metric_sample_destroy_generic(void *gen) {
   int r = 0;
 
@@ -63,6 +193,20 @@ int prom_metric_sample_add(prom_metric_sample_t *self, double r_value) {
   if (r_value < 0) {
     return 1;
   }
+  if (self->shards != NULL) {
+    if (prom_metric_sample_shard_index == SIZE_MAX) {
+      prom_metric_sample_shard_index =
+          atomic_fetch_add_explicit(&prom_metric_sample_next_shard_index, 1, memory_order_relaxed);
+    }
+    // The shard is rarely shared, so the compare and swap almost never retries. No ordering is required since the
+    // shards are only summed on scrape.
+    _Atomic double *shard = &self->shards[prom_metric_sample_shard_index & (self->shard_count - 1)].r_value;
+    double old = atomic_load_explicit(shard, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(shard, &old, old + r_value, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+    return 0;
+  }
   _Atomic double old = atomic_load(&self->r_value);
   for (;;) {
     _Atomic double new = ATOMIC_VAR_INIT(old + r_value);
@@ -95,3 +239,13 @@ int prom_metric_sample_set(prom_metric_sample_t *self, double r_value) {
   atomic_store(&self->r_value, r_value);
   return 0;
 }
+
+int prom_metric_sample_set_total(prom_metric_sample_t *self, double r_value) {
+  PROM_ASSERT(self != NULL);
+  if (self->type != PROM_COUNTER || self->shards != NULL) {
+    PROM_LOG(PROM_METRIC_INCORRECT_TYPE);
+    return 1;
+  }
+  atomic_store(&self->r_value, r_value);
+  return 0;
+}
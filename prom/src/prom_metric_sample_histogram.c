@@ -14,7 +14,8 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 
 // Public
@@ -22,284 +23,225 @@
 #include "prom_histogram.h"
 
 // Private
+#include "prom_arena_i.h"
 #include "prom_assert.h"
-#include "prom_errors.h"
-#include "prom_linked_list_i.h"
-#include "prom_log.h"
-#include "prom_map_i.h"
+#include "prom_exemplar_i.h"
+#include "prom_histogram_native_i.h"
 #include "prom_metric_formatter_i.h"
 #include "prom_metric_sample_histogram_i.h"
 #include "prom_metric_sample_i.h"
 
+// The le label appended to the labels of each bucket
+#define PROM_METRIC_SAMPLE_HISTOGRAM_LE_KEY "le"
+
+// Terminates the le value of a bucket prefix
+#define PROM_METRIC_SAMPLE_HISTOGRAM_LE_END "\"} "
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Static Declarations
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static const char *prom_metric_sample_histogram_l_value_for_bucket(prom_metric_sample_histogram_t *self,
-                                                                   const char *name, size_t label_count,
-                                                                   const char **label_keys, const char **label_values,
-                                                                   double bucket);
-
-static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                                size_t label_count, const char **label_keys,
-                                                                const char **label_values);
-
-static void prom_metric_sample_histogram_free_str_generic(void *gen);
-
-static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_histogram_t *self, const char *name,
-                                                            size_t label_count, const char **label_keys,
-                                                            const char **label_values);
-
-static int prom_metric_sample_histogram_init_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                 size_t label_count, const char **label_keys,
-                                                 const char **label_values);
-
-static int prom_metric_sample_histogram_init_count(prom_metric_sample_histogram_t *self, const char *name,
-                                                   size_t label_count, const char **label_keys,
-                                                   const char **label_values);
-
-static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogram_t *self, const char *name,
-                                                     size_t label_count, const char **label_keys,
-                                                     const char **label_values);
+static int prom_metric_sample_histogram_init_prefixes(prom_metric_sample_histogram_t *self, prom_arena_t *arena,
+                                                      const char *name, size_t label_count, const char **label_keys,
+                                                      const char **label_values);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // End static declarations
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *name, prom_histogram_buckets_t *buckets,
-                                                                 size_t label_count, const char **label_keys,
-                                                                 const char **label_values) {
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(prom_arena_t *arena, const char *name,
+                                                                 prom_histogram_buckets_t *buckets, size_t label_count,
+                                                                 const char **label_keys, const char **label_values) {
   // Capture return codes
   int r = 0;
 
-  // Allocate and set self
-  prom_metric_sample_histogram_t *self =
-      (prom_metric_sample_histogram_t *)prom_malloc(sizeof(prom_metric_sample_histogram_t));
-
-  // Allocate and set the l_value_list
-  self->l_value_list = prom_linked_list_new();
-  if (self->l_value_list == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  // Allocate the struct together with the bucket counters. The final counter belongs to the +Inf bucket
+  size_t bucket_count = prom_histogram_buckets_count(buckets);
+  size_t size = sizeof(prom_metric_sample_histogram_t) + sizeof(_Atomic uint64_t) * (bucket_count + 1);
+  prom_metric_sample_histogram_t *self = NULL;
+  if (arena == NULL) {
+    self = (prom_metric_sample_histogram_t *)prom_malloc(size);
+  } else {
+    self = (prom_metric_sample_histogram_t *)prom_arena_alloc(arena, size);
   }
-
-  // Allocate and set the metric formatter
-  self->metric_formatter = prom_metric_formatter_new();
-  if (self->metric_formatter == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Store map of l_value/prom_metric_sample_t
-  self->samples = prom_map_new();
-  if (self->samples == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  if (self == NULL) return NULL;
+  self->from_arena = arena != NULL;
+  self->buckets = buckets;
+  self->bucket_count = bucket_count;
+  self->prefix_offsets = NULL;
+  self->prefixes = NULL;
+  self->bucket_counts = (_Atomic uint64_t *)(self + 1);
+  atomic_init(&self->sum, 0.0);
+  self->label_values = NULL;
+  self->created = prom_metric_sample_now();
+  self->exemplars = NULL;
+  atomic_init(&self->touched, true);
+  self->pinned = false;
+  self->idle_since = 0;
+  self->native = NULL;
+  for (size_t i = 0; i <= self->bucket_count; i++) {
+    atomic_init(&self->bucket_counts[i], 0);
   }
 
-  // Set the free value function on the samples map
-  r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
+  // Render the series prefixes
+  r = prom_metric_sample_histogram_init_prefixes(self, arena, name, label_count, label_keys, label_values);
   if (r) {
     prom_metric_sample_histogram_destroy(self);
     return NULL;
   }
 
-  // Set a map of bucket: l_value
-  self->l_values = prom_map_new();  // Store map of bucket/l_value
-  if (self->l_values == NULL) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-
-  // Set the free value function for thhe l_values map
-  r = prom_map_set_free_value_fn(self->l_values, prom_metric_sample_histogram_free_str_generic);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
+  return self;
+}
 
-  self->buckets = buckets;
+static int prom_metric_sample_histogram_init_prefixes(prom_metric_sample_histogram_t *self, prom_arena_t *arena,
+                                                      const char *name, size_t label_count, const char **label_keys,
+                                                      const char **label_values) {
+  PROM_ASSERT(self != NULL);
 
-  // Allocate and initialize the lock
-  self->rwlock = (pthread_rwlock_t *)prom_malloc(sizeof(pthread_rwlock_t));
-  r = pthread_rwlock_init(self->rwlock, NULL);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+#define PROM_METRIC_SAMPLE_HISTOGRAM_INIT_PREFIXES_CLEANUP() \
+  for (size_t i = 0; i < self->bucket_count; i++) {         \
+    prom_free(le_values[i]);                                \
+  }                                                         \
+  prom_free(le_values);                                     \
+  prom_free(keys);
+
+  // The pieces are the bucket suffixes including +Inf, the count prefix and the sum prefix. One more offset marks the
+  // end of the arena.
+  size_t piece_count = self->bucket_count + 3;
+
+  // Append the le label to the user labels. Rendering it with an empty value and dropping the closing quote and brace
+  // yields the label block shared by every bucket.
+  const char **keys = (const char **)prom_malloc(sizeof(const char *) * (label_count + 1) * 2);
+  const char **values = keys + label_count + 1;
+  for (size_t i = 0; i < label_count; i++) {
+    keys[i] = label_keys[i];
+    values[i] = label_values[i];
   }
+  keys[label_count] = PROM_METRIC_SAMPLE_HISTOGRAM_LE_KEY;
+  values[label_count] = "";
 
-  // Allocate and initialize bucket metric samples
-  r = prom_metric_sample_histogram_init_bucket_samples(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  // Render the le value of each bucket
+  char **le_values = (char **)prom_malloc(sizeof(char *) * self->bucket_count);
+  for (size_t i = 0; i < self->bucket_count; i++) {
+    le_values[i] = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
   }
 
-  // Allocate and initialize the +Inf metric sample
-  r = prom_metric_sample_histogram_init_inf(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  // Measure the arena
+  size_t label_block_len = prom_metric_formatter_render_l_value(NULL, 0, name, NULL, label_count + 1, keys, values) - 2;
+  size_t le_end_len = strlen(PROM_METRIC_SAMPLE_HISTOGRAM_LE_END);
+  size_t size = label_block_len;
+  for (size_t i = 0; i < self->bucket_count; i++) size += strlen(le_values[i]) + le_end_len;
+  size += strlen("+Inf") + le_end_len;
+  size_t count_len =
+      prom_metric_formatter_render_l_value(NULL, 0, name, "count", label_count, label_keys, label_values);
+  size_t sum_len = prom_metric_formatter_render_l_value(NULL, 0, name, "sum", label_count, label_keys, label_values);
+  size += count_len + 1 + sum_len + 1;
+
+  // Allocate the offsets and the characters together. The character after the end of the arena leaves room for the
+  // terminating null byte written by prom_metric_formatter_render_l_value.
+  size_t prefixes_size = sizeof(size_t) * (piece_count + 1) + size + 1;
+  if (arena == NULL) {
+    self->prefix_offsets = (size_t *)prom_malloc(prefixes_size);
+  } else {
+    self->prefix_offsets = (size_t *)prom_arena_alloc(arena, prefixes_size);
   }
-
-  // Allocate and initialize the count metric sample
-  r = prom_metric_sample_histogram_init_count(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  if (self->prefix_offsets == NULL) {
+    PROM_METRIC_SAMPLE_HISTOGRAM_INIT_PREFIXES_CLEANUP();
+    return 1;
   }
-
-  // Add summary sample
-  r = prom_metric_sample_histogram_init_summary(self, name, label_count, label_keys, label_values);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
+  char *prefixes = (char *)(self->prefix_offsets + piece_count + 1);
+  self->prefixes = prefixes;
+
+  size_t len = prom_metric_formatter_render_l_value(prefixes, size + 1, name, NULL, label_count + 1, keys, values) - 2;
+  size_t piece = 0;
+  for (size_t i = 0; i <= self->bucket_count; i++) {
+    self->prefix_offsets[piece++] = len;
+    const char *le_value = (i < self->bucket_count) ? le_values[i] : "+Inf";
+    size_t le_value_len = strlen(le_value);
+    memcpy(prefixes + len, le_value, le_value_len);
+    len += le_value_len;
+    memcpy(prefixes + len, PROM_METRIC_SAMPLE_HISTOGRAM_LE_END, le_end_len);
+    len += le_end_len;
   }
 
-  // The value of nodes in this map will be simple prom_metric_sample pointers.
-  r = prom_map_set_free_value_fn(self->samples, &prom_metric_sample_free_generic);
-  if (r) {
-    prom_metric_sample_histogram_destroy(self);
-    return NULL;
-  }
-  return self;
-}
-
-static int prom_metric_sample_histogram_init_bucket_samples(prom_metric_sample_histogram_t *self, const char *name,
-                                                            size_t label_count, const char **label_keys,
-                                                            const char **label_values) {
-  PROM_ASSERT(self);
-  int r = 0;
-  int bucket_count = prom_histogram_buckets_count(self->buckets);
-
-  // For each bucket, create an prom_metric_sample_t with an appropriate l_value and default value of 0.0. The
-  // l_value will contain the metric name, user labels, and finally, the le label and bucket value.
-  for (int i = 0; i < bucket_count; i++) {
-    const char *l_value = prom_metric_sample_histogram_l_value_for_bucket(self, name, label_count, label_keys,
-                                                                          label_values, self->buckets->upper_bounds[i]);
-    if (l_value == NULL) return 1;
+  self->prefix_offsets[piece++] = len;
+  len += prom_metric_formatter_render_l_value(prefixes + len, size + 1 - len, name, "count", label_count, label_keys,
+                                              label_values);
+  prefixes[len++] = ' ';
 
-    r = prom_linked_list_append(self->l_value_list, prom_strdup(l_value));
-    if (r) return r;
+  self->prefix_offsets[piece++] = len;
+  len += prom_metric_formatter_render_l_value(prefixes + len, size + 1 - len, name, "sum", label_count, label_keys,
+                                              label_values);
+  prefixes[len++] = ' ';
 
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) return 1;
+  self->prefix_offsets[piece] = len;
+  prefixes[len] = '\0';
+  PROM_ASSERT(len == size);
 
-    r = prom_map_set(self->l_values, bucket_key, (char *)l_value);
-    if (r) return r;
-
-    prom_metric_sample_t *sample = prom_metric_sample_new(PROM_HISTOGRAM, l_value, 0.0);
-    if (sample == NULL) return 1;
-
-    r = prom_map_set(self->samples, l_value, sample);
-    if (r) return r;
-
-    prom_free((void *)bucket_key);
-  }
+  PROM_METRIC_SAMPLE_HISTOGRAM_INIT_PREFIXES_CLEANUP();
   return 0;
 }
 
-static int prom_metric_sample_histogram_init_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                 size_t label_count, const char **label_keys,
-                                                 const char **label_values) {
+const char *prom_metric_sample_histogram_label_block(prom_metric_sample_histogram_t *self, size_t *len) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-  const char *inf_l_value =
-      prom_metric_sample_histogram_l_value_for_inf(self, name, label_count, label_keys, label_values);
-  if (inf_l_value == NULL) return 1;
-
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(inf_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "+Inf", (char *)inf_l_value);
-  if (r) return r;
-
-  prom_metric_sample_t *inf_sample = prom_metric_sample_new(PROM_HISTOGRAM, (char *)inf_l_value, 0.0);
-  if (inf_sample == NULL) return 1;
-
-  return prom_map_set(self->samples, inf_l_value, inf_sample);
+  *len = self->prefix_offsets[0];
+  return self->prefixes;
 }
 
-static int prom_metric_sample_histogram_init_count(prom_metric_sample_histogram_t *self, const char *name,
-                                                   size_t label_count, const char **label_keys,
-                                                   const char **label_values) {
+const char *prom_metric_sample_histogram_prefix(prom_metric_sample_histogram_t *self, size_t index, size_t *len) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, "count", label_count, label_keys, label_values);
-  if (r) return r;
-
-  const char *count_l_value = prom_metric_formatter_dump(self->metric_formatter);
-  if (count_l_value == NULL) return 1;
-
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(count_l_value));
-  if (r) return r;
-
-  r = prom_map_set(self->l_values, "count", (char *)count_l_value);
-  if (r) return r;
-
-  prom_metric_sample_t *count_sample = prom_metric_sample_new(PROM_HISTOGRAM, count_l_value, 0.0);
-  if (count_sample == NULL) return 1;
-
-  return prom_map_set(self->samples, count_l_value, count_sample);
+  PROM_ASSERT(index <= self->bucket_count + 2);
+  *len = self->prefix_offsets[index + 1] - self->prefix_offsets[index];
+  return self->prefixes + self->prefix_offsets[index];
 }
 
-static int prom_metric_sample_histogram_init_summary(prom_metric_sample_histogram_t *self, const char *name,
-                                                     size_t label_count, const char **label_keys,
-                                                     const char **label_values) {
+int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
+  if (self == NULL) return 0;
 
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, "sum", label_count, label_keys, label_values);
-  if (r) return r;
+  if (self->exemplars != NULL) {
+    for (size_t i = 0; i <= self->bucket_count; i++) {
+      if (self->exemplars[i] != NULL) prom_exemplar_destroy(self->exemplars[i]);
+    }
+    prom_free(self->exemplars);
+    self->exemplars = NULL;
+  }
 
-  const char *sum_l_value = prom_metric_formatter_dump(self->metric_formatter);
-  if (sum_l_value == NULL) return 1;
+  if (self->native != NULL) {
+    prom_histogram_native_destroy(self->native);
+    self->native = NULL;
+  }
 
-  r = prom_linked_list_append(self->l_value_list, prom_strdup(sum_l_value));
-  if (r) return r;
+  // Everything else held by a sample allocated from an arena is released along with the arena
+  if (self->from_arena) return 0;
 
-  r = prom_map_set(self->l_values, "sum", (char *)sum_l_value);
-  if (r) return r;
+  prom_free(self->prefix_offsets);
+  self->prefix_offsets = NULL;
+  self->prefixes = NULL;
+  self->bucket_counts = NULL;
 
-  prom_metric_sample_t *sum_sample = prom_metric_sample_new(PROM_HISTOGRAM, sum_l_value, 0.0);
-  if (sum_sample == NULL) return 1;
+  prom_free((void *)self->label_values);
+  self->label_values = NULL;
 
-  return prom_map_set(self->samples, sum_l_value, sum_sample);
+  prom_free(self);
+  self = NULL;
+  return 0;
 }
 
-int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self) {
+int prom_metric_sample_histogram_recycle(prom_metric_sample_histogram_t *self, prom_arena_t *arena) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-  int ret = 0;
-
+  PROM_ASSERT(self->from_arena);
   if (self == NULL) return 0;
+  int r = prom_metric_sample_histogram_destroy(self);
+  if (r) return r;
 
-  r = prom_linked_list_destroy(self->l_value_list);
-  self->l_value_list = NULL;
-  if (r) ret = r;
-
-  r = prom_map_destroy(self->samples);
-  if (r) ret = r;
-  self->samples = NULL;
-
-  r = prom_map_destroy(self->l_values);
-  if (r) ret = r;
-  self->l_values = NULL;
-
-  r = prom_metric_formatter_destroy(self->metric_formatter);
-  if (r) ret = r;
-  self->metric_formatter = NULL;
-
-  r = pthread_rwlock_destroy(self->rwlock);
-  if (r) ret = r;
-
-  prom_free(self->rwlock);
-  self->rwlock = NULL;
-
-  prom_free(self);
-  self = NULL;
-  return ret;
+  // The sizes mirror the allocations made by prom_metric_sample_histogram_new
+  size_t piece_count = self->bucket_count + 3;
+  size_t prefixes_size = sizeof(size_t) * (piece_count + 1) + self->prefix_offsets[piece_count] + 1;
+  r = prom_arena_free(arena, self->prefix_offsets, prefixes_size);
+  if (r) return r;
+  return prom_arena_free(arena, self,
+                         sizeof(prom_metric_sample_histogram_t) + sizeof(_Atomic uint64_t) * (self->bucket_count + 1));
 }
 
 int prom_metric_sample_histogram_destroy_generic(void *gen) {
@@ -316,187 +258,46 @@ void prom_metric_sample_histogram_free_generic(void *gen) {
   prom_metric_sample_histogram_destroy(self);
 }
 
-int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
-  int r = 0;
-
-  r = pthread_rwlock_wrlock(self->rwlock);
-  if (r) {
-    printf("RETURN CODE: %d\n", r);
-    PROM_LOG(PROM_PTHREAD_RWLOCK_LOCK_ERROR);
-    return r;
-  }
-
-#define PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r) \
-  int rr = 0;                                                 \
-  rr = pthread_rwlock_unlock(self->rwlock);                   \
-  if (rr) {                                                   \
-    PROM_LOG(PROM_PTHREAD_RWLOCK_UNLOCK_ERROR);               \
-    return rr;                                                \
-  } else {                                                    \
-    return r;                                                 \
-  }
-
-  // Update the counter for the proper bucket if found
-  int bucket_count = prom_histogram_buckets_count(self->buckets);
-  for (int i = (bucket_count - 1); i >= 0; i--) {
-    if (value > self->buckets->upper_bounds[i]) {
-      break;
-    }
-
-    const char *bucket_key = prom_metric_sample_histogram_bucket_to_str(self->buckets->upper_bounds[i]);
-    if (bucket_key == NULL) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
+size_t prom_metric_sample_histogram_bucket_index(prom_metric_sample_histogram_t *self, double value) {
+  const double *upper_bounds = self->buckets->upper_bounds;
+  size_t low = 0;
+  size_t high = self->bucket_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (value <= upper_bounds[mid]) {
+      high = mid;
+    } else {
+      low = mid + 1;
     }
-
-    const char *l_value = prom_map_get(self->l_values, bucket_key);
-    if (l_value == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
-
-    prom_metric_sample_t *sample = prom_map_get(self->samples, l_value);
-    if (sample == NULL) {
-      prom_free((void *)bucket_key);
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1)
-    }
-
-    prom_free((void *)bucket_key);
-    r = prom_metric_sample_add(sample, 1.0);
-    if (r) {
-      PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
-    }
-  }
-
-  // Update the +Inf and count samples
-  const char *inf_l_value = prom_map_get(self->l_values, "+Inf");
-  if (inf_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  prom_metric_sample_t *inf_sample = prom_map_get(self->samples, inf_l_value);
-  if (inf_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
   }
-
-  r = prom_metric_sample_add(inf_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  const char *count_l_value = prom_map_get(self->l_values, "count");
-  if (count_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  prom_metric_sample_t *count_sample = prom_map_get(self->samples, count_l_value);
-  if (count_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  r = prom_metric_sample_add(count_sample, 1.0);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  // Update the sum sample
-  const char *sum_l_value = prom_map_get(self->l_values, "sum");
-  if (sum_l_value == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  prom_metric_sample_t *sum_sample = prom_map_get(self->samples, sum_l_value);
-  if (sum_sample == NULL) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(1);
-  }
-
-  r = prom_metric_sample_add(sum_sample, value);
-  PROM_METRIC_SAMPLE_HISTOGRAM_OBSERVE_HANDLE_UNLOCK(r);
-  return r;
+  return low;
 }
 
-static const char *prom_metric_sample_histogram_l_value_for_bucket(prom_metric_sample_histogram_t *self,
-                                                                   const char *name, size_t label_count,
-                                                                   const char **label_keys, const char **label_values,
-                                                                   double bucket) {
+int prom_metric_sample_histogram_observe(prom_metric_sample_histogram_t *self, double value) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
+  if (self == NULL) return 1;
 
-#define PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP() \
-  for (size_t i = 0; i < label_count + 1; i++) {                  \
-    prom_free((char *)new_keys[i]);                               \
-    prom_free((char *)new_values[i]);                             \
-  }                                                               \
-  prom_free(new_keys);                                            \
-  prom_free(new_values);
+  // Only the bucket containing the value is updated. Cumulative counts are computed when the sample is exported.
+  atomic_fetch_add_explicit(&self->bucket_counts[prom_metric_sample_histogram_bucket_index(self, value)], 1,
+                            memory_order_relaxed);
 
-  // Make new array to hold label_keys with le label key
-  const char **new_keys = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_keys[i] = prom_strdup(label_keys[i]);
+  double sum = atomic_load_explicit(&self->sum, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&self->sum, &sum, sum + value, memory_order_relaxed,
+                                                memory_order_relaxed)) {
   }
-  new_keys[label_count] = prom_strdup("le");
 
-  // Make new array to hold label_values with le label value
-  const char **new_values = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_values[i] = prom_strdup(label_values[i]);
-  }
-
-  new_values[label_count] = prom_metric_sample_histogram_bucket_to_str(bucket);
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, NULL, label_count + 1, new_keys, new_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP();
-    return NULL;
-  }
-  const char *ret = (const char *)prom_metric_formatter_dump(self->metric_formatter);
-  PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_BUCKET_CLEANUP();
-  return ret;
+  if (self->native != NULL) return prom_histogram_native_observe(self->native, value);
+  return 0;
 }
 
-static const char *prom_metric_sample_histogram_l_value_for_inf(prom_metric_sample_histogram_t *self, const char *name,
-                                                                size_t label_count, const char **label_keys,
-                                                                const char **label_values) {
+uint64_t prom_metric_sample_histogram_bucket_value(prom_metric_sample_histogram_t *self, size_t index) {
   PROM_ASSERT(self != NULL);
-  int r = 0;
-
-#define PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP() \
-  for (size_t i = 0; i < label_count + 1; i++) {               \
-    prom_free((char *)new_keys[i]);                            \
-    prom_free((char *)new_values[i]);                          \
-  }                                                            \
-  prom_free(new_keys);                                         \
-  prom_free(new_values);
-
-  // Make new array to hold label_keys with le label key
-  const char **new_keys = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_keys[i] = prom_strdup(label_keys[i]);
+  PROM_ASSERT(index <= self->bucket_count);
+  uint64_t value = 0;
+  for (size_t i = 0; i <= index; i++) {
+    value += atomic_load_explicit(&self->bucket_counts[i], memory_order_relaxed);
   }
-  new_keys[label_count] = prom_strdup("le");
-
-  // Make new array to hold label_values with le label value
-  const char **new_values = (const char **)prom_malloc((label_count + 1) * sizeof(char *));
-  for (size_t i = 0; i < label_count; i++) {
-    new_values[i] = prom_strdup(label_values[i]);
-  }
-
-  new_values[label_count] = prom_strdup("+Inf");
-
-  r = prom_metric_formatter_load_l_value(self->metric_formatter, name, NULL, label_count + 1, new_keys, new_values);
-  if (r) {
-    PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP()
-    return NULL;
-  }
-  const char *ret = (const char *)prom_metric_formatter_dump(self->metric_formatter);
-  PROM_METRIC_SAMPLE_HISTOGRAM_L_VALUE_FOR_INF_CLEANUP()
-  return ret;
-}
-
-static void prom_metric_sample_histogram_free_str_generic(void *gen) {
-  char *str = (char *)gen;
-  prom_free((void *)str);
-  str = NULL;
+  return value;
 }
 
 char *prom_metric_sample_histogram_bucket_to_str(double bucket) {
@@ -17,29 +17,68 @@
 #ifndef PROM_METRIC_HISTOGRAM_SAMPLE_I_H
 #define PROM_METRIC_HISTOGRAM_SAMPLE_I_H
 
+#include <stdint.h>
+
 // Public
 #include "prom_metric_sample_histogram.h"
 
 // Private
+#include "prom_arena_t.h"
 #include "prom_metric_sample_histogram_t.h"
 
 /**
  * @brief API PRIVATE Create a pointer to a prom_metric_sample_histogram_t
+ *
+ * If arena is not NULL, the sample and its prefixes are allocated from it and released when the arena is destroyed.
+ * The caller must serialize allocations from the arena.
  */
-prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(const char *name, prom_histogram_buckets_t *buckets,
-                                                                 size_t label_count, const char **label_keys,
-                                                                 const char **label_vales);
+prom_metric_sample_histogram_t *prom_metric_sample_histogram_new(prom_arena_t *arena, const char *name,
+                                                                 prom_histogram_buckets_t *buckets, size_t label_count,
+                                                                 const char **label_keys, const char **label_vales);
 
 /**
  * @brief API PRIVATE Destroy a prom_metric_sample_histogram_t
  */
 int prom_metric_sample_histogram_destroy(prom_metric_sample_histogram_t *self);
 
+/**
+ * @brief API PRIVATE Destroys a prom_metric_sample_histogram_t* allocated from arena and returns its memory to the
+ * arena, to be reused by a later sample of the same size. The label values belong to the metric.
+ */
+int prom_metric_sample_histogram_recycle(prom_metric_sample_histogram_t *self, prom_arena_t *arena);
+
 /**
  * @brief API PRIVATE Destroy a void pointer that is cast to a prom_metric_sample_histogram_t*
  */
 int prom_metric_sample_histogram_destroy_generic(void *gen);
 
+/**
+ * @brief API PRIVATE Returns the index of the first bucket whose upper bound is greater than or equal to value, or the
+ * bucket count if there is none. NaN is placed in the +Inf bucket.
+ */
+size_t prom_metric_sample_histogram_bucket_index(prom_metric_sample_histogram_t *self, double value);
+
+/**
+ * @brief API PRIVATE Returns the number of observations less than or equal to the upper bound of the bucket at the
+ * given index. An index equal to the bucket count refers to the +Inf bucket, whose value is the total count.
+ *
+ * Buckets are stored non-cumulatively, so this sums the buckets up to and including index.
+ */
+uint64_t prom_metric_sample_histogram_bucket_value(prom_metric_sample_histogram_t *self, size_t index);
+
+/**
+ * @brief API PRIVATE Returns the label block shared by the bucket prefixes and stores its length in len. The block is
+ * not null terminated.
+ */
+const char *prom_metric_sample_histogram_label_block(prom_metric_sample_histogram_t *self, size_t *len);
+
+/**
+ * @brief API PRIVATE Returns a piece of the rendered series prefixes and stores its length in len. Indexes up to and
+ * including the bucket count refer to the bucket suffixes that follow the label block, the last one being +Inf. The
+ * next two indexes refer to the count and sum prefixes. Pieces are not null terminated.
+ */
+const char *prom_metric_sample_histogram_prefix(prom_metric_sample_histogram_t *self, size_t index, size_t *len);
+
 char *prom_metric_sample_histogram_bucket_to_str(double bucket);
 
 void prom_metric_sample_histogram_free_generic(void *gen);
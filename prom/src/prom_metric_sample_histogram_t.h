@@ -14,26 +14,53 @@
  * limitations under the License.
  */
 
-#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
 #include "prom_metric_sample_histogram.h"
 
 // Private
-#include "prom_map_t.h"
-#include "prom_metric_formatter_t.h"
+#include "prom_exemplar_t.h"
+#include "prom_histogram_native_t.h"
 
 #ifndef PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 #define PROM_METRIC_HISTOGRAM_SAMPLE_T_H
 
+/**
+ * @brief API PRIVATE A histogram sample. Observations update flat arrays of atomic counters, so observing a classic
+ * histogram takes no lock and allocates nothing. Native histograms additionally update their sparse buckets under the
+ * lock of prom_histogram_native_t.
+ *
+ * The series prefixes are rendered once at construction into a single arena. Buckets share one label block and only
+ * store their le value:
+ *
+ *   name{labels,le="  5.0"} 10.0"} ... +Inf"} name_count{labels} name_sum{labels}
+ *
+ * prefix_offsets[i] is the offset of piece i within prefixes, where pieces 0 through bucket_count are the bucket
+ * suffixes (the last one being +Inf), followed by the count prefix, the sum prefix and finally the end of the arena.
+ * The label block spans the bytes before prefix_offsets[0]. The offsets and the characters share one allocation.
+ *
+ * The bucket counters follow the struct in the same allocation. When the sample belongs to a metric, both allocations
+ * are made from the metric's arena. The native buckets, like the exemplars, are allocated separately.
+ */
 struct prom_metric_sample_histogram {
-  prom_linked_list_t *l_value_list;
-  prom_map_t *l_values;
-  prom_map_t *samples;
-  prom_metric_formatter_t *metric_formatter;
-  prom_histogram_buckets_t *buckets;
-  pthread_rwlock_t *rwlock;
+  bool from_arena;                   /**< from_arena      True if the sample and its labels belong to a metric arena */
+  prom_histogram_buckets_t *buckets; /**< buckets         The upper bounds. Owned by the metric */
+  size_t bucket_count;               /**< bucket_count    The number of buckets excluding +Inf */
+  size_t *prefix_offsets;            /**< prefix_offsets  The offsets of each piece in prefixes */
+  const char *prefixes;              /**< prefixes        The rendered series prefixes */
+  _Atomic uint64_t *bucket_counts;   /**< bucket_counts   The non-cumulative count of each bucket and +Inf */
+  _Atomic double sum;                /**< sum             The sum of all observations */
+  const char **label_values;         /**< label_values    The label values or NULL if there are none */
+  double created;                    /**< created         The Unix time at which the sample was created in seconds */
+  prom_exemplar_t **exemplars;       /**< exemplars       The exemplar of each bucket. Guarded by the metric lock */
+  _Atomic bool touched;              /**< touched         Set by updates through label values and cleared by sweeps */
+  bool pinned;                       /**< pinned          True once handed out as a child. Guarded by the metric lock */
+  uint64_t idle_since;               /**< idle_since      The monotonic time of the last sweep that found it touched */
+  prom_histogram_native_t *native;   /**< native          The native buckets or NULL if the histogram has none */
 };
 
 #endif  // PROM_METRIC_HISTOGRAM_SAMPLE_T_H
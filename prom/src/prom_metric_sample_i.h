@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "prom_arena_t.h"
 #include "prom_metric_sample_t.h"
 #include "prom_metric_t.h"
 
@@ -29,11 +30,66 @@
  */
 prom_metric_sample_t *prom_metric_sample_new(prom_metric_type_t type, const char *l_value, double r_value);
 
+/**
+ * @brief API PRIVATE Return a sharded prom_metric_sample_t*
+ *
+ * Updates made via prom_metric_sample_add are spread across shard_count cache line padded slots, one chosen per thread,
+ * and summed by prom_metric_sample_value. Only prom_metric_sample_add is supported by sharded samples.
+ *
+ * @param type The type of metric sample
+ * @param l_value The entire left value of the metric e.g metric_name{foo="bar"}
+ * @param shard_count The number of shards. Must be a power of two no greater than PROM_METRIC_SAMPLE_MAX_SHARDS.
+ */
+prom_metric_sample_t *prom_metric_sample_new_sharded(prom_metric_type_t type, const char *l_value, size_t shard_count);
+
+/**
+ * @brief API PRIVATE Return a prom_metric_sample_t* allocated from arena
+ *
+ * The sample, its prefix and its shards are bump allocated from the arena and released when the arena is destroyed.
+ * prom_metric_sample_destroy only releases the memory the sample holds outside of the arena.
+ *
+ * @param arena The arena of the metric owning the sample. The caller must serialize allocations from it.
+ * @param type The type of metric sample
+ * @param l_value The entire left value of the metric e.g metric_name{foo="bar"}
+ * @param shard_count The number of shards or 0 for an unsharded sample. Must be a power of two no greater than
+ * PROM_METRIC_SAMPLE_MAX_SHARDS.
+ */
+prom_metric_sample_t *prom_metric_sample_new_from_arena(prom_arena_t *arena, prom_metric_type_t type,
+                                                        const char *l_value, size_t shard_count);
+
+/**
+ * @brief API PRIVATE Returns the number of CPUs rounded up to a power of two and capped at
+ * PROM_METRIC_SAMPLE_MAX_SHARDS. This is the shard count used by sharded metrics.
+ */
+size_t prom_metric_sample_default_shard_count(void);
+
+/**
+ * @brief API PRIVATE Returns the current Unix time in seconds. Used to timestamp sample creation and exemplars.
+ */
+double prom_metric_sample_now(void);
+
+/**
+ * @brief API PRIVATE Returns the current value of the sample, summing its shards if it is sharded
+ */
+double prom_metric_sample_value(prom_metric_sample_t *self);
+
+/**
+ * @brief API PRIVATE Sets a counter sample to an absolute value. Only meant for counters mirroring a total kept
+ * elsewhere, such as by the kernel, which never decreases on its own. Sharded samples are not supported.
+ */
+int prom_metric_sample_set_total(prom_metric_sample_t *self, double r_value);
+
 /**
  * @brief API PRIVATE Destroy the prom_metric_sample**
  */
 int prom_metric_sample_destroy(prom_metric_sample_t *self);
 
+/**
+ * @brief API PRIVATE Destroys a prom_metric_sample_t* allocated from arena and returns its memory to the arena, to be
+ * reused by a later sample of the same size. The label values belong to the metric.
+ */
+int prom_metric_sample_recycle(prom_metric_sample_t *self, prom_arena_t *arena);
+
 /**
  * @brief API PRIVATE A prom_linked_list_free_item_fn to enable item destruction within a linked list's destructor
  */
@@ -17,13 +17,43 @@
 #ifndef PROM_METRIC_SAMPLE_T_H
 #define PROM_METRIC_SAMPLE_T_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "prom_exemplar_t.h"
 #include "prom_metric_sample.h"
 #include "prom_metric_t.h"
 
+#define PROM_METRIC_SAMPLE_CACHE_LINE_SIZE 64
+
+/**
+ * @brief API PRIVATE The upper bound on the number of shards allocated for a sharded metric sample
+ */
+#define PROM_METRIC_SAMPLE_MAX_SHARDS 64
+
+/**
+ * @brief API PRIVATE A slot of a sharded metric sample. Each slot occupies its own cache line so that threads updating
+ * different slots do not contend.
+ */
+typedef struct prom_metric_sample_shard {
+  _Alignas(PROM_METRIC_SAMPLE_CACHE_LINE_SIZE) _Atomic double r_value; /**< r_value The partial value of the sample */
+} prom_metric_sample_shard_t;
+
 struct prom_metric_sample {
-  prom_metric_type_t type; /**< type is the metric type for the sample */
-  char *l_value;           /**< l_value is the full metric name and label set represeted as a string */
-  _Atomic double r_value;  /**< r_value is the value of the metric sample */
+  prom_metric_type_t type;            /**< type is the metric type for the sample */
+  bool from_arena;                    /**< from_arena is true if the sample and its labels belong to a metric arena */
+  char *prefix;                       /**< prefix is the l_value followed by a space. Stored after the struct */
+  size_t prefix_len;                  /**< prefix_len is the length of prefix */
+  _Atomic double r_value;             /**< r_value is the value of the metric sample */
+  size_t shard_count;                 /**< shard_count is the number of shards or 0 if the sample is not sharded */
+  prom_metric_sample_shard_t *shards; /**< shards are cache line aligned partial values summed on scrape */
+  void *shards_alloc;                 /**< shards_alloc is the allocation backing shards */
+  const char **label_values;          /**< label_values are the label values of the sample or NULL if it has none */
+  double created;                     /**< created is the Unix time at which the sample was created in seconds */
+  prom_exemplar_t *exemplar;          /**< exemplar is the most recent exemplar or NULL. Guarded by the metric lock */
+  _Atomic bool touched;               /**< touched is set by updates through label values and cleared by sweeps */
+  bool pinned;                        /**< pinned is true once the sample was handed out as a child. Metric lock */
+  uint64_t idle_since;                /**< idle_since is the monotonic time of the last sweep that found it touched */
 };
 
 #endif  // PROM_METRIC_SAMPLE_T_H
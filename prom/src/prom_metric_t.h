@@ -18,12 +18,17 @@
 #define PROM_METRIC_T_H
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // Public
 #include "prom_histogram_buckets.h"
 #include "prom_metric.h"
 
 // Private
+#include "prom_arena_t.h"
+#include "prom_intern_t.h"
 #include "prom_map_i.h"
 #include "prom_map_t.h"
 #include "prom_metric_formatter_t.h"
@@ -38,20 +43,56 @@ typedef enum prom_metric_type { PROM_COUNTER, PROM_GAUGE, PROM_HISTOGRAM, PROM_S
  */
 extern char *prom_metric_type_map[4];
 
+/**
+ * @brief API PRIVATE Counts the series created by the metrics of a registry against its series limit. Shared by every
+ * metric registered with the registry.
+ */
+typedef struct prom_series_budget {
+  _Atomic size_t max_series; /**< max_series The maximum number of series or 0 if unlimited */
+  _Atomic size_t series;     /**< series     The number of series created */
+} prom_series_budget_t;
+
+/**
+ * @brief API PRIVATE A series removed from a metric. Updates look a series up without a lock within an epoch critical
+ * section, so its sample is kept until every section that may have found it has ended, and then returned to the arena
+ * of the metric. Records are allocated from the arena too.
+ */
+typedef struct prom_metric_retired {
+  struct prom_metric_retired *next; /**< next          The series retired after this one */
+  void *sample;                     /**< sample        The prom_metric_sample_t* or prom_metric_sample_histogram_t* */
+  uint64_t retired_epoch;           /**< retired_epoch The epoch in which it was removed */
+} prom_metric_retired_t;
+
 /**
  * @brief API PRIVATE An opaque struct to users containing metric metadata; one or more metric samples; and a metric
  * formatter for locating metric samples and exporting metric data
  */
 struct prom_metric {
-  prom_metric_type_t type;            /**< metric_type      The type of metric */
-  const char *name;                   /**< name             The name of the metric */
-  const char *help;                   /**< help             The help output for the metric */
-  prom_map_t *samples;                /**< samples          Map comprised of samples for the given metric */
-  prom_histogram_buckets_t *buckets;  /**< buckets          Array of histogram bucket upper bound values */
-  size_t label_key_count;             /**< label_keys_count The count of labe_keys*/
-  prom_metric_formatter_t *formatter; /**< formatter        The metric formatter  */
-  pthread_rwlock_t *rwlock;           /**< rwlock           Required for locking on certain non-atomic operations */
-  const char **label_keys;            /**< labels           Array comprised of const char **/
+  prom_metric_type_t type;                /**< metric_type      The type of metric */
+  const char *name;                       /**< name             The name of the metric */
+  const char *help;                       /**< help             The help output for the metric */
+  prom_map_t *samples;                    /**< samples          Indexes the samples by the hash of their label values */
+  prom_histogram_buckets_t *buckets;      /**< buckets          Array of histogram bucket upper bound values */
+  bool native;                            /**< native           True if histogram samples keep native buckets */
+  int native_schema;                      /**< native_schema    The initial schema of native histogram samples */
+  size_t native_max_buckets;              /**< native_max_buckets The bucket count reducing the schema or 0 */
+  size_t label_key_count;                 /**< label_keys_count The count of labe_keys*/
+  prom_metric_formatter_t *formatter;     /**< formatter        The metric formatter  */
+  pthread_rwlock_t *rwlock;               /**< rwlock           Required for locking on certain non-atomic operations */
+  const char **label_keys;                /**< labels           Array comprised of interned const char **/
+  size_t shard_count;                     /**< shard_count      The number of shards per sample or 0 if not sharded */
+  prom_arena_t *arena;                    /**< arena            Backs the samples. Guarded by rwlock */
+  prom_intern_t *intern;                  /**< intern           Interns the label keys */
+  size_t max_series;                      /**< max_series       The maximum number of series or 0 if unlimited */
+  prom_series_overflow_t overflow;        /**< overflow         The policy for updates to series beyond the limit */
+  _Atomic size_t series_count;            /**< series_count     The number of series, excluding the overflow series */
+  _Atomic uint64_t series_rejected;       /**< series_rejected  The number of updates rejected by a series limit */
+  _Atomic(void *) overflow_sample;        /**< overflow_sample  The sample of the overflow series or NULL */
+  _Atomic(prom_series_budget_t *) budget; /**< budget           The budget of the registry or NULL if unregistered */
+  _Atomic uint64_t series_ttl;            /**< series_ttl       Nanoseconds after which idle series expire or 0 */
+  prom_metric_retired_t *retired;         /**< retired          The series removed the longest ago. Guarded by rwlock */
+  prom_metric_retired_t *retired_tail;    /**< retired_tail     The series removed most recently */
+  _Atomic size_t retired_count;           /**< retired_count    The number of retired series */
 };
 
 #endif  // PROM_METRIC_T_H
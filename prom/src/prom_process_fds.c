@@ -15,10 +15,20 @@
  */
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#endif
+
 // Public
 #include "prom_alloc.h"
 #include "prom_gauge.h"
@@ -26,11 +36,92 @@
 // Private
 #include "prom_errors.h"
 #include "prom_log.h"
+#include "prom_process_fds_i.h"
 #include "prom_process_fds_t.h"
 
+#ifdef __linux__
+#ifndef PROC_SUPER_MAGIC
+#define PROC_SUPER_MAGIC 0x9fa0
+#endif
+
+// The layout of the records filled in by the getdents64 system call
+struct prom_process_fds_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+#endif
+
 prom_gauge_t *prom_process_open_fds;
 
-int prom_process_fds_count(const char *path) {
+static bool prom_process_fds_is_dot(const char *name) {
+  return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+int prom_process_fds_count_stat(const char *path) {
+#ifdef __linux__
+  struct stat st;
+  if (stat(path ? path : PROM_PROCESS_FDS_SELF_PATH, &st) || !S_ISDIR(st.st_mode) || st.st_size <= 0) return -1;
+
+  // Other file systems report the size of the directory itself, which is not an entry count
+  struct statfs sfs;
+  if (statfs(path ? path : PROM_PROCESS_FDS_SELF_PATH, &sfs) || sfs.f_type != PROC_SUPER_MAGIC) return -1;
+  return (int)st.st_size;
+#else
+  (void)path;
+  return -1;
+#endif
+}
+
+int prom_process_fds_count_getdents(const char *path) {
+#ifdef __linux__
+  int fd = open(path ? path : PROM_PROCESS_FDS_SELF_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    PROM_LOG(PROM_STDIO_OPEN_DIR_ERROR);
+    return -1;
+  }
+  char *buf = (char *)prom_malloc(PROM_PROCESS_FDS_DIRENT_BUF_SIZE);
+  if (buf == NULL) {
+    close(fd);
+    return -1;
+  }
+
+  // Scanning our own descriptor table lists the descriptor doing the scan, which is not counted
+  char self_name[16] = "";
+  if (path == NULL) snprintf(self_name, sizeof(self_name), "%d", fd);
+
+  int count = 0;
+  for (;;) {
+    long n = syscall(SYS_getdents64, fd, buf, PROM_PROCESS_FDS_DIRENT_BUF_SIZE);
+    if (n < 0) {
+      count = -1;
+      break;
+    }
+    if (n == 0) break;
+    for (long i = 0; i < n;) {
+      struct prom_process_fds_dirent64 *de = (struct prom_process_fds_dirent64 *)(buf + i);
+      i += de->d_reclen;
+      if (prom_process_fds_is_dot(de->d_name) || strcmp(self_name, de->d_name) == 0) continue;
+      count++;
+    }
+  }
+
+  prom_free(buf);
+  buf = NULL;
+  if (close(fd)) {
+    PROM_LOG(PROM_STDIO_CLOSE_DIR_ERROR);
+    return -1;
+  }
+  return count;
+#else
+  (void)path;
+  return -1;
+#endif
+}
+
+int prom_process_fds_count_readdir(const char *path) {
   int count = 0;
   int r = 0;
   struct dirent *de;
@@ -52,8 +143,12 @@ int prom_process_fds_count(const char *path) {
     }
   }
 
+  // Scanning our own descriptor table lists the descriptor doing the scan, which is not counted
+  char self_name[16] = "";
+  if (path == NULL) snprintf(self_name, sizeof(self_name), "%d", dirfd(d));
+
   while ((de = readdir(d)) != NULL) {
-    if (strcmp(".", de->d_name) == 0 || strcmp("..", de->d_name) == 0) {
+    if (prom_process_fds_is_dot(de->d_name) || strcmp(self_name, de->d_name) == 0) {
       continue;
     }
     count++;
@@ -66,6 +161,14 @@ int prom_process_fds_count(const char *path) {
   return count;
 }
 
+int prom_process_fds_count(const char *path) {
+  int count = prom_process_fds_count_stat(path);
+  if (count >= 0) return count;
+  count = prom_process_fds_count_getdents(path);
+  if (count >= 0) return count;
+  return prom_process_fds_count_readdir(path);
+}
+
 int prom_process_fds_init(void) {
   prom_process_open_fds = prom_gauge_new("process_open_fds", "Number of open file descriptors.", 0, NULL);
   return 0;
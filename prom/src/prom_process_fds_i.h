@@ -17,7 +17,30 @@
 #ifndef PROM_PROESS_FDS_I_INCLUDED
 #define PROM_PROESS_FDS_I_INCLUDED
 
+/**
+ * @brief API PRIVATE Returns the number of open file descriptors listed in the fd directory at path, or in that of the
+ * calling process if path is NULL. The cheapest method available is used: the directory size reported by stat, then a
+ * getdents64 scan, then readdir. Returns -1 upon failure.
+ */
 int prom_process_fds_count(const char *path);
+
+/**
+ * @brief API PRIVATE Returns the entry count that Linux 6.2 and later report as the size of a /proc/[pid]/fd directory.
+ * This costs the same for any number of descriptors. Returns -1 if the kernel or file system does not report it.
+ */
+int prom_process_fds_count_stat(const char *path);
+
+/**
+ * @brief API PRIVATE Counts the entries of the directory at path by reading them with getdents64 in batches of
+ * PROM_PROCESS_FDS_DIRENT_BUF_SIZE bytes. Returns -1 upon failure or where getdents64 is unavailable.
+ */
+int prom_process_fds_count_getdents(const char *path);
+
+/**
+ * @brief API PRIVATE Counts the entries of the directory at path with readdir. Returns -1 upon failure.
+ */
+int prom_process_fds_count_readdir(const char *path);
+
 int prom_process_fds_init(void);
 
 #endif  // PROM_PROESS_FDS_I_INCLUDED
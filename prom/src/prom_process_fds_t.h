@@ -19,6 +19,9 @@
 #ifndef PROM_PROESS_FDS_T_H
 #define PROM_PROESS_FDS_T_H
 
+#define PROM_PROCESS_FDS_SELF_PATH "/proc/self/fd"
+#define PROM_PROCESS_FDS_DIRENT_BUF_SIZE 65536
+
 extern prom_gauge_t *prom_process_open_fds;
 
 #endif  // PROM_PROESS_FDS_T_H
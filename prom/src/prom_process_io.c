@@ -0,0 +1,72 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+// Public
+#include "prom_counter.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_process_io_i.h"
+#include "prom_process_io_t.h"
+#include "prom_procfs_i.h"
+
+prom_counter_t *prom_process_io_read_bytes_total;
+prom_counter_t *prom_process_io_write_bytes_total;
+prom_counter_t *prom_process_io_storage_read_bytes_total;
+prom_counter_t *prom_process_io_storage_write_bytes_total;
+
+int prom_process_io_parse(prom_process_io_t *self, prom_process_io_file_t *io_f) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  r = prom_procfs_buf_value(io_f, "rchar", &self->rchar);
+  if (r) return r;
+
+  r = prom_procfs_buf_value(io_f, "wchar", &self->wchar);
+  if (r) return r;
+
+  r = prom_procfs_buf_value(io_f, "read_bytes", &self->read_bytes);
+  if (r) return r;
+
+  return prom_procfs_buf_value(io_f, "write_bytes", &self->write_bytes);
+}
+
+/**
+ * @brief Initializes each counter metric
+ */
+int prom_process_io_init(void) {
+  // /proc/[pid]/io rchar
+  prom_process_io_read_bytes_total = prom_counter_new(
+      "process_io_read_bytes_total", "Total bytes read by the process, including from the page cache.", 0, NULL);
+
+  // /proc/[pid]/io wchar
+  prom_process_io_write_bytes_total = prom_counter_new(
+      "process_io_write_bytes_total", "Total bytes written by the process, including to the page cache.", 0, NULL);
+
+  // /proc/[pid]/io read_bytes
+  prom_process_io_storage_read_bytes_total =
+      prom_counter_new("process_io_storage_read_bytes_total",
+                       "Total bytes the process caused to be read from storage.", 0, NULL);
+
+  // /proc/[pid]/io write_bytes
+  prom_process_io_storage_write_bytes_total =
+      prom_counter_new("process_io_storage_write_bytes_total",
+                       "Total bytes the process caused to be written to storage.", 0, NULL);
+  return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_PROCESS_IO_T_H
+#define PROM_PROCESS_IO_T_H
+
+#include <stdint.h>
+
+#include "prom_counter.h"
+#include "prom_procfs_t.h"
+
+extern prom_counter_t *prom_process_io_read_bytes_total;
+extern prom_counter_t *prom_process_io_write_bytes_total;
+extern prom_counter_t *prom_process_io_storage_read_bytes_total;
+extern prom_counter_t *prom_process_io_storage_write_bytes_total;
+
+/**
+ * @brief The fields of /proc/[pid]/io exported by the process collector. Refer to man proc and search for
+ * /proc/[pid]/io
+ */
+typedef struct prom_process_io {
+  uint64_t rchar;
+  uint64_t wchar;
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+} prom_process_io_t;
+
+typedef prom_procfs_buf_t prom_process_io_file_t;
+
+#endif  // PROM_PROCESS_IO_T_H
@@ -16,9 +16,13 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 // Public
@@ -27,6 +31,7 @@
 
 // Private
 #include "prom_assert.h"
+#include "prom_log.h"
 #include "prom_map_i.h"
 #include "prom_process_limits_i.h"
 #include "prom_process_limits_t.h"
@@ -430,6 +435,77 @@ bool prom_process_limits_rdp_match(prom_process_limits_file_t *f, const char *to
   return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scanner
+
+int prom_process_limits_soft(prom_process_limits_file_t *f, const char *limit, double *soft) {
+  PROM_ASSERT(f != NULL);
+  size_t limit_len = strlen(limit);
+
+  // Limit names are separated from the soft limit by at least two spaces, which tells "Max realtime priority" apart
+  // from a limit named "Max realtime"
+  for (const char *line = f->buf; line != NULL && *line != '\0'; line = strchr(line, '\n')) {
+    if (*line == '\n') line++;
+    if (strncmp(line, limit, limit_len) != 0 || line[limit_len] != ' ' || line[limit_len + 1] != ' ') continue;
+
+    const char *c = line + limit_len;
+    while (*c == ' ') c++;
+    if (strncmp(c, PROM_PROCESS_LIMITS_RDP_UNLIMITED, strlen(PROM_PROCESS_LIMITS_RDP_UNLIMITED)) == 0) {
+      *soft = -1;
+      return 0;
+    }
+    if (*c < '0' || *c > '9') return 1;
+    uint64_t value = 0;
+    for (; *c >= '0' && *c <= '9'; c++) value = value * 10 + (uint64_t)(*c - '0');
+    *soft = (double)value;
+    return 0;
+  }
+  return 1;
+}
+
+static int prom_process_limits_rlimit(int resource, double *soft) {
+  struct rlimit limit;
+  if (getrlimit(resource, &limit)) {
+    PROM_LOG("failed to get the resource limit");
+    return 1;
+  }
+  *soft = (limit.rlim_cur == RLIM_INFINITY) ? -1.0 : (double)limit.rlim_cur;
+  return 0;
+}
+
+static uint64_t prom_process_limits_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+int prom_process_limits_load(prom_process_limits_values_t *self, prom_process_limits_file_t *f) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  if (f == NULL) {
+    r = prom_process_limits_rlimit(RLIMIT_NOFILE, &self->max_fds);
+    if (r) return r;
+    return prom_process_limits_rlimit(RLIMIT_AS, &self->virtual_memory_max_bytes);
+  }
+
+  uint64_t now = prom_process_limits_now();
+  if (self->loaded_at != 0 && now - self->loaded_at < PROM_PROCESS_LIMITS_REFRESH_INTERVAL_NS) return 0;
+
+  r = prom_procfs_buf_read(f);
+  if (r) return r;
+
+  r = prom_process_limits_soft(f, "Max open files", &self->max_fds);
+  if (r) return r;
+
+  r = prom_process_limits_soft(f, "Max address space", &self->virtual_memory_max_bytes);
+  if (r) return r;
+
+  self->loaded_at = now;
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
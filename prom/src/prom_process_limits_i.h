@@ -70,6 +70,19 @@ bool prom_process_limits_rdp_units(prom_process_limits_file_t *f, prom_map_t *da
 int prom_process_limits_rdp_next_token(prom_process_limits_file_t *f);
 bool prom_process_limits_rdp_match(prom_process_limits_file_t *f, const char *token);
 
+/**
+ * @brief Scans the contents of f for the row of the given limit and stores its soft limit in soft, or -1 if it is
+ * unlimited. Unlike prom_process_limits, nothing is allocated. Returns non-zero if the row is missing.
+ */
+int prom_process_limits_soft(prom_process_limits_file_t *f, const char *limit, double *soft);
+
+/**
+ * @brief Loads the soft limits exported by the process collector into self. If f is NULL, the limits of the calling
+ * process are queried with getrlimit, which costs a system call and nothing else. Otherwise f is read and scanned, at
+ * most once per PROM_PROCESS_LIMITS_REFRESH_INTERVAL_NS.
+ */
+int prom_process_limits_load(prom_process_limits_values_t *self, prom_process_limits_file_t *f);
+
 int prom_process_limits_init(void);
 
 #endif  // PROM_PROCESS_I_H
@@ -17,6 +17,8 @@
 #ifndef PROM_PROCESS_T_H
 #define PROM_PROCESS_T_H
 
+#include <stdint.h>
+
 #include "prom_gauge.h"
 #include "prom_procfs_t.h"
 
@@ -40,4 +42,19 @@ typedef struct prom_process_limits_current_row {
 
 typedef prom_procfs_buf_t prom_process_limits_file_t;
 
+/**
+ * @brief The interval in nanoseconds at which limits read from a file are refreshed. Limits rarely change, so they are
+ * not read again on every collection.
+ */
+#define PROM_PROCESS_LIMITS_REFRESH_INTERVAL_NS 60000000000ULL
+
+/**
+ * @brief The soft limits exported by the process collector. -1 stands for unlimited.
+ */
+typedef struct prom_process_limits_values {
+  double max_fds;                  /**< max_fds                  The soft limit of Max open files */
+  double virtual_memory_max_bytes; /**< virtual_memory_max_bytes The soft limit of Max address space */
+  uint64_t loaded_at;              /**< loaded_at                The monotonic time of the last file read or 0 */
+} prom_process_limits_values_t;
+
 #endif  // PROM_PROCESS_T_H
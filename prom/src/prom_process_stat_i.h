@@ -21,8 +21,19 @@
 
 prom_process_stat_file_t *prom_process_stat_file_new(const char *path);
 int prom_process_stat_file_destroy(prom_process_stat_file_t *self);
-prom_process_stat_t *prom_process_stat_new(prom_process_stat_file_t *stat_f);
-int prom_process_stat_destroy(prom_process_stat_t *self);
+
+/**
+ * @brief Scans the contents of stat_f for the fields of prom_process_stat_t. Only those fields are parsed; the others
+ * are skipped. Returns non-zero if the contents end before the last of them.
+ */
+int prom_process_stat_parse(prom_process_stat_t *self, prom_process_stat_file_t *stat_f);
+
+/**
+ * @brief Copies the command name of field 2 of stat_f, without its parentheses, into comm. Returns non-zero if the
+ * contents hold no command name.
+ */
+int prom_process_stat_comm(prom_process_stat_file_t *stat_f, char comm[PROM_PROCESS_STAT_COMM_SIZE]);
+
 int prom_process_stats_init(void);
 
 #endif  // PROM_PROCESS_STATS_I_H
@@ -0,0 +1,49 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+// Public
+#include "prom_counter.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_process_status_i.h"
+#include "prom_process_status_t.h"
+#include "prom_procfs_i.h"
+
+prom_counter_t *prom_process_context_switches_total;
+
+int prom_process_status_parse(prom_process_status_t *self, prom_process_status_file_t *status_f) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int r = 0;
+  r = prom_procfs_buf_value(status_f, "voluntary_ctxt_switches", &self->voluntary_ctxt_switches);
+  if (r) return r;
+  return prom_procfs_buf_value(status_f, "nonvoluntary_ctxt_switches", &self->nonvoluntary_ctxt_switches);
+}
+
+/**
+ * @brief Initializes each counter metric
+ */
+int prom_process_status_init(void) {
+  // /proc/[pid]/status voluntary_ctxt_switches and nonvoluntary_ctxt_switches
+  prom_process_context_switches_total =
+      prom_counter_new("process_context_switches_total", "Total context switches of the threads of the process.", 1,
+                       (const char *[]){"type"});
+  return 0;
+}
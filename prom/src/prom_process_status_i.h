@@ -0,0 +1,29 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_PROCESS_STATUS_I_H
+#define PROM_PROCESS_STATUS_I_H
+
+#include "prom_process_status_t.h"
+
+/**
+ * @brief Scans the contents of status_f for the fields of prom_process_status_t. Returns non-zero if one is missing.
+ */
+int prom_process_status_parse(prom_process_status_t *self, prom_process_status_file_t *status_f);
+
+int prom_process_status_init(void);
+
+#endif  // PROM_PROCESS_STATUS_I_H
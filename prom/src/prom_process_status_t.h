@@ -0,0 +1,38 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_PROCESS_STATUS_T_H
+#define PROM_PROCESS_STATUS_T_H
+
+#include <stdint.h>
+
+#include "prom_counter.h"
+#include "prom_procfs_t.h"
+
+extern prom_counter_t *prom_process_context_switches_total;
+
+/**
+ * @brief The fields of /proc/[pid]/status exported by the process collector. Refer to man proc and search for
+ * /proc/[pid]/status
+ */
+typedef struct prom_process_status {
+  uint64_t voluntary_ctxt_switches;
+  uint64_t nonvoluntary_ctxt_switches;
+} prom_process_status_t;
+
+typedef prom_procfs_buf_t prom_process_status_file_t;
+
+#endif  // PROM_PROCESS_STATUS_T_H
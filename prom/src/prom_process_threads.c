@@ -0,0 +1,253 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Public
+#include "prom_alloc.h"
+#include "prom_counter.h"
+
+// Private
+#include "prom_assert.h"
+#include "prom_counter_i.h"
+#include "prom_errors.h"
+#include "prom_log.h"
+#include "prom_process_stat_i.h"
+#include "prom_process_threads_i.h"
+#include "prom_process_threads_t.h"
+#include "prom_procfs_i.h"
+
+prom_counter_t *prom_process_thread_cpu_seconds_total;
+
+prom_process_threads_t *prom_process_threads_new(const char *path) {
+  prom_process_threads_t *self = (prom_process_threads_t *)prom_malloc(sizeof(prom_process_threads_t));
+  if (self == NULL) return NULL;
+  self->names = NULL;
+  self->count = 0;
+  self->capacity = 0;
+  self->tasks = NULL;
+  self->task_count = 0;
+  self->task_capacity = 0;
+  self->buf = NULL;
+  self->dir = opendir(path);
+  if (self->dir == NULL) {
+    PROM_LOG(PROM_STDIO_OPEN_DIR_ERROR);
+    prom_process_threads_destroy(self);
+    return NULL;
+  }
+  self->buf = prom_procfs_buf_open(NULL);
+  if (self->buf == NULL) {
+    prom_process_threads_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+int prom_process_threads_destroy(prom_process_threads_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 0;
+
+  int r = 0;
+  if (self->dir != NULL && closedir(self->dir)) {
+    PROM_LOG(PROM_STDIO_CLOSE_DIR_ERROR);
+    r = 1;
+  }
+  self->dir = NULL;
+  if (self->buf != NULL) {
+    int rr = prom_procfs_buf_destroy(self->buf);
+    if (rr) r = rr;
+  }
+  self->buf = NULL;
+  prom_free(self->names);
+  self->names = NULL;
+  prom_free(self->tasks);
+  self->tasks = NULL;
+  prom_free(self);
+  self = NULL;
+  return r;
+}
+
+/**
+ * @brief Returns the index of the entry for name, adding it if it is new. Once PROM_PROCESS_THREADS_MAX_NAMES names
+ * are known, further ones map to the overflow entry. Returns SIZE_MAX upon allocation failure.
+ */
+static size_t prom_process_threads_name(prom_process_threads_t *self, const char *name) {
+  if (self->count >= PROM_PROCESS_THREADS_MAX_NAMES) name = PROM_PROCESS_THREADS_OVERFLOW_NAME;
+  for (size_t i = 0; i < self->count; i++) {
+    if (strcmp(self->names[i].name, name) == 0) return i;
+  }
+  if (self->count == self->capacity) {
+    size_t capacity = (self->capacity == 0) ? 8 : self->capacity * 2;
+    prom_process_threads_name_t *names =
+        (prom_process_threads_name_t *)prom_realloc(self->names, capacity * sizeof(prom_process_threads_name_t));
+    if (names == NULL) return SIZE_MAX;
+    self->names = names;
+    self->capacity = capacity;
+  }
+  prom_process_threads_name_t *entry = &self->names[self->count];
+  strcpy(entry->name, name);
+  entry->exited = 0.0;
+  entry->seconds = 0.0;
+  return self->count++;
+}
+
+/**
+ * @brief Returns the task with the given id among the first count tasks, which are sorted by id, or NULL
+ */
+static prom_process_threads_task_t *prom_process_threads_task_find(prom_process_threads_t *self, size_t count,
+                                                                   pid_t tid) {
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->tasks[mid].tid == tid) return &self->tasks[mid];
+    if (self->tasks[mid].tid < tid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Appends a task for a thread not found by previous updates. Returns NULL upon allocation failure.
+ */
+static prom_process_threads_task_t *prom_process_threads_task_add(prom_process_threads_t *self) {
+  if (self->task_count == self->task_capacity) {
+    size_t capacity = (self->task_capacity == 0) ? 8 : self->task_capacity * 2;
+    prom_process_threads_task_t *tasks =
+        (prom_process_threads_task_t *)prom_realloc(self->tasks, capacity * sizeof(prom_process_threads_task_t));
+    if (tasks == NULL) return NULL;
+    self->tasks = tasks;
+    self->task_capacity = capacity;
+  }
+  return &self->tasks[self->task_count++];
+}
+
+static int prom_process_threads_task_compare(const void *a, const void *b) {
+  pid_t tid_a = ((const prom_process_threads_task_t *)a)->tid;
+  pid_t tid_b = ((const prom_process_threads_task_t *)b)->tid;
+  return (tid_a > tid_b) - (tid_a < tid_b);
+}
+
+/**
+ * @brief Moves the CPU time a task has accumulated under its current name to the exited time of that name
+ */
+static void prom_process_threads_task_retire(prom_process_threads_t *self, prom_process_threads_task_t *task) {
+  self->names[task->name].exited += task->seconds - task->offset;
+  task->offset = task->seconds;
+}
+
+int prom_process_threads_update(prom_process_threads_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  // Tasks added by this update are appended past the sorted ones and only sorted in once it is done
+  size_t sorted_count = self->task_count;
+  for (size_t i = 0; i < self->task_count; i++) self->tasks[i].seen = false;
+
+  double ticks_per_second = (double)sysconf(_SC_CLK_TCK);
+  char path[NAME_MAX + sizeof("/stat")];
+  rewinddir(self->dir);
+  struct dirent *de;
+  while ((de = readdir(self->dir)) != NULL) {
+    if (de->d_name[0] == '.') continue;
+    snprintf(path, sizeof(path), "%s/stat", de->d_name);
+    if (prom_procfs_buf_read_at(self->buf, dirfd(self->dir), path)) continue;
+
+    prom_process_stat_t stat;
+    char comm[PROM_PROCESS_STAT_COMM_SIZE];
+    if (prom_process_stat_parse(&stat, self->buf) || prom_process_stat_comm(self->buf, comm)) continue;
+
+    // Label values are exposed as they are, so characters that would end or escape them are replaced
+    for (char *c = comm; *c != '\0'; c++) {
+      if (*c == '"' || *c == '\\' || *c == '\n') *c = '_';
+    }
+
+    size_t name = prom_process_threads_name(self, comm);
+    if (name == SIZE_MAX) return 1;
+    double seconds = (double)(stat.utime + stat.stime) / ticks_per_second;
+
+    pid_t tid = (pid_t)atoi(de->d_name);
+    prom_process_threads_task_t *task = prom_process_threads_task_find(self, sorted_count, tid);
+    if (task != NULL && task->starttime != stat.starttime) {
+      // The id was reused by a new thread after the previous one exited
+      prom_process_threads_task_retire(self, task);
+      task->offset = 0.0;
+      task->name = name;
+    } else if (task != NULL && task->name != name) {
+      // The thread was renamed. Its CPU time so far stays counted under the former name.
+      task->seconds = seconds;
+      prom_process_threads_task_retire(self, task);
+      task->name = name;
+    } else if (task == NULL) {
+      task = prom_process_threads_task_add(self);
+      if (task == NULL) return 1;
+      task->tid = tid;
+      task->name = name;
+      task->offset = 0.0;
+    }
+    task->starttime = stat.starttime;
+    task->seconds = seconds;
+    task->seen = true;
+  }
+
+  // The CPU time of threads that exited stays counted under their name
+  size_t task_count = 0;
+  for (size_t i = 0; i < self->task_count; i++) {
+    prom_process_threads_task_t *task = &self->tasks[i];
+    if (!task->seen) {
+      prom_process_threads_task_retire(self, task);
+      continue;
+    }
+    self->tasks[task_count++] = *task;
+  }
+  self->task_count = task_count;
+  qsort(self->tasks, self->task_count, sizeof(prom_process_threads_task_t), prom_process_threads_task_compare);
+
+  for (size_t i = 0; i < self->count; i++) self->names[i].seconds = self->names[i].exited;
+  for (size_t i = 0; i < self->task_count; i++) {
+    prom_process_threads_task_t *task = &self->tasks[i];
+    self->names[task->name].seconds += task->seconds - task->offset;
+  }
+  for (size_t i = 0; i < self->count; i++) {
+    prom_process_threads_name_t *entry = &self->names[i];
+    int r = prom_counter_set_total(prom_process_thread_cpu_seconds_total, entry->seconds,
+                                   (const char *[]){entry->name});
+    if (r) return r;
+  }
+  return 0;
+}
+
+/**
+ * @brief Initializes each counter metric
+ */
+int prom_process_threads_init(void) {
+  // /proc/[pid]/task/[tid]/stat utime + stime / ticks per second
+  prom_process_thread_cpu_seconds_total =
+      prom_counter_new("process_thread_cpu_seconds_total",
+                       "Total user and system CPU time spent in seconds by the threads of a name.", 1,
+                       (const char *[]){"thread"});
+  return 0;
+}
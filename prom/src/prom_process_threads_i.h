@@ -0,0 +1,42 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_PROCESS_THREADS_I_H
+#define PROM_PROCESS_THREADS_I_H
+
+#include "prom_process_threads_t.h"
+
+/**
+ * @brief API PRIVATE Opens the task directory at path, e.g. /proc/self/task. Returns NULL upon failure.
+ */
+prom_process_threads_t *prom_process_threads_new(const char *path);
+
+/**
+ * @brief API PRIVATE Closes the task directory and destroys the threads
+ */
+int prom_process_threads_destroy(prom_process_threads_t *self);
+
+/**
+ * @brief API PRIVATE Reads the stat file of every thread and sets prom_process_thread_cpu_seconds_total to the CPU
+ * time of the threads of each name. Threads are grouped by name, and at most PROM_PROCESS_THREADS_MAX_NAMES names get
+ * a series of their own. The CPU time of a thread that exits or is renamed stays counted under its former name, so
+ * totals never decrease. Threads that exit during the update are skipped.
+ */
+int prom_process_threads_update(prom_process_threads_t *self);
+
+int prom_process_threads_init(void);
+
+#endif  // PROM_PROCESS_THREADS_I_H
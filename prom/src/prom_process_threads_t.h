@@ -0,0 +1,76 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROM_PROCESS_THREADS_T_H
+#define PROM_PROCESS_THREADS_T_H
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "prom_counter.h"
+#include "prom_process_stat_t.h"
+#include "prom_procfs_t.h"
+
+extern prom_counter_t *prom_process_thread_cpu_seconds_total;
+
+/**
+ * @brief API PRIVATE The maximum number of thread names with a series of their own. Threads of any further name are
+ * counted under PROM_PROCESS_THREADS_OVERFLOW_NAME, so names that embed an id cannot create a series per thread.
+ */
+#define PROM_PROCESS_THREADS_MAX_NAMES 64
+#define PROM_PROCESS_THREADS_OVERFLOW_NAME "__overflow__"
+
+/**
+ * @brief API PRIVATE The CPU time of the threads that share a name. Names are kept once found so that their totals
+ * never decrease.
+ */
+typedef struct prom_process_threads_name {
+  char name[PROM_PROCESS_STAT_COMM_SIZE]; /**< name    The thread name, which is the label value of its series */
+  double exited;                          /**< exited  The CPU time of threads that exited or were renamed since */
+  double seconds;                         /**< seconds The total as of the last update, including exited */
+} prom_process_threads_name_t;
+
+/**
+ * @brief API PRIVATE A thread found by the last update. A thread whose id is reused is told apart by its start time.
+ */
+typedef struct prom_process_threads_task {
+  pid_t tid;          /**< tid       The thread id */
+  uint64_t starttime; /**< starttime The start time of the thread in clock ticks after boot */
+  size_t name;        /**< name      The index of the name the thread is counted under */
+  double seconds;     /**< seconds   The CPU time of the thread */
+  double offset;      /**< offset    The part of seconds counted under the names the thread had before */
+  bool seen;          /**< seen      Whether the thread was found by the current update */
+} prom_process_threads_task_t;
+
+/**
+ * @brief API PRIVATE Reads the CPU time of every thread from the task directory of a process. The directory and the
+ * buffer for the stat files of the threads are reused by every update.
+ */
+typedef struct prom_process_threads {
+  DIR *dir;                           /**< dir           The open /proc/[pid]/task directory */
+  prom_procfs_buf_t *buf;             /**< buf           The buffer the stat file of each thread is read into */
+  prom_process_threads_name_t *names; /**< names         Every thread name found so far */
+  size_t count;                       /**< count         The number of names */
+  size_t capacity;                    /**< capacity      The number of names allocated */
+  prom_process_threads_task_t *tasks; /**< tasks         The threads found by the last update, sorted by id */
+  size_t task_count;                  /**< task_count    The number of threads */
+  size_t task_capacity;               /**< task_capacity The number of threads allocated */
+} prom_process_threads_t;
+
+#endif  // PROM_PROCESS_THREADS_T_H
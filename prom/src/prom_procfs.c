@@ -15,10 +15,13 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 // Public
 #include "prom_alloc.h"
@@ -28,72 +31,136 @@
 #include "prom_log.h"
 #include "prom_procfs_i.h"
 
-static int prom_procfs_ensure_buf_size(prom_procfs_buf_t *self) {
-  PROM_ASSERT(self != NULL);
-  if (self->allocated >= self->size + 1) return 0;
-  while (self->allocated < self->size + 1) self->allocated <<= 1;
-  self->buf = (char *)prom_realloc(self->buf, self->allocated);
-  return 0;
+static void prom_procfs_log_errno(void) {
+  char errbuf[100];
+  strerror_r(errno, errbuf, sizeof(errbuf));
+  PROM_LOG(errbuf);
 }
 
-prom_procfs_buf_t *prom_procfs_buf_new(const char *path) {
-  int r = 0;
-
-  FILE *f = fopen(path, "r");
-  char errbuf[100];
+prom_procfs_buf_t *prom_procfs_buf_open(const char *path) {
+  int fd = -1;
+  if (path != NULL) {
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      prom_procfs_log_errno();
+      return NULL;
+    }
+  }
 
-  if (f == NULL) {
-    strerror_r(errno, errbuf, 100);
-    PROM_LOG(errbuf);
+  prom_procfs_buf_t *self = (prom_procfs_buf_t *)prom_malloc(sizeof(prom_procfs_buf_t));
+  if (self == NULL) {
+    if (fd >= 0) close(fd);
+    return NULL;
+  }
+  self->buf = (char *)prom_malloc(PROM_PROCFS_BUF_INITIAL_SIZE);
+  if (self->buf == NULL) {
+    if (fd >= 0) close(fd);
+    prom_free(self);
     return NULL;
   }
+  self->buf[0] = '\0';
+  self->size = 1;
+  self->index = 0;
+  self->allocated = PROM_PROCFS_BUF_INITIAL_SIZE;
+  self->fd = fd;
+  return self;
+}
 
-#define PROM_PROCFS_BUF_NEW_HANDLE_F_CLOSE(f) \
-  r = fclose(f);                              \
-  if (r) {                                    \
-    strerror_r(errno, errbuf, 100);           \
-    PROM_LOG(errbuf);                         \
+prom_procfs_buf_t *prom_procfs_buf_new(const char *path) {
+  prom_procfs_buf_t *self = prom_procfs_buf_open(path);
+  if (self == NULL) return NULL;
+  if (prom_procfs_buf_read(self)) {
+    prom_procfs_buf_destroy(self);
+    return NULL;
   }
+  return self;
+}
 
-  unsigned short int initial_size = 32;
-  prom_procfs_buf_t *self = prom_malloc(sizeof(prom_procfs_buf_t));
-  self->buf = prom_malloc(initial_size);
-  self->size = 0;
-  self->index = 0;
-  self->allocated = initial_size;
-
-  for (int current_char = getc(f), i = 0; current_char != EOF; current_char = getc(f), i++) {
-    r = prom_procfs_ensure_buf_size(self);
-    if (r) {
-      prom_procfs_buf_destroy(self);
-      self = NULL;
-      PROM_PROCFS_BUF_NEW_HANDLE_F_CLOSE(f);
-      return NULL;
+/**
+ * @brief Reads the contents of fd from its start into the buffer of self
+ */
+static int prom_procfs_buf_pread(prom_procfs_buf_t *self, int fd) {
+  size_t len = 0;
+  for (;;) {
+    // One byte is kept for the terminating null byte. procfs fills the whole buffer unless it reached the end of the
+    // file, so a short read holds the complete contents.
+    ssize_t n = pread(fd, self->buf, self->allocated - 1, 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      prom_procfs_log_errno();
+      return 1;
     }
-    self->buf[i] = current_char;
-    self->size++;
+    len = (size_t)n;
+    if (len < self->allocated - 1) break;
+
+    // The contents did not fit. Grow the buffer and read them again from the start, since procfs files are only
+    // consistent within a single read.
+    char *buf = (char *)prom_realloc(self->buf, self->allocated * 2);
+    if (buf == NULL) return 1;
+    self->buf = buf;
+    self->allocated *= 2;
   }
-  r = prom_procfs_ensure_buf_size(self);
-  if (r) {
-    prom_procfs_buf_destroy(self);
-    self = NULL;
-    PROM_PROCFS_BUF_NEW_HANDLE_F_CLOSE(f);
-    return NULL;
+
+  self->buf[len] = '\0';
+  self->size = len + 1;
+  self->index = 0;
+  return 0;
+}
+
+int prom_procfs_buf_read(prom_procfs_buf_t *self) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+  return prom_procfs_buf_pread(self, self->fd);
+}
+
+int prom_procfs_buf_read_at(prom_procfs_buf_t *self, int dir_fd, const char *path) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
+
+  int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 1;
+  int r = prom_procfs_buf_pread(self, fd);
+  if (close(fd)) {
+    prom_procfs_log_errno();
+    r = 1;
   }
+  return r;
+}
 
-  self->buf[self->size] = '\0';
-  self->size++;
+int prom_procfs_buf_value(prom_procfs_buf_t *self, const char *key, uint64_t *value) {
+  PROM_ASSERT(self != NULL);
+  if (self == NULL) return 1;
 
-  PROM_PROCFS_BUF_NEW_HANDLE_F_CLOSE(f);
-  if (r) return NULL;
-  return self;
+  size_t key_len = strlen(key);
+  for (const char *line = self->buf; *line != '\0';) {
+    if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+      const char *c = line + key_len + 1;
+      while (*c == ' ' || *c == '\t') c++;
+      if (*c < '0' || *c > '9') return 1;
+      *value = 0;
+      for (; *c >= '0' && *c <= '9'; c++) *value = *value * 10 + (uint64_t)(*c - '0');
+      return 0;
+    }
+    line = strchr(line, '\n');
+    if (line == NULL) break;
+    line++;
+  }
+  return 1;
 }
 
 int prom_procfs_buf_destroy(prom_procfs_buf_t *self) {
   PROM_ASSERT(self != NULL);
   if (self == NULL) return 0;
+
+  int r = 0;
+  if (self->fd >= 0 && close(self->fd)) {
+    prom_procfs_log_errno();
+    r = 1;
+  }
+  self->fd = -1;
   prom_free(self->buf);
+  self->buf = NULL;
   prom_free(self);
   self = NULL;
-  return 0;
+  return r;
 }
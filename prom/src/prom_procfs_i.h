@@ -17,10 +17,44 @@
 #ifndef PROM_PROCFS_I_H
 #define PROM_PROCFS_I_H
 
+#include <stdint.h>
+
 #include "prom_procfs_t.h"
 
+/**
+ * @brief API PRIVATE Opens the file at path and reads its contents. Returns NULL upon failure.
+ */
 prom_procfs_buf_t *prom_procfs_buf_new(const char *path);
 
+/**
+ * @brief API PRIVATE Opens the file at path without reading it. The file stays open until the buffer is destroyed.
+ * Pass NULL for a buffer without a file, which is only filled by prom_procfs_buf_read_at. Returns NULL upon failure.
+ */
+prom_procfs_buf_t *prom_procfs_buf_open(const char *path);
+
+/**
+ * @brief API PRIVATE Reads the current contents of the file from its start into the buffer and resets the index.
+ * procfs files are regenerated on every read from offset 0, so a single pread usually returns the whole file. The
+ * buffer only grows if the contents do not fit.
+ */
+int prom_procfs_buf_read(prom_procfs_buf_t *self);
+
+/**
+ * @brief API PRIVATE Opens the file at path relative to the directory dir_fd, reads it into the buffer as
+ * prom_procfs_buf_read does and closes it again. Suits files that come and go, such as those of threads. Returns
+ * non-zero without logging if the file cannot be opened.
+ */
+int prom_procfs_buf_read_at(prom_procfs_buf_t *self, int dir_fd, const char *path);
+
+/**
+ * @brief API PRIVATE Scans the contents for the line "key: value", as found in /proc/[pid]/status and io, and stores
+ * the unsigned decimal value. Returns non-zero if there is no such line.
+ */
+int prom_procfs_buf_value(prom_procfs_buf_t *self, const char *key, uint64_t *value);
+
+/**
+ * @brief API PRIVATE Closes the file and destroys the buffer
+ */
 int prom_procfs_buf_destroy(prom_procfs_buf_t *self);
 
 #endif  // PROM_PROCFS_I_H
@@ -17,11 +17,23 @@
 #ifndef PROM_PROCFS_T_H
 #define PROM_PROCFS_T_H
 
+#include <stddef.h>
+
+/**
+ * @brief API PRIVATE The initial size of a prom_procfs_buf_t buffer. Large enough for /proc/[pid]/stat and limits, so
+ * reading them never reallocates.
+ */
+#define PROM_PROCFS_BUF_INITIAL_SIZE 4096
+
+/**
+ * @brief API PRIVATE The contents of a procfs file. The file is kept open and its buffer is reused by every read.
+ */
 typedef struct prom_procfs_buf {
-  size_t allocated;
-  size_t size;
-  size_t index;
-  char *buf;
+  size_t allocated; /**< allocated The size of buf */
+  size_t size;      /**< size      The length of the contents including the terminating null byte */
+  size_t index;     /**< index     The position of a parser within the contents */
+  char *buf;        /**< buf       The null terminated contents */
+  int fd;           /**< fd        The open file or -1 */
 } prom_procfs_buf_t;
 
 #endif  // PROM_PROCFS_T_H
@@ -103,6 +103,40 @@ int prom_string_builder_add_str(prom_string_builder_t *self, const char *str) {
   return 0;
 }
 
+int prom_string_builder_add_strn(prom_string_builder_t *self, const char *str, size_t len) {
+  PROM_ASSERT(self != NULL);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  if (len == 0) return 0;
+
+  r = prom_string_builder_ensure_space(self, len);
+  if (r) return r;
+
+  memcpy(self->str + self->len, str, len);
+  self->len += len;
+  self->str[self->len] = '\0';
+  return 0;
+}
+
+int prom_string_builder_insert(prom_string_builder_t *self, size_t pos, const char *str, size_t len) {
+  PROM_ASSERT(self != NULL);
+  PROM_ASSERT(pos <= self->len);
+  int r = 0;
+
+  if (self == NULL) return 1;
+  if (len == 0) return 0;
+
+  r = prom_string_builder_ensure_space(self, len);
+  if (r) return r;
+
+  memmove(self->str + pos + len, self->str + pos, self->len - pos);
+  memcpy(self->str + pos, str, len);
+  self->len += len;
+  self->str[self->len] = '\0';
+  return 0;
+}
+
 int prom_string_builder_add_char(prom_string_builder_t *self, char c) {
   PROM_ASSERT(self != NULL);
   int r = 0;
@@ -139,6 +173,11 @@ size_t prom_string_builder_len(prom_string_builder_t *self) {
   return self->len;
 }
 
+size_t prom_string_builder_allocated(prom_string_builder_t *self) {
+  PROM_ASSERT(self != NULL);
+  return self->allocated;
+}
+
 char *prom_string_builder_dump(prom_string_builder_t *self) {
   PROM_ASSERT(self != NULL);
   // +1 to accommodate \0
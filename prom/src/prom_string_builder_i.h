@@ -39,6 +39,18 @@ int prom_string_builder_destroy(prom_string_builder_t *self);
  */
 int prom_string_builder_add_str(prom_string_builder_t *self, const char *str);
 
+/**
+ * API PRIVATE
+ * @brief Adds the first len bytes of str
+ */
+int prom_string_builder_add_strn(prom_string_builder_t *self, const char *str, size_t len);
+
+/**
+ * API PRIVATE
+ * @brief Inserts the first len bytes of str at offset pos, moving the bytes that follow
+ */
+int prom_string_builder_insert(prom_string_builder_t *self, size_t pos, const char *str, size_t len);
+
 /**
  * API PRIVATE
  * @brief Adds a char
@@ -55,7 +67,7 @@ int prom_string_builder_clear(prom_string_builder_t *self);
  * API PRIVATE
  * @brief Remove data from the end
  */
-int prom_string_buillder_truncate(prom_string_builder_t *self, size_t len);
+int prom_string_builder_truncate(prom_string_builder_t *self, size_t len);
 
 /**
  * API PRIVATE
@@ -63,6 +75,12 @@ int prom_string_buillder_truncate(prom_string_builder_t *self, size_t len);
  */
 size_t prom_string_builder_len(prom_string_builder_t *self);
 
+/**
+ * API PRIVATE
+ * @brief Returns the number of bytes allocated for the string
+ */
+size_t prom_string_builder_allocated(prom_string_builder_t *self);
+
 /**
  * API PRIVATE
  * @brief Returns a copy of the string. The returned string must be deallocated when no longer needed.
@@ -0,0 +1,107 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prom_test_helpers.h"
+
+void test_prom_allocator_malloc_info_next(void) {
+#if defined(PROM_ALLOCATOR_GLIBC)
+  const char *xml =
+      "<malloc version=\"1\">\n"
+      "<heap nr=\"0\">\n"
+      "<sizes>\n"
+      "  <size from=\"33\" to=\"48\" total=\"48\" count=\"1\"/>\n"
+      "</sizes>\n"
+      "<total type=\"fast\" count=\"1\" size=\"48\"/>\n"
+      "<total type=\"rest\" count=\"2\" size=\"4000\"/>\n"
+      "<system type=\"current\" size=\"135168\"/>\n"
+      "<system type=\"max\" size=\"200704\"/>\n"
+      "</heap>\n"
+      "<heap nr=\"1\">\n"
+      "<total type=\"rest\" count=\"1\" size=\"100\"/>\n"
+      "<system type=\"current\" size=\"132096\"/>\n"
+      "</heap>\n"
+      "<total type=\"fast\" count=\"1\" size=\"48\"/>\n"
+      "<system type=\"current\" size=\"267264\"/>\n"
+      "</malloc>\n";
+
+  const char *c = xml;
+  prom_allocator_arena_t arena;
+  TEST_ASSERT_EQUAL_INT(0, prom_allocator_malloc_info_next(&c, &arena));
+  TEST_ASSERT_EQUAL_UINT(0, arena.nr);
+  TEST_ASSERT_EQUAL_UINT64(135168, arena.system_bytes);
+  TEST_ASSERT_EQUAL_UINT64(4048, arena.free_bytes);
+
+  // The totals after the last heap belong to no arena
+  TEST_ASSERT_EQUAL_INT(0, prom_allocator_malloc_info_next(&c, &arena));
+  TEST_ASSERT_EQUAL_UINT(1, arena.nr);
+  TEST_ASSERT_EQUAL_UINT64(132096, arena.system_bytes);
+  TEST_ASSERT_EQUAL_UINT64(100, arena.free_bytes);
+  TEST_ASSERT_EQUAL_INT(1, prom_allocator_malloc_info_next(&c, &arena));
+#else
+  TEST_IGNORE_MESSAGE("malloc_info is specific to glibc");
+#endif
+}
+
+void test_prom_collector_allocator(void) {
+#if defined(PROM_ALLOCATOR_GLIBC)
+  prom_collector_t *collector = prom_collector_allocator_new(true);
+  TEST_ASSERT_NOT_NULL(collector);
+  prom_map_t *m = collector->collect_fn(collector);
+  TEST_ASSERT_NOT_NULL(m);
+  TEST_ASSERT_EQUAL_INT(7, prom_map_size(m));
+
+  // Every arena in use has a series, and the main arena is always in use
+  prom_metric_sample_t *sample =
+      prom_metric_sample_from_labels(prom_allocator_arena_system_bytes, (const char *[]){"0"});
+  TEST_ASSERT_NOT_NULL(sample);
+
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+  // Sanitizers replace malloc, so the statistics of glibc only reflect the allocations of the application without them
+  double allocated = prom_metric_sample_value(prom_metric_sample_from_labels(prom_allocator_allocated_bytes, NULL));
+  TEST_ASSERT_TRUE(allocated > 0.0);
+  TEST_ASSERT_TRUE(prom_metric_sample_value(sample) > 0.0);
+
+  char *block = (char *)malloc(4 << 20);
+  TEST_ASSERT_NOT_NULL(block);
+  memset(block, 1, 4 << 20);
+  TEST_ASSERT_EQUAL_PTR(m, collector->collect_fn(collector));
+  TEST_ASSERT_TRUE(prom_metric_sample_value(prom_metric_sample_from_labels(prom_allocator_allocated_bytes, NULL)) >=
+                   allocated + (4 << 20));
+  TEST_ASSERT_TRUE(prom_metric_sample_value(prom_metric_sample_from_labels(prom_allocator_mmapped_bytes, NULL)) >=
+                   4 << 20);
+  free(block);
+#endif
+
+  prom_collector_destroy(collector);
+  collector = NULL;
+
+  // Without arenas only the totals are reported
+  collector = prom_collector_allocator_new(false);
+  TEST_ASSERT_NOT_NULL(collector);
+  TEST_ASSERT_EQUAL_INT(5, prom_map_size(collector->collect_fn(collector)));
+  prom_collector_destroy(collector);
+  collector = NULL;
+#else
+  TEST_IGNORE_MESSAGE("no allocator statistics without glibc or jemalloc");
+#endif
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_allocator_malloc_info_next);
+  RUN_TEST(test_prom_collector_allocator);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include "prom_test_helpers.h"
+
+void test_prom_arena_alloc(void) {
+  prom_arena_t *a = prom_arena_new();
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_allocated(a));
+
+  // Consecutive allocations are aligned and packed into the same chunk
+  char *one = (char *)prom_arena_alloc(a, 3);
+  char *two = (char *)prom_arena_alloc(a, 5);
+  TEST_ASSERT_NOT_NULL(one);
+  TEST_ASSERT_EQUAL_INT(0, (uintptr_t)one % PROM_ARENA_ALIGNMENT);
+  TEST_ASSERT_EQUAL_INT(0, (uintptr_t)two % PROM_ARENA_ALIGNMENT);
+  TEST_ASSERT_EQUAL_PTR(one + PROM_ARENA_ALIGNMENT, two);
+  size_t allocated = prom_arena_allocated(a);
+  TEST_ASSERT_TRUE(allocated > 0);
+
+  memcpy(one, "one", 3);
+  memcpy(two, "two!", 5);
+  TEST_ASSERT_EQUAL_STRING("two!", two);
+
+  // A large allocation gets a chunk of its own and leaves the current chunk in use
+  char *large = (char *)prom_arena_alloc(a, 1 << 20);
+  TEST_ASSERT_NOT_NULL(large);
+  memset(large, 'x', 1 << 20);
+  TEST_ASSERT_TRUE(prom_arena_allocated(a) >= allocated + (1 << 20));
+  char *three = (char *)prom_arena_alloc(a, 1);
+  TEST_ASSERT_EQUAL_PTR(two + PROM_ARENA_ALIGNMENT, three);
+
+  // Filling the current chunk moves on to a new one
+  for (int i = 0; i < 10000; i++) {
+    TEST_ASSERT_NOT_NULL(prom_arena_alloc(a, 24));
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_destroy(a));
+  a = NULL;
+}
+
+void test_prom_arena_free(void) {
+  prom_arena_t *a = prom_arena_new();
+
+  // Freed blocks are handed out again to allocations of the same aligned size only
+  char *one = (char *)prom_arena_alloc(a, 20);
+  char *two = (char *)prom_arena_alloc(a, 20);
+  char *three = (char *)prom_arena_alloc(a, 40);
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_free(a, three, 40));
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_free(a, one, 20));
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_free(a, two, 20));
+  TEST_ASSERT_EQUAL_PTR(two, prom_arena_alloc(a, 24));
+  TEST_ASSERT_EQUAL_PTR(one, prom_arena_alloc(a, 17));
+  char *four = (char *)prom_arena_alloc(a, 20);
+  TEST_ASSERT_NOT_EQUAL(one, four);
+  TEST_ASSERT_NOT_EQUAL(two, four);
+  TEST_ASSERT_EQUAL_PTR(three, prom_arena_alloc(a, 40));
+
+  // Churn within a single size reuses the same memory
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_free(a, prom_arena_alloc(a, 100), 100));
+  size_t allocated = prom_arena_allocated(a);
+  for (int i = 0; i < 10000; i++) {
+    char *block = (char *)prom_arena_alloc(a, 100);
+    TEST_ASSERT_NOT_NULL(block);
+    memset(block, 'x', 100);
+    TEST_ASSERT_EQUAL_INT(0, prom_arena_free(a, block, 100));
+  }
+  TEST_ASSERT_EQUAL_INT(allocated, prom_arena_allocated(a));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_destroy(a));
+  a = NULL;
+}
+
+void test_prom_arena_metric(void) {
+  prom_counter_t *c = prom_counter_new("test_counter", "counter under test", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_arena_allocated(c->arena));
+
+  // Series are allocated from the arena of their metric. Both fit in the first chunk.
+  prom_counter_inc(c, (const char *[]){"bar"});
+  size_t allocated = prom_arena_allocated(c->arena);
+  size_t used = c->arena->chunks->used;
+  TEST_ASSERT_TRUE(allocated > 0);
+  prom_counter_inc(c, (const char *[]){"baz"});
+  TEST_ASSERT_EQUAL_INT(allocated, prom_arena_allocated(c->arena));
+  TEST_ASSERT_TRUE(c->arena->chunks->used > used);
+
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(c, (const char *[]){"baz"});
+  TEST_ASSERT_TRUE(sample->from_arena);
+  TEST_ASSERT_EQUAL_STRING("baz", sample->label_values[0]);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_value(sample));
+
+  prom_counter_destroy(c);
+  c = NULL;
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_arena_alloc);
+  RUN_TEST(test_prom_arena_free);
+  RUN_TEST(test_prom_arena_metric);
+  return UNITY_END();
+}
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "prom_test_helpers.h"
 
 static void prom_registry_test_init(void);
@@ -96,6 +99,240 @@ void test_prom_collector_registry_bridge(void) {
   prom_registry_test_destroy();
 }
 
+void test_prom_collector_registry_stream(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  const char *label[] = {"label"};
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 1, label);
+  prom_histogram_t *histogram = prom_histogram_new("test_histogram", "histogram under test",
+                                                   prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, histogram);
+  prom_collector_registry_register_collector(registry, collector);
+
+  for (int i = 0; i < 100; i++) {
+    char value[8];
+    sprintf(value, "%d", i);
+    prom_counter_inc(counter, (const char *[]){value});
+  }
+  prom_histogram_observe(histogram, 3.0, NULL);
+
+  // Read in chunks smaller than a single line to exercise the boundaries
+  prom_string_builder_t *sb = prom_string_builder_new();
+  prom_collector_registry_stream_t *stream = prom_collector_registry_stream_new(registry);
+  TEST_ASSERT_NOT_NULL(stream);
+  char buf[8];
+  size_t len = 0;
+  do {
+    TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_stream_read(stream, buf, sizeof(buf) - 1, &len));
+    buf[len] = '\0';
+    prom_string_builder_add_str(sb, buf);
+  } while (len > 0);
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_stream_read(stream, buf, sizeof(buf) - 1, &len));
+  TEST_ASSERT_EQUAL_INT(0, len);
+  prom_collector_registry_stream_destroy(stream);
+  stream = NULL;
+
+  const char *expected = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_EQUAL_STRING(expected, prom_string_builder_str(sb));
+  TEST_ASSERT_NOT_NULL(strstr(expected, "test_counter{label=\"99\"} 1\n"));
+
+  free((char *)expected);
+  prom_string_builder_destroy(sb);
+  prom_collector_registry_destroy(registry);
+}
+
+static void *test_prom_collector_registry_bridge_worker(void *arg) {
+  prom_collector_registry_t *registry = (prom_collector_registry_t *)arg;
+  for (int i = 0; i < 200; i++) {
+    const char *result = prom_collector_registry_bridge(registry);
+    if (result == NULL) return (void *)1;
+    int ok = strstr(result, "test_counter{label=\"foo\"} 3\n") != NULL &&
+             strstr(result, "test_histogram_count 1\n") != NULL;
+    free((char *)result);
+    if (!ok) return (void *)1;
+  }
+  return NULL;
+}
+
+void test_prom_collector_registry_bridge_concurrent(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 1, (const char *[]){"label"});
+  prom_histogram_t *histogram = prom_histogram_new("test_histogram", "histogram under test",
+                                                   prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, histogram);
+  prom_collector_registry_register_collector(registry, collector);
+  prom_counter_add(counter, 3.0, (const char *[]){"foo"});
+  prom_histogram_observe(histogram, 3.0, NULL);
+
+  // Each scrape renders into a formatter of its own
+  pthread_t scrapers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&scrapers[i], NULL, test_prom_collector_registry_bridge_worker, registry);
+  }
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(scrapers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+  TEST_ASSERT(registry->formatter_pool_size > 0);
+  TEST_ASSERT(registry->formatter_pool_size <= PROM_COLLECTOR_REGISTRY_FORMATTER_POOL_SIZE);
+
+  prom_collector_registry_destroy(registry);
+}
+
+static char *test_prom_collector_registry_read_stream(prom_collector_registry_t *registry,
+                                                     prom_exposition_format_t format) {
+  prom_string_builder_t *sb = prom_string_builder_new();
+  prom_collector_registry_stream_t *stream = prom_collector_registry_stream_new_format(registry, format);
+  TEST_ASSERT_NOT_NULL(stream);
+  char buf[8];
+  size_t len = 0;
+  do {
+    TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_stream_read(stream, buf, sizeof(buf) - 1, &len));
+    buf[len] = '\0';
+    prom_string_builder_add_str(sb, buf);
+  } while (len > 0);
+  prom_collector_registry_stream_destroy(stream);
+  char *result = prom_string_builder_dump(sb);
+  prom_string_builder_destroy(sb);
+  return result;
+}
+
+void test_prom_collector_registry_cache(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 0, NULL);
+  prom_collector_add_metric(collector, counter);
+  prom_collector_registry_register_collector(registry, collector);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_enable_cache(registry, 60000));
+  prom_counter_inc(counter, NULL);
+  const char *result = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(strstr(result, "test_counter 1\n"));
+  free((char *)result);
+
+  // Updates are not visible until the cached exposition expires
+  prom_counter_inc(counter, NULL);
+  result = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(strstr(result, "test_counter 1\n"));
+  char *streamed = test_prom_collector_registry_read_stream(registry, PROM_EXPOSITION_FORMAT_TEXT);
+  TEST_ASSERT_EQUAL_STRING(result, streamed);
+  free(streamed);
+
+  // Each format is cached on its own
+  streamed = test_prom_collector_registry_read_stream(registry, PROM_EXPOSITION_FORMAT_OPENMETRICS);
+  TEST_ASSERT_NOT_NULL(strstr(streamed, "test_counter_total 2\n"));
+  free(streamed);
+  free((char *)result);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_enable_cache(registry, 0));
+  result = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(strstr(result, "test_counter 2\n"));
+  free((char *)result);
+
+  prom_collector_registry_destroy(registry);
+}
+
+void test_prom_collector_registry_stream_openmetrics(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 0, NULL);
+  prom_gauge_t *gauge = prom_gauge_new("test_gauge", "gauge under test", 0, NULL);
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, gauge);
+  prom_collector_registry_register_collector(registry, collector);
+  prom_counter_inc(counter, NULL);
+  prom_gauge_set(gauge, 2.5, NULL);
+
+  char *result = test_prom_collector_registry_read_stream(registry, PROM_EXPOSITION_FORMAT_OPENMETRICS);
+  TEST_ASSERT_NOT_NULL(strstr(result, "# TYPE test_counter counter\ntest_counter_total 1\ntest_counter_created "));
+  TEST_ASSERT_NOT_NULL(strstr(result, "# TYPE test_gauge gauge\ntest_gauge 2.5\n"));
+  TEST_ASSERT_NULL(strstr(result, "\n\n"));
+
+  // The exposition is terminated once, after the last family
+  size_t len = strlen(result);
+  TEST_ASSERT(len > strlen("# EOF\n"));
+  TEST_ASSERT_EQUAL_STRING("# EOF\n", result + len - strlen("# EOF\n"));
+  TEST_ASSERT_EQUAL_PTR(result + len - strlen("# EOF\n"), strstr(result, "# EOF"));
+  free(result);
+
+  prom_collector_registry_destroy(registry);
+}
+
+static atomic_int test_prom_collector_registry_collect_count;
+
+static prom_map_t *test_prom_collector_registry_counting_collect(prom_collector_t *self) {
+  atomic_fetch_add(&test_prom_collector_registry_collect_count, 1);
+  return self->metrics;
+}
+
+void test_prom_collector_registry_cache_concurrent(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 1, (const char *[]){"label"});
+  prom_histogram_t *histogram = prom_histogram_new("test_histogram", "histogram under test",
+                                                   prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, histogram);
+  prom_collector_set_collect_fn(collector, &test_prom_collector_registry_counting_collect);
+  prom_collector_registry_register_collector(registry, collector);
+  prom_counter_add(counter, 3.0, (const char *[]){"foo"});
+  prom_histogram_observe(histogram, 3.0, NULL);
+  prom_collector_registry_enable_cache(registry, 60000);
+
+  // Concurrent scrapes share a single rendering
+  atomic_store(&test_prom_collector_registry_collect_count, 0);
+  pthread_t scrapers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&scrapers[i], NULL, test_prom_collector_registry_bridge_worker, registry);
+  }
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(scrapers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&test_prom_collector_registry_collect_count));
+
+  prom_collector_registry_destroy(registry);
+}
+
+void test_prom_collector_registry_series_limit(void) {
+  prom_collector_registry_t *registry = prom_collector_registry_new("test");
+  prom_collector_t *collector = prom_collector_new("test");
+  prom_counter_t *counter = prom_counter_new("test_counter", "counter under test", 1, (const char *[]){"label"});
+  prom_gauge_t *gauge = prom_gauge_new("test_gauge", "gauge under test", 1, (const char *[]){"label"});
+  prom_collector_add_metric(collector, counter);
+  prom_collector_add_metric(collector, gauge);
+
+  // Series created before registration count against the limit
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(counter, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_register_collector(registry, collector));
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_set_series_limit(registry, 3));
+
+  // The limit is shared by every metric of the registry
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 1.0, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(gauge, 1.0, (const char *[]){"b"}));
+  TEST_ASSERT_NOT_EQUAL(0, prom_gauge_set(gauge, 1.0, (const char *[]){"c"}));
+  TEST_ASSERT_NOT_EQUAL(0, prom_counter_inc(counter, (const char *[]){"b"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(counter, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(1, prom_metric_series_rejected(counter));
+  TEST_ASSERT_EQUAL_INT(1, prom_metric_series_rejected(gauge));
+
+  // Lifting the limit accepts new series again
+  TEST_ASSERT_EQUAL_INT(0, prom_collector_registry_set_series_limit(registry, 0));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(counter, (const char *[]){"b"}));
+
+  const char *result = prom_collector_registry_bridge(registry);
+  TEST_ASSERT_NOT_NULL(strstr(result, "test_counter{label=\"b\"} 1"));
+  TEST_ASSERT_NULL(strstr(result, "test_gauge{label=\"c\"}"));
+  free((char *)result);
+
+  prom_collector_registry_destroy(registry);
+}
+
 void test_prom_collector_registry_validate_metric_name(void) {
   prom_registry_test_init();
 
@@ -125,6 +362,12 @@ int main(int argc, const char **argv) {
   UNITY_BEGIN();
   // RUN_TEST(test_prom_collector_registry_must_register);
   RUN_TEST(test_prom_collector_registry_bridge);
+  RUN_TEST(test_prom_collector_registry_stream);
+  RUN_TEST(test_prom_collector_registry_bridge_concurrent);
+  RUN_TEST(test_prom_collector_registry_stream_openmetrics);
+  RUN_TEST(test_prom_collector_registry_cache);
+  RUN_TEST(test_prom_collector_registry_cache_concurrent);
+  RUN_TEST(test_prom_collector_registry_series_limit);
   // RUN_TEST(test_prom_collector_registry_validate_metric_name);
   // RUN_TEST(test_large_registry);
   return UNITY_END();
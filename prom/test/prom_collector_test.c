@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
 #include "prom_test_helpers.h"
 
 void test_prom_collector(void) {
@@ -30,7 +32,38 @@ void test_prom_process_collector(void) {
   prom_collector_t *collector =
       prom_collector_process_new("/code/prom/test/fixtures/limits", "/code/prom/test/fixtures/stat");
   prom_map_t *m = collector->collect_fn(collector);
-  TEST_ASSERT_EQUAL_INT(7, prom_map_size(m));
+  TEST_ASSERT_EQUAL_INT(16, prom_map_size(m));
+
+  // The files stay open and are read again by every collection
+  TEST_ASSERT_EQUAL_PTR(m, collector->collect_fn(collector));
+  TEST_ASSERT_EQUAL_DOUBLE(1048576.0,
+                           prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_max_fds, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      -1.0, prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_virtual_memory_max_bytes, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      19058688.0, prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_virtual_memory_bytes, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      7.0 / sysconf(_SC_CLK_TCK),
+      prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_cpu_seconds_total, NULL)));
+
+  // The status and io files and the task directory are found next to the stat file
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_threads, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      1463.0, prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_minor_page_faults_total, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(152.0, prom_metric_sample_value(prom_metric_sample_from_labels(
+                                      prom_process_context_switches_total, (const char *[]){"voluntary"})));
+  TEST_ASSERT_EQUAL_DOUBLE(17.0, prom_metric_sample_value(prom_metric_sample_from_labels(
+                                     prom_process_context_switches_total, (const char *[]){"involuntary"})));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      4096.0, prom_metric_sample_value(prom_metric_sample_from_labels(prom_process_io_storage_read_bytes_total, NULL)));
+  TEST_ASSERT_EQUAL_DOUBLE(
+      50.0 / sysconf(_SC_CLK_TCK), prom_metric_sample_value(prom_metric_sample_from_labels(
+                                       prom_process_thread_cpu_seconds_total, (const char *[]){"worker"})));
+
+  // Totals kept by the kernel are exposed as counters
+  TEST_ASSERT_EQUAL_INT(PROM_COUNTER, prom_process_minor_page_faults_total->type);
+  TEST_ASSERT_EQUAL_INT(PROM_COUNTER, prom_process_context_switches_total->type);
+  TEST_ASSERT_EQUAL_INT(PROM_COUNTER, prom_process_io_read_bytes_total->type);
   prom_collector_destroy(collector);
   collector = NULL;
 }
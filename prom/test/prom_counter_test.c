@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 
 #include "prom_test_helpers.h"
 
@@ -52,9 +53,136 @@ void test_counter_add(void) {
   c = NULL;
 }
 
+void test_counter_set_total(void) {
+  prom_counter_t *c = prom_counter_new("test_counter", "counter under test", 2, (const char *[]){"foo", "bar"});
+  TEST_ASSERT(c);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_set_total(c, 42.0, sample_labels_a));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_set_total(c, 40.0, sample_labels_a));
+  TEST_ASSERT_EQUAL_DOUBLE(40.0, prom_metric_sample_value(prom_metric_sample_from_labels(c, sample_labels_a)));
+
+  // Sharded counters and other metric types are rejected
+  prom_counter_t *sharded = prom_counter_new_sharded("test_sharded", "counter under test", 0, NULL);
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_set_total(sharded, 1.0, NULL));
+  prom_gauge_t *g = prom_gauge_new("test_gauge", "gauge under test", 0, NULL);
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_set_total(g, 1.0, NULL));
+
+  prom_gauge_destroy(g);
+  g = NULL;
+  prom_counter_destroy(sharded);
+  sharded = NULL;
+  prom_counter_destroy(c);
+  c = NULL;
+}
+
+void test_counter_with_labels(void) {
+  prom_counter_t *c = prom_counter_new("test_counter", "counter under test", 2, (const char *[]){"foo", "bar"});
+  TEST_ASSERT(c);
+
+  prom_counter_child_t *child = prom_counter_with_labels(c, sample_labels_a);
+  TEST_ASSERT_NOT_NULL(child);
+  TEST_ASSERT_EQUAL_PTR(child, prom_counter_with_labels(c, sample_labels_a));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_child_inc(child));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_child_add(child, 2.5));
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_child_add(child, -1.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(c, sample_labels_a));
+
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(c, sample_labels_a);
+  TEST_ASSERT_EQUAL_DOUBLE(4.5, sample->r_value);
+
+  sample = prom_metric_sample_from_labels(c, sample_labels_b);
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, sample->r_value);
+
+  prom_counter_destroy(c);
+  c = NULL;
+}
+
+void test_counter_with_labels_incorrect_type(void) {
+  prom_gauge_t *g = prom_gauge_new("test_gauge", "gauge under test", 0, NULL);
+  TEST_ASSERT(g);
+
+  TEST_ASSERT_NULL(prom_counter_with_labels(g, NULL));
+  prom_gauge_child_t *child = prom_gauge_with_labels(g, NULL);
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_child_inc(child));
+
+  prom_gauge_destroy(g);
+  g = NULL;
+}
+
+static void *test_counter_sharded_worker(void *arg) {
+  prom_counter_child_t *child = (prom_counter_child_t *)arg;
+  for (int i = 0; i < 10000; i++) {
+    if (prom_counter_child_inc(child)) return (void *)1;
+  }
+  return NULL;
+}
+
+void test_counter_sharded(void) {
+  prom_counter_t *c = prom_counter_new_sharded("test_counter", "counter under test", 2, (const char *[]){"foo", "bar"});
+  TEST_ASSERT(c);
+
+  prom_counter_child_t *child = prom_counter_with_labels(c, sample_labels_a);
+  TEST_ASSERT_NOT_NULL(child);
+  TEST_ASSERT(child->shard_count > 0);
+
+  pthread_t workers[8];
+  for (int i = 0; i < 8; i++) {
+    pthread_create(&workers[i], NULL, test_counter_sharded_worker, child);
+  }
+  for (int i = 0; i < 8; i++) {
+    void *result = NULL;
+    pthread_join(workers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add(c, 0.5, sample_labels_a));
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_add(c, -1.0, sample_labels_a));
+  TEST_ASSERT_EQUAL_DOUBLE(80000.5, prom_metric_sample_value(child));
+
+  // The shards are summed when the sample is formatted
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  prom_metric_formatter_load_sample(mf, child);
+  char *result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_EQUAL_STRING("test_counter{foo=\"f\",bar=\"b\"} 80000.5\n", result);
+  free(result);
+  prom_metric_formatter_destroy(mf);
+  mf = NULL;
+
+  prom_counter_destroy(c);
+  c = NULL;
+}
+
+void test_counter_add_with_exemplar(void) {
+  prom_counter_t *c = prom_counter_new("test_counter", "counter under test", 2, (const char *[]){"foo", "bar"});
+  const char *keys[] = {"trace_id"};
+
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add_with_exemplar(c, 2.0, sample_labels_a, 1, keys, (const char *[]){"abc"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add_with_exemplar(c, 3.0, sample_labels_a, 1, keys, (const char *[]){"xyz"}));
+  prom_counter_child_t *child = prom_counter_with_labels(c, sample_labels_a);
+  TEST_ASSERT_EQUAL_DOUBLE(5.0, prom_metric_sample_value(child));
+  TEST_ASSERT_EQUAL_STRING("xyz", child->exemplar->label_values[0]);
+  TEST_ASSERT_EQUAL_DOUBLE(3.0, child->exemplar->value);
+
+  // Exemplars whose labels exceed 128 characters are refused and the counter is left untouched
+  char value[128];
+  memset(value, 'a', sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+  TEST_ASSERT_EQUAL_INT(1, prom_counter_add_with_exemplar(c, 1.0, sample_labels_a, 1, keys, (const char *[]){value}));
+  TEST_ASSERT_EQUAL_DOUBLE(5.0, prom_metric_sample_value(child));
+  TEST_ASSERT_EQUAL_STRING("xyz", child->exemplar->label_values[0]);
+
+  prom_counter_destroy(c);
+  c = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_counter_inc);
   RUN_TEST(test_counter_add);
+  RUN_TEST(test_counter_set_total);
+  RUN_TEST(test_counter_with_labels);
+  RUN_TEST(test_counter_with_labels_incorrect_type);
+  RUN_TEST(test_counter_sharded);
+  RUN_TEST(test_counter_add_with_exemplar);
   return UNITY_END();
 }
@@ -0,0 +1,89 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "prom_test_helpers.h"
+
+static void assert_dtoa(double value, const char *expected) {
+  char buf[PROM_DTOA_BUFFER_SIZE];
+  size_t len = prom_dtoa(value, buf);
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+  TEST_ASSERT_EQUAL_INT(strlen(expected), len);
+}
+
+void test_prom_dtoa_special(void) {
+  assert_dtoa(0.0, "0");
+  assert_dtoa(-0.0, "-0");
+  assert_dtoa(1.0 / 0.0, "+Inf");
+  assert_dtoa(-1.0 / 0.0, "-Inf");
+  assert_dtoa(0.0 / 0.0, "NaN");
+}
+
+void test_prom_dtoa_integral(void) {
+  assert_dtoa(1.0, "1");
+  assert_dtoa(-42.0, "-42");
+  assert_dtoa(1048576.0, "1048576");
+  assert_dtoa(9007199254740991.0, "9007199254740991");
+  assert_dtoa(9007199254740992.0, "9007199254740992");
+  assert_dtoa(1e16, "10000000000000000");
+  assert_dtoa(1e17, "1e+17");
+  assert_dtoa(1.8446744073709552e19, "1.8446744073709552e+19");
+}
+
+void test_prom_dtoa_fraction(void) {
+  assert_dtoa(0.1, "0.1");
+  assert_dtoa(0.3, "0.3");
+  assert_dtoa(0.1 + 0.2, "0.30000000000000004");
+  assert_dtoa(20.5, "20.5");
+  assert_dtoa(80000.5, "80000.5");
+  assert_dtoa(-1.5, "-1.5");
+  assert_dtoa(3.141592653589793, "3.141592653589793");
+  assert_dtoa(0.0001, "0.0001");
+  assert_dtoa(0.00001, "1e-05");
+  assert_dtoa(1.25e-7, "1.25e-07");
+  assert_dtoa(1.7976931348623157e308, "1.7976931348623157e+308");
+  assert_dtoa(5e-324, "5e-324");
+  assert_dtoa(2.2250738585072014e-308, "2.2250738585072014e-308");
+}
+
+void test_prom_dtoa_round_trip(void) {
+  char buf[PROM_DTOA_BUFFER_SIZE];
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for (int i = 0; i < 100000; i++) {
+    // xorshift64 over the raw bit patterns covers every exponent range
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double value;
+    memcpy(&value, &state, sizeof(value));
+    if (isnan(value) || isinf(value)) continue;
+    size_t len = prom_dtoa(value, buf);
+    TEST_ASSERT_TRUE(len < PROM_DTOA_BUFFER_SIZE);
+    double parsed = strtod(buf, NULL);
+    TEST_ASSERT_EQUAL_MEMORY(&value, &parsed, sizeof(value));
+  }
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_dtoa_special);
+  RUN_TEST(test_prom_dtoa_integral);
+  RUN_TEST(test_prom_dtoa_fraction);
+  RUN_TEST(test_prom_dtoa_round_trip);
+  return UNITY_END();
+}
@@ -100,6 +100,38 @@ void test_gauge_set(void) {
   g = NULL;
 }
 
+void test_gauge_with_labels(void) {
+  prom_gauge_t *g = prom_gauge_new("test_gauge", "gauge under test", 2, (const char *[]){"foo", "bar"});
+  TEST_ASSERT(g);
+
+  prom_gauge_child_t *child = prom_gauge_with_labels(g, sample_labels_a);
+  TEST_ASSERT_NOT_NULL(child);
+  TEST_ASSERT_EQUAL_PTR(child, prom_gauge_with_labels(g, sample_labels_a));
+
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(g, sample_labels_a);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_child_set(child, 10.0));
+  TEST_ASSERT_EQUAL_DOUBLE(10.0, sample->r_value);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_child_inc(child));
+  TEST_ASSERT_EQUAL_DOUBLE(11.0, sample->r_value);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_child_dec(child));
+  TEST_ASSERT_EQUAL_DOUBLE(10.0, sample->r_value);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_child_add(child, 2.5));
+  TEST_ASSERT_EQUAL_DOUBLE(12.5, sample->r_value);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_child_sub(child, 20.0));
+  TEST_ASSERT_EQUAL_DOUBLE(-7.5, sample->r_value);
+
+  sample = prom_metric_sample_from_labels(g, sample_labels_b);
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, sample->r_value);
+
+  prom_gauge_destroy(g);
+  g = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_gauge_inc);
@@ -107,5 +139,6 @@ int main(int argc, const char **argv) {
   RUN_TEST(test_gauge_add);
   RUN_TEST(test_gauge_sub);
   RUN_TEST(test_gauge_set);
+  RUN_TEST(test_gauge_with_labels);
   return UNITY_END();
 }
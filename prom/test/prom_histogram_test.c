@@ -14,8 +14,25 @@
  * limitations under the License.
  */
 
+#include <math.h>
+#include <pthread.h>
+
 #include "prom_test_helpers.h"
 
+// Concatenates the label block and the suffix of a bucket, or returns the count or sum prefix
+static const char *histogram_prefix(prom_metric_sample_histogram_t *h_sample, size_t index) {
+  static char buf[256];
+  size_t label_block_len = 0;
+  size_t len = 0;
+  const char *label_block = prom_metric_sample_histogram_label_block(h_sample, &label_block_len);
+  const char *prefix = prom_metric_sample_histogram_prefix(h_sample, index, &len);
+  if (index > h_sample->bucket_count) label_block_len = 0;
+  memcpy(buf, label_block, label_block_len);
+  memcpy(buf + label_block_len, prefix, len);
+  buf[label_block_len + len] = '\0';
+  return buf;
+}
+
 void test_prom_histogram(void) {
   prom_histogram_t *h =
       prom_histogram_new("test_histogram", "histogram under test", prom_histogram_buckets_linear(5.0, 5.0, 3), 0, NULL);
@@ -28,47 +45,244 @@ void test_prom_histogram(void) {
   prom_metric_sample_histogram_t *h_sample = prom_metric_sample_histogram_from_labels(h, NULL);
 
   // Test counter for each bucket
-  char *bucket_key = prom_metric_sample_histogram_bucket_to_str(5.0);
-  const char *l_value = prom_map_get(h_sample->l_values, bucket_key);
-  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"5.0\"}", sample->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(1.0, sample->r_value);
-  free((char *)bucket_key);
-  bucket_key = NULL;
-
-  bucket_key = prom_metric_sample_histogram_bucket_to_str(10.0);
-  l_value = prom_map_get(h_sample->l_values, bucket_key);
-  sample = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"10.0\"}", sample->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(2.0, sample->r_value);
-  free((char *)bucket_key);
-  bucket_key = NULL;
-
-  bucket_key = prom_metric_sample_histogram_bucket_to_str(15.0);
-  l_value = prom_map_get(h_sample->l_values, bucket_key);
-  sample = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"15.0\"}", sample->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(3.0, sample->r_value);
-  free((char *)bucket_key);
-  bucket_key = NULL;
-
-  l_value = prom_map_get(h_sample->l_values, "+Inf");
-  sample = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"+Inf\"}", sample->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(4.0, sample->r_value);
+  TEST_ASSERT_EQUAL_INT(3, h_sample->bucket_count);
+  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"5.0\"} ", histogram_prefix(h_sample, 0));
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_histogram_bucket_value(h_sample, 0));
+
+  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"10.0\"} ", histogram_prefix(h_sample, 1));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0, prom_metric_sample_histogram_bucket_value(h_sample, 1));
+
+  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"15.0\"} ", histogram_prefix(h_sample, 2));
+  TEST_ASSERT_EQUAL_DOUBLE(3.0, prom_metric_sample_histogram_bucket_value(h_sample, 2));
+
+  TEST_ASSERT_EQUAL_STRING("test_histogram{le=\"+Inf\"} ", histogram_prefix(h_sample, 3));
+  TEST_ASSERT_EQUAL_DOUBLE(4.0, prom_metric_sample_histogram_bucket_value(h_sample, 3));
+
+  // Each observation is stored in a single bucket
+  TEST_ASSERT_EQUAL_INT(1, h_sample->bucket_counts[0]);
+  TEST_ASSERT_EQUAL_INT(1, h_sample->bucket_counts[1]);
+  TEST_ASSERT_EQUAL_INT(1, h_sample->bucket_counts[2]);
+  TEST_ASSERT_EQUAL_INT(1, h_sample->bucket_counts[3]);
 
   // Test total count. Should equal value ini +Inf
-  l_value = prom_map_get(h_sample->l_values, "count");
-  prom_metric_sample_t *sample_count = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram_count", sample_count->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(4.0, sample_count->r_value);
+  TEST_ASSERT_EQUAL_STRING("test_histogram_count ", histogram_prefix(h_sample, h_sample->bucket_count + 1));
+  TEST_ASSERT_EQUAL_DOUBLE(4.0, prom_metric_sample_histogram_bucket_value(h_sample, h_sample->bucket_count));
 
   // Test sum
-  l_value = prom_map_get(h_sample->l_values, "sum");
-  sample = (prom_metric_sample_t *)prom_map_get(h_sample->samples, l_value);
-  TEST_ASSERT_EQUAL_STRING("test_histogram_sum", sample->l_value);
-  TEST_ASSERT_EQUAL_DOUBLE(41.0, sample->r_value);
+  TEST_ASSERT_EQUAL_STRING("test_histogram_sum ", histogram_prefix(h_sample, h_sample->bucket_count + 2));
+  TEST_ASSERT_EQUAL_DOUBLE(41.0, h_sample->sum);
+
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+void test_prom_histogram_with_labels(void) {
+  prom_histogram_t *h = prom_histogram_new("test_histogram", "histogram under test",
+                                           prom_histogram_buckets_linear(5.0, 5.0, 3), 1, (const char *[]){"foo"});
+
+  prom_histogram_child_t *child = prom_histogram_with_labels(h, (const char *[]){"bar"});
+  TEST_ASSERT_NOT_NULL(child);
+  TEST_ASSERT_EQUAL_PTR(child, prom_histogram_with_labels(h, (const char *[]){"bar"}));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 7.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe(h, 22.0, (const char *[]){"bar"}));
+
+  TEST_ASSERT_EQUAL_STRING("test_histogram{foo=\"bar\",le=\"10.0\"} ", histogram_prefix(child, 1));
+  TEST_ASSERT_EQUAL_STRING("test_histogram_count{foo=\"bar\"} ", histogram_prefix(child, child->bucket_count + 1));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0, prom_metric_sample_histogram_bucket_value(child, child->bucket_count));
+  TEST_ASSERT_EQUAL_DOUBLE(29.0, child->sum);
+
+  TEST_ASSERT_NULL(prom_counter_with_labels(h, NULL));
+
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+static void *test_prom_histogram_observe_worker(void *arg) {
+  prom_histogram_child_t *child = (prom_histogram_child_t *)arg;
+  for (int i = 0; i < 10000; i++) {
+    if (prom_histogram_child_observe(child, (double)(i % 4) * 5.0)) return (void *)1;
+  }
+  return NULL;
+}
+
+void test_prom_histogram_observe_concurrent(void) {
+  prom_histogram_t *h =
+      prom_histogram_new("test_histogram", "histogram under test", prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_histogram_child_t *child = prom_histogram_with_labels(h, NULL);
+
+  pthread_t workers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&workers[i], NULL, test_prom_histogram_observe_worker, child);
+  }
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(workers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+
+  // Each worker observes 0, 5, 10 and 15 in equal measure
+  TEST_ASSERT_EQUAL_DOUBLE(20000.0, prom_metric_sample_histogram_bucket_value(child, 0));
+  TEST_ASSERT_EQUAL_DOUBLE(30000.0, prom_metric_sample_histogram_bucket_value(child, 1));
+  TEST_ASSERT_EQUAL_DOUBLE(40000.0, prom_metric_sample_histogram_bucket_value(child, 2));
+  TEST_ASSERT_EQUAL_DOUBLE(40000.0, prom_metric_sample_histogram_bucket_value(child, child->bucket_count));
+  TEST_ASSERT_EQUAL_DOUBLE(300000.0, child->sum);
+
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+void test_prom_histogram_format(void) {
+  prom_histogram_t *h =
+      prom_histogram_new("test_histogram", "histogram under test", prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_histogram_observe(h, 3.0, NULL);
+  prom_histogram_observe(h, 5.0, NULL);
+  prom_histogram_observe(h, 12.5, NULL);
+
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_histogram_sample(mf, prom_histogram_with_labels(h, NULL)));
+  char *result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_EQUAL_STRING(
+      "test_histogram{le=\"5.0\"} 2\n"
+      "test_histogram{le=\"10.0\"} 2\n"
+      "test_histogram{le=\"+Inf\"} 3\n"
+      "test_histogram_count 3\n"
+      "test_histogram_sum 20.5\n",
+      result);
+  free(result);
+  prom_metric_formatter_destroy(mf);
+  mf = NULL;
+
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+void test_prom_histogram_native_bucket_index(void) {
+  prom_histogram_t *h = prom_histogram_new_native("test_histogram", "histogram under test", 0, 0, 0, NULL);
+
+  // Schema 0 doubles the upper bound from one bucket to the next, powers of two being inclusive upper bounds
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_native_bucket_index(0, 1.0));
+  TEST_ASSERT_EQUAL_INT(1, prom_histogram_native_bucket_index(0, 1.5));
+  TEST_ASSERT_EQUAL_INT(1, prom_histogram_native_bucket_index(0, 2.0));
+  TEST_ASSERT_EQUAL_INT(2, prom_histogram_native_bucket_index(0, 3.0));
+  TEST_ASSERT_EQUAL_INT(-1, prom_histogram_native_bucket_index(0, 0.5));
+  TEST_ASSERT_EQUAL_INT(1025, prom_histogram_native_bucket_index(0, INFINITY));
+
+  // Schema 1 splits each power of two at its square root
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_native_bucket_index(1, 1.0));
+  TEST_ASSERT_EQUAL_INT(1, prom_histogram_native_bucket_index(1, 1.4));
+  TEST_ASSERT_EQUAL_INT(2, prom_histogram_native_bucket_index(1, 1.5));
+  TEST_ASSERT_EQUAL_INT(2, prom_histogram_native_bucket_index(1, 2.0));
+  TEST_ASSERT_EQUAL_INT(-2, prom_histogram_native_bucket_index(1, 0.5));
+
+  // Schema -1 quadruples the upper bound from one bucket to the next
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_native_bucket_index(-1, 0.3));
+  TEST_ASSERT_EQUAL_INT(1, prom_histogram_native_bucket_index(-1, 2.0));
+  TEST_ASSERT_EQUAL_INT(1, prom_histogram_native_bucket_index(-1, 4.0));
+  TEST_ASSERT_EQUAL_INT(2, prom_histogram_native_bucket_index(-1, 5.0));
+  TEST_ASSERT_EQUAL_INT(-1, prom_histogram_native_bucket_index(-1, 0.25));
+
+  TEST_ASSERT_NULL(prom_histogram_new_native("test_histogram", "histogram under test", 9, 0, 0, NULL));
+  TEST_ASSERT_NULL(prom_histogram_new_native("test_histogram", "histogram under test", -5, 0, 0, NULL));
+
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+void test_prom_histogram_native_observe(void) {
+  prom_histogram_t *h = prom_histogram_new_native("test_histogram", "histogram under test", 0, 3, 0, NULL);
+  prom_histogram_child_t *child = prom_histogram_with_labels(h, NULL);
+  TEST_ASSERT_NOT_NULL(child);
+  prom_histogram_native_t *native = child->native;
+  TEST_ASSERT_NOT_NULL(native);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 1.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 2.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, -1.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 0.0));
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 2.0));
+
+  TEST_ASSERT_EQUAL_INT(0, native->schema);
+  TEST_ASSERT_EQUAL_INT(5, native->count);
+  TEST_ASSERT_EQUAL_INT(1, native->zero_count);
+  TEST_ASSERT_EQUAL_INT(2, native->positive.count);
+  TEST_ASSERT_EQUAL_INT(0, native->positive.buckets[0].index);
+  TEST_ASSERT_EQUAL_INT(1, native->positive.buckets[0].count);
+  TEST_ASSERT_EQUAL_INT(1, native->positive.buckets[1].index);
+  TEST_ASSERT_EQUAL_INT(2, native->positive.buckets[1].count);
+  TEST_ASSERT_EQUAL_INT(1, native->negative.count);
+
+  // A fourth bucket exceeds the maximum and merges the buckets (1, 2] and (2, 4] into (1, 4]
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, 4.0));
+  TEST_ASSERT_EQUAL_INT(-1, native->schema);
+  TEST_ASSERT_EQUAL_INT(2, native->positive.count);
+  TEST_ASSERT_EQUAL_INT(0, native->positive.buckets[0].index);
+  TEST_ASSERT_EQUAL_INT(1, native->positive.buckets[0].count);
+  TEST_ASSERT_EQUAL_INT(1, native->positive.buckets[1].index);
+  TEST_ASSERT_EQUAL_INT(3, native->positive.buckets[1].count);
+  TEST_ASSERT_EQUAL_INT(1, native->negative.count);
+  TEST_ASSERT_EQUAL_INT(0, native->negative.buckets[0].index);
+
+  // NaN is counted without a bucket
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_child_observe(child, NAN));
+  TEST_ASSERT_EQUAL_INT(7, native->count);
+  TEST_ASSERT_EQUAL_INT(3, native->positive.count + native->negative.count);
+
+  // The text formats only expose the +Inf bucket
+  prom_histogram_t *text = prom_histogram_new_native("test_histogram", "histogram under test", 3, 0, 0, NULL);
+  prom_histogram_observe(text, 3.0, NULL);
+  prom_histogram_observe(text, 0.5, NULL);
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_histogram_sample(mf, prom_histogram_with_labels(text, NULL)));
+  char *result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_EQUAL_STRING(
+      "test_histogram{le=\"+Inf\"} 2\n"
+      "test_histogram_count 2\n"
+      "test_histogram_sum 3.5\n",
+      result);
+  free(result);
+  prom_metric_formatter_destroy(mf);
+  mf = NULL;
+
+  prom_histogram_destroy(text);
+  text = NULL;
+  prom_histogram_destroy(h);
+  h = NULL;
+}
+
+// Returns true if needle occurs within haystack
+static bool test_prom_histogram_contains(const unsigned char *haystack, size_t haystack_len,
+                                         const unsigned char *needle, size_t needle_len) {
+  for (size_t i = 0; i + needle_len <= haystack_len; i++) {
+    if (memcmp(haystack + i, needle, needle_len) == 0) return true;
+  }
+  return false;
+}
+
+void test_prom_histogram_native_format_protobuf(void) {
+  prom_histogram_t *h = prom_histogram_new_native("test_histogram", "histogram under test", 0, 0, 0, NULL);
+  prom_histogram_observe(h, 1.0, NULL);
+  prom_histogram_observe(h, 2.0, NULL);
+  prom_histogram_observe(h, 8.0, NULL);
+  prom_histogram_observe(h, -1.0, NULL);
+
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  mf->format = PROM_EXPOSITION_FORMAT_PROTOBUF;
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, h));
+
+  // sample_count: 4, schema: 0, zero_threshold: 2^-128, zero_count: 0,
+  // negative_span: [{offset: 0, length: 1}], negative_delta: [1],
+  // positive_span: [{offset: 0, length: 2}, {offset: 1, length: 1}], positive_delta: [1, 0, 0]
+  const unsigned char expected[] = {0x08, 0x04, 0x28, 0x00, 0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x37,
+                                    0x38, 0x00, 0x4a, 0x04, 0x08, 0x00, 0x10, 0x01, 0x52, 0x01, 0x02, 0x62, 0x04,
+                                    0x08, 0x00, 0x10, 0x02, 0x62, 0x04, 0x08, 0x02, 0x10, 0x01, 0x6a, 0x03, 0x02,
+                                    0x00, 0x00};
+  TEST_ASSERT_TRUE(test_prom_histogram_contains((const unsigned char *)prom_string_builder_str(mf->string_builder),
+                                                prom_string_builder_len(mf->string_builder), expected,
+                                                sizeof(expected)));
 
+  prom_metric_formatter_destroy(mf);
+  mf = NULL;
   prom_histogram_destroy(h);
   h = NULL;
 }
@@ -76,5 +290,11 @@ void test_prom_histogram(void) {
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_prom_histogram);
+  RUN_TEST(test_prom_histogram_with_labels);
+  RUN_TEST(test_prom_histogram_observe_concurrent);
+  RUN_TEST(test_prom_histogram_format);
+  RUN_TEST(test_prom_histogram_native_bucket_index);
+  RUN_TEST(test_prom_histogram_native_observe);
+  RUN_TEST(test_prom_histogram_native_format_protobuf);
   return UNITY_END();
 }
@@ -0,0 +1,79 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prom_test_helpers.h"
+
+void test_prom_intern(void) {
+  prom_intern_t *intern = prom_intern_new();
+  TEST_ASSERT_NOT_NULL(intern);
+
+  TEST_ASSERT_NULL(prom_intern_find(intern, "GET"));
+  const char *get = prom_intern_add(intern, "GET");
+  const char *post = prom_intern_add(intern, "POST");
+  TEST_ASSERT_NOT_NULL(get);
+  TEST_ASSERT_NOT_NULL(post);
+  TEST_ASSERT_EQUAL_STRING("GET", get);
+
+  // Each string is stored once
+  char method[] = "GET";
+  TEST_ASSERT_EQUAL_PTR(get, prom_intern_add(intern, method));
+  TEST_ASSERT_EQUAL_PTR(get, prom_intern_find(intern, method));
+  TEST_ASSERT_EQUAL_PTR(post, prom_intern_find(intern, "POST"));
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(intern->entries));
+
+  TEST_ASSERT_EQUAL_INT(0, prom_intern_destroy(intern));
+  intern = NULL;
+}
+
+void test_prom_intern_shared_by_metrics(void) {
+  prom_counter_t *c = prom_counter_new("test_counter", "counter under test", 1, (const char *[]){"method"});
+  prom_gauge_t *g = prom_gauge_new("test_gauge", "gauge under test", 1, (const char *[]){"method"});
+  char c_method[] = "PATCH";
+  char g_method[] = "PATCH";
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_inc(c, (const char *[]){c_method}));
+  TEST_ASSERT_EQUAL_INT(0, prom_gauge_set(g, 2.0, (const char *[]){g_method}));
+
+  // Label keys are stored once and referenced by every metric using them
+  prom_metric_sample_t *c_sample = prom_metric_sample_from_labels(c, (const char *[]){"PATCH"});
+  prom_metric_sample_t *g_sample = prom_metric_sample_from_labels(g, (const char *[]){"PATCH"});
+  TEST_ASSERT_EQUAL_PTR(c->label_keys[0], g->label_keys[0]);
+  TEST_ASSERT_EQUAL_PTR(prom_intern_find(prom_intern_default(), "method"), c->label_keys[0]);
+
+  // Label values are copied into each series, which frees them when it is removed
+  TEST_ASSERT_NULL(prom_intern_find(prom_intern_default(), "PATCH"));
+  TEST_ASSERT_EQUAL_STRING("PATCH", c_sample->label_values[0]);
+  TEST_ASSERT_EQUAL_STRING("PATCH", g_sample->label_values[0]);
+  TEST_ASSERT_TRUE(c_sample->label_values[0] != c_method);
+  TEST_ASSERT_TRUE(c_sample->label_values[0] != g_sample->label_values[0]);
+
+  // Each series keeps its rendered text for the exposition
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(c->samples));
+  TEST_ASSERT_EQUAL_STRING("test_counter{method=\"PATCH\"} ", c_sample->prefix);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_value(c_sample));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0, prom_metric_sample_value(g_sample));
+
+  prom_counter_destroy(c);
+  c = NULL;
+  prom_gauge_destroy(g);
+  g = NULL;
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_intern);
+  RUN_TEST(test_prom_intern_shared_by_metrics);
+  return UNITY_END();
+}
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+
 #include "prom_test_helpers.h"
 
 void test_prom_map(void) {
@@ -51,7 +53,7 @@ void test_prom_map_when_large(void) {
 
   // Ensure each inserted key and value are present
   for (int i = 1; i <= 10000; i++) {
-    char buf[4];
+    char buf[8];
     sprintf(buf, "%d", i);
     const char *k = (const char *)buf;
     int *set = malloc(sizeof(int));
@@ -68,7 +70,7 @@ void test_prom_map_when_large(void) {
 
   // Ensure each key and value is correct
   for (int i = 1; i <= 10000; i++) {
-    char buf[5];
+    char buf[8];
     sprintf(buf, "%d", i);
     const char *k = (const char *)buf;
     int actual = *((int *)prom_map_get(map, k));
@@ -87,9 +89,299 @@ void test_prom_map_when_large(void) {
   map = NULL;
 }
 
+static void *prom_map_test_reader(void *arg) {
+  prom_map_t *map = (prom_map_t *)arg;
+  for (int n = 0; n < 20; n++) {
+    // The sentinel is present before the readers start and must remain visible while the map grows
+    if (prom_map_get(map, "sentinel") == NULL) return (void *)1;
+    for (int i = 1; i <= 5000; i++) {
+      char buf[8];
+      sprintf(buf, "%d", i);
+      int *value = (int *)prom_map_get(map, buf);
+      if (value != NULL && *value != i) return (void *)1;
+    }
+  }
+  return NULL;
+}
+
+void test_prom_map_get_during_set(void) {
+  prom_map_t *map = prom_map_new();
+  prom_map_set_free_value_fn(map, free);
+  prom_map_set(map, "sentinel", malloc(sizeof(int)));
+
+  pthread_t readers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&readers[i], NULL, prom_map_test_reader, map);
+  }
+
+  for (int i = 1; i <= 5000; i++) {
+    char buf[8];
+    sprintf(buf, "%d", i);
+    int *set = malloc(sizeof(int));
+    *set = i;
+    prom_map_set(map, buf, (void *)set);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(readers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+  TEST_ASSERT_EQUAL_INT(5001, prom_map_size(map));
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+void test_prom_map_delete(void) {
+  prom_map_t *map = prom_map_new();
+  for (int i = 1; i <= 100; i++) {
+    char buf[8];
+    sprintf(buf, "%d", i);
+    prom_map_set(map, buf, "value");
+  }
+
+  prom_map_delete(map, "50");
+  prom_map_delete(map, "nope");
+  TEST_ASSERT_NULL(prom_map_get(map, "50"));
+  TEST_ASSERT_EQUAL_STRING("value", (const char *)prom_map_get(map, "51"));
+  TEST_ASSERT_EQUAL_INT(99, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(99, map->keys->size);
+
+  prom_map_set(map, "50", "again");
+  TEST_ASSERT_EQUAL_STRING("again", (const char *)prom_map_get(map, "50"));
+  TEST_ASSERT_EQUAL_INT(100, prom_map_size(map));
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+void test_prom_map_next(void) {
+  prom_map_t *map = prom_map_new();
+  char buf[8];
+  for (int i = 0; i < 100; i++) {
+    sprintf(buf, "%d", i);
+    prom_map_set(map, buf, (void *)(intptr_t)(i + 1));
+  }
+  prom_map_delete(map, "0");
+  prom_map_delete(map, "50");
+
+  // Values are visited in insertion order, skipping deleted ones
+  size_t cursor = 0;
+  int expected = 1;
+  for (void *value = prom_map_next(map, &cursor); value != NULL; value = prom_map_next(map, &cursor)) {
+    if (expected == 50) expected++;
+    TEST_ASSERT_EQUAL_INT(expected + 1, (intptr_t)value);
+    expected++;
+  }
+  TEST_ASSERT_EQUAL_INT(100, expected);
+
+  // Deleted slots are reclaimed, so churning through keys does not grow the map
+  for (int i = 0; i < 10000; i++) {
+    sprintf(buf, "c%d", i);
+    prom_map_set(map, buf, "churn");
+    prom_map_delete(map, buf);
+  }
+  TEST_ASSERT_EQUAL_INT(98, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(256, map->max_size);
+  TEST_ASSERT_EQUAL_INT(99, (intptr_t)prom_map_get(map, "98"));
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+void test_prom_map_resize(void) {
+  prom_map_t *map = prom_map_new();
+  char buf[8];
+
+  // The 18th key grows the map past half of its 32 slots. The slots of the old array are copied over by later calls.
+  for (int i = 0; i < 18; i++) {
+    sprintf(buf, "%d", i);
+    prom_map_set(map, buf, (void *)(intptr_t)(i + 1));
+  }
+  TEST_ASSERT_EQUAL_INT(64, map->max_size);
+  prom_map_table_t *prev = atomic_load(&map->table)->prev;
+  TEST_ASSERT_NOT_NULL(prev);
+  TEST_ASSERT_EQUAL_INT(32, prev->max_size);
+  for (int i = 0; i < 18; i++) {
+    sprintf(buf, "%d", i);
+    TEST_ASSERT_EQUAL_INT(i + 1, (intptr_t)prom_map_get(map, buf));
+  }
+
+  // Keys not copied yet may be replaced and deleted
+  prom_map_set(map, "1", (void *)(intptr_t)100);
+  TEST_ASSERT_NOT_NULL(atomic_load(&map->table)->prev);
+  prom_map_delete(map, "0");
+  TEST_ASSERT_NULL(prom_map_get(map, "0"));
+  TEST_ASSERT_EQUAL_INT(17, prom_map_size(map));
+
+  // Each insertion copies a few slots until the old array is detached
+  for (int i = 18; i < 22; i++) {
+    sprintf(buf, "%d", i);
+    prom_map_set(map, buf, (void *)(intptr_t)(i + 1));
+  }
+  TEST_ASSERT_NULL(atomic_load(&map->table)->prev);
+  TEST_ASSERT_NULL(prom_map_get(map, "0"));
+  TEST_ASSERT_EQUAL_INT(100, (intptr_t)prom_map_get(map, "1"));
+  for (int i = 2; i < 22; i++) {
+    sprintf(buf, "%d", i);
+    TEST_ASSERT_EQUAL_INT(i + 1, (intptr_t)prom_map_get(map, buf));
+  }
+
+  prom_map_set(map, "0", (void *)(intptr_t)200);
+  TEST_ASSERT_EQUAL_INT(200, (intptr_t)prom_map_get(map, "0"));
+  TEST_ASSERT_EQUAL_INT(22, prom_map_size(map));
+  TEST_ASSERT_EQUAL_INT(22, map->keys->size);
+
+  // Keys deleted after they were copied are not revived from the old array when set again
+  for (int i = 22; i < 34; i++) {
+    sprintf(buf, "%d", i);
+    prom_map_set(map, buf, (void *)(intptr_t)(i + 1));
+  }
+  TEST_ASSERT_EQUAL_INT(128, map->max_size);
+  TEST_ASSERT_NOT_NULL(atomic_load(&map->table)->prev);
+  for (int i = 0; i < 34; i++) {
+    sprintf(buf, "%d", i);
+    prom_map_delete(map, buf);
+    prom_map_set(map, buf, (void *)(intptr_t)(i + 1000));
+  }
+  TEST_ASSERT_NULL(atomic_load(&map->table)->prev);
+  for (int i = 0; i < 34; i++) {
+    sprintf(buf, "%d", i);
+    TEST_ASSERT_EQUAL_INT(i + 1000, (intptr_t)prom_map_get(map, buf));
+  }
+  TEST_ASSERT_EQUAL_INT(34, prom_map_size(map));
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+static bool test_prom_map_match_str(const void *value, const void *arg) {
+  return strcmp((const char *)value, (const char *)arg) == 0;
+}
+
+void test_prom_map_hashed(void) {
+  prom_map_t *map = prom_map_new();
+
+  // Values sharing a hash are told apart by the match function
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, 42, "one"));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, 42, "two"));
+  for (uint64_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, i * 0x9e3779b97f4a7c15ULL, "other"));
+  }
+  TEST_ASSERT_EQUAL_STRING("one", prom_map_get_hashed(map, 42, test_prom_map_match_str, "one"));
+  TEST_ASSERT_EQUAL_STRING("two", prom_map_get_hashed(map, 42, test_prom_map_match_str, "two"));
+  TEST_ASSERT_NULL(prom_map_get_hashed(map, 42, test_prom_map_match_str, "three"));
+  TEST_ASSERT_NULL(prom_map_get_hashed(map, 43ULL << 32, test_prom_map_match_str, "one"));
+  TEST_ASSERT_EQUAL_INT(1002, prom_map_size(map));
+
+  // Hashed values have no key
+  TEST_ASSERT_EQUAL_INT(0, map->keys->size);
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+void test_prom_map_remove_hashed(void) {
+  prom_map_t *map = prom_map_new();
+  static char values[2000][8];
+  for (int i = 0; i < 2000; i++) sprintf(values[i], "%d", i);
+
+  // Only the matching value is removed, and it is handed back rather than freed
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, 42, "one"));
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, 42, "two"));
+  TEST_ASSERT_EQUAL_STRING("one", prom_map_remove_hashed(map, 42, test_prom_map_match_str, "one"));
+  TEST_ASSERT_NULL(prom_map_remove_hashed(map, 42, test_prom_map_match_str, "one"));
+  TEST_ASSERT_NULL(prom_map_get_hashed(map, 42, test_prom_map_match_str, "one"));
+  TEST_ASSERT_EQUAL_STRING("two", prom_map_get_hashed(map, 42, test_prom_map_match_str, "two"));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(map));
+
+  // The emptied node is reused
+  TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, 7, "three"));
+  TEST_ASSERT_EQUAL_INT(2, map->node_count);
+
+  // Values removed while the map grows, some of them still in the slot array being migrated from, stay removed
+  for (uint64_t i = 0; i < 2000; i++) {
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, i * 0x9e3779b97f4a7c15ULL, values[i]));
+    if (i % 2 == 1) {
+      uint64_t j = i - 1;
+      TEST_ASSERT_EQUAL_PTR(values[j],
+                            prom_map_remove_hashed(map, j * 0x9e3779b97f4a7c15ULL, test_prom_map_match_str, values[j]));
+    }
+  }
+  for (uint64_t i = 0; i < 2000; i++) {
+    void *value = prom_map_get_hashed(map, i * 0x9e3779b97f4a7c15ULL, test_prom_map_match_str, values[i]);
+    if (i % 2 == 0) {
+      TEST_ASSERT_NULL(value);
+    } else {
+      TEST_ASSERT_EQUAL_PTR(values[i], value);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(1002, prom_map_size(map));
+
+  // Churn neither grows the nodes nor the slot array
+  size_t node_count = map->node_count;
+  size_t max_size = map->max_size;
+  for (uint64_t i = 0; i < 100000; i++) {
+    uint64_t hash = (i % 2000) * 0x9e3779b97f4a7c15ULL;
+    const char *value = values[i % 2000];
+    if (i % 2000 % 2 == 0) {
+      TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, hash, (void *)value));
+      TEST_ASSERT_EQUAL_PTR(value, prom_map_remove_hashed(map, hash, test_prom_map_match_str, value));
+      TEST_ASSERT_TRUE(map->retired_count <= 1);
+    }
+  }
+  TEST_ASSERT_TRUE(map->node_count <= node_count + 1);
+  TEST_ASSERT_TRUE(map->max_size <= max_size * 2);
+
+  size_t cursor = 0;
+  size_t visited = 0;
+  while (prom_map_next(map, &cursor) != NULL) visited++;
+  TEST_ASSERT_EQUAL_INT(1002, visited);
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
+void test_prom_map_retired_tables(void) {
+  prom_map_t *map = prom_map_new();
+  static char values[64][8];
+  for (int i = 0; i < 64; i++) sprintf(values[i], "%d", i);
+
+  // A critical section in progress keeps every slot array retired after it began
+  prom_epoch_enter();
+  for (uint64_t i = 0; i < 20000; i++) {
+    uint64_t hash = (i % 64) * 0x9e3779b97f4a7c15ULL;
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, hash, values[i % 64]));
+    TEST_ASSERT_EQUAL_PTR(values[i % 64], prom_map_remove_hashed(map, hash, test_prom_map_match_str, values[i % 64]));
+  }
+  size_t retired_count = map->retired_count;
+  TEST_ASSERT_TRUE(retired_count > 0);
+  prom_epoch_exit();
+
+  // Once it ends, they are freed by the next insertion and churn keeps at most one awaiting reclamation
+  for (uint64_t i = 0; i < 1000000; i++) {
+    uint64_t hash = (i % 64) * 0x9e3779b97f4a7c15ULL;
+    TEST_ASSERT_EQUAL_INT(0, prom_map_set_hashed(map, hash, values[i % 64]));
+    TEST_ASSERT_EQUAL_PTR(values[i % 64], prom_map_remove_hashed(map, hash, test_prom_map_match_str, values[i % 64]));
+    TEST_ASSERT_TRUE(map->retired_count <= 1);
+  }
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(map));
+
+  prom_map_destroy(map);
+  map = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_prom_map);
   RUN_TEST(test_prom_map_when_large);
+  RUN_TEST(test_prom_map_get_during_set);
+  RUN_TEST(test_prom_map_delete);
+  RUN_TEST(test_prom_map_next);
+  RUN_TEST(test_prom_map_resize);
+  RUN_TEST(test_prom_map_hashed);
+  RUN_TEST(test_prom_map_remove_hashed);
+  RUN_TEST(test_prom_map_retired_tables);
   return UNITY_END();
 }
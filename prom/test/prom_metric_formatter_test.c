@@ -127,11 +127,100 @@ void test_prom_metric_formatter_load_metrics(void) {
   PROM_COLLECTOR_REGISTRY_DEFAULT = NULL;
 }
 
+void test_prom_metric_formatter_load_metric_openmetrics(void) {
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  mf->format = PROM_EXPOSITION_FORMAT_OPENMETRICS;
+
+  prom_counter_t *c = prom_counter_new("test_requests_total", "counter under test", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_counter_add_with_exemplar(c, 2.0, (const char *[]){"f"}, 1,
+                                                          (const char *[]){"trace_id"}, (const char *[]){"abc"}));
+  prom_counter_child_t *child = prom_counter_with_labels(c, (const char *[]){"f"});
+  child->created = 1700000000.5;
+  child->exemplar->timestamp = 1700000001.25;
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, c));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_end(mf));
+  char *result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP test_requests counter under test\n"
+      "# TYPE test_requests counter\n"
+      "test_requests_total{foo=\"f\"} 2 # {trace_id=\"abc\"} 2 1700000001.25\n"
+      "test_requests_created{foo=\"f\"} 1700000000.5\n"
+      "# EOF\n",
+      result);
+  free(result);
+
+  prom_histogram_t *h =
+      prom_histogram_new("test_histogram", "histogram under test", prom_histogram_buckets_linear(5.0, 5.0, 2), 0, NULL);
+  prom_histogram_observe(h, 3.0, NULL);
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe_with_exemplar(h, 7.5, NULL, 1, (const char *[]){"trace_id"},
+                                                                (const char *[]){"def"}));
+  prom_histogram_child_t *h_child = prom_histogram_with_labels(h, NULL);
+  h_child->created = 1700000000.0;
+  h_child->exemplars[1]->timestamp = 1700000002.0;
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, h));
+  result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP test_histogram histogram under test\n"
+      "# TYPE test_histogram histogram\n"
+      "test_histogram_bucket{le=\"5.0\"} 1\n"
+      "test_histogram_bucket{le=\"10.0\"} 2 # {trace_id=\"def\"} 7.5 1700000002\n"
+      "test_histogram_bucket{le=\"+Inf\"} 2\n"
+      "test_histogram_count 2\n"
+      "test_histogram_sum 10.5\n"
+      "test_histogram_created 1700000000\n",
+      result);
+  free(result);
+
+  prom_histogram_destroy(h);
+  prom_counter_destroy(c);
+  prom_metric_formatter_destroy(mf);
+}
+
+void test_prom_metric_formatter_load_metric_protobuf(void) {
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  mf->format = PROM_EXPOSITION_FORMAT_PROTOBUF;
+
+  // A gauge without samples carries no data and is dropped
+  prom_gauge_t *g = prom_gauge_new("g", "h", 1, (const char *[]){"a"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, g));
+  TEST_ASSERT_EQUAL_INT(0, prom_string_builder_len(mf->string_builder));
+
+  prom_gauge_set(g, 1.0, (const char *[]){"b"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, g));
+
+  // MetricFamily{name: "g", help: "h", type: GAUGE, metric: [{label: [{name: "a", value: "b"}], gauge: {value: 1}}]}
+  const unsigned char expected[] = {0x1d, 0x0a, 0x01, 'g',  0x12, 0x01, 'h',  0x18, 0x01, 0x22, 0x13,
+                                    0x0a, 0x06, 0x0a, 0x01, 'a',  0x12, 0x01, 'b',  0x12, 0x09, 0x09,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x3f};
+  TEST_ASSERT_EQUAL_INT(sizeof(expected), prom_string_builder_len(mf->string_builder));
+  TEST_ASSERT_EQUAL_MEMORY(expected, prom_string_builder_str(mf->string_builder), sizeof(expected));
+  prom_metric_formatter_clear(mf);
+
+  // Messages are delimited by their length, however long the nested messages
+  prom_histogram_t *h = prom_histogram_new("test_histogram", "histogram under test",
+                                           prom_histogram_buckets_linear(1.0, 1.0, 20), 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_histogram_observe_with_exemplar(h, 3.0, (const char *[]){"bar"}, 1,
+                                                                (const char *[]){"trace_id"}, (const char *[]){"def"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, h));
+  const unsigned char *data = (const unsigned char *)prom_string_builder_str(mf->string_builder);
+  size_t len = prom_string_builder_len(mf->string_builder);
+  TEST_ASSERT(len > 128);
+  TEST_ASSERT_EQUAL_INT(0x80, data[0] & 0x80);
+  TEST_ASSERT_EQUAL_INT(len - 2, (data[0] & 0x7f) | (data[1] << 7));
+  TEST_ASSERT_EQUAL_INT(0x0a, data[2]);
+
+  prom_histogram_destroy(h);
+  prom_gauge_destroy(g);
+  prom_metric_formatter_destroy(mf);
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_prom_metric_formatter_load_l_value);
   RUN_TEST(test_prom_metric_formatter_load_sample);
   RUN_TEST(test_prom_metric_formatter_load_metric);
   RUN_TEST(test_prom_metric_formatter_load_metrics);
+  RUN_TEST(test_prom_metric_formatter_load_metric_openmetrics);
+  RUN_TEST(test_prom_metric_formatter_load_metric_protobuf);
   return UNITY_END();
 }
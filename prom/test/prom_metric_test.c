@@ -14,8 +14,17 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
 #include "prom_test_helpers.h"
 
+static void test_metric_sleep_ms(long ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
 void test_metric_with_no_labels(void) {
   prom_metric_t *metric = prom_metric_new(PROM_GAUGE, "test_counter", "counter under test", 0, NULL);
   prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, NULL);
@@ -37,9 +46,305 @@ void test_metric_sample_from_labels(void) {
   metric = NULL;
 }
 
+static void *test_metric_sample_from_labels_worker(void *arg) {
+  prom_metric_t *metric = (prom_metric_t *)arg;
+  const char *values[][1] = {{"a"}, {"b"}, {"c"}, {"d"}};
+  for (int i = 0; i < 1000; i++) {
+    prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, values[i % 4]);
+    if (sample == NULL) return (void *)1;
+    prom_metric_sample_add(sample, 1.0);
+  }
+  return NULL;
+}
+
+void test_metric_sample_from_labels_concurrent(void) {
+  prom_metric_t *metric = prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 1, (const char *[]){"foo"});
+
+  pthread_t workers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&workers[i], NULL, test_metric_sample_from_labels_worker, metric);
+  }
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(workers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+
+  // Every worker must have resolved the same four samples
+  TEST_ASSERT_EQUAL_INT(4, prom_map_size(metric->samples));
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, (const char *[]){"a"});
+  TEST_ASSERT_EQUAL_DOUBLE(1000.0, (_Atomic double)sample->r_value);
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_sample_from_labels_long_l_value(void) {
+  char value[512];
+  memset(value, 'x', sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+
+  prom_metric_t *metric = prom_metric_new(PROM_GAUGE, "test_metric", "test gauge", 1, (const char *[]){"foo"});
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, (const char *[]){value});
+  TEST_ASSERT_NOT_NULL(sample);
+  TEST_ASSERT_EQUAL_INT(strlen("test_metric{foo=\"\"}") + strlen(value) + 1, sample->prefix_len);
+  TEST_ASSERT_EQUAL_PTR(sample, prom_metric_sample_from_labels(metric, (const char *[]){value}));
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_sample_from_labels_tuple(void) {
+  prom_metric_t *metric =
+      prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 2, (const char *[]){"foo", "bar"});
+
+  // Series are identified by their label values one by one, so neither swapping nor shifting characters between values
+  // yields the same series
+  char value[16];
+  for (int i = 0; i < 300; i++) {
+    sprintf(value, "value_%d", i);
+    prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){value, "x"}), 1.0);
+    prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"x", value}), 2.0);
+  }
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"ab", "c"}), 3.0);
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"a", "bc"}), 4.0);
+  TEST_ASSERT_EQUAL_INT(602, prom_map_size(metric->samples));
+
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, (const char *[]){"value_299", "x"});
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"value_299\",bar=\"x\"} ", sample->prefix);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_value(sample));
+  sample = prom_metric_sample_from_labels(metric, (const char *[]){"x", "value_299"});
+  TEST_ASSERT_EQUAL_DOUBLE(2.0, prom_metric_sample_value(sample));
+  sample = prom_metric_sample_from_labels(metric, (const char *[]){"a", "bc"});
+  TEST_ASSERT_EQUAL_DOUBLE(4.0, prom_metric_sample_value(sample));
+
+  // Samples are kept in creation order for the exposition
+  size_t cursor = 0;
+  sample = (prom_metric_sample_t *)prom_map_next(metric->samples, &cursor);
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"value_0\",bar=\"x\"} ", sample->prefix);
+  sample = (prom_metric_sample_t *)prom_map_next(metric->samples, &cursor);
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"x\",bar=\"value_0\"} ", sample->prefix);
+  for (int i = 2; i < 601; i++) prom_map_next(metric->samples, &cursor);
+  sample = (prom_metric_sample_t *)prom_map_next(metric->samples, &cursor);
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"a\",bar=\"bc\"} ", sample->prefix);
+  TEST_ASSERT_NULL(prom_map_next(metric->samples, &cursor));
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_series_limit_drop(void) {
+  prom_metric_t *metric = prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_limit(metric, 2, PROM_SERIES_OVERFLOW_DROP));
+
+  TEST_ASSERT_NOT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"a"}));
+  TEST_ASSERT_NOT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"b"}));
+  TEST_ASSERT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"c"}));
+  TEST_ASSERT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"d"}));
+  TEST_ASSERT_EQUAL_INT(2, prom_metric_series_rejected(metric));
+
+  // Existing series are still updated
+  TEST_ASSERT_NOT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(metric->samples));
+  TEST_ASSERT_EQUAL_INT(2, prom_metric_series_rejected(metric));
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_series_limit_fold(void) {
+  prom_metric_t *metric =
+      prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 2, (const char *[]){"foo", "bar"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_limit(metric, 1, PROM_SERIES_OVERFLOW_FOLD));
+
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"a", "b"}), 1.0);
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"c", "d"}), 2.0);
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"e", "f"}), 3.0);
+  TEST_ASSERT_EQUAL_INT(2, prom_metric_series_rejected(metric));
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(metric->samples));
+
+  // Rejected updates are folded into a single series
+  prom_metric_sample_t *sample =
+      prom_metric_sample_from_labels(metric, (const char *[]){"__overflow__", "__overflow__"});
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"__overflow__\",bar=\"__overflow__\"} ", sample->prefix);
+  TEST_ASSERT_EQUAL_DOUBLE(5.0, prom_metric_sample_value(sample));
+  sample = prom_metric_sample_from_labels(metric, (const char *[]){"a", "b"});
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, prom_metric_sample_value(sample));
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_remove(void) {
+  prom_metric_t *metric = prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_limit(metric, 2, PROM_SERIES_OVERFLOW_DROP));
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"a"}), 1.0);
+  prom_metric_sample_add(prom_metric_sample_from_labels(metric, (const char *[]){"b"}), 2.0);
+  TEST_ASSERT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"c"}));
+
+  // A removed series is no longer exposed and frees up room for another one
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(metric->samples));
+  TEST_ASSERT_EQUAL_INT(0, metric->retired_count);
+  size_t cursor = 0;
+  prom_metric_sample_t *sample = (prom_metric_sample_t *)prom_map_next(metric->samples, &cursor);
+  TEST_ASSERT_EQUAL_STRING("test_metric{foo=\"b\"} ", sample->prefix);
+  TEST_ASSERT_NULL(prom_map_next(metric->samples, &cursor));
+  TEST_ASSERT_NOT_NULL(prom_metric_sample_from_labels(metric, (const char *[]){"c"}));
+
+  // Updating the label set again starts a new series
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, (const char *[]){"c"}));
+  sample = prom_metric_sample_from_labels(metric, (const char *[]){"a"});
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, prom_metric_sample_value(sample));
+
+  // Retired series are kept while an update that may have found them is in flight
+  prom_epoch_enter();
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, (const char *[]){"a"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, (const char *[]){"b"}));
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  TEST_ASSERT_EQUAL_INT(2, metric->retired_count);
+  prom_epoch_exit();
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  TEST_ASSERT_EQUAL_INT(0, metric->retired_count);
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+void test_metric_remove_reuses_memory(void) {
+  prom_metric_t *counter = prom_metric_new(PROM_COUNTER, "test_counter", "test counter", 1, (const char *[]){"foo"});
+  prom_histogram_t *histogram = prom_histogram_new("test_histogram", "test histogram",
+                                                   prom_histogram_buckets_linear(5.0, 5.0, 4), 1,
+                                                   (const char *[]){"foo"});
+
+  // Removing a series recycles it right away, so churning through label sets of the same length reuses its memory
+  // even if the metrics are never scraped
+  char value[16];
+  size_t counter_allocated = 0;
+  size_t histogram_allocated = 0;
+  size_t node_count = 0;
+  size_t interned = 0;
+  for (int i = 0; i < 1000; i++) {
+    sprintf(value, "value_%03d", i);
+    const char *label_values[] = {value};
+    prom_metric_sample_add(prom_metric_sample_from_labels(counter, label_values), 1.0);
+    prom_metric_sample_histogram_observe(prom_metric_sample_histogram_from_labels(histogram, label_values), 1.0);
+    prom_metric_sample_set_exemplar(counter, prom_metric_sample_from_labels(counter, label_values),
+                                    prom_exemplar_new(1, (const char *[]){"trace_id"}, label_values, 1.0));
+    TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(counter, label_values));
+    TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(histogram, label_values));
+    TEST_ASSERT_EQUAL_INT(0, counter->retired_count);
+    TEST_ASSERT_EQUAL_INT(0, histogram->retired_count);
+    if (i == 1) {
+      counter_allocated = prom_arena_allocated(counter->arena);
+      histogram_allocated = prom_arena_allocated(histogram->arena);
+      node_count = counter->samples->node_count;
+      interned = prom_map_size(prom_intern_default()->entries);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(counter_allocated, prom_arena_allocated(counter->arena));
+  TEST_ASSERT_EQUAL_INT(histogram_allocated, prom_arena_allocated(histogram->arena));
+  TEST_ASSERT_EQUAL_INT(node_count, counter->samples->node_count);
+  TEST_ASSERT_EQUAL_INT(0, prom_map_size(counter->samples));
+  // Label values are not interned, so they do not outlive their series
+  TEST_ASSERT_EQUAL_INT(interned, prom_map_size(prom_intern_default()->entries));
+
+  prom_metric_destroy(counter);
+  counter = NULL;
+  prom_histogram_destroy(histogram);
+  histogram = NULL;
+}
+
+void test_metric_series_ttl(void) {
+  prom_metric_t *metric = prom_metric_new(PROM_GAUGE, "test_metric", "test gauge", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_ttl(metric, 20));
+  prom_metric_sample_set(prom_metric_sample_from_labels(metric, (const char *[]){"a"}), 1.0);
+  prom_metric_sample_set(prom_metric_sample_from_labels(metric, (const char *[]){"b"}), 1.0);
+  prom_metric_sample_t *child = (prom_metric_sample_t *)prom_metric_series_pin(metric, (const char *[]){"c"});
+  TEST_ASSERT_NOT_NULL(child);
+
+  // Series idle for longer than the TTL expire, unless they were handed out as a child
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  TEST_ASSERT_EQUAL_INT(3, prom_map_size(metric->samples));
+  test_metric_sleep_ms(30);
+  prom_metric_sample_t *sample = prom_metric_sample_from_labels(metric, (const char *[]){"a"});
+  prom_metric_sample_set(sample, 2.0);
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(metric->samples));
+  TEST_ASSERT_EQUAL_INT(0, metric->retired_count);
+  TEST_ASSERT_EQUAL_DOUBLE(2.0, prom_metric_sample_value(sample));
+
+  // The update above counts as of the sweep that noticed it. Each scrape sweeps the metric first.
+  test_metric_sleep_ms(30);
+  prom_metric_formatter_t *mf = prom_metric_formatter_new();
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_formatter_load_metric(mf, metric));
+  char *result = prom_metric_formatter_dump(mf);
+  TEST_ASSERT_NULL(strstr(result, "test_metric{foo=\"a\"}"));
+  TEST_ASSERT_NOT_NULL(strstr(result, "test_metric{foo=\"c\"} 0"));
+  free(result);
+  prom_metric_formatter_destroy(mf);
+  TEST_ASSERT_EQUAL_INT(1, prom_map_size(metric->samples));
+  TEST_ASSERT_EQUAL_PTR(child, prom_metric_series_pin(metric, (const char *[]){"c"}));
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
+static _Atomic bool test_metric_remove_done;
+
+static void *test_metric_remove_worker(void *arg) {
+  prom_metric_t *metric = (prom_metric_t *)arg;
+  const char *values[][1] = {{"a"}, {"b"}, {"c"}, {"d"}, {"e"}, {"f"}, {"g"}, {"h"}};
+  for (int i = 0; !atomic_load(&test_metric_remove_done); i++) {
+    if (prom_counter_inc(metric, values[i % 8])) return (void *)1;
+  }
+  return NULL;
+}
+
+void test_metric_remove_concurrent(void) {
+  prom_metric_t *metric = prom_metric_new(PROM_COUNTER, "test_metric", "test counter", 1, (const char *[]){"foo"});
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_set_series_ttl(metric, 1));
+
+  // Series are removed and recreated while workers update them without a lock
+  atomic_store(&test_metric_remove_done, false);
+  pthread_t workers[4];
+  for (int i = 0; i < 4; i++) {
+    pthread_create(&workers[i], NULL, test_metric_remove_worker, metric);
+  }
+  const char *values[][1] = {{"a"}, {"c"}, {"e"}, {"g"}};
+  for (int i = 0; i < 2000; i++) {
+    TEST_ASSERT_EQUAL_INT(0, prom_metric_remove(metric, values[i % 4]));
+    if (i % 2 == 0) TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  }
+  atomic_store(&test_metric_remove_done, true);
+  for (int i = 0; i < 4; i++) {
+    void *result = NULL;
+    pthread_join(workers[i], &result);
+    TEST_ASSERT_NULL(result);
+  }
+  TEST_ASSERT_TRUE(prom_map_size(metric->samples) <= 8);
+
+  // With the workers gone, nothing holds off recycling any longer
+  TEST_ASSERT_EQUAL_INT(0, prom_metric_sweep(metric));
+  TEST_ASSERT_EQUAL_INT(0, metric->retired_count);
+
+  prom_metric_destroy(metric);
+  metric = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_metric_with_no_labels);
   RUN_TEST(test_metric_sample_from_labels);
+  RUN_TEST(test_metric_sample_from_labels_concurrent);
+  RUN_TEST(test_metric_sample_from_labels_long_l_value);
+  RUN_TEST(test_metric_sample_from_labels_tuple);
+  RUN_TEST(test_metric_series_limit_drop);
+  RUN_TEST(test_metric_series_limit_fold);
+  RUN_TEST(test_metric_remove);
+  RUN_TEST(test_metric_remove_reuses_memory);
+  RUN_TEST(test_metric_series_ttl);
+  RUN_TEST(test_metric_remove_concurrent);
   return UNITY_END();
 }
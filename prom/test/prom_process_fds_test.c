@@ -0,0 +1,81 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "prom_test_helpers.h"
+
+#define PROM_PROCESS_FDS_TEST_OPEN 64
+
+void test_prom_process_fds_count(void) {
+  int before = prom_process_fds_count(NULL);
+  TEST_ASSERT_TRUE(before > 0);
+
+  int fds[PROM_PROCESS_FDS_TEST_OPEN];
+  for (int i = 0; i < PROM_PROCESS_FDS_TEST_OPEN; i++) {
+    fds[i] = open("/dev/null", O_RDONLY);
+    TEST_ASSERT_TRUE(fds[i] >= 0);
+  }
+
+  // Every method that is available must agree
+  int expected = before + PROM_PROCESS_FDS_TEST_OPEN;
+  TEST_ASSERT_EQUAL_INT(expected, prom_process_fds_count(NULL));
+  TEST_ASSERT_EQUAL_INT(expected, prom_process_fds_count_readdir(NULL));
+  TEST_ASSERT_EQUAL_INT(expected, prom_process_fds_count_getdents(NULL));
+  int r = prom_process_fds_count_stat(NULL);
+  if (r != -1) TEST_ASSERT_EQUAL_INT(expected, r);
+  r = prom_process_fds_count_stat("/proc/self/fd");
+  if (r != -1) TEST_ASSERT_EQUAL_INT(expected, r);
+
+  for (int i = 0; i < PROM_PROCESS_FDS_TEST_OPEN; i++) close(fds[i]);
+  TEST_ASSERT_EQUAL_INT(before, prom_process_fds_count(NULL));
+}
+
+void test_prom_process_fds_count_dir(void) {
+  char dir[] = "/tmp/prom_process_fds_test.XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  char path[64];
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%d", dir, i);
+    int fd = open(path, O_WRONLY | O_CREAT, 0600);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+  }
+
+  // Outside of procfs the size of a directory is not its entry count, so only the scans apply
+  TEST_ASSERT_EQUAL_INT(-1, prom_process_fds_count_stat(dir));
+  TEST_ASSERT_EQUAL_INT(3, prom_process_fds_count_getdents(dir));
+  TEST_ASSERT_EQUAL_INT(3, prom_process_fds_count_readdir(dir));
+  TEST_ASSERT_EQUAL_INT(3, prom_process_fds_count(dir));
+
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%d", dir, i);
+    unlink(path);
+  }
+  rmdir(dir);
+
+  TEST_ASSERT_EQUAL_INT(-1, prom_process_fds_count(dir));
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_process_fds_count);
+  RUN_TEST(test_prom_process_fds_count_dir);
+  return UNITY_END();
+}
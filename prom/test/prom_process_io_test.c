@@ -0,0 +1,42 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prom_test_helpers.h"
+
+void test_prom_process_io_parse(void) {
+  prom_process_io_file_t *f = prom_procfs_buf_new("/code/prom/test/fixtures/io");
+  TEST_ASSERT_NOT_NULL(f);
+
+  prom_process_io_t io;
+  TEST_ASSERT_EQUAL_INT(0, prom_process_io_parse(&io, f));
+  TEST_ASSERT_EQUAL_UINT64(323934931, io.rchar);
+  TEST_ASSERT_EQUAL_UINT64(323929600, io.wchar);
+  TEST_ASSERT_EQUAL_UINT64(4096, io.read_bytes);
+  TEST_ASSERT_EQUAL_UINT64(323932160, io.write_bytes);
+  prom_procfs_buf_destroy(f);
+
+  // Every field is required
+  f = prom_procfs_buf_new("/code/prom/test/fixtures/status");
+  TEST_ASSERT_EQUAL_INT(1, prom_process_io_parse(&io, f));
+  prom_procfs_buf_destroy(f);
+  f = NULL;
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_process_io_parse);
+  return UNITY_END();
+}
@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 
 #include "prom_map_i.h"
 #include "prom_process_limits_i.h"
@@ -200,6 +201,65 @@ void test_prom_process_limits_rdp_letter(void) {
   cr = NULL;
 }
 
+void test_prom_process_limits_soft(void) {
+  prom_process_limits_file_t *f = prom_process_limits_file_new(path);
+  double soft = 0.0;
+
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_soft(f, "Max open files", &soft));
+  TEST_ASSERT_EQUAL_DOUBLE(1048576.0, soft);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_soft(f, "Max address space", &soft));
+  TEST_ASSERT_EQUAL_DOUBLE(-1.0, soft);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_soft(f, "Max realtime timeout", &soft));
+  TEST_ASSERT_EQUAL_DOUBLE(-1.0, soft);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_soft(f, "Max core file size", &soft));
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, soft);
+
+  // Names must match whole
+  TEST_ASSERT_EQUAL_INT(1, prom_process_limits_soft(f, "Max realtime", &soft));
+  TEST_ASSERT_EQUAL_INT(1, prom_process_limits_soft(f, "Max open", &soft));
+
+  prom_process_limits_file_destroy(f);
+  f = NULL;
+}
+
+void test_prom_process_limits_load(void) {
+  prom_process_limits_values_t limits = {0.0, 0.0, 0};
+
+  // Without a file the limits come from getrlimit on every load
+  struct rlimit nofile;
+  TEST_ASSERT_EQUAL_INT(0, getrlimit(RLIMIT_NOFILE, &nofile));
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_load(&limits, NULL));
+  if (nofile.rlim_cur == RLIM_INFINITY) {
+    TEST_ASSERT_EQUAL_DOUBLE(-1.0, limits.max_fds);
+  } else {
+    TEST_ASSERT_EQUAL_DOUBLE((double)nofile.rlim_cur, limits.max_fds);
+  }
+  TEST_ASSERT_EQUAL_UINT64(0, limits.loaded_at);
+
+  prom_process_limits_file_t *f = prom_process_limits_file_new(path);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_load(&limits, f));
+  TEST_ASSERT_EQUAL_DOUBLE(1048576.0, limits.max_fds);
+  TEST_ASSERT_EQUAL_DOUBLE(-1.0, limits.virtual_memory_max_bytes);
+  uint64_t loaded_at = limits.loaded_at;
+  TEST_ASSERT_NOT_EQUAL(0, loaded_at);
+
+  // Within the refresh interval the file is not read again
+  f->buf[0] = '\0';
+  limits.max_fds = 0.0;
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_load(&limits, f));
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, limits.max_fds);
+  TEST_ASSERT_EQUAL_UINT64(loaded_at, limits.loaded_at);
+
+  // Once the interval has passed it is
+  limits.loaded_at -= PROM_PROCESS_LIMITS_REFRESH_INTERVAL_NS;
+  TEST_ASSERT_EQUAL_INT(0, prom_process_limits_load(&limits, f));
+  TEST_ASSERT_EQUAL_DOUBLE(1048576.0, limits.max_fds);
+  TEST_ASSERT_TRUE(limits.loaded_at >= loaded_at);
+
+  prom_process_limits_file_destroy(f);
+  f = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_prom_process_limits_rdp_next_token);
@@ -211,5 +271,7 @@ int main(int argc, const char **argv) {
   RUN_TEST(test_prom_process_limits_rdp_letter);
 
   RUN_TEST(test_prom_process_limits_file_parsing);
+  RUN_TEST(test_prom_process_limits_soft);
+  RUN_TEST(test_prom_process_limits_load);
   return UNITY_END();
 }
@@ -0,0 +1,85 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "prom_test_helpers.h"
+
+void test_prom_process_stat_parse(void) {
+  prom_process_stat_file_t *f = prom_process_stat_file_new("/code/prom/test/fixtures/stat");
+  TEST_ASSERT_NOT_NULL(f);
+
+  prom_process_stat_t stat;
+  TEST_ASSERT_EQUAL_INT(0, prom_process_stat_parse(&stat, f));
+  TEST_ASSERT_EQUAL_INT(3, stat.utime);
+  TEST_ASSERT_EQUAL_INT(4, stat.stime);
+  TEST_ASSERT_EQUAL_INT(29414985, stat.starttime);
+  TEST_ASSERT_EQUAL_INT(19058688, stat.vsize);
+  TEST_ASSERT_EQUAL_INT(885, stat.rss);
+  TEST_ASSERT_EQUAL_INT(1463, stat.minflt);
+  TEST_ASSERT_EQUAL_INT(0, stat.majflt);
+  TEST_ASSERT_EQUAL_INT(1, stat.num_threads);
+
+  char comm[PROM_PROCESS_STAT_COMM_SIZE];
+  TEST_ASSERT_EQUAL_INT(0, prom_process_stat_comm(f, comm));
+  TEST_ASSERT_EQUAL_STRING("bash", comm);
+
+  prom_process_stat_file_destroy(f);
+  f = NULL;
+}
+
+void test_prom_process_stat_parse_comm(void) {
+  // The command name may contain spaces and parentheses
+  char contents[] = "7 (a) b (c)) R 1 7 7 0 -1 4194560 10 0 0 0 12 34 0 0 20 0 1 0 56 78 9 18446744073709551615";
+  prom_process_stat_file_t f = {.size = sizeof(contents), .index = 0, .buf = contents};
+  prom_process_stat_t stat;
+  TEST_ASSERT_EQUAL_INT(0, prom_process_stat_parse(&stat, &f));
+  TEST_ASSERT_EQUAL_INT(12, stat.utime);
+  TEST_ASSERT_EQUAL_INT(34, stat.stime);
+  TEST_ASSERT_EQUAL_INT(56, stat.starttime);
+  TEST_ASSERT_EQUAL_INT(78, stat.vsize);
+  TEST_ASSERT_EQUAL_INT(9, stat.rss);
+  TEST_ASSERT_EQUAL_INT(10, stat.minflt);
+  TEST_ASSERT_EQUAL_INT(1, stat.num_threads);
+
+  char comm[PROM_PROCESS_STAT_COMM_SIZE];
+  TEST_ASSERT_EQUAL_INT(0, prom_process_stat_comm(&f, comm));
+  TEST_ASSERT_EQUAL_STRING("a) b (c)", comm);
+
+  // Names longer than the kernel allows are truncated
+  char long_comm[] = "7 (0123456789abcdefgh) R";
+  f.buf = long_comm;
+  f.size = sizeof(long_comm);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_stat_comm(&f, comm));
+  TEST_ASSERT_EQUAL_STRING("0123456789abcde", comm);
+
+  // Contents ending before the last field are rejected
+  char truncated[] = "7 (a) R 1 7 7 0 -1 4194560 10 0 0 0 12 34 0 0 20 0 1 0 56 78";
+  f.buf = truncated;
+  f.size = sizeof(truncated);
+  TEST_ASSERT_EQUAL_INT(1, prom_process_stat_parse(&stat, &f));
+
+  char no_comm[] = "7 a R 1";
+  f.buf = no_comm;
+  f.size = sizeof(no_comm);
+  TEST_ASSERT_EQUAL_INT(1, prom_process_stat_parse(&stat, &f));
+  TEST_ASSERT_EQUAL_INT(1, prom_process_stat_comm(&f, comm));
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_process_stat_parse);
+  RUN_TEST(test_prom_process_stat_parse_comm);
+  return UNITY_END();
+}
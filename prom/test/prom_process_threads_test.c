@@ -0,0 +1,153 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prom_test_helpers.h"
+
+static double prom_process_threads_test_value(const char *name) {
+  prom_metric_sample_t *sample =
+      prom_metric_sample_from_labels(prom_process_thread_cpu_seconds_total, (const char *[]){name});
+  return prom_metric_sample_value(sample);
+}
+
+void test_prom_process_threads_update(void) {
+  prom_process_threads_init();
+  prom_process_threads_t *threads = prom_process_threads_new("/code/prom/test/fixtures/task");
+  TEST_ASSERT_NOT_NULL(threads);
+
+  // Threads are grouped by name
+  double ticks = (double)sysconf(_SC_CLK_TCK);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_INT(2, threads->count);
+  TEST_ASSERT_EQUAL_INT(2, prom_map_size(prom_process_thread_cpu_seconds_total->samples));
+  TEST_ASSERT_EQUAL_DOUBLE(7.0 / ticks, prom_process_threads_test_value("bash"));
+  TEST_ASSERT_EQUAL_DOUBLE(50.0 / ticks, prom_process_threads_test_value("worker"));
+
+  // Updates set the sums again rather than adding to them
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(50.0 / ticks, prom_process_threads_test_value("worker"));
+  TEST_ASSERT_EQUAL_INT(3, threads->task_count);
+
+  prom_process_threads_destroy(threads);
+  threads = NULL;
+  prom_counter_destroy(prom_process_thread_cpu_seconds_total);
+  prom_process_thread_cpu_seconds_total = NULL;
+}
+
+// Writes the stat file of a thread into the task directory dir
+static void prom_process_threads_test_write(const char *dir, int tid, const char *comm, int ticks, int starttime) {
+  char path[128];
+  snprintf(path, sizeof(path), "%s/%d", dir, tid);
+  mkdir(path, 0700);
+  snprintf(path, sizeof(path), "%s/%d/stat", dir, tid);
+  FILE *f = fopen(path, "w");
+  TEST_ASSERT_NOT_NULL(f);
+  fprintf(f, "%d (%s) S 0 1 1 34816 410 4210944 1463 89550 0 7 %d 0 165 193 20 0 1 0 %d 19058688 885\n", tid, comm,
+          ticks, starttime);
+  fclose(f);
+}
+
+static void prom_process_threads_test_remove(const char *dir, int tid) {
+  char path[128];
+  snprintf(path, sizeof(path), "%s/%d/stat", dir, tid);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/%d", dir, tid);
+  rmdir(path);
+}
+
+void test_prom_process_threads_update_monotonic(void) {
+  prom_process_threads_init();
+  char dir[] = "/tmp/prom_process_threads_test.XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  prom_process_threads_test_write(dir, 2, "worker", 10, 100);
+  prom_process_threads_test_write(dir, 3, "worker", 20, 100);
+  prom_process_threads_t *threads = prom_process_threads_new(dir);
+  TEST_ASSERT_NOT_NULL(threads);
+
+  double ticks = (double)sysconf(_SC_CLK_TCK);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(30.0 / ticks, prom_process_threads_test_value("worker"));
+
+  // The CPU time of a thread that exited stays counted
+  prom_process_threads_test_remove(dir, 3);
+  prom_process_threads_test_write(dir, 2, "worker", 15, 100);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(35.0 / ticks, prom_process_threads_test_value("worker"));
+  TEST_ASSERT_EQUAL_INT(1, threads->task_count);
+
+  // A renamed thread leaves its CPU time up to the update that noticed the new name under its former name
+  prom_process_threads_test_write(dir, 2, "renamed", 17, 100);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(37.0 / ticks, prom_process_threads_test_value("worker"));
+  TEST_ASSERT_EQUAL_DOUBLE(0.0, prom_process_threads_test_value("renamed"));
+  prom_process_threads_test_write(dir, 2, "renamed", 19, 100);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0 / ticks, prom_process_threads_test_value("renamed"));
+
+  // A new thread reusing the id of one that exited is told apart by its start time
+  prom_process_threads_test_write(dir, 2, "worker", 1, 200);
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_DOUBLE(38.0 / ticks, prom_process_threads_test_value("worker"));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0 / ticks, prom_process_threads_test_value("renamed"));
+
+  // Names beyond the limit share a single series
+  char comm[16];
+  for (int i = 0; i < PROM_PROCESS_THREADS_MAX_NAMES; i++) {
+    snprintf(comm, sizeof(comm), "pool-%d", i);
+    prom_process_threads_test_write(dir, 100 + i, comm, 1, 100);
+  }
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_EQUAL_INT(PROM_PROCESS_THREADS_MAX_NAMES + 1, threads->count);
+  TEST_ASSERT_EQUAL_INT(PROM_PROCESS_THREADS_MAX_NAMES + 1,
+                        prom_map_size(prom_process_thread_cpu_seconds_total->samples));
+  TEST_ASSERT_EQUAL_DOUBLE(2.0 / ticks, prom_process_threads_test_value(PROM_PROCESS_THREADS_OVERFLOW_NAME));
+
+  prom_process_threads_destroy(threads);
+  threads = NULL;
+  for (int i = 0; i < PROM_PROCESS_THREADS_MAX_NAMES; i++) prom_process_threads_test_remove(dir, 100 + i);
+  prom_process_threads_test_remove(dir, 2);
+  rmdir(dir);
+  prom_counter_destroy(prom_process_thread_cpu_seconds_total);
+  prom_process_thread_cpu_seconds_total = NULL;
+}
+
+void test_prom_process_threads_update_self(void) {
+  prom_process_threads_init();
+  prom_process_threads_t *threads = prom_process_threads_new("/proc/self/task");
+  TEST_ASSERT_NOT_NULL(threads);
+
+  TEST_ASSERT_EQUAL_INT(0, prom_process_threads_update(threads));
+  TEST_ASSERT_TRUE(threads->count >= 1);
+  TEST_ASSERT_EQUAL_INT(threads->count, prom_map_size(prom_process_thread_cpu_seconds_total->samples));
+
+  prom_process_threads_destroy(threads);
+  threads = NULL;
+  prom_counter_destroy(prom_process_thread_cpu_seconds_total);
+  prom_process_thread_cpu_seconds_total = NULL;
+
+  TEST_ASSERT_NULL(prom_process_threads_new("/code/prom/test/fixtures/missing"));
+}
+
+int main(int argc, const char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_prom_process_threads_update);
+  RUN_TEST(test_prom_process_threads_update_monotonic);
+  RUN_TEST(test_prom_process_threads_update_self);
+  return UNITY_END();
+}
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "prom_test_helpers.h"
 
 void test_prom_procfs_buf(void) {
@@ -24,8 +27,92 @@ void test_prom_procfs_buf(void) {
   buf = NULL;
 }
 
+void test_prom_procfs_buf_read(void) {
+  prom_procfs_buf_t *buf = prom_procfs_buf_open("/code/prom/test/fixtures/limits");
+  TEST_ASSERT_NOT_NULL(buf);
+  TEST_ASSERT_EQUAL_STRING("", buf->buf);
+
+  // Reads reuse the buffer
+  char *data = buf->buf;
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_read(buf));
+  size_t size = buf->size;
+  TEST_ASSERT_EQUAL_PTR(data, buf->buf);
+  TEST_ASSERT_EQUAL_INT(0, strncmp(buf->buf, "Limit ", 6));
+  buf->index = 3;
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_read(buf));
+  TEST_ASSERT_EQUAL_INT(size, buf->size);
+  TEST_ASSERT_EQUAL_INT(0, buf->index);
+  TEST_ASSERT_EQUAL_PTR(data, buf->buf);
+  TEST_ASSERT_EQUAL_INT(size - 1, strlen(buf->buf));
+
+  // Contents that do not fit grow the buffer and are read again from the start
+  buf->allocated = 16;
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_read(buf));
+  TEST_ASSERT_EQUAL_INT(size, buf->size);
+  TEST_ASSERT(buf->allocated >= size);
+  TEST_ASSERT_EQUAL_INT(0, strncmp(buf->buf, "Limit ", 6));
+  TEST_ASSERT_NOT_NULL(strstr(buf->buf, "Max realtime timeout"));
+
+  prom_procfs_buf_destroy(buf);
+  buf = NULL;
+
+  TEST_ASSERT_NULL(prom_procfs_buf_open("/code/prom/test/fixtures/missing"));
+}
+
+void test_prom_procfs_buf_read_at(void) {
+  // A buffer without a file reads a different file every time
+  prom_procfs_buf_t *buf = prom_procfs_buf_open(NULL);
+  TEST_ASSERT_NOT_NULL(buf);
+  TEST_ASSERT_EQUAL_INT(-1, buf->fd);
+
+  int dir_fd = open("/code/prom/test/fixtures", O_RDONLY | O_DIRECTORY);
+  TEST_ASSERT_TRUE(dir_fd >= 0);
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_read_at(buf, dir_fd, "task/2/stat"));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(buf->buf, "2 (worker) ", 11));
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_read_at(buf, dir_fd, "io"));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(buf->buf, "rchar: ", 7));
+  TEST_ASSERT_EQUAL_INT(1, prom_procfs_buf_read_at(buf, dir_fd, "task/4/stat"));
+  close(dir_fd);
+
+  prom_procfs_buf_destroy(buf);
+  buf = NULL;
+}
+
+void test_prom_procfs_buf_value(void) {
+  prom_procfs_buf_t *buf = prom_procfs_buf_new("/code/prom/test/fixtures/io");
+  TEST_ASSERT_NOT_NULL(buf);
+  uint64_t value = 0;
+
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_value(buf, "rchar", &value));
+  TEST_ASSERT_EQUAL_UINT64(323934931, value);
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_value(buf, "write_bytes", &value));
+  TEST_ASSERT_EQUAL_UINT64(323932160, value);
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_value(buf, "cancelled_write_bytes", &value));
+  TEST_ASSERT_EQUAL_UINT64(0, value);
+
+  // Keys must match whole and start a line
+  TEST_ASSERT_EQUAL_INT(1, prom_procfs_buf_value(buf, "read", &value));
+  TEST_ASSERT_EQUAL_INT(1, prom_procfs_buf_value(buf, "char", &value));
+  TEST_ASSERT_EQUAL_INT(1, prom_procfs_buf_value(buf, "missing", &value));
+
+  prom_procfs_buf_destroy(buf);
+
+  // Values may be separated by tabs and must be numeric
+  buf = prom_procfs_buf_new("/code/prom/test/fixtures/status");
+  TEST_ASSERT_NOT_NULL(buf);
+  TEST_ASSERT_EQUAL_INT(0, prom_procfs_buf_value(buf, "Threads", &value));
+  TEST_ASSERT_EQUAL_UINT64(3, value);
+  TEST_ASSERT_EQUAL_INT(1, prom_procfs_buf_value(buf, "Name", &value));
+
+  prom_procfs_buf_destroy(buf);
+  buf = NULL;
+}
+
 int main(int argc, const char **argv) {
   UNITY_BEGIN();
   RUN_TEST(test_prom_procfs_buf);
+  RUN_TEST(test_prom_procfs_buf_read);
+  RUN_TEST(test_prom_procfs_buf_read_at);
+  RUN_TEST(test_prom_procfs_buf_value);
   return UNITY_END();
 }
@@ -4,8 +4,22 @@
 #include <string.h>
 
 #include "prom.h"
+#include "prom_allocator_i.h"
+#include "prom_allocator_t.h"
+#include "prom_arena_i.h"
+#include "prom_arena_t.h"
 #include "prom_collector_registry_t.h"
 #include "prom_collector_t.h"
+#include "prom_counter_i.h"
+#include "prom_dtoa_i.h"
+#include "prom_epoch_i.h"
+#include "prom_epoch_t.h"
+#include "prom_exemplar_i.h"
+#include "prom_exemplar_t.h"
+#include "prom_histogram_native_i.h"
+#include "prom_histogram_native_t.h"
+#include "prom_intern_i.h"
+#include "prom_intern_t.h"
 #include "prom_linked_list_i.h"
 #include "prom_linked_list_t.h"
 #include "prom_map_i.h"
@@ -20,10 +34,16 @@
 #include "prom_metric_t.h"
 #include "prom_process_fds_i.h"
 #include "prom_process_fds_t.h"
+#include "prom_process_io_i.h"
+#include "prom_process_io_t.h"
 #include "prom_process_limits_i.h"
 #include "prom_process_limits_t.h"
 #include "prom_process_stat_i.h"
 #include "prom_process_stat_t.h"
+#include "prom_process_status_i.h"
+#include "prom_process_status_t.h"
+#include "prom_process_threads_i.h"
+#include "prom_process_threads_t.h"
 #include "prom_procfs_i.h"
 #include "prom_procfs_t.h"
 #include "prom_string_builder_i.h"
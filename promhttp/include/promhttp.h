@@ -17,12 +17,20 @@
 /**
  * @file promhttp.h
  * @brief Provides a HTTP endpoint for metric exposition
+ *
+ * The exposition format is negotiated from the Accept request header. The Prometheus text format is served by default
+ * and length delimited protobuf to scrapers accepting
+ * application/vnd.google.protobuf;proto=io.prometheus.client.MetricFamily;encoding=delimited. The OpenMetrics text
+ * format must be enabled with promhttp_set_openmetrics before it is served to scrapers accepting
+ * application/openmetrics-text.
+ *
  * References:
  *   * MHD_FLAG: https://www.gnu.org/software/libmicrohttpd/manual/libmicrohttpd.html#microhttpd_002dconst
  *   * MHD_AcceptPolicyCallback:
  * https://www.gnu.org/software/libmicrohttpd/manual/libmicrohttpd.html#index-_002aMHD_005fAcceptPolicyCallback
  */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include "microhttpd.h"
@@ -36,6 +44,37 @@
  */
 void promhttp_set_active_collector_registry(prom_collector_registry_t *active_registry);
 
+/**
+ * @brief Passing PROMHTTP_COMPRESSION_DEFAULT_LEVEL to promhttp_set_compression selects the default level of each
+ * compression codec.
+ */
+#define PROMHTTP_COMPRESSION_DEFAULT_LEVEL -1
+
+/**
+ * @brief Configures compression of the metric exposition.
+ *
+ * The exposition is compressed with gzip, or zstd when promhttp is built with zstd support, if the scraper accepts it
+ * as indicated by the Accept-Encoding request header. Compression happens incrementally as the registry is rendered.
+ * By default the default level of each codec is used and expositions smaller than 1024 bytes are sent uncompressed.
+ * This function MUST be called before the daemon is started.
+ *
+ * @param level The compression level, e.g. 1 through 9 for gzip. PROMHTTP_COMPRESSION_DEFAULT_LEVEL selects the default
+ *              level of each codec and 0 disables compression.
+ * @param min_size Expositions smaller than min_size bytes are sent uncompressed.
+ */
+void promhttp_set_compression(int level, size_t min_size);
+
+/**
+ * @brief Enables the OpenMetrics text format for scrapers that accept it.
+ *
+ * Disabled by default. Prometheus lists OpenMetrics first in its Accept request header, so enabling it switches
+ * existing deployments to OpenMetrics, which also exposes a _created series for each counter and histogram series.
+ * This function MUST be called before the daemon is started.
+ *
+ * @param enabled Whether application/openmetrics-text is negotiated
+ */
+void promhttp_set_openmetrics(bool enabled);
+
 /**
  *  @brief Starts a daemon in the background and returns a pointer to an HMD_Daemon.
  *
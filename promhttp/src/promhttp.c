@@ -14,13 +14,68 @@
  * limitations under the License.
  */
 
+#include <stdbool.h>
 #include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+#ifdef PROMHTTP_ZSTD
+#include <zstd.h>
+#endif
 
 #include "microhttpd.h"
 #include "prom.h"
+#include "promhttp.h"
+
+#define PROMHTTP_STREAM_BLOCK_SIZE 32768
+
+// Expositions smaller than this are sent uncompressed unless promhttp_set_compression says otherwise
+#define PROMHTTP_COMPRESSION_MIN_SIZE 1024
+
+// The gzip header and trailer are requested by adding 16 to the maximum window size
+#define PROMHTTP_GZIP_WINDOW_BITS (15 + 16)
+#define PROMHTTP_GZIP_MEM_LEVEL 8
 
 prom_collector_registry_t *PROM_ACTIVE_REGISTRY;
 
+static int promhttp_compression_level = PROMHTTP_COMPRESSION_DEFAULT_LEVEL;
+static size_t promhttp_compression_min_size = PROMHTTP_COMPRESSION_MIN_SIZE;
+static bool promhttp_openmetrics = false;
+
+typedef enum promhttp_encoding {
+  PROMHTTP_ENCODING_IDENTITY,
+  PROMHTTP_ENCODING_GZIP,
+  PROMHTTP_ENCODING_ZSTD
+} promhttp_encoding_t;
+
+static const char *promhttp_encoding_names[] = {"identity", "gzip", "zstd"};
+
+// The Content-Type of each exposition format, indexed by prom_exposition_format_t
+static const char *promhttp_content_types[] = {
+    "text/plain; version=0.0.4; charset=utf-8", "application/openmetrics-text; version=1.0.0; charset=utf-8",
+    "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited"};
+
+/**
+ * @brief Compresses a registry stream as libmicrohttpd drains the response. The uncompressed exposition is read into
+ * in one block at a time and handed to the compressor, so neither the plain nor the compressed exposition is ever
+ * held in full.
+ */
+typedef struct promhttp_compressed_stream {
+  prom_collector_registry_stream_t *stream; /**< The uncompressed exposition */
+  promhttp_encoding_t encoding;             /**< The negotiated content coding */
+  char *in;                                 /**< Uncompressed input */
+  size_t in_size;                           /**< The size of in in bytes */
+  size_t in_len;                            /**< The number of bytes held in in */
+  size_t in_pos;                            /**< The number of bytes of in already consumed by the compressor */
+  bool in_done;                             /**< Set once the exposition has been read in full */
+  bool finished;                            /**< Set once the compressor has written its final block */
+  bool initialized;                         /**< Set once the compressor has been initialized */
+  z_stream zs;                              /**< The gzip compressor */
+#ifdef PROMHTTP_ZSTD
+  ZSTD_CCtx *cctx; /**< The zstd compressor */
+#endif
+} promhttp_compressed_stream_t;
+
 void promhttp_set_active_collector_registry(prom_collector_registry_t *active_registry) {
   if (!active_registry) {
     PROM_ACTIVE_REGISTRY = PROM_COLLECTOR_REGISTRY_DEFAULT;
@@ -29,6 +84,338 @@ void promhttp_set_active_collector_registry(prom_collector_registry_t *active_re
   }
 }
 
+void promhttp_set_compression(int level, size_t min_size) {
+  promhttp_compression_level = level;
+  promhttp_compression_min_size = min_size;
+}
+
+void promhttp_set_openmetrics(bool enabled) { promhttp_openmetrics = enabled; }
+
+/**
+ * @brief Returns a pointer to the value of the named parameter within the parameters of an Accept or Accept-Encoding
+ * element, or NULL if the parameter is absent.
+ */
+static const char *promhttp_param(const char *params, size_t len, const char *name) {
+  size_t name_len = strlen(name);
+  for (size_t i = 0; i + name_len < len; i++) {
+    if (strncasecmp(params + i, name, name_len) != 0 || params[i + name_len] != '=') continue;
+    if (i > 0 && params[i - 1] != ';' && params[i - 1] != ' ' && params[i - 1] != '\t') continue;
+    return params + i + name_len + 1;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Returns true if the named parameter of an element has the given value
+ */
+static bool promhttp_param_is(const char *params, size_t len, const char *name, const char *value) {
+  const char *v = promhttp_param(params, len, name);
+  if (v == NULL) return false;
+  size_t value_len = strlen(value);
+  if ((size_t)(params + len - v) < value_len || strncasecmp(v, value, value_len) != 0) return false;
+  v += value_len;
+  return v == params + len || *v == ' ' || *v == '\t' || *v == ';';
+}
+
+/**
+ * @brief Returns the q-value of an element in thousandths, 1000 if the element carries none
+ */
+static int promhttp_qvalue(const char *params, size_t len) {
+  const char *v = promhttp_param(params, len, "q");
+  if (v == NULL) return 1000;
+  const char *end = params + len;
+  if (v == end || (*v != '0' && *v != '1')) return 1000;
+  int q = (*v++ - '0') * 1000;
+  if (v < end && *v == '.') {
+    v++;
+    for (int scale = 100; scale > 0 && v < end && *v >= '0' && *v <= '9'; scale /= 10, v++) {
+      q += (*v - '0') * scale;
+    }
+  }
+  return (q > 1000) ? 1000 : q;
+}
+
+/**
+ * @brief Picks the content coding of the exposition from the Accept-Encoding request header. zstd is preferred over
+ * gzip when both are accepted and promhttp was built with zstd support.
+ */
+static promhttp_encoding_t promhttp_negotiate_encoding(struct MHD_Connection *connection) {
+  if (promhttp_compression_level == 0) return PROMHTTP_ENCODING_IDENTITY;
+
+  const char *header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  if (header == NULL) return PROMHTTP_ENCODING_IDENTITY;
+
+  // -1 means the coding is not listed, 0 that it is refused and 1 that it is accepted. Unlisted codings fall back on
+  // the wildcard.
+  int gzip = -1;
+  int zstd = -1;
+  int wildcard = -1;
+  const char *p = header;
+  while (*p != '\0') {
+    p += strspn(p, " \t,");
+    const char *coding = p;
+    size_t coding_len = strcspn(p, " \t;,");
+    p += coding_len;
+    size_t params_len = strcspn(p, ",");
+    int accepted = (promhttp_qvalue(p, params_len) == 0) ? 0 : 1;
+    p += params_len;
+
+    if (coding_len == 4 && strncasecmp(coding, "gzip", 4) == 0) {
+      gzip = accepted;
+    } else if (coding_len == 4 && strncasecmp(coding, "zstd", 4) == 0) {
+      zstd = accepted;
+    } else if (coding_len == 1 && *coding == '*') {
+      wildcard = accepted;
+    }
+  }
+  if (gzip == -1) gzip = wildcard;
+  if (zstd == -1) zstd = wildcard;
+
+#ifdef PROMHTTP_ZSTD
+  if (zstd == 1) return PROMHTTP_ENCODING_ZSTD;
+#endif
+  if (gzip == 1) return PROMHTTP_ENCODING_GZIP;
+  return PROMHTTP_ENCODING_IDENTITY;
+}
+
+/**
+ * @brief Picks the exposition format from the Accept request header. The supported media type with the highest q-value
+ * wins, the earliest listed one breaking ties. The text format is used when nothing else is accepted. OpenMetrics is
+ * only considered once enabled by promhttp_set_openmetrics.
+ */
+static prom_exposition_format_t promhttp_negotiate_format(struct MHD_Connection *connection) {
+  const char *header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT);
+  if (header == NULL) return PROM_EXPOSITION_FORMAT_TEXT;
+
+  prom_exposition_format_t format = PROM_EXPOSITION_FORMAT_TEXT;
+  int best = 0;
+  const char *p = header;
+  while (*p != '\0') {
+    p += strspn(p, " \t,");
+    const char *type = p;
+    size_t type_len = strcspn(p, " \t;,");
+    p += type_len;
+    const char *params = p;
+    size_t params_len = strcspn(p, ",");
+    p += params_len;
+
+    prom_exposition_format_t candidate;
+    if (type_len == 28 && strncasecmp(type, "application/openmetrics-text", 28) == 0) {
+      if (!promhttp_openmetrics) continue;
+      candidate = PROM_EXPOSITION_FORMAT_OPENMETRICS;
+    } else if (type_len == 31 && strncasecmp(type, "application/vnd.google.protobuf", 31) == 0 &&
+               promhttp_param_is(params, params_len, "proto", "io.prometheus.client.MetricFamily") &&
+               promhttp_param_is(params, params_len, "encoding", "delimited")) {
+      candidate = PROM_EXPOSITION_FORMAT_PROTOBUF;
+    } else if ((type_len == 10 && strncasecmp(type, "text/plain", 10) == 0) ||
+               (type_len == 3 && strncmp(type, "*/*", 3) == 0)) {
+      candidate = PROM_EXPOSITION_FORMAT_TEXT;
+    } else {
+      continue;
+    }
+
+    int q = promhttp_qvalue(params, params_len);
+    if (q > best) {
+      best = q;
+      format = candidate;
+    }
+  }
+  return format;
+}
+
+static void promhttp_compressed_stream_destroy(promhttp_compressed_stream_t *self) {
+  if (self == NULL) return;
+  if (self->initialized) {
+    if (self->encoding == PROMHTTP_ENCODING_GZIP) deflateEnd(&self->zs);
+#ifdef PROMHTTP_ZSTD
+    if (self->encoding == PROMHTTP_ENCODING_ZSTD) ZSTD_freeCCtx(self->cctx);
+#endif
+  }
+  prom_collector_registry_stream_destroy(self->stream);
+  self->stream = NULL;
+  prom_free(self->in);
+  self->in = NULL;
+  prom_free(self);
+}
+
+/**
+ * @brief Constructs a promhttp_compressed_stream_t* that takes ownership of the given registry stream. Returns NULL
+ * upon failure, in which case the registry stream is destroyed.
+ */
+static promhttp_compressed_stream_t *promhttp_compressed_stream_new(prom_collector_registry_stream_t *stream,
+                                                                    promhttp_encoding_t encoding) {
+  promhttp_compressed_stream_t *self =
+      (promhttp_compressed_stream_t *)prom_malloc(sizeof(promhttp_compressed_stream_t));
+  memset(self, 0, sizeof(promhttp_compressed_stream_t));
+  self->stream = stream;
+  self->encoding = encoding;
+  self->in_size = PROMHTTP_STREAM_BLOCK_SIZE;
+  if (self->in_size < promhttp_compression_min_size) self->in_size = promhttp_compression_min_size;
+  self->in = (char *)prom_malloc(self->in_size);
+  if (self->in == NULL) {
+    promhttp_compressed_stream_destroy(self);
+    return NULL;
+  }
+
+  int level = promhttp_compression_level;
+  if (encoding == PROMHTTP_ENCODING_GZIP) {
+    if (level < 0) level = Z_DEFAULT_COMPRESSION;
+    if (deflateInit2(&self->zs, level, Z_DEFLATED, PROMHTTP_GZIP_WINDOW_BITS, PROMHTTP_GZIP_MEM_LEVEL,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      promhttp_compressed_stream_destroy(self);
+      return NULL;
+    }
+    self->initialized = true;
+  }
+#ifdef PROMHTTP_ZSTD
+  if (encoding == PROMHTTP_ENCODING_ZSTD) {
+    if (level < 0) level = ZSTD_CLEVEL_DEFAULT;
+    self->cctx = ZSTD_createCCtx();
+    if (self->cctx == NULL) {
+      promhttp_compressed_stream_destroy(self);
+      return NULL;
+    }
+    self->initialized = true;
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(self->cctx, ZSTD_c_compressionLevel, level))) {
+      promhttp_compressed_stream_destroy(self);
+      return NULL;
+    }
+  }
+#endif
+  return self;
+}
+
+/**
+ * @brief Reads the next block of the exposition into the unused space of in, discarding input already consumed by the
+ * compressor. Sets in_done at the end of the exposition.
+ */
+static int promhttp_compressed_stream_fill(promhttp_compressed_stream_t *self) {
+  if (self->in_pos == self->in_len) {
+    self->in_pos = 0;
+    self->in_len = 0;
+  }
+  size_t len = 0;
+  if (prom_collector_registry_stream_read(self->stream, self->in + self->in_len, self->in_size - self->in_len, &len)) {
+    return 1;
+  }
+  if (len == 0) self->in_done = true;
+  self->in_len += len;
+  return 0;
+}
+
+/**
+ * @brief Runs the compressor over the pending input, writing at most size bytes to buf. The compressor is asked to
+ * finish once the exposition has been read in full.
+ */
+static int promhttp_compressed_stream_compress(promhttp_compressed_stream_t *self, char *buf, size_t size,
+                                               size_t *produced) {
+  if (self->encoding == PROMHTTP_ENCODING_GZIP) {
+    self->zs.next_in = (Bytef *)(self->in + self->in_pos);
+    self->zs.avail_in = (uInt)(self->in_len - self->in_pos);
+    self->zs.next_out = (Bytef *)buf;
+    self->zs.avail_out = (uInt)size;
+    int r = deflate(&self->zs, self->in_done ? Z_FINISH : Z_NO_FLUSH);
+    if (r == Z_STREAM_END) {
+      self->finished = true;
+    } else if (r != Z_OK && r != Z_BUF_ERROR) {
+      return 1;
+    }
+    self->in_pos = self->in_len - self->zs.avail_in;
+    *produced = size - self->zs.avail_out;
+    return 0;
+  }
+#ifdef PROMHTTP_ZSTD
+  if (self->encoding == PROMHTTP_ENCODING_ZSTD) {
+    ZSTD_inBuffer input = {self->in + self->in_pos, self->in_len - self->in_pos, 0};
+    ZSTD_outBuffer output = {buf, size, 0};
+    size_t r = ZSTD_compressStream2(self->cctx, &output, &input, self->in_done ? ZSTD_e_end : ZSTD_e_continue);
+    if (ZSTD_isError(r)) return 1;
+    if (self->in_done && r == 0) self->finished = true;
+    self->in_pos += input.pos;
+    *produced = output.pos;
+    return 0;
+  }
+#endif
+  return 1;
+}
+
+static ssize_t promhttp_compressed_stream_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  promhttp_compressed_stream_t *self = (promhttp_compressed_stream_t *)cls;
+  size_t len = 0;
+  while (len < max && !self->finished) {
+    if (self->in_pos == self->in_len && !self->in_done) {
+      if (promhttp_compressed_stream_fill(self)) return MHD_CONTENT_READER_END_WITH_ERROR;
+      continue;
+    }
+    size_t produced = 0;
+    if (promhttp_compressed_stream_compress(self, buf + len, max - len, &produced)) {
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    len += produced;
+  }
+  if (len == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+  return (ssize_t)len;
+}
+
+static void promhttp_compressed_stream_free(void *cls) {
+  promhttp_compressed_stream_destroy((promhttp_compressed_stream_t *)cls);
+}
+
+static ssize_t promhttp_stream_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  prom_collector_registry_stream_t *stream = (prom_collector_registry_stream_t *)cls;
+  size_t len = 0;
+  if (prom_collector_registry_stream_read(stream, buf, max, &len)) return MHD_CONTENT_READER_END_WITH_ERROR;
+  if (len == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+  return (ssize_t)len;
+}
+
+static void promhttp_stream_free(void *cls) {
+  prom_collector_registry_stream_t *stream = (prom_collector_registry_stream_t *)cls;
+  prom_collector_registry_stream_destroy(stream);
+}
+
+/**
+ * @brief Creates the response for a metrics request. The exposition is rendered metric by metric as libmicrohttpd
+ * drains the response and, if a content coding was negotiated, compressed on the way out. Returns NULL upon failure.
+ */
+static struct MHD_Response *promhttp_create_metrics_response(prom_collector_registry_stream_t *stream,
+                                                             promhttp_encoding_t encoding) {
+  struct MHD_Response *response = NULL;
+
+  if (encoding == PROMHTTP_ENCODING_IDENTITY) {
+    response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, PROMHTTP_STREAM_BLOCK_SIZE, &promhttp_stream_reader,
+                                                 stream, &promhttp_stream_free);
+    if (response == NULL) prom_collector_registry_stream_destroy(stream);
+    return response;
+  }
+
+  promhttp_compressed_stream_t *compressed = promhttp_compressed_stream_new(stream, encoding);
+  if (compressed == NULL) return NULL;
+
+  // Read ahead up to the minimum size. Expositions that end before reaching it are not worth compressing.
+  while (!compressed->in_done && compressed->in_len < promhttp_compression_min_size) {
+    if (promhttp_compressed_stream_fill(compressed)) {
+      promhttp_compressed_stream_destroy(compressed);
+      return NULL;
+    }
+  }
+  if (compressed->in_done && compressed->in_len < promhttp_compression_min_size) {
+    response = MHD_create_response_from_buffer(compressed->in_len, compressed->in, MHD_RESPMEM_MUST_COPY);
+    promhttp_compressed_stream_destroy(compressed);
+    return response;
+  }
+
+  response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, PROMHTTP_STREAM_BLOCK_SIZE,
+                                               &promhttp_compressed_stream_reader, compressed,
+                                               &promhttp_compressed_stream_free);
+  if (response == NULL) {
+    promhttp_compressed_stream_destroy(compressed);
+    return NULL;
+  }
+  MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, promhttp_encoding_names[encoding]);
+  return response;
+}
+
 int promhttp_handler(void *cls, struct MHD_Connection *connection, const char *url, const char *method,
                      const char *version, const char *upload_data, size_t *upload_data_size, void **con_cls) {
   if (strcmp(method, "GET") != 0) {
@@ -46,8 +433,14 @@ int promhttp_handler(void *cls, struct MHD_Connection *connection, const char *u
     return ret;
   }
   if (strcmp(url, "/metrics") == 0) {
-    const char *buf = prom_collector_registry_bridge(PROM_ACTIVE_REGISTRY);
-    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(buf), (void *)buf, MHD_RESPMEM_MUST_FREE);
+    // The stream is destroyed along with the response once it is complete
+    prom_exposition_format_t format = promhttp_negotiate_format(connection);
+    prom_collector_registry_stream_t *stream = prom_collector_registry_stream_new_format(PROM_ACTIVE_REGISTRY, format);
+    if (stream == NULL) return MHD_NO;
+    struct MHD_Response *response = promhttp_create_metrics_response(stream, promhttp_negotiate_encoding(connection));
+    if (response == NULL) return MHD_NO;
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, promhttp_content_types[format]);
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, "Accept, Accept-Encoding");
     int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
     MHD_destroy_response(response);
     return ret;
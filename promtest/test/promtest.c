@@ -15,6 +15,7 @@
  */
 
 #include "promtest_counter.h"
+#include "promtest_counter_sharded.h"
 #include "promtest_gauge.h"
 #include "promtest_histogram.h"
 #include "promtest_helpers.h"
@@ -25,5 +26,6 @@ int main(int argc, const char **argv) {
   RUN_TEST(promtest_counter);
   RUN_TEST(promtest_gauge);
   RUN_TEST(promtest_histogram);
+  RUN_TEST(promtest_counter_sharded);
   return UNITY_END();
 }
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2019-2020 DigitalOcean Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "promtest_counter_sharded.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "prom.h"
+#include "unity.h"
+
+#define PROMTEST_COUNTER_SHARDED_INCREMENTS 2000000
+#define PROMTEST_COUNTER_SHARDED_MAX_THREADS 64
+
+static void *promtest_counter_sharded_handler(void *data);
+static double promtest_counter_sharded_run(prom_counter_t *counter, int thread_count);
+
+/**
+ * @brief Compares the throughput of a plain counter to that of a sharded counter as the number of threads incrementing
+ * a single sample grows from 1 to the number of CPUs.
+ *
+ * Each thread increments the sample PROMTEST_COUNTER_SHARDED_INCREMENTS times. The increments per second for each
+ * thread count are printed, and the final value of each counter is checked via the registry bridge.
+ */
+void promtest_counter_sharded(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = 1;
+  if (cpus > PROMTEST_COUNTER_SHARDED_MAX_THREADS) {
+    max_threads = PROMTEST_COUNTER_SHARDED_MAX_THREADS;
+  } else if (cpus > 1) {
+    max_threads = (int)cpus;
+  }
+
+  printf("%8s %20s %20s\n", "threads", "plain inc/s", "sharded inc/s");
+  for (int thread_count = 1;; thread_count = (thread_count * 2 > max_threads) ? max_threads : thread_count * 2) {
+    prom_collector_registry_t *registry = prom_collector_registry_new("promtest_counter_sharded");
+    prom_collector_t *collector = prom_collector_new("promtest_counter_sharded");
+    prom_counter_t *plain = prom_counter_new("plain_counter", "plain counter", 0, NULL);
+    prom_counter_t *sharded = prom_counter_new_sharded("sharded_counter", "sharded counter", 0, NULL);
+    if (prom_collector_add_metric(collector, plain) || prom_collector_add_metric(collector, sharded) ||
+        prom_collector_registry_register_collector(registry, collector)) {
+      TEST_FAIL_MESSAGE("failed to setup promtest_counter_sharded");
+    }
+
+    double plain_rate = promtest_counter_sharded_run(plain, thread_count);
+    double sharded_rate = promtest_counter_sharded_run(sharded, thread_count);
+    printf("%8d %20.0f %20.0f\n", thread_count, plain_rate, sharded_rate);
+
+    char expected[64];
+    const char *output = prom_collector_registry_bridge(registry);
+    snprintf(expected, sizeof(expected), "\nplain_counter %d\n", thread_count * PROMTEST_COUNTER_SHARDED_INCREMENTS);
+    TEST_ASSERT_NOT_NULL(strstr(output, expected));
+    snprintf(expected, sizeof(expected), "\nsharded_counter %d\n", thread_count * PROMTEST_COUNTER_SHARDED_INCREMENTS);
+    TEST_ASSERT_NOT_NULL(strstr(output, expected));
+    free((void *)output);
+
+    prom_collector_registry_destroy(registry);
+    if (thread_count == max_threads) break;
+  }
+}
+
+/**
+ * @brief Increments counter from thread_count threads and returns the aggregate increments per second
+ */
+static double promtest_counter_sharded_run(prom_counter_t *counter, int thread_count) {
+  pthread_t thread_pool[PROMTEST_COUNTER_SHARDED_MAX_THREADS];
+  prom_counter_child_t *child = prom_counter_with_labels(counter, NULL);
+  if (child == NULL) TEST_FAIL_MESSAGE("failed to resolve counter child");
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < thread_count; i++) {
+    if (pthread_create(&(thread_pool[i]), NULL, promtest_counter_sharded_handler, child)) {
+      TEST_FAIL_MESSAGE("failed to create thread");
+    }
+  }
+  for (int i = 0; i < thread_count; i++) {
+    if (pthread_join(thread_pool[i], NULL)) {
+      TEST_FAIL_MESSAGE("thread failed to join");
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  return (double)thread_count * PROMTEST_COUNTER_SHARDED_INCREMENTS / elapsed;
+}
+
+/**
+ * @brief The entrypoint to a worker thread within promtest_counter_sharded
+ */
+static void *promtest_counter_sharded_handler(void *data) {
+  prom_counter_child_t *child = (prom_counter_child_t *)data;
+  for (int i = 0; i < PROMTEST_COUNTER_SHARDED_INCREMENTS; i++) {
+    prom_counter_child_inc(child);
+  }
+  return NULL;
+}